@@ -10,6 +10,20 @@
 //~ uint16_t angleLookup[5000];
 #include "lookup_table.c"
 
+#if defined(TELEMETRY_MUX)
+//shared with the ground station, built in here so it's compiled for the avr
+#include "telemetryMux.c"
+struct telemetryMux telemetry;
+uint8_t telemetry_frame[TELEMETRY_MUX_MAX_FRAME_LENGTH];
+int16_t telemetry_state[TELEMETRY_MUX_FIELDS];
+#elif defined(TELEMETRY_CODED)
+//shared with the ground station, built in here so it's compiled for the avr
+#include "telemetryCodec.c"
+struct telemetryEncoder telemetry;
+uint8_t telemetry_frame[TELEMETRY_MAX_FRAME_LENGTH];
+volatile uint8_t telemetry_ctr = 0;
+#endif
+
 #define ACCEL_BUFFER_LENGTH 1000
 #define GYRO_SUM_TIME 500
 
@@ -63,6 +77,7 @@ volatile struct pid_info pitch_pid;
 volatile struct pid_info yaw_pid;
 
 volatile struct fcu_pkt_t fcu_tx;
+volatile uint16_t fcu_tick = 0;     //ms since power up, wraps every 65 seconds
 
 volatile float roll;
 volatile float pitch;
@@ -252,6 +267,49 @@ void print_status(void)
         stdout = tmp;
     }
 }
+
+#if defined(TELEMETRY_MUX)
+int16_t telemetry_clamp(float value)
+{
+    if(value > 32767)
+        return 32767;
+    if(value < -32768)
+        return -32768;
+    return (int16_t)value;
+}
+
+//the latest of every telemetry field, in TELEMETRY_PACKET_FIELDS order (see packetSchema.h)
+void telemetry_fill_state(void)
+{
+    int16_t * s = telemetry_state;
+    *s++ = fcu_tx.x_gyro;       //gyro
+    *s++ = fcu_tx.y_gyro;
+    *s++ = fcu_tx.z_gyro;
+    *s++ = fcu_tx.roll;         //attitude
+    *s++ = fcu_tx.pitch;
+    *s++ = fcu_tx.yaw;
+    *s++ = fcu_tx.x_accel;      //accel
+    *s++ = fcu_tx.y_accel;
+    *s++ = fcu_tx.z_accel;
+    *s++ = fcu_tx.motor1;       //motors
+    *s++ = fcu_tx.motor2;
+    *s++ = fcu_tx.motor3;
+    *s++ = fcu_tx.motor4;
+    *s++ = fcu_tx.rollTarget;   //targets
+    *s++ = fcu_tx.pitchTarget;
+    *s++ = fcu_tx.yawTarget;
+    *s++ = telemetry_clamp(roll_pid.prev_error);    //pid
+    *s++ = telemetry_clamp(roll_pid.i);
+    *s++ = telemetry_clamp(roll_pid_output);
+    *s++ = telemetry_clamp(pitch_pid.prev_error);
+    *s++ = telemetry_clamp(pitch_pid.i);
+    *s++ = telemetry_clamp(pitch_pid_output);
+    *s++ = telemetry_clamp(yaw_pid.prev_error);
+    *s++ = telemetry_clamp(yaw_pid.i);
+    *s++ = telemetry_clamp(yaw_pid_output);
+    *s++ = telemetry_clamp(bat_voltage_human*1000); //battery
+}
+#endif
  
 void process_rx_buf(volatile char * rx_buf)
 {
@@ -273,6 +331,8 @@ void process_rx_buf(volatile char * rx_buf)
             \r\tkp <float> - set kp\n\r\
             \r\tki <float> - set ki\n\r\
             \r\tkd <float> - set kd\n\r\
+            \r\trate_<channel> <hz> - telemetry channel rate, 0 is off\n\r\
+            \r\tprio_<channel> <n> - telemetry channel priority, lower goes first\n\r\
             \r\thelp - print this message\n\r";
     if(cmd[0] == '\0') { } //do nothing
     else if(strcmp(cmd, "reboot") == 0) { printf("\n\rrebooting..."); CCPWrite(&RST_CTRL, RST_SWRST_bm); }
@@ -342,6 +402,10 @@ void process_rx_buf(volatile char * rx_buf)
     else if(strcmp(cmd, "request_imu") == 0) { request_imu_pkt(); }
     else if(strcmp(cmd, "init_imu_rx") == 0) { init_imu_rx_pkt(&imu_rx); }
     else if(strcmp(cmd, "stream") == 0) { stream_data_flag ^= 1; }
+#if defined(TELEMETRY_MUX)
+    else if(strncmp(cmd, "rate_", 5) == 0 && val >= 0 && telemetryMuxSetRate(&telemetry, cmd + 5, (uint16_t)val) == 0) { }
+    else if(strncmp(cmd, "prio_", 5) == 0 && val >= 0 && telemetryMuxSetPriority(&telemetry, cmd + 5, (uint8_t)val) == 0) { }
+#endif
     else { printf("\n\rcommand not found: %s", cmd); }
 }
 
@@ -363,7 +427,10 @@ ISR(SPIE_INT_vect)
         if(receive_imu_pkt_flag == 1)
         {
             char * ptr = (char *)&imu_rx;
-            ptr[imu_rx_index] = SPIE.DATA;
+            char data = SPIE.DATA;
+            //the imu sends high byte first, put each byte where the avr wants it so nothing needs swapping
+            if(imu_rx_index < sizeof(struct imu_rx_pkt_t))
+                ptr[IMU_PACKET_SPI_SLOT(imu_rx_index)] = data;
             imu_rx_index++;
             if(imu_rx_index > sizeof(struct imu_rx_pkt_t))
             {
@@ -371,16 +438,7 @@ ISR(SPIE_INT_vect)
                 PORTB.OUTSET = 1<<SS1;
 
                 real_imu_parity = parity_byte(&imu_rx, sizeof(struct imu_rx_pkt_t)/2 -1);
-                
-                //reverse order of bytes
-                int i;
-                char tmp;
-                for(i = 2; i < sizeof(struct imu_rx_pkt_t); i+=2)
-                {
-                    tmp = ptr[i];
-                    ptr[i] = ptr[i+1];
-                    ptr[i+1] = tmp;
-                }
+
                 fcu_tx.x_gyro = imu_rx.roll;
                 imu_rx.roll += ROLL_OFFSET;
                 //fcu_tx.roll = imu_rx.roll;
@@ -412,8 +470,45 @@ ISR(SPIE_INT_vect)
                 y_accel_buf_ctr++;
                 z_accel_buf_ctr++;
 
+#if defined(TELEMETRY_MUX)
+                //every packet is a tick, the mux decides what's due and sends it if the xbee has room
+                if(stream_data_flag)
+                {
+                    telemetry_fill_state();
+                    int length = telemetryMuxTick(&telemetry, telemetry_state, fcu_tick, telemetry_frame);
+                    FILE * tmp_ptr = stdout;
+                    stdout = &xbee_out;
+                    int j;
+                    for(j = 0; j < length; j++)
+                    {
+                        printf("%c", telemetry_frame[j]);
+                    }
+                    stdout = tmp_ptr;
+                }
+#elif defined(TELEMETRY_CODED)
+                //every TELEMETRY_DECIMATION'th packet goes into the codec, a block goes out whenever one fills
+                if(stream_data_flag && ++telemetry_ctr >= TELEMETRY_DECIMATION)
+                {
+                    fcu_tx.tick = fcu_tick;
+                    int length = telemetryEncoderAdd(&telemetry, (const int16_t *)&fcu_tx.x_gyro, telemetry_frame);
+                    fcu_tx.sequence++;
+                    FILE * tmp_ptr = stdout;
+                    stdout = &xbee_out;
+                    int j;
+                    for(j = 0; j < length; j++)
+                    {
+                        printf("%c", telemetry_frame[j]);
+                    }
+                    stdout = tmp_ptr;
+                    telemetry_ctr = 0;
+                }
+#else
                 if(stream_data_flag && loop_ctr == 100)
                 {
+                    //stamped so the ground station can tell what was lost and when it was sent
+                    fcu_tx.tick = fcu_tick;
+                    //parity over everything after start/parity, the ground station checks it
+                    fcu_tx.parity = parity_byte((uint16_t *)&fcu_tx.x_gyro, (sizeof(struct fcu_pkt_t)-2)/2);
                     char * fcu_ptr = (char *)&fcu_tx;
                     FILE * tmp_ptr = stdout;
                     //stdout = &usb_out;
@@ -424,8 +519,10 @@ ISR(SPIE_INT_vect)
                         printf("%c", fcu_ptr[j]);
                     }
                     stdout = tmp_ptr;
+                    fcu_tx.sequence++;
                     loop_ctr = 0;
                 }
+#endif
             }
             else
                 SPIE.DATA = 0;
@@ -485,6 +582,12 @@ ISR(SPIE_INT_vect)
     }
 }
 
+/***** tick *****/
+ISR(TCE0_OVF_vect)
+{
+    fcu_tick++;
+}
+
 /***** xbee *****/
 ISR(USARTF0_TXC_vect)
 {
@@ -605,9 +708,15 @@ int main (void)
 
     init_imu_tx_pkt(&imu_tx);
     init_imu_rx_pkt(&imu_rx);
+#if defined(TELEMETRY_MUX)
+    telemetryMuxInit(&telemetry, TELEMETRY_TICK_RATE, TELEMETRY_LINK_BYTES);
+#elif defined(TELEMETRY_CODED)
+    telemetryEncoderInit(&telemetry, (sizeof(struct fcu_pkt_t)-2)/2);
+#endif
 
     uint8_t loop_count = 0;
 
+    init_tick();
     sei();
 
     /************** Main Loop ***************/
@@ -17,6 +17,8 @@
 #include "adc_driver.h"
 #include "pid.h"
 #include "parity_byte.h"
+#include "tcnt.h"
+#include "packetSchema.h"
 
 //#include "/usr/lib/avr/include/avr/iox128a3.h"
 
@@ -47,6 +49,24 @@
 #define IMU_RX_START    0xAA
 //AA
 
+//telemetry goes out as raw fcu_pkt_t's unless one of these is uncommented, so a
+//plain build talks to a plain "graph <port>".  with neither, every frame is
+//stamped with its sequence and tick.
+//
+//uncomment to send telemetry channels through the mux (software/gui/telemetryMux.h),
+//each at its own rate and never more than the xbee can carry.  the ground station
+//sets rates with "rate_<channel> <hz>".  run it as "graph <port> mux"
+//#define TELEMETRY_MUX
+#define TELEMETRY_TICK_RATE 500     //imu packets a second, a rough figure.  channel rates are only as good as this
+#define TELEMETRY_LINK_BYTES 5760   //bytes a second at 57600 baud
+
+//or uncomment to send telemetry through the codec (software/gui/telemetryCodec.h)
+//instead of raw fcu_pkt_t's.  a coded sample is a third to a quarter of the bytes,
+//so 4 times as many fit down the xbee.  run the ground station as "graph <port> coded".
+//the mux wins if both are uncommented
+//#define TELEMETRY_CODED
+#define TELEMETRY_DECIMATION 25 //imu packets per telemetry sample, the raw stream went out about every 100
+
 //#define ROLL_OFFSET     610
 #define ROLL_OFFSET     622
 //#define PITCH_OFFSET    -304
@@ -93,43 +113,9 @@ struct imu_tx_pkt_t
     volatile uint16_t start;
 };
 
-struct imu_rx_pkt_t
-{
-    volatile uint8_t start;
-    volatile uint8_t parity;
-    volatile int16_t roll;
-    volatile int16_t pitch_tmp;
-    volatile int16_t pitch;
-    volatile int16_t yaw;
-    volatile int16_t yaw_tmp;
-    volatile int16_t z_accel;
-    volatile int16_t x_accel;
-    volatile int16_t y_accel;
-};
-
-struct fcu_pkt_t
-{
-    volatile uint8_t start;
-    volatile uint8_t parity;
-    volatile int16_t x_gyro;
-    volatile int16_t x_gyro_tmp;
-    volatile int16_t y_gyro;
-    volatile int16_t z_gyro;
-    volatile int16_t z_gyro_tmp;
-    volatile int16_t z_accel;
-    volatile int16_t x_accel;
-    volatile int16_t y_accel;
-    volatile int16_t roll;
-    volatile int16_t pitch;
-    volatile int16_t yaw;
-    volatile int16_t rollTarget;
-    volatile int16_t pitchTarget;
-    volatile int16_t yawTarget;
-    volatile int16_t motor1;
-    volatile int16_t motor2;
-    volatile int16_t motor3;
-    volatile int16_t motor4;
-};
+// layouts come from the shared schema (software/gui/packetSchema.h)
+PACKET_STRUCT(imu_rx_pkt_t, IMU_PACKET_FIELDS);
+PACKET_STRUCT(fcu_pkt_t, FCU_PACKET_FIELDS);
 
 /* Function Prototypes */
 void init_mcu_tx_pkt(volatile struct mcu_tx_pkt_t * pkt);
@@ -143,3 +129,5 @@ void send_mcu_pkt();
 void print_imu_pkts(volatile struct imu_tx_pkt_t * tx_pkt, volatile struct imu_rx_pkt_t * rx_pkt);
 
 void process_rx_buf(volatile char * rx_buf);
+int16_t telemetry_clamp(float value);
+void telemetry_fill_state(void);
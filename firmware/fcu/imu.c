@@ -10,7 +10,7 @@ void init_imu_tx_pkt(volatile struct imu_tx_pkt_t * pkt)
 void init_imu_rx_pkt(volatile struct imu_rx_pkt_t * pkt)
 {
     pkt->start = 2;
-    pkt->chksum = 2;
+    pkt->parity = 2;
     pkt->pitch_tmp = 2;
     pkt->pitch = 2;
     pkt->yaw = 2;
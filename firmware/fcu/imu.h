@@ -1,3 +1,7 @@
+// not built (imu.c isn't in the makefile's PRJSRC), fcu.c does all of this
+// itself with the structs from fcu.h
+#include "packetSchema.h"
+
 #define IMU_START 0xFACE
 
 /* Function Prototypes */
@@ -10,16 +14,4 @@ struct imu_tx_pkt_t
     volatile uint16_t start;
 };
 
-struct imu_rx_pkt_t
-{
-    volatile uint8_t start;
-    volatile uint8_t chksum;
-    volatile int16_t pitch_tmp;
-    volatile int16_t pitch;
-    volatile int16_t yaw;
-    volatile int16_t yaw_tmp;
-    volatile int16_t z_accel;
-    volatile int16_t y_accel;
-    volatile int16_t x_accel;
-    volatile int16_t roll;
-};
+PACKET_STRUCT(imu_rx_pkt_t, IMU_PACKET_FIELDS);
@@ -28,3 +28,13 @@ void init_tcnt()
        */
 
 }
+
+//TCE0 overflows at 1kHz and fcu.c counts it in fcu_tick, the
+//clock telemetry frames are stamped with (PACKET_TICK_HZ in packetSchema.h)
+void init_tick()
+{
+    TCE0.CTRLA = TC_CLKSEL_DIV64_gc;
+    TCE0.CTRLB = TC_WGMODE_NORMAL_gc;
+    TCE0.PER = 499; //32MHz/64/500, PACKET_TICK_HZ
+    TCE0.INTCTRLA = TC_OVFINTLVL_LO_gc;
+}
@@ -1 +1,2 @@
 void init_tcnt();
+void init_tick();
@@ -4,6 +4,7 @@
 #include "DSP28x_Project.h"
 #include "CLAShared.h"
 #include <stdlib.h>
+#include "../../../../software/gui/packetSchema.h"
 
 enum PACKET_TYPE{ RAW_SENSOR_DATA, EULER_ANGLES, STATUS};
 
@@ -23,19 +24,17 @@ enum PACKET_TYPE{ RAW_SENSOR_DATA, EULER_ANGLES, STATUS};
 #define SPIA_CHAR_LNGTH_MSK 0x0F //16-bit
 #define SPIB_CHAR_LNGTH_MSK 0x0F //16-bit
 #define FCU_START 0xFACE
+#define SENSOR_COUNT PACKET_FIELD_COUNT(IMU_PACKET_FIELDS)
 
+//one int per field of the imu packet, in the order the schema puts them on the wire.
+//the adc isr fills sensor[] by index, so the schema order is also the adc channel order.
+//int is 16 bits here, the same as the INT16 fields.
+#define SENSOR_MEMBER(type, name, label) int name;
 struct SENSOR_VALUES {
-	int roll;
-	int	pitch_temp;
-	int pitch;
-	int yaw;
-	int yaw_temp;
-	int z_accel;
-	int x_accel;
-	int y_accel;
+	IMU_PACKET_FIELDS(SENSOR_MEMBER)
 };
 union SENSOR_DATA {
-	int	sensor[8];
+	int	sensor[SENSOR_COUNT];
 	struct SENSOR_VALUES value;
 };
 
@@ -25,7 +25,7 @@ void make_fcu_packet(volatile struct FCU_PACKET * fcu_pkt)
 	//fill the fcu_pkt->data array.
 	switch(fcu_pkt->type){
 		case RAW_SENSOR_DATA:
-			for(i=0;i<8;i++){
+			for(i=0;i<SENSOR_COUNT;i++){
 				fcu_pkt->data[i+1] = sensors.sensor[i];	
 			}
 			break;
@@ -55,7 +55,7 @@ void init_fcu_packet(volatile struct FCU_PACKET * fcu_pkt, enum PACKET_TYPE type
 		default:
 			break;	
 	}
-	fcu_pkt->data[0] = 0xAA00;
+	fcu_pkt->data[0] = PACKET_START_BYTE << 8;
 	fcu_pkt->type = type;	
 	make_fcu_packet(fcu_pkt);
 	fcu_pkt->data[0] ^= 0x000F; //mess up parity_byte, so fcu knows data isn't valid yet.
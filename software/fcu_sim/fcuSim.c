@@ -0,0 +1,348 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <termios.h>
+
+#include "fcuSim.h"
+#include "frameDecoder.h"
+
+static uint64_t fcuSimRandom (struct fcuSim* sim);
+static double fcuSimUniform (struct fcuSim* sim);
+static double fcuSimGaussian (struct fcuSim* sim);
+static int16_t fcuSimValue (struct fcuSim* sim, double value);
+static int fcuSimWrite (struct fcuSim* sim, int fd, const uint8_t* data, int length, volatile int* running);
+static void fcuSimRead (struct fcuSim* sim, int fd);
+
+void fcuSimDefaults (struct fcuSimSettings* settings) {
+	memset(settings, 0, sizeof(struct fcuSimSettings));
+	settings->packet = FCU_SIM_FCU;
+	settings->rate = 100;
+}
+
+// one of FCU_SIM_OPTIONS from getopt.  returns non zero if it's bad
+int fcuSimOption (struct fcuSimSettings* settings, int option, const char* value) {
+	switch (option) {
+		case 'p':
+			if (strcmp(value, "fcu") == 0)
+				settings->packet = FCU_SIM_FCU;
+			else if (strcmp(value, "imu") == 0)
+				settings->packet = FCU_SIM_IMU;
+			else
+				return -1;
+			return 0;
+		case 'r': settings->rate = (strcmp(value, "max") == 0) ? 0 : atof(value); return settings->rate < 0;
+		case 'n': settings->noise = atof(value); return 0;
+		case 'e': settings->bitErrorRate = atof(value); return 0;
+		case 'd': settings->dropRate = atof(value); return 0;
+		case 'f': settings->falseStartRate = atof(value); return 0;
+		case 's': settings->seed = strtoul(value, NULL, 0); return 0;
+		case 'c': settings->coded = 1; return 0;
+		case 'm': settings->muxed = 1; return 0;
+	}
+	return -1;
+}
+
+void fcuSimInit (struct fcuSim* sim, const struct fcuSimSettings* settings) {
+	memset(sim, 0, sizeof(struct fcuSim));
+	sim->settings = *settings;
+	sim->frameLength = (settings->packet == FCU_SIM_IMU) ? IMU_PACKET_LENGTH : FCU_PACKET_LENGTH;
+	sim->random = settings->seed ? settings->seed : 88172645463325252ULL;
+	if ((settings->coded || settings->muxed) && settings->packet == FCU_SIM_IMU) {
+		fprintf(stderr, "the IMU doesn't code or mux its packets, sending them raw\n");
+		sim->settings.coded = 0;
+		sim->settings.muxed = 0;
+	}
+	if (sim->settings.coded && sim->settings.muxed) {
+		fprintf(stderr, "the FCU codes or muxes, not both, muxing\n");
+		sim->settings.coded = 0;
+	}
+	telemetryEncoderInit(&sim->encoder, FCU_FIELD_COUNT);
+	telemetryMuxInit(&sim->mux, (settings->rate > 0 && settings->rate < 65536) ? (uint16_t) settings->rate : 1000, FCU_SIM_MUX_LINK_BYTES);
+}
+
+// the next frame, as it would come down the wire, into buffer (which needs
+// room for FCU_SIM_MAX_BUILD_LENGTH).  returns the number of bytes, coded
+// that's 0 until a block fills and muxed it's 0 when nothing was due
+int fcuSimBuild (struct fcuSim* sim, uint8_t* buffer) {
+	uint8_t frame[TELEMETRY_MAX_FRAME_LENGTH];
+	double t = sim->flightTime;
+	double roll = 3000*sin(0.5*t), pitch = 2000*sin(0.31*t + 1), yaw = 8000*sin(0.05*t);
+	double byteErrorRate = 1 - pow(1 - sim->settings.bitErrorRate, 8);
+	int damaged = 0, length = 0, frameLength = sim->frameLength, samples = 1, i;
+
+	memset(frame, 0, sizeof(frame));
+	if (sim->settings.packet == FCU_SIM_IMU) {
+		struct imu_rx_pkt_t* packet = (struct imu_rx_pkt_t*) frame;
+		packet->roll = fcuSimValue(sim, roll);
+		packet->pitch = fcuSimValue(sim, pitch);
+		packet->yaw = fcuSimValue(sim, yaw);
+		packet->x_accel = fcuSimValue(sim, 600*sin(0.5*t));
+		packet->y_accel = fcuSimValue(sim, 600*sin(0.31*t + 1));
+		packet->z_accel = fcuSimValue(sim, 16384);
+	} else {
+		struct fcu_pkt_t* packet = (struct fcu_pkt_t*) frame;
+		packet->x_gyro = fcuSimValue(sim, 1500*cos(0.5*t));
+		packet->y_gyro = fcuSimValue(sim, 620*cos(0.31*t + 1));
+		packet->z_gyro = fcuSimValue(sim, 400*cos(0.05*t));
+		packet->x_accel = fcuSimValue(sim, 600*sin(0.5*t));
+		packet->y_accel = fcuSimValue(sim, 600*sin(0.31*t + 1));
+		packet->z_accel = fcuSimValue(sim, 16384);
+		packet->roll = fcuSimValue(sim, roll);
+		packet->pitch = fcuSimValue(sim, pitch);
+		packet->yaw = fcuSimValue(sim, yaw);
+		packet->rollTarget = fcuSimValue(sim, 3000*sin(0.5*t + 0.2));
+		packet->pitchTarget = fcuSimValue(sim, 2000*sin(0.31*t + 1.2));
+		packet->yawTarget = fcuSimValue(sim, 8000*sin(0.05*t + 0.2));
+		packet->motor1 = fcuSimValue(sim, 1500 + roll/20);
+		packet->motor2 = fcuSimValue(sim, 1500 - roll/20);
+		packet->motor3 = fcuSimValue(sim, 1500 + pitch/20);
+		packet->motor4 = fcuSimValue(sim, 1500 - pitch/20);
+		packet->sequence = sim->sequence++;
+		packet->tick = (uint16_t)(uint64_t)(t*PACKET_TICK_HZ);
+	}
+	frame[0] = FRAME_DECODER_START_BYTE;
+	frame[1] = frameDecoderParity(frame, sim->frameLength);
+
+	// the fields are little endian int16s straight after start and parity, just like the FCU's memory
+	if (sim->settings.coded) {
+		int16_t sample[FCU_FIELD_COUNT];
+		memcpy(sample, frame + 2, sizeof(sample));
+		samples = sim->encoder.count + 1;
+		frameLength = telemetryEncoderAdd(&sim->encoder, sample, frame);
+		samples -= sim->encoder.count;
+	} else if (sim->settings.muxed) {
+		// the mux takes the latest of every channel each tick and sends what's due
+		struct fcu_pkt_t* packet = (struct fcu_pkt_t*) frame;
+		int16_t state[TELEMETRY_FIELD_COUNT];
+		state[TELEMETRY_FIELD_x_gyro] = packet->x_gyro;
+		state[TELEMETRY_FIELD_y_gyro] = packet->y_gyro;
+		state[TELEMETRY_FIELD_z_gyro] = packet->z_gyro;
+		state[TELEMETRY_FIELD_roll] = packet->roll;
+		state[TELEMETRY_FIELD_pitch] = packet->pitch;
+		state[TELEMETRY_FIELD_yaw] = packet->yaw;
+		state[TELEMETRY_FIELD_x_accel] = packet->x_accel;
+		state[TELEMETRY_FIELD_y_accel] = packet->y_accel;
+		state[TELEMETRY_FIELD_z_accel] = packet->z_accel;
+		state[TELEMETRY_FIELD_motor1] = packet->motor1;
+		state[TELEMETRY_FIELD_motor2] = packet->motor2;
+		state[TELEMETRY_FIELD_motor3] = packet->motor3;
+		state[TELEMETRY_FIELD_motor4] = packet->motor4;
+		state[TELEMETRY_FIELD_rollTarget] = packet->rollTarget;
+		state[TELEMETRY_FIELD_pitchTarget] = packet->pitchTarget;
+		state[TELEMETRY_FIELD_yawTarget] = packet->yawTarget;
+		state[TELEMETRY_FIELD_rollError] = packet->rollTarget - packet->roll;
+		state[TELEMETRY_FIELD_rollIntegral] = fcuSimValue(sim, 200*sin(0.1*t));
+		state[TELEMETRY_FIELD_rollOutput] = fcuSimValue(sim, (packet->rollTarget - packet->roll)/20.0);
+		state[TELEMETRY_FIELD_pitchError] = packet->pitchTarget - packet->pitch;
+		state[TELEMETRY_FIELD_pitchIntegral] = fcuSimValue(sim, 200*sin(0.07*t));
+		state[TELEMETRY_FIELD_pitchOutput] = fcuSimValue(sim, (packet->pitchTarget - packet->pitch)/20.0);
+		state[TELEMETRY_FIELD_yawError] = packet->yawTarget - packet->yaw;
+		state[TELEMETRY_FIELD_yawIntegral] = fcuSimValue(sim, 200*sin(0.03*t));
+		state[TELEMETRY_FIELD_yawOutput] = fcuSimValue(sim, (packet->yawTarget - packet->yaw)/20.0);
+		state[TELEMETRY_FIELD_battery] = fcuSimValue(sim, 12600 - 10*t);
+		frameLength = telemetryMuxTick(&sim->mux, state, packet->tick, frame);
+		samples = (frameLength > 0);
+	}
+
+	// and now break it
+	for (i=0; i<frameLength; i++) {
+		uint8_t byte = frame[i];
+		if (sim->settings.dropRate > 0 && fcuSimUniform(sim) < sim->settings.dropRate) {
+			sim->stats.bytesDropped++;
+			damaged = 1;
+			continue;
+		}
+		if (byteErrorRate > 0 && fcuSimUniform(sim) < byteErrorRate) {
+			byte ^= 1 << (fcuSimRandom(sim) & 7);
+			sim->stats.bitsFlipped++;
+			damaged = 1;
+		}
+		buffer[length++] = byte;
+	}
+	if (sim->settings.falseStartRate > 0 && fcuSimUniform(sim) < sim->settings.falseStartRate) {
+		buffer[length++] = sim->settings.muxed ? TELEMETRY_MUX_START_BYTE : sim->settings.coded ? TELEMETRY_START_BYTE : FRAME_DECODER_START_BYTE;
+		sim->stats.falseStarts++;
+	}
+
+	if (!sim->settings.muxed || frameLength > 0) // a tick with nothing due sent nothing
+		sim->stats.framesSent++;
+	sim->stats.framesDamaged += damaged ? samples : 0;
+	sim->flightTime += (sim->settings.rate > 0) ? 1/sim->settings.rate : 0.001;
+	return length;
+}
+
+// streams frames to fd at the configured rate for seconds (0 for ever) or until
+// *running goes to 0.  fd should be non-blocking.  returns -1 on a write error
+int fcuSimRun (struct fcuSim* sim, int fd, double seconds, volatile int* running) {
+	static uint8_t buffer[FCU_SIM_BATCH*(FCU_SIM_MAX_FRAME_LENGTH+1) + FCU_SIM_MAX_BUILD_LENGTH];
+	double start = fcuSimNow();
+	uint64_t sent = 0;
+
+	while (*running) {
+		double now = fcuSimNow();
+		uint64_t due = sent + FCU_SIM_BATCH;
+		int length = 0;
+
+		if (seconds > 0 && now - start >= seconds)
+			break;
+
+		if (sim->settings.rate > 0) {
+			due = (uint64_t)((now - start)*sim->settings.rate) + 1;
+			if (due > sent + FCU_SIM_BATCH)
+				due = sent + FCU_SIM_BATCH;
+		}
+		for (; sent < due; sent++)
+			length += fcuSimBuild(sim, buffer + length);
+		if (fcuSimWrite(sim, fd, buffer, length, running))
+			return -1;
+		fcuSimRead(sim, fd);
+
+		// sleep until the next frame is due
+		if (sim->settings.rate > 0) {
+			struct timespec wake;
+			double next = start + sent/sim->settings.rate;
+			if (next > fcuSimNow()) {
+				wake.tv_sec = (time_t) next;
+				wake.tv_nsec = (long)((next - wake.tv_sec)*1e9);
+				clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, NULL);
+			}
+		}
+	}
+
+	return 0;
+}
+
+// one line from the ground station, the mux commands the FCU understands
+// ("rate_gyro 100", "prio_pid 1").  returns 0 if it was one of them
+int fcuSimCommand (struct fcuSim* sim, const char* command) {
+	char name[FCU_SIM_COMMAND_LENGTH];
+	float value;
+
+	if (sscanf(command, "rate_%63s %f", name, &value) == 2 && value >= 0)
+		return telemetryMuxSetRate(&sim->mux, name, (uint16_t) value);
+	if (sscanf(command, "prio_%63s %f", name, &value) == 2 && value >= 0)
+		return telemetryMuxSetPriority(&sim->mux, name, (uint8_t) value);
+	return -1;
+}
+
+// a new pseudo-terminal in raw mode.  returns the master fd (non-blocking) and
+// puts the path to give the ground station in slaveName, or -1
+int fcuSimOpenPty (char* slaveName, int slaveNameLength) {
+	struct termios tio;
+	int fd = posix_openpt(O_RDWR | O_NOCTTY);
+
+	if (fd < 0) {
+		perror("\n***** FCU SIM ERROR: posix_openpt failed\n\n");
+		return -1;
+	}
+	if (grantpt(fd) < 0 || unlockpt(fd) < 0 || ptsname_r(fd, slaveName, slaveNameLength) != 0) {
+		perror("\n***** FCU SIM ERROR: couldn't set up the pty\n\n");
+		close(fd);
+		return -1;
+	}
+
+	// the line discipline mustn't touch our bytes before the ground station gets to configure it
+	if (tcgetattr(fd, &tio) == 0) {
+		cfmakeraw(&tio);
+		tcsetattr(fd, TCSANOW, &tio);
+	}
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+	return fd;
+}
+
+void fcuSimPrintStats (const struct fcuSim* sim, double seconds) {
+	printf ("sent %llu frames (%.0f a second, %llu damaged on purpose), %llu bytes\n",
+		(unsigned long long) sim->stats.framesSent, seconds > 0 ? sim->stats.framesSent/seconds : 0,
+		(unsigned long long) sim->stats.framesDamaged, (unsigned long long) sim->stats.bytesWritten);
+	printf ("%llu bits flipped, %llu bytes dropped, %llu false start bytes, %llu write stalls\n",
+		(unsigned long long) sim->stats.bitsFlipped, (unsigned long long) sim->stats.bytesDropped,
+		(unsigned long long) sim->stats.falseStarts, (unsigned long long) sim->stats.writeStalls);
+}
+
+double fcuSimNow (void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+// xorshift64*, quick and the same every run for a given seed
+static uint64_t fcuSimRandom (struct fcuSim* sim) {
+	sim->random ^= sim->random >> 12;
+	sim->random ^= sim->random << 25;
+	sim->random ^= sim->random >> 27;
+	return sim->random * 2685821657736338717ULL;
+}
+
+static double fcuSimUniform (struct fcuSim* sim) {
+	return (fcuSimRandom(sim) >> 11) * (1.0/9007199254740992.0);
+}
+
+static double fcuSimGaussian (struct fcuSim* sim) {
+	double u = fcuSimUniform(sim), v = fcuSimUniform(sim);
+	return sqrt(-2*log(u + 1e-300)) * cos(2*M_PI*v);
+}
+
+// adds the noise and keeps it in range
+static int16_t fcuSimValue (struct fcuSim* sim, double value) {
+	if (sim->settings.noise > 0)
+		value += sim->settings.noise * fcuSimGaussian(sim);
+	if (value > 32767)
+		value = 32767;
+	if (value < -32768)
+		value = -32768;
+	return (int16_t) lrint(value);
+}
+
+// writes everything, waiting in poll() while the reader catches up
+static int fcuSimWrite (struct fcuSim* sim, int fd, const uint8_t* data, int length, volatile int* running) {
+	struct pollfd pfd;
+
+	pfd.fd = fd;
+	pfd.events = POLLOUT;
+
+	while (length > 0 && *running) {
+		int written = write(fd, data, length);
+		if (written < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno != EAGAIN) {
+				perror("\n***** FCU SIM ERROR: write failed\n\n");
+				return -1;
+			}
+			sim->stats.writeStalls++;
+			poll(&pfd, 1, FCU_SIM_POLL_MS);
+			continue;
+		}
+		sim->stats.bytesWritten += written;
+		data += written;
+		length -= written;
+	}
+
+	return 0;
+}
+
+// whatever the ground station wrote since last time, a command runs once its \r arrives
+static void fcuSimRead (struct fcuSim* sim, int fd) {
+	char data[FCU_SIM_COMMAND_LENGTH];
+	int length, i;
+
+	while ((length = read(fd, data, sizeof(data))) > 0) {
+		for (i=0; i<length; i++) {
+			if (data[i] == '\r' || data[i] == '\n') {
+				sim->command[sim->commandLength] = '\0';
+				if (sim->commandLength > 0 && fcuSimCommand(sim, sim->command))
+					fprintf(stderr, "fcusim: command not found: %s\n", sim->command);
+				sim->commandLength = 0;
+			} else if (sim->commandLength < FCU_SIM_COMMAND_LENGTH - 1)
+				sim->command[sim->commandLength++] = data[i];
+		}
+	}
+}
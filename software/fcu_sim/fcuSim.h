@@ -0,0 +1,95 @@
+#ifndef __FCU_SIM_H__
+#define __FCU_SIM_H__
+
+#include <stdint.h>
+
+#include "packets.h"
+#include "telemetryCodec.h"
+#include "telemetryMux.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+// a pretend FCU (or IMU) for testing the ground station without hardware.  it
+// makes up a gently wobbling flight, packs it into the same frames the real
+// boards send and damages the byte stream on purpose: noise on the values,
+// flipped bits, dropped bytes and stray start bytes between frames.  it keeps
+// count of what it broke so whoever is listening can be checked for loss.
+
+#define FCU_SIM_MAX_FRAME_LENGTH 64
+#define FCU_SIM_MAX_BUILD_LENGTH (TELEMETRY_MAX_FRAME_LENGTH+1) // most one fcuSimBuild can write, a coded block and a stray start byte
+#define FCU_SIM_BATCH 256          // most frames built and written in one go
+#define FCU_SIM_POLL_MS 100        // how long a write waits for a slow reader before checking it should stop
+#define FCU_SIM_MUX_LINK_BYTES 5760 // bytes a second a muxed FCU allows itself, what the xbee's 57600 baud carries
+#define FCU_SIM_COMMAND_LENGTH 64
+
+// command line options the simulator and the load test share
+#define FCU_SIM_OPTIONS "p:r:n:e:d:f:s:cm"
+#define FCU_SIM_OPTIONS_USAGE \
+	"  -p fcu|imu    packet to send (fcu)\n" \
+	"  -r hz|max     frames a second (100)\n" \
+	"  -n counts     gaussian noise on every value (0)\n" \
+	"  -e rate       bit error rate (0)\n" \
+	"  -d rate       chance of dropping each byte (0)\n" \
+	"  -f rate       chance of a stray start byte after each frame (0)\n" \
+	"  -s seed       random seed\n" \
+	"  -c            send fcu packets through the telemetry codec\n" \
+	"  -m            send telemetry channels through the mux, -r is its tick rate\n"
+
+typedef enum
+{
+FCU_SIM_FCU,
+FCU_SIM_IMU,
+}fcuSimPacket;
+
+struct fcuSimSettings {
+	fcuSimPacket packet;
+	double rate;             // frames a second, 0 for as fast as the reader takes them
+	double noise;            // standard deviation added to every value, in counts
+	double bitErrorRate;     // chance of any one bit being flipped
+	double dropRate;         // chance of any one byte going missing
+	double falseStartRate;   // chance of a stray start byte after a frame
+	uint32_t seed;
+	int coded;               // fcu packets go out as telemetry codec blocks
+	int muxed;               // telemetry channels go out through the mux, each at its own rate
+};
+
+struct fcuSimStats {
+	uint64_t framesSent;
+	uint64_t framesDamaged;  // had a bit flipped or a byte dropped, a decoder can't be expected to get these
+	uint64_t bytesWritten;
+	uint64_t bitsFlipped;
+	uint64_t bytesDropped;
+	uint64_t falseStarts;
+	uint64_t writeStalls;    // times the reader wasn't keeping up and we had to wait
+};
+
+struct fcuSim {
+	struct fcuSimSettings settings;
+	struct fcuSimStats stats;
+	uint16_t frameLength;
+	uint64_t random;         // xorshift state
+	double flightTime;       // seconds of made up flight so far, the frames' tick stamps count it
+	uint16_t sequence;       // of the next fcu_pkt_t
+	struct telemetryEncoder encoder;
+	struct telemetryMux mux;
+	char command[FCU_SIM_COMMAND_LENGTH]; // what the ground station has sent of its next command
+	int commandLength;
+};
+
+void fcuSimDefaults (struct fcuSimSettings* settings);
+int fcuSimOption (struct fcuSimSettings* settings, int option, const char* value);
+void fcuSimInit (struct fcuSim* sim, const struct fcuSimSettings* settings);
+int fcuSimBuild (struct fcuSim* sim, uint8_t* buffer);
+int fcuSimCommand (struct fcuSim* sim, const char* command);
+int fcuSimRun (struct fcuSim* sim, int fd, double seconds, volatile int* running);
+int fcuSimOpenPty (char* slaveName, int slaveNameLength);
+void fcuSimPrintStats (const struct fcuSim* sim, double seconds);
+double fcuSimNow (void);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __FCU_SIM_H__ */
@@ -0,0 +1,218 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include "fcuSim.h"
+#include "frameDecoder.h"
+
+// load test for the ground station.  with a command it runs that host tool
+// against a simulated FCU on a pty (PTY in its arguments becomes the pty's
+// path) and reports what it cost the tool and what it lost.  without one it
+// measures the frame decoder on its own.
+
+#define SETTLE_SECONDS 1.0         // time the tool gets to open the port before we start sending
+#define DRAIN_SECONDS 0.5          // time it gets to read what's still in the pty once we stop
+#define EXIT_SECONDS 5.0           // time it gets to finish after SIGINT
+#define BENCH_FRAMES 1000000       // frames in the stream the decoder benchmark replays
+#define BENCH_READ 4096            // bytes per push, what frameDecoderRead asks read() for
+
+static int runTool (struct fcuSim* sim, double seconds, char** command);
+static int benchDecoder (struct fcuSim* sim, double seconds);
+static void countFrame (const uint8_t* frame, uint16_t length, void* userData);
+static void countBlock (const uint8_t* frame, uint16_t length, void* userData);
+
+// what the coded benchmark's decoder callback needs
+struct codedBench {
+	struct telemetryDecoder telemetry;
+	uint64_t* decoded;
+};
+
+int main (int argc, char *argv[]) {
+	struct fcuSimSettings settings;
+	struct fcuSim sim;
+	double seconds = 10;
+	int option;
+
+	fcuSimDefaults(&settings);
+	settings.rate = 0;
+	while ((option = getopt(argc, argv, "+" FCU_SIM_OPTIONS "t:")) != -1) {
+		if (option == 't')
+			seconds = atof(optarg);
+		else if (fcuSimOption(&settings, option, optarg)) {
+			printf ("Usage: loadtest [options] [host tool and its arguments, PTY is replaced by the simulated port]\n"
+				FCU_SIM_OPTIONS_USAGE
+				"  -t seconds    how long to run (10)\n"
+				"the rate defaults to max here\n"
+				"ex: loadtest -r 1000 -e 1e-5 -- ../record_data/record PTY /tmp/flight.log\n");
+			exit(-1);
+		}
+	}
+
+	fcuSimInit(&sim, &settings);
+	if (optind < argc)
+		return runTool(&sim, seconds, argv + optind);
+	return benchDecoder(&sim, seconds);
+}
+
+static int runTool (struct fcuSim* sim, double seconds, char** command) {
+	char slaveName[128], outputName[] = "/tmp/loadtestXXXXXX", line[256];
+	int masterfd, slavefd, outputfd, status = 0, i, running = 1;
+	unsigned int recorded = 0, corrupt = 0, dropped = 0, reported = 0;
+	double start, sendStart, sendTime, wall;
+	struct rusage usage;
+	FILE* output;
+	pid_t pid;
+
+	masterfd = fcuSimOpenPty(slaveName, sizeof(slaveName));
+	if (masterfd < 0)
+		return -1;
+	slavefd = open(slaveName, O_RDWR | O_NOCTTY | O_NONBLOCK);
+
+	for (i=0; command[i] != NULL; i++)
+		if (strcmp(command[i], "PTY") == 0)
+			command[i] = slaveName;
+
+	// the tool's output goes to a file, we want to read its counters at the end
+	outputfd = mkstemp(outputName);
+	if (outputfd < 0) {
+		perror("\n***** LOAD TEST ERROR: mkstemp failed\n\n");
+		return -1;
+	}
+	unlink(outputName);
+
+	start = fcuSimNow();
+	pid = fork();
+	if (pid < 0) {
+		perror("\n***** LOAD TEST ERROR: fork failed\n\n");
+		return -1;
+	}
+	if (pid == 0) {
+		dup2(outputfd, STDOUT_FILENO);
+		close(masterfd);
+		execvp(command[0], command);
+		perror("exec");
+		_exit(127);
+	}
+
+	usleep((useconds_t)(SETTLE_SECONDS*1e6));
+	sendStart = fcuSimNow();
+	fcuSimRun(sim, masterfd, seconds, &running);
+	sendTime = fcuSimNow() - sendStart;
+
+	// ask it to stop, then insist
+	usleep((useconds_t)(DRAIN_SECONDS*1e6));
+	kill(pid, SIGINT);
+	while (waitpid(pid, &status, WNOHANG) == 0) {
+		if (fcuSimNow() - sendStart - sendTime > DRAIN_SECONDS + EXIT_SECONDS) {
+			kill(pid, SIGKILL);
+			waitpid(pid, &status, 0);
+			break;
+		}
+		usleep(10000);
+	}
+	wall = fcuSimNow() - start;
+	getrusage(RUSAGE_CHILDREN, &usage);
+
+	printf ("---- %s\n", command[0]);
+	lseek(outputfd, 0, SEEK_SET);
+	output = fdopen(outputfd, "r");
+	while (output != NULL && fgets(line, sizeof(line), output) != NULL) {
+		fputs(line, stdout);
+		if (sscanf(line, "%u frames recorded, %u corrupt, %u bytes dropped", &recorded, &corrupt, &dropped) == 3)
+			reported = 1;
+	}
+	if (output != NULL)
+		fclose(output);
+
+	printf ("---- simulated FCU on %s for %.1f seconds\n", slaveName, sendTime);
+	fcuSimPrintStats(sim, sendTime);
+	printf ("---- host tool\n");
+	printf ("cpu %.2fs user %.2fs system, %.1f%% of a core over %.1f seconds, max rss %ld kB\n",
+		usage.ru_utime.tv_sec + usage.ru_utime.tv_usec*1e-6, usage.ru_stime.tv_sec + usage.ru_stime.tv_usec*1e-6,
+		100*(usage.ru_utime.tv_sec + usage.ru_utime.tv_usec*1e-6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec*1e-6)/wall,
+		wall, usage.ru_maxrss);
+	if (reported) {
+		uint64_t intact = sim->stats.framesSent - sim->stats.framesDamaged;
+		printf ("decoded %u frames (%.0f a second), %llu intact frames lost (%.3f%%), %u corrupt, %u bytes dropped\n",
+			recorded, recorded/sendTime,
+			(unsigned long long)(intact > recorded ? intact - recorded : 0),
+			intact ? 100.0*(intact > recorded ? intact - recorded : 0)/intact : 0,
+			corrupt, dropped);
+	} else
+		printf ("the tool didn't report its frame counts, only its cost is known\n");
+
+	close(slavefd);
+	close(masterfd);
+	return 0;
+}
+
+// build a stream once then time nothing but the decoder chewing through it
+static int benchDecoder (struct fcuSim* sim, double seconds) {
+	struct frameDecoder decoder;
+	struct codedBench bench;
+	uint64_t decoded = 0, bytes = 0, firstPass = 0, intact;
+	uint8_t* stream;
+	size_t length = 0, offset;
+	double start, elapsed;
+	uint32_t i;
+
+	stream = malloc((size_t)BENCH_FRAMES*(FCU_SIM_MAX_FRAME_LENGTH+1) + FCU_SIM_MAX_BUILD_LENGTH);
+	if (stream == NULL) {
+		perror("\n***** LOAD TEST ERROR: malloc failed\n\n");
+		return -1;
+	}
+	for (i=0; i<BENCH_FRAMES; i++)
+		length += fcuSimBuild(sim, stream + length);
+	intact = sim->stats.framesSent - sim->stats.framesDamaged;
+
+	if (sim->settings.coded) {
+		bench.decoded = &decoded;
+		telemetryDecoderInit(&bench.telemetry, FCU_FIELD_COUNT);
+		frameDecoderInit(&decoder, TELEMETRY_MAX_FRAME_LENGTH, FRAME_DECODER_CHECK_PARITY | FRAME_DECODER_VARIABLE_LENGTH, countBlock, &bench);
+		decoder.startByte = TELEMETRY_START_BYTE;
+	} else if (sim->settings.muxed) {
+		frameDecoderInit(&decoder, TELEMETRY_MUX_MAX_FRAME_LENGTH, FRAME_DECODER_CHECK_PARITY | FRAME_DECODER_VARIABLE_LENGTH, countFrame, &decoded);
+		decoder.startByte = TELEMETRY_MUX_START_BYTE;
+	} else
+		frameDecoderInit(&decoder, sim->frameLength, FRAME_DECODER_CHECK_PARITY, countFrame, &decoded);
+	start = fcuSimNow();
+	do {
+		for (offset=0; offset<length; offset+=BENCH_READ)
+			frameDecoderPush(&decoder, stream + offset, (length - offset < BENCH_READ) ? length - offset : BENCH_READ);
+		bytes += length;
+		if (firstPass == 0)
+			firstPass = decoded;
+		elapsed = fcuSimNow() - start;
+	} while (elapsed < seconds);
+
+	printf ("decoder: %.2f M frames a second, %.1f MB a second\n", decoded/elapsed/1e6, bytes/elapsed/1e6);
+	printf ("first pass: %llu frames sent, %llu intact, %llu decoded, %llu intact frames lost\n",
+		(unsigned long long) sim->stats.framesSent, (unsigned long long) intact, (unsigned long long) firstPass,
+		(unsigned long long)(intact > firstPass ? intact - firstPass : 0));
+	printf ("corrupt frames %u, resyncs %u, bytes dropped %u (totals over every pass)\n",
+		decoder.stats.framesCorrupt, decoder.stats.resyncs, decoder.stats.bytesDropped);
+
+	free(stream);
+	return 0;
+}
+
+static void countFrame (const uint8_t* frame, uint16_t length, void* userData) {
+	(*(uint64_t*) userData)++;
+}
+
+// coded, a frame is a block of samples and they're what gets counted
+static void countBlock (const uint8_t* frame, uint16_t length, void* userData) {
+	struct codedBench* bench = (struct codedBench*) userData;
+	int16_t samples[TELEMETRY_BLOCK_SAMPLES][TELEMETRY_MAX_FIELDS];
+	int count = telemetryDecode(&bench->telemetry, frame, length, samples);
+	if (count > 0)
+		*bench->decoded += count;
+}
@@ -0,0 +1,70 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+
+#include "fcuSim.h"
+
+void terminate(int sig);
+
+volatile int running = 1;
+
+int main (int argc, char *argv[]) {
+	struct fcuSimSettings settings;
+	struct fcuSim sim;
+	char slaveName[128];
+	const char* link = NULL;
+	double seconds = 0, start;
+	int masterfd, slavefd, option, error;
+
+	fcuSimDefaults(&settings);
+	while ((option = getopt(argc, argv, FCU_SIM_OPTIONS "t:l:")) != -1) {
+		if (option == 't')
+			seconds = atof(optarg);
+		else if (option == 'l')
+			link = optarg;
+		else if (fcuSimOption(&settings, option, optarg)) {
+			printf ("Usage: fcusim [options]\n" FCU_SIM_OPTIONS_USAGE
+				"  -t seconds    stop after this long (run until ctrl-c)\n"
+				"  -l path       also make path a link to the pty (ex /tmp/ttyFCU)\n");
+			exit(-1);
+		}
+	}
+
+	masterfd = fcuSimOpenPty(slaveName, sizeof(slaveName));
+	if (masterfd < 0)
+		exit(-1);
+
+	// hang on to the slave end so the pty survives the ground station closing and reopening it
+	slavefd = open(slaveName, O_RDWR | O_NOCTTY | O_NONBLOCK);
+
+	if (link != NULL) {
+		unlink(link);
+		if (symlink(slaveName, link) < 0)
+			perror("symlink");
+	}
+	printf ("FCU simulator on %s%s%s\n", slaveName, link ? " -> " : "", link ? link : "");
+	fflush(stdout);
+
+	//Set up termination signal routine (when user hits Ctrl-c or SIGINT/SIGTERM is sent to this process)
+	signal(SIGINT, terminate);
+	signal(SIGTERM, terminate);
+
+	fcuSimInit(&sim, &settings);
+	start = fcuSimNow();
+	error = fcuSimRun(&sim, masterfd, seconds, &running);
+	fcuSimPrintStats(&sim, fcuSimNow() - start);
+
+	if (link != NULL)
+		unlink(link);
+	close(slavefd);
+	close(masterfd);
+	return error ? -1 : 0;
+}
+
+//Callback for ctrl-c signal (SIGINT) and SIGTERM
+void terminate(int sig) {
+	running = 0;
+}
@@ -20,27 +20,14 @@
 #include "uart.h"
 #include "gtkgraph.h"
 #include "dyGraph.h"
+#include "frameDecoder.h"
+#include "packets.h"
 
-#define RX_BUFFER_LENGTH 10000
-
-
-struct imu_rx_pkt_t
-{
-    volatile uint8_t start;
-    volatile uint8_t parity;
-    volatile int16_t roll;
-    volatile int16_t pitch_tmp;
-    volatile int16_t pitch;
-    volatile int16_t yaw;
-    volatile int16_t yaw_tmp;
-    volatile int16_t z_accel;
-    volatile int16_t x_accel;
-    volatile int16_t y_accel;
-};
 
 void terminate(int sig);
-void graphPacket (struct imu_rx_pkt_t * packet, float time);
+void graphPacket (const uint8_t* frame, float time);
 guint readSerial (void);
+void framePacket (const uint8_t* frame, uint16_t length, void* userData);
 
 struct dyGraph* graph;
 
@@ -53,8 +40,10 @@ struct dyTrace* zAccelTrace;
 struct dyTrace* pitchTempTrace;
 struct dyTrace* yawTempTrace;
 
-float graphTime = 0;
+double startTime = -1;  // CLOCK_MONOTONIC of the first read, the plot's zero
+double readTime;        // of the read the decoder is handing frames out of
 int uartfd; 
+struct frameDecoder decoder;
 
 int main (int argc, char *argv[]) {
 	
@@ -64,6 +53,7 @@ int main (int argc, char *argv[]) {
 	} 
 
 	uartfd = initUART(argv[1]);
+	frameDecoderInit (&decoder, IMU_PACKET_LENGTH, FRAME_DECODER_CHECK_PARITY, framePacket, NULL);
 	
 	//Set up termination signal routine (when user hits Ctrl-c or SIGINT is sent to this process)
 	signal(SIGINT, terminate);
@@ -105,40 +95,32 @@ int main (int argc, char *argv[]) {
 	return 0;
 }
 
-void graphPacket (struct imu_rx_pkt_t * packet, float time) {
-	dyGraphAddData(graph, rollTrace, time, packet->roll);
-	dyGraphAddData(graph, pitchTrace, time, packet->pitch);
-	dyGraphAddData(graph, yawTrace, time, packet->yaw);
-	dyGraphAddData(graph, yawTempTrace, time, packet->yaw_tmp);
-	dyGraphAddData(graph, pitchTempTrace, time, packet->pitch_tmp);
-	dyGraphAddData(graph, zAccelTrace, time, packet->z_accel);
-	dyGraphAddData(graph, xAccelTrace, time, packet->x_accel);
-	dyGraphAddData(graph, yAccelTrace, time, packet->y_accel);
+void graphPacket (const uint8_t* frame, float time) {
+	dyGraphAddData(graph, rollTrace, time, IMU_PACKET_GET(frame, roll));
+	dyGraphAddData(graph, pitchTrace, time, IMU_PACKET_GET(frame, pitch));
+	dyGraphAddData(graph, yawTrace, time, IMU_PACKET_GET(frame, yaw));
+	dyGraphAddData(graph, yawTempTrace, time, IMU_PACKET_GET(frame, yaw_tmp));
+	dyGraphAddData(graph, pitchTempTrace, time, IMU_PACKET_GET(frame, pitch_tmp));
+	dyGraphAddData(graph, zAccelTrace, time, IMU_PACKET_GET(frame, z_accel));
+	dyGraphAddData(graph, xAccelTrace, time, IMU_PACKET_GET(frame, x_accel));
+	dyGraphAddData(graph, yAccelTrace, time, IMU_PACKET_GET(frame, y_accel));
+}
+
+// called by the decoder for every valid frame
+void framePacket (const uint8_t* frame, uint16_t length, void* userData) {
+	// the IMU doesn't stamp its frames, so they go at the time they came in
+	// rather than every frame a fixed step on from the last
+	graphPacket (frame, readTime - startTime);
 }
 
 guint readSerial (void) {
-	unsigned char rxBuffer[RX_BUFFER_LENGTH];
-	
-	int bytesRead = read (uartfd, rxBuffer, RX_BUFFER_LENGTH-1);
-	int i;
-	for (i=0; i<bytesRead; i++) {
-		if (rxBuffer[i] == 0xAA) {
-			int j=0;
-			while (i<bytesRead) { // if 0xAA was found at index in rxBuffer other than 0, shift everything over so that 0xAA is at 0
-				rxBuffer[j] = rxBuffer[i];
-				j++;
-				i++;
-			}
-			while (j<18) {
-				int dataBytesRead = read (uartfd, rxBuffer+j, RX_BUFFER_LENGTH-j-1);
-				j += dataBytesRead;
-				usleep(100);
-			}
-			graphTime += 0.001;
-			graphPacket ((struct imu_rx_pkt_t*)rxBuffer, graphTime);
-			break;
-		}
-	}
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	readTime = ts.tv_sec + ts.tv_nsec*1e-9;
+	if (startTime < 0)
+		startTime = readTime;
+	if (frameDecoderRead (&decoder, uartfd) < 0)
+		perror("readSerial");
 	return TRUE;
 }
 
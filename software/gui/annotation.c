@@ -22,7 +22,6 @@ if (tmp == (GtkGraphAnnotation *) NULL)
 tmp->type = VERTICAL;
 tmp->value = 0;
 tmp->text = NULL;
-tmp->next = NULL;
 
 return(tmp);
 }
@@ -39,22 +38,19 @@ return(tmp);
 gint gtk_graph_annotation_new(GtkGraph *graph)
 {
 
-int i;
-GtkGraphAnnotation *new_annotation, *tmp;
+GtkGraphAnnotation *new_annotation;
 
 g_return_val_if_fail (graph != NULL, FALSE);
 g_return_val_if_fail (GTK_IS_GRAPH (graph), FALSE);
 
 new_annotation = gtk_graph_annotation_allocate();
 
-if (graph->annotations == NULL)
-	graph->annotations = new_annotation;
-else
+if (graph->num_annotations >= graph->annotations_size)
 	{
-	for (i = 0, tmp = graph->annotations; tmp->next != NULL ; tmp = tmp->next , i++)  // Should advance us to last item in list
-        ;
-	tmp->next = new_annotation;
+	graph->annotations_size = graph->annotations_size * 2 + 4;
+	graph->annotations = (GtkGraphAnnotation **) g_realloc(graph->annotations, graph->annotations_size * sizeof(GtkGraphAnnotation *));
 	}
+graph->annotations[graph->num_annotations] = new_annotation;
 graph->num_annotations += 1;
 return graph->num_annotations - 1;
 }
@@ -75,28 +71,24 @@ return graph->num_annotations - 1;
 void gtk_graph_annotation_set_data(GtkGraph *graph, gint annotation_id, GtkGraphAnnotationType type, gfloat value, gchar *text)
 {
 GtkGraphAnnotation *t;
-gint i;
 g_return_if_fail (graph != NULL);
 g_return_if_fail (GTK_IS_GRAPH (graph));
 if (graph->annotations == NULL)
 	return;
-g_return_if_fail (annotation_id < graph->num_annotations);
+g_return_if_fail (annotation_id >= 0 && annotation_id < graph->num_annotations);
 
-t = graph->annotations;
-for (i = 0 ; i < annotation_id ; i++)
-	t = t->next;
+t = graph->annotations[annotation_id];
 
 t->type = type;
 t->value = value;
 t->text = g_strdup(text);
-
+gtk_graph_queue_redraw(graph, GTK_GRAPH_DIRTY_TRACES);
 }
 void gtk_graph_plot_annotations(GtkGraph *graph)
 {
 gint n;
 gint plotting_value, text_width, text_height;
 GtkGraphAnnotation *tmp;
-PangoFontDescription *fontdesc = NULL;
 PangoLayout *layout = NULL;
 gint centre_x = user_width / 2.0 + user_origin_x, xpos;
 gint centre_y = user_height / 2.0 + user_origin_y, ypos;	
@@ -112,13 +104,10 @@ g_return_if_fail (GTK_WIDGET_REALIZED(GTK_WIDGET(graph)));
 if (graph->annotations == NULL)
 	return;
 
-fontdesc = pango_font_description_from_string("Sans 9");
-layout = gtk_widget_create_pango_layout(GTK_WIDGET(graph), NULL);
-pango_layout_set_font_description(layout, fontdesc);		
 	
-tmp = graph->annotations;
 for (n = 0 ; n < graph->num_annotations ; n++)
 	{
+	tmp = graph->annotations[n];
 	switch(tmp->type)
 		{
 		case HORIZONTAL:
@@ -142,8 +131,7 @@ for (n = 0 ; n < graph->num_annotations ; n++)
 				text_buffer = g_strdup_printf( "%s\nY: %.2f", tmp->text, tmp->value);
 			else
 				text_buffer = g_strdup_printf("Y: %.2f", tmp->value);
-			pango_layout_set_text(layout, text_buffer, -1);
-			pango_layout_get_pixel_size(layout, &text_width, &text_height);
+			layout = gtk_graph_label(graph, GTK_GRAPH_FONT_ANNOTATION, text_buffer, &text_width, &text_height);
 
 			if (tmp->value <= (graph->dependant->axis_max - graph->dependant->axis_min) / 2.0)
 				gdk_draw_layout(buffer, BandWcontext, (graph->independant->n_maj_tick * graph->independant->pxls_per_maj_tick )/2 + user_origin_x, plotting_value -  text_height - 2, layout);
@@ -171,8 +159,7 @@ for (n = 0 ; n < graph->num_annotations ; n++)
 				text_buffer = g_strdup_printf("%s\nX: %.2f", tmp->text, tmp->value);
 			else
 				text_buffer = g_strdup_printf("X: %.2f", tmp->value);
-			pango_layout_set_text(layout, text_buffer, -1);
-			pango_layout_get_pixel_size(layout, &text_width, &text_height);
+			layout = gtk_graph_label(graph, GTK_GRAPH_FONT_ANNOTATION, text_buffer, &text_width, &text_height);
 			if (tmp->value <= (graph->independant->axis_max - graph->independant->axis_min) / 2.0)
 				gdk_draw_layout(buffer, BandWcontext, plotting_value +2, vertical_position, layout);
 			else
@@ -196,8 +183,7 @@ for (n = 0 ; n < graph->num_annotations ; n++)
 				text_buffer = g_strdup_printf("%s\nTheta: %.2f", tmp->text, tmp->value);
 			else
 				text_buffer = g_strdup_printf("Theta: %.1f", tmp->value);
-			pango_layout_set_text(layout, text_buffer, -1);
-			pango_layout_get_pixel_size(layout, &text_width, &text_height);
+			layout = gtk_graph_label(graph, GTK_GRAPH_FONT_ANNOTATION, text_buffer, &text_width, &text_height);
 			if (xpos > centre_x)
 				{
 				if (ypos >= centre_y)
@@ -228,8 +214,7 @@ for (n = 0 ; n < graph->num_annotations ; n++)
 				text_buffer = g_strdup_printf( "%s\nRadius: %.1f", tmp->text, tmp->value);
 			else
 				text_buffer = g_strdup_printf( "Radius: %.1f", tmp->value);
-			pango_layout_set_text(layout, text_buffer, -1);
-			pango_layout_get_pixel_size(layout, &text_width, &text_height);
+			layout = gtk_graph_label(graph, GTK_GRAPH_FONT_ANNOTATION, text_buffer, &text_width, &text_height);
 			gdk_draw_layout(buffer, BandWcontext, centre_x - plotting_value / 1.414 - text_width - 2, centre_y - plotting_value / 1.414 - text_height, layout);			
 			break;
 		case VSWR:
@@ -243,8 +228,7 @@ for (n = 0 ; n < graph->num_annotations ; n++)
 				text_buffer = g_strdup_printf( "%s\nVSWR: %.1f", tmp->text, tmp->value);
 			else
 				text_buffer = g_strdup_printf( "VSWR: %.1f", tmp->value);				
-			pango_layout_set_text(layout, text_buffer, -1);
-			pango_layout_get_pixel_size(layout, &text_width, &text_height);
+			layout = gtk_graph_label(graph, GTK_GRAPH_FONT_ANNOTATION, text_buffer, &text_width, &text_height);
 			break;
 		case Q:
 			if (graph->graph_type != SMITH)
@@ -260,15 +244,10 @@ for (n = 0 ; n < graph->num_annotations ; n++)
 				text_buffer = g_strdup_printf( "%s\nQ: %.1f", tmp->text, tmp->value);
 			else
 				text_buffer = g_strdup_printf( "Q: %.1f", tmp->value);				
-			pango_layout_set_text(layout, text_buffer, -1);
-			pango_layout_get_pixel_size(layout, &text_width, &text_height);
+			layout = gtk_graph_label(graph, GTK_GRAPH_FONT_ANNOTATION, text_buffer, &text_width, &text_height);
 			gdk_draw_layout(buffer, BandWcontext, centre_x - text_width / 2, centre_y - plotting_value + r, layout);			
 			break;
 			
 		}
-	/* and then move onto the next trace */
-	tmp = tmp->next;		
 	}
-pango_font_description_free(fontdesc);
-g_object_unref(layout);	
 }
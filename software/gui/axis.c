@@ -35,6 +35,7 @@ else
 	target->min_tick = target->maj_tick;
 
 target->autoscale_tick = FALSE;
+gtk_graph_queue_redraw(graph, GTK_GRAPH_DIRTY_AXES);
 }
 
 /* Set_Limits: Set upper and lower limits, as well as tick increments */
@@ -56,6 +57,9 @@ switch(axis)
 		break;
 	}
 
+if (target->axis_max != max || target->axis_min != min || target->autoscale_limits)
+	gtk_graph_queue_redraw(graph, GTK_GRAPH_DIRTY_AXES);
+
 target->axis_max = max;
 target->axis_min = min;
 
@@ -77,6 +81,7 @@ target->crossing_type = type;
 target->crossing_value = 0;
 if (type == GTK_GRAPH_USERVALUE)
     target->crossing_value = crossing_value;    
+gtk_graph_queue_redraw(graph, GTK_GRAPH_DIRTY_AXES);
 }
 /* Scale_Axis: A simple Axis Scaler */
 void gtk_graph_axis_scale_axis(GtkGraph *graph, gint user_width, gint user_height)
@@ -89,12 +94,11 @@ gint i;
 g_return_if_fail (graph != NULL);
 g_return_if_fail (GTK_IS_GRAPH (graph));
 
-t = graph->traces;
-
 if (graph->independant->autoscale_limits || graph->dependant->autoscale_limits)
 	{
 	for (i = 0 ; i < graph->num_traces ; i++)
 		{
+		t = graph->traces[i];
 		if (t->xmax > global_X_max)
 			global_X_max = t->xmax;
 		if (t->xmin < global_X_min)
@@ -103,7 +107,6 @@ if (graph->independant->autoscale_limits || graph->dependant->autoscale_limits)
 			global_Y_max = t->ymax;
 		if (t->ymin < global_Y_min)
 			global_Y_min = t->ymin;
-		t = t->next;
 		}
 	}
 
@@ -219,6 +222,7 @@ target->precision = precision;
 if (target->title != NULL)
 	g_free(target->title);
 target->title = g_strdup(title);
+gtk_graph_queue_redraw(graph, GTK_GRAPH_DIRTY_AXES | GTK_GRAPH_DIRTY_TITLES);
 }
 
 /* Format_Grid: Specify whether Grid is visible [and how to draw it (to be implemented)] */
@@ -234,6 +238,7 @@ if (axis == GTK_GRAPH_AXIS_DEPENDANT)		/* and correct things it its not */
 
 g_return_if_fail (target != NULL);   				/* --- Do error checking --- */
 target->grid_visible = visible;
+gtk_graph_queue_redraw(graph, GTK_GRAPH_DIRTY_AXES);
 }
 
 /* Nicenum: provides nice numerical limits when scaling an axis */
@@ -0,0 +1,112 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "telemetryCodec.h"
+
+// round trips of the telemetry block codec on the host, every delta width from
+// 0 to 16 bits and some noisy streams.  returns the number of failures so a
+// makefile can stop on it
+
+#define TEST_FIELDS 9      // an fcu packet's worth
+#define TEST_SAMPLES 4000
+
+static int failures = 0;
+
+static void testCheck (int ok, const char* what, int detail);
+static int16_t testDelta (int width, int sign);
+static void testRoundTrip (const int16_t (*stream)[TELEMETRY_MAX_FIELDS], int samples, int fields, const char* what, int detail);
+static void testWidths (void);
+static void testNoise (void);
+
+int main (void) {
+	testWidths();
+	testNoise();
+
+	if (failures)
+		printf ("%d failures\n", failures);
+	else
+		printf ("all passed\n");
+	return failures != 0;
+}
+
+static void testCheck (int ok, const char* what, int detail) {
+	if (!ok) {
+		printf ("FAILED: %s (%d)\n", what, detail);
+		failures++;
+	}
+}
+
+// the biggest delta whose zigzag needs exactly width bits
+static int16_t testDelta (int width, int sign) {
+	uint16_t zigzag = (width == 0) ? 0 : (uint16_t)((1u << width) - 1);
+	if (width == 0)
+		return 0;
+	if (sign < 0)
+		return (int16_t)((zigzag + 1) >> 1) * -1;  // odd zigzags are the negative ones
+	return (int16_t)((zigzag - 1) >> 1);
+}
+
+// encode the stream, decode every frame and compare
+static void testRoundTrip (const int16_t (*stream)[TELEMETRY_MAX_FIELDS], int samples, int fields, const char* what, int detail) {
+	struct telemetryEncoder encoder;
+	struct telemetryDecoder decoder;
+	uint8_t frame[TELEMETRY_MAX_FRAME_LENGTH];
+	int16_t decoded[TELEMETRY_BLOCK_SAMPLES][TELEMETRY_MAX_FIELDS];
+	int sent = 0, received = 0, length, count, i, f;
+
+	telemetryEncoderInit (&encoder, fields);
+	telemetryDecoderInit (&decoder, fields);
+
+	while (sent < samples || encoder.count > 0) {
+		if (sent < samples)
+			length = telemetryEncoderAdd (&encoder, stream[sent++], frame);
+		else
+			length = telemetryEncoderFlush (&encoder, frame);
+		if (length == 0)
+			continue;
+
+		testCheck (length <= TELEMETRY_MAX_FRAME_LENGTH && frame[2] == length, what, detail);
+		count = telemetryDecode (&decoder, frame, length, decoded);
+		testCheck (count > 0, what, detail);
+		for (i=0; i<count && received + i < samples; i++)
+			for (f=0; f<fields; f++)
+				testCheck (decoded[i][f] == stream[received + i][f], what, detail);
+		if (count > 0)
+			received += count;
+	}
+	testCheck (received == samples, what, detail);
+	testCheck (decoder.stats.blocksBad == 0 && decoder.stats.blocksLost == 0 && decoder.stats.blocksSkipped == 0, what, detail);
+}
+
+// every field of a block moving by the most each width allows, both ways, on
+// one field and on all of them (so the frame is as long as it gets)
+static void testWidths (void) {
+	static int16_t stream[TEST_SAMPLES][TELEMETRY_MAX_FIELDS];
+	int width, all, i, f;
+
+	for (width=0; width<=16; width++) {
+		for (all=0; all<2; all++) {
+			memset(stream, 0, sizeof(stream));
+			for (i=1; i<TEST_SAMPLES; i++)
+				for (f=0; f<TEST_FIELDS; f++)
+					stream[i][f] = (all || f == 4) ? stream[i-1][f] + testDelta(width, (i & 1) ? 1 : -1) : stream[i-1][f];
+			testRoundTrip ((const int16_t (*)[TELEMETRY_MAX_FIELDS]) stream, TEST_SAMPLES, TEST_FIELDS, all ? "every field at width" : "one field at width", width);
+		}
+	}
+}
+
+// sensor like channels: slow drift plus noise of a different size per field,
+// and the widest frame the codec allows
+static void testNoise (void) {
+	static int16_t stream[TEST_SAMPLES][TELEMETRY_MAX_FIELDS];
+	int i, f;
+
+	srand(1);
+	for (i=0; i<TEST_SAMPLES; i++)
+		for (f=0; f<TELEMETRY_MAX_FIELDS; f++)
+			stream[i][f] = (int16_t)(i*f + (rand() % (2 << f % 16)) - (1 << f % 16));
+	testRoundTrip ((const int16_t (*)[TELEMETRY_MAX_FIELDS]) stream, TEST_SAMPLES, TEST_FIELDS, "noise", TEST_FIELDS);
+	testRoundTrip ((const int16_t (*)[TELEMETRY_MAX_FIELDS]) stream, TEST_SAMPLES, TELEMETRY_MAX_FIELDS, "noise", TELEMETRY_MAX_FIELDS);
+}
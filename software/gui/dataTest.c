@@ -0,0 +1,364 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "sampleColumn.h"
+#include "minMaxPyramid.h"
+#include "dyData.h"
+
+// headless checks of the sample storage behind dyGraph, no GTK or display
+// needed, and what appending and range queries cost.  returns the number of
+// failures so a makefile can stop on it
+
+#define TEST_LENGTH 300000       // samples appended, past four chunks
+#define TEST_BLOCK 1000
+#define TEST_QUERIES 20          // random ranges checked after every block
+#define TEST_TRACES 3            // traces in a channel group
+#define TEST_PERIOD 0.001        // x between samples, a 1 kHz stream in seconds
+#define TEST_COLUMNS 100         // pixel columns decimated to
+
+#define BENCH_SAMPLES 8000000
+#define BENCH_QUERIES 1000000
+
+static int failures = 0;
+static uint32_t appended = 0;    // notifications the observer got
+
+static void testCheck (int ok, const char* what, uint32_t detail);
+static float testSample (uint32_t index);
+static void testQuery (const struct minMaxPyramid* pyramid, const struct sampleColumn* column, uint32_t start, uint32_t end);
+static void testPyramidHistory (uint32_t history);
+static void testObserver (struct dyDataTrace* trace, dyDataChange changes, void* context);
+static void testDataQuery (const struct dyDataTrace* trace, uint32_t start, uint32_t end);
+static void testDataGroup (void);
+static void testDataHistory (float history);
+static void testScaleObserver (struct dyDataTrace* trace, dyDataChange changes, void* context);
+static void testDataWindow (void);
+static void testDataFree (struct dyDataSet* set, struct dyChannelGroup* group);
+static void benchData (void);
+static double benchNow (void);
+
+int main (void) {
+	testPyramidHistory(20000);
+	testPyramidHistory(140000);  // keeps the second chunk while 2^17 sample buckets straddle the first
+	testDataGroup();
+	testDataHistory(20000*TEST_PERIOD);
+	testDataHistory(140000*TEST_PERIOD);
+	testDataWindow();
+	benchData();
+
+	if (failures)
+		printf ("%d failures\n", failures);
+	else
+		printf ("all passed\n");
+	return failures != 0;
+}
+
+static void testCheck (int ok, const char* what, uint32_t detail) {
+	if (!ok) {
+		printf ("FAILED: %s (%u)\n", what, detail);
+		failures++;
+	}
+}
+
+// repeatable noise with a slow trend, so min/max move around
+static float testSample (uint32_t index) {
+	return (float)((index*2654435761u) >> 20) + index*0.01;
+}
+
+// the pyramid's answer for start .. end-1 against a plain scan
+static void testQuery (const struct minMaxPyramid* pyramid, const struct sampleColumn* column, uint32_t start, uint32_t end) {
+	uint32_t minIndex, maxIndex, i;
+	float min = sampleColumnAt(column, start), max = min;
+
+	for (i=start; i<end; i++) {
+		if (sampleColumnAt(column, i) < min)
+			min = sampleColumnAt(column, i);
+		if (sampleColumnAt(column, i) > max)
+			max = sampleColumnAt(column, i);
+	}
+	minMaxPyramidQuery (pyramid, column, start, end, &minIndex, &maxIndex);
+	testCheck (minIndex >= column->start && minIndex < end && sampleColumnAt(column, minIndex) == min, "pyramid min", start);
+	testCheck (maxIndex >= column->start && maxIndex < end && sampleColumnAt(column, maxIndex) == max, "pyramid max", start);
+}
+
+// history mode: only the last history samples are held, the chunks before
+// them go back to the pool while the pyramid keeps summarising.  buckets that
+// straddle the oldest held sample once made the pyramid read dropped chunks
+static void testPyramidHistory (uint32_t history) {
+	struct sampleColumn column;
+	struct minMaxPyramid pyramid;
+	float block[TEST_BLOCK];
+	uint32_t n, i, start, end;
+
+	sampleColumnInit (&column);
+	minMaxPyramidInit (&pyramid);
+	srand(1);
+
+	for (n=0; n<TEST_LENGTH; n+=TEST_BLOCK) {
+		for (i=0; i<TEST_BLOCK; i++)
+			block[i] = testSample(n + i);
+		testCheck (sampleColumnAppend (&column, block, TEST_BLOCK) == 0, "append", n);
+		testCheck (minMaxPyramidUpdate (&pyramid, &column) == 0, "pyramid update", n);
+		if (column.end > history) {
+			sampleColumnDiscard (&column, column.end - history);
+			minMaxPyramidDiscard (&pyramid, column.end - history);
+		}
+
+		for (i=0; i<TEST_QUERIES; i++) {
+			start = column.start + rand() % (column.end - column.start);
+			end = start + 1 + rand() % (column.end - start);
+			testQuery (&pyramid, &column, start, end);
+		}
+		testQuery (&pyramid, &column, column.start, column.end);
+	}
+	testCheck (column.start == TEST_LENGTH - history, "held start", column.start);
+	for (i=column.start; i<column.end; i++)
+		testCheck (sampleColumnAt(&column, i) == testSample(i), "held sample", i);
+
+	minMaxPyramidFree (&pyramid);
+	sampleColumnFree (&column);
+}
+
+static void testObserver (struct dyDataTrace* trace, dyDataChange changes, void* context) {
+	if (changes & DY_DATA_APPENDED)
+		appended++;
+}
+
+// dyDataRange for start .. end-1 against a plain scan
+static void testDataQuery (const struct dyDataTrace* trace, uint32_t start, uint32_t end) {
+	uint32_t minIndex, maxIndex, i;
+	float min = sampleColumnAt(&trace->yData, start), max = min;
+
+	for (i=start; i<end; i++) {
+		if (sampleColumnAt(&trace->yData, i) < min)
+			min = sampleColumnAt(&trace->yData, i);
+		if (sampleColumnAt(&trace->yData, i) > max)
+			max = sampleColumnAt(&trace->yData, i);
+	}
+	dyDataRange (trace, start, end, &minIndex, &maxIndex);
+	testCheck (minIndex >= dyDataHeldStart(trace) && minIndex < end && sampleColumnAt(&trace->yData, minIndex) == min, "range min", start);
+	testCheck (maxIndex >= dyDataHeldStart(trace) && maxIndex < end && sampleColumnAt(&trace->yData, maxIndex) == max, "range max", start);
+}
+
+// a group of traces appended together share one copy of x, and the set's
+// extents and the observer keep up with them
+static void testDataGroup (void) {
+	struct dyDataSet* set = dyDataNew();
+	struct dyChannelGroup* group = dyDataNewGroup();
+	struct dyDataTrace* traces[TEST_TRACES];
+	static float x[TEST_BLOCK], y[TEST_TRACES][TEST_BLOCK];
+	const float* columns[TEST_TRACES];
+	float yMin = 0, yMax = 0;
+	uint32_t n, i, k, start;
+
+	for (k=0; k<TEST_TRACES; k++) {
+		traces[k] = dyDataAddTrace (set, group, NULL);
+		columns[k] = y[k];
+	}
+	dyDataSetObserver (set, testObserver, NULL);
+	appended = 0;
+	srand(1);
+
+	for (n=0; n<TEST_LENGTH; n+=TEST_BLOCK) {
+		for (i=0; i<TEST_BLOCK; i++) {
+			x[i] = (n + i)*TEST_PERIOD;
+			for (k=0; k<TEST_TRACES; k++) {
+				y[k][i] = testSample(n + i)*(k + 1) - k*1000.0;
+				yMin = (n + i == 0 || y[k][i] < yMin) ? y[k][i] : yMin;
+				yMax = (n + i == 0 || y[k][i] > yMax) ? y[k][i] : yMax;
+			}
+		}
+		testCheck (dyDataAppendMulti (traces, TEST_TRACES, x, columns, TEST_BLOCK) == 0, "append", n);
+
+		for (i=0; i<TEST_QUERIES; i++) {
+			k = rand() % TEST_TRACES;
+			start = rand() % (n + TEST_BLOCK);
+			testDataQuery (traces[k], start, start + 1 + rand() % (n + TEST_BLOCK - start));
+		}
+	}
+
+	testCheck (group->xData.end == TEST_LENGTH, "one copy of x", group->xData.end);
+	testCheck (appended == TEST_TRACES*TEST_LENGTH/TEST_BLOCK, "observer told of every append", appended);
+	testCheck (set->xDataMin == 0 && set->xDataMax == (float)((TEST_LENGTH - 1)*TEST_PERIOD), "x extents", 0);
+	testCheck (set->yDataMin == yMin && set->yDataMax == yMax, "y extents", 0);
+	for (k=0; k<TEST_TRACES; k++) {
+		testCheck (traces[k]->dataCurr == TEST_LENGTH, "trace length", k);
+		for (i=0; i<TEST_LENGTH; i+=997)
+			testCheck (sampleColumnAt(&traces[k]->yData, i) == testSample(i)*(k + 1) - k*1000.0f, "trace sample", i);
+		testDataQuery (traces[k], 0, TEST_LENGTH);
+	}
+
+	testDataFree (set, group);
+}
+
+// history mode through dyData: old chunks go, what's left is the last history
+// of x, and range queries and decimation over it still match a scan
+static void testDataHistory (float history) {
+	struct dyDataSet* set = dyDataNew();
+	struct dyChannelGroup* group = dyDataNewGroup();
+	struct dyDataTrace* trace = dyDataAddTrace (set, group, NULL);
+	static float x[TEST_BLOCK], y[TEST_BLOCK];
+	float min[TEST_COLUMNS], max[TEST_COLUMNS], lowest, highest;
+	uint32_t n, i, held, start, columns;
+
+	dyDataSetHistory (set, history);
+	srand(2);
+
+	for (n=0; n<TEST_LENGTH; n+=TEST_BLOCK) {
+		for (i=0; i<TEST_BLOCK; i++) {
+			x[i] = (n + i)*TEST_PERIOD;
+			y[i] = testSample(n + i);
+		}
+		testCheck (dyDataAppend (trace, x, y, TEST_BLOCK) == 0, "append", n);
+
+		held = dyDataHeldStart(trace);
+		testCheck (sampleColumnAt(&group->xData, held) >= x[TEST_BLOCK-1] - history - TEST_PERIOD, "history dropped", held);
+		for (i=0; i<TEST_QUERIES; i++) {
+			start = held + rand() % (trace->dataCurr - held);
+			testDataQuery (trace, start, start + 1 + rand() % (trace->dataCurr - start));
+		}
+
+		// the last second of x as a plot TEST_COLUMNS wide
+		columns = dyDataDecimate (trace, x[TEST_BLOCK-1] - 1, x[TEST_BLOCK-1], TEST_COLUMNS, min, max);
+		testCheck (columns == TEST_COLUMNS, "decimated columns", n);
+		lowest = highest = y[TEST_BLOCK-1];
+		for (i=sampleColumnFind(&group->xData, x[TEST_BLOCK-1] - 1); i<trace->dataCurr; i++) {
+			lowest = (sampleColumnAt(&trace->yData, i) < lowest) ? sampleColumnAt(&trace->yData, i) : lowest;
+			highest = (sampleColumnAt(&trace->yData, i) > highest) ? sampleColumnAt(&trace->yData, i) : highest;
+		}
+		for (i=1; i<columns; i++) {
+			min[0] = (min[i] < min[0]) ? min[i] : min[0];
+			max[0] = (max[i] > max[0]) ? max[i] : max[0];
+		}
+		testCheck (min[0] == lowest && max[0] == highest, "decimated extents", n);
+	}
+
+	// no more chunks than the history needs, plus the ones it straddles
+	testCheck (trace->yData.chunkCount <= history/TEST_PERIOD/SAMPLE_COLUMN_CHUNK_LENGTH + 2, "chunks held", trace->yData.chunkCount);
+	testCheck (group->xData.chunkCount <= history/TEST_PERIOD/SAMPLE_COLUMN_CHUNK_LENGTH + 2, "x chunks held", group->xData.chunkCount);
+
+	testDataFree (set, group);
+}
+
+// checks the scale a trace is told about against the window of every trace,
+// so a trace that's told before the others have their block shows up
+static void testScaleObserver (struct dyDataTrace* trace, dyDataChange changes, void* context) {
+	struct dyDataSet* set = trace->set;
+	uint32_t k, i, start;
+
+	if (!(changes & DY_DATA_APPENDED))
+		return; // a trace whose x moved while another got its block
+	appended++;
+	for (k=0; k<set->traceCount; k++) {
+		struct dyDataTrace* other = set->traces[k];
+		testCheck (other->dataCurr == trace->dataCurr, "told after every trace has its block", k);
+		start = sampleColumnFind(&other->group->xData, set->xDataMax - set->window);
+		for (i=start; i<other->dataCurr; i++)
+			if (sampleColumnAt(&other->yData, i) < set->yScaleMin || sampleColumnAt(&other->yData, i) > set->yScaleMax) {
+				testCheck (0, "window scale holds the window", i);
+				break;
+			}
+	}
+}
+
+// the windowed y scale over a group appended together.  an old spike leaves
+// the window and the scale comes back in, once the scale is known every trace
+// is told and what it's told covers them all
+static void testDataWindow (void) {
+	struct dyDataSet* set = dyDataNew();
+	struct dyChannelGroup* group = dyDataNewGroup();
+	struct dyDataTrace* traces[TEST_TRACES];
+	static float x[TEST_BLOCK], y[TEST_TRACES][TEST_BLOCK];
+	const float* columns[TEST_TRACES];
+	uint32_t n, i, k;
+
+	for (k=0; k<TEST_TRACES; k++) {
+		traces[k] = dyDataAddTrace (set, group, NULL);
+		columns[k] = y[k];
+	}
+	dyDataSetObserver (set, testScaleObserver, NULL);
+	dyDataSetWindow (set, 10*TEST_BLOCK*TEST_PERIOD, 0.2);
+	appended = 0;
+
+	for (n=0; n<TEST_LENGTH/10; n+=TEST_BLOCK) {
+		for (i=0; i<TEST_BLOCK; i++) {
+			x[i] = (n + i)*TEST_PERIOD;
+			for (k=0; k<TEST_TRACES; k++)
+				y[k][i] = testSample(n + i)*(k + 1) + ((n == 5*TEST_BLOCK && i == 0 && k == 1) ? 100000.0f : 0);
+		}
+		testCheck (dyDataAppendMulti (traces, TEST_TRACES, x, columns, TEST_BLOCK) == 0, "append", n);
+	}
+	testCheck (appended == TEST_TRACES*(TEST_LENGTH/10)/TEST_BLOCK, "observer told of every window append", appended);
+	testCheck (set->yScaleMax < 50000.0f, "spike left the window scale", (uint32_t) set->yScaleMax);
+
+	// the motors idle after a spike, a window of nothing but 0 comes back in
+	// around 0 instead of keeping the spike's range
+	for (; n<TEST_LENGTH/5; n+=TEST_BLOCK) {
+		for (i=0; i<TEST_BLOCK; i++) {
+			x[i] = (n + i)*TEST_PERIOD;
+			for (k=0; k<TEST_TRACES; k++)
+				y[k][i] = (n == TEST_LENGTH/10 && i == 0) ? 100000.0f : 0;
+		}
+		testCheck (dyDataAppendMulti (traces, TEST_TRACES, x, columns, TEST_BLOCK) == 0, "append", n);
+	}
+	testCheck (set->yScaleMin < 0 && set->yScaleMin >= -2*DY_DATA_FLAT_PAD && set->yScaleMax > 0 && set->yScaleMax <= 2*DY_DATA_FLAT_PAD,
+		"flat window rescaled", (uint32_t) set->yScaleMax);
+
+	testDataFree (set, group);
+}
+
+// there's no dyDataFree, the graph keeps its data for as long as it runs
+static void testDataFree (struct dyDataSet* set, struct dyChannelGroup* group) {
+	uint32_t i;
+
+	for (i=0; i<set->traceCount; i++) {
+		sampleColumnFree (&set->traces[i]->yData);
+		minMaxPyramidFree (&set->traces[i]->pyramid);
+		free(set->traces[i]);
+	}
+	free(set->traces);
+	free(set);
+	sampleColumnFree (&group->xData);
+	free(group->traces);
+	free(group);
+}
+
+// ns a sample to append and ns a range query over a long trace
+static void benchData (void) {
+	struct dyDataSet* set = dyDataNew();
+	struct dyChannelGroup* group = dyDataNewGroup();
+	struct dyDataTrace* trace = dyDataAddTrace (set, group, NULL);
+	static float x[TEST_BLOCK], y[TEST_BLOCK];
+	uint32_t n, i, start, minIndex, maxIndex, sum = 0;
+	double begin, append, query;
+
+	srand(3);
+	begin = benchNow();
+	for (n=0; n<BENCH_SAMPLES; n+=TEST_BLOCK) {
+		for (i=0; i<TEST_BLOCK; i++) {
+			x[i] = n + i;
+			y[i] = testSample(n + i);
+		}
+		dyDataAppend (trace, x, y, TEST_BLOCK);
+	}
+	append = benchNow() - begin;
+
+	begin = benchNow();
+	for (i=0; i<BENCH_QUERIES; i++) {
+		start = rand() % BENCH_SAMPLES;
+		dyDataRange (trace, start, start + 1 + rand() % (BENCH_SAMPLES - start), &minIndex, &maxIndex);
+		sum += minIndex ^ maxIndex;
+	}
+	query = benchNow() - begin;
+
+	printf ("%u samples: append %.1f ns a sample, range query %.0f ns (%u)\n", BENCH_SAMPLES,
+		append*1e9/BENCH_SAMPLES, query*1e9/BENCH_QUERIES, sum & 1);
+	testDataFree (set, group);
+}
+
+static double benchNow (void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec*1e-9;
+}
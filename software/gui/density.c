@@ -0,0 +1,276 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "gtkgraph.h"
+#include "gtkgraph_internal.h"
+
+/* The density renderer.  Rather than joining up the points of an XY trace it
+ * counts how many land in each pixel of the plotting area and shades the pixel
+ * by the log of the count, in the trace's colour, so a whole flight of a noisy
+ * signal (or one channel against another) shows where it spends its time
+ * instead of a solid scribble.  Nothing is decimated and no GDK call is made
+ * per point: every point is binned, split across threads when there are
+ * enough of them, then the shaded image is painted over the axes once.  Each
+ * trace keeps its counts, so while the axes and size stay the same only the
+ * points appended since the last redraw are binned.  A new axis, size or
+ * format, or points dropping off the front, bins the trace from scratch. */
+
+#define GTK_GRAPH_DENSITY_THREAD_POINTS (1 << 20)	/* fewer points than this are binned on the calling thread */
+#define GTK_GRAPH_DENSITY_MAX_THREADS 8
+#define GTK_GRAPH_DENSITY_FLOOR 0.25				/* opacity of a pixel with one point, so lone points still show */
+
+/* One thread's share of a trace */
+typedef struct
+{
+GtkGraphTrace *t;
+gint start;				/* points start .. end-1 */
+gint end;
+guint32 *counts;		/* its own width * height bins */
+gint width;
+gint height;
+gfloat x_min;
+gfloat x_scale;
+gfloat y_max;
+gfloat y_scale;
+} GtkGraphDensityJob;
+
+/* Declaration of all local functions */
+
+static void *gtk_graph_density_bin(void *data);
+static gboolean gtk_graph_density_check(GtkGraph *graph);
+static void gtk_graph_density_bin_trace(GtkGraph *graph, GtkGraphTrace *t, gint from, gint threads);
+static void gtk_graph_density_shade(GtkGraph *graph, GtkGraphTrace *t);
+static gint gtk_graph_density_threads(void);
+
+/* Externally referenceable functions */
+
+/**
+ * gtk_graph_density_plot:
+ * @graph:  the #GtkGraph, bound and with its axes scaled
+ *
+ * Bins the points of every XY trace without markers that haven't been
+ * binned yet, shades the bins and paints them onto the graph's pixmap.
+ */
+void gtk_graph_density_plot(GtkGraph *graph)
+{
+GtkGraphTrace *t;
+gint n, from, end, threads = 1, size = user_width * user_height;
+gboolean keep;
+cairo_t *cr;
+
+if (user_width <= 0 || user_height <= 0)
+	return;
+
+keep = gtk_graph_density_check(graph);
+cairo_surface_flush(graph->density);
+for (n = 0 ; n < user_height ; n++)
+	memset(cairo_image_surface_get_data(graph->density) + n * cairo_image_surface_get_stride(graph->density), 0, user_width * 4);
+
+for (n = 0 ; n < graph->num_traces ; n++)
+	if (graph->traces[n]->num_points >= GTK_GRAPH_DENSITY_THREAD_POINTS)
+		threads = gtk_graph_density_threads();
+
+if (graph->density_counts_size < (threads - 1) * size)
+	{
+	graph->density_counts_size = (threads - 1) * size;
+	graph->density_counts = (guint32 *) g_realloc(graph->density_counts, graph->density_counts_size * sizeof(guint32));
+	}
+
+for (n = 0 ; n < graph->num_traces ; n++)
+	{
+	t = graph->traces[n];
+	if (t->x_chunks == NULL || t->y_chunks == NULL || t->num_points == 0 || t->format->marker_type != GTK_GRAPH_MARKER_NONE || !t->format->line_visible)
+		{
+		t->density_end = 0;	/* markers are drawn with GDK */
+		continue;
+		}
+
+	/* carry on from the last point binned unless the counts can't be kept or points have gone */
+	end = t->first_point + t->num_points;
+	from = t->density_end;
+	if (t->density_counts == NULL)
+		t->density_counts = (guint32 *) g_malloc(size * sizeof(guint32));
+	if (!keep || t->density_end == 0 || t->density_start != t->first_point || end < t->density_end)
+		{
+		memset(t->density_counts, 0, size * sizeof(guint32));
+		from = t->first_point;
+		}
+	t->density_start = t->first_point;
+	t->density_end = end;
+
+	gtk_graph_density_bin_trace(graph, t, from, end - from >= GTK_GRAPH_DENSITY_THREAD_POINTS ? threads : 1);
+	gtk_graph_density_shade(graph, t);
+	}
+cairo_surface_mark_dirty(graph->density);
+
+cr = gdk_cairo_create(buffer);
+cairo_set_source_surface(cr, graph->density, user_origin_x, user_origin_y);
+cairo_paint(cr);
+cairo_destroy(cr);
+}
+
+void gtk_graph_density_free(GtkGraph *graph)
+{
+gint n;
+
+if (graph->density != NULL)
+	cairo_surface_destroy(graph->density);
+graph->density = NULL;
+g_free(graph->density_counts);
+graph->density_counts = NULL;
+graph->density_counts_size = 0;
+for (n = 0 ; n < graph->num_traces ; n++)
+	{
+	g_free(graph->traces[n]->density_counts);
+	graph->traces[n]->density_counts = NULL;
+	graph->traces[n]->density_end = 0;
+	}
+}
+
+/* Can the traces' counts be added to rather than binned from scratch?  Makes a
+ * new image, and drops the counts, if the size has changed */
+static gboolean gtk_graph_density_check(GtkGraph *graph)
+{
+gboolean ok = TRUE;
+
+if (graph->density == NULL || cairo_image_surface_get_width(graph->density) != user_width || cairo_image_surface_get_height(graph->density) != user_height)
+	{
+	gtk_graph_density_free(graph);
+	graph->density = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, user_width, user_height);
+	ok = FALSE;
+	}
+
+if (graph->dirty & GTK_GRAPH_DIRTY_FORMAT)
+	ok = FALSE;
+if (graph->density_x_min != graph->independant->axis_min || graph->density_x_scale != graph->independant->scale_factor)
+	ok = FALSE;
+if (graph->density_y_max != graph->dependant->axis_max || graph->density_y_scale != graph->dependant->scale_factor)
+	ok = FALSE;
+
+graph->density_x_min = graph->independant->axis_min;
+graph->density_x_scale = graph->independant->scale_factor;
+graph->density_y_max = graph->dependant->axis_max;
+graph->density_y_scale = graph->dependant->scale_factor;
+return ok;
+}
+
+/* Add t's points from .. first_point + num_points - 1 to t->density_counts.  With
+ * more than one thread each slice but the first is counted into its own bins in
+ * graph->density_counts, which are then added on */
+static void gtk_graph_density_bin_trace(GtkGraph *graph, GtkGraphTrace *t, gint from, gint threads)
+{
+GtkGraphDensityJob jobs[GTK_GRAPH_DENSITY_MAX_THREADS];
+pthread_t ids[GTK_GRAPH_DENSITY_MAX_THREADS];
+gboolean started[GTK_GRAPH_DENSITY_MAX_THREADS];
+gint size = user_width * user_height;
+gint n = t->first_point + t->num_points - from;
+gint k, i;
+
+if (threads > 1)
+	memset(graph->density_counts, 0, (threads - 1) * size * sizeof(guint32));
+for (k = 0 ; k < threads ; k++)
+	{
+	jobs[k].t = t;
+	jobs[k].start = from + (gint) ((gint64) n * k / threads);
+	jobs[k].end = from + (gint) ((gint64) n * (k + 1) / threads);
+	jobs[k].counts = (k == 0) ? t->density_counts : graph->density_counts + (k - 1) * size;
+	jobs[k].width = user_width;
+	jobs[k].height = user_height;
+	jobs[k].x_min = graph->independant->axis_min;
+	jobs[k].x_scale = graph->independant->scale_factor;
+	jobs[k].y_max = graph->dependant->axis_max;
+	jobs[k].y_scale = graph->dependant->scale_factor;
+	}
+
+/* the calling thread takes the first slice, and any a thread couldn't be started for */
+for (k = 1 ; k < threads ; k++)
+	started[k] = (pthread_create(&ids[k], NULL, gtk_graph_density_bin, &jobs[k]) == 0);
+gtk_graph_density_bin(&jobs[0]);
+for (k = 1 ; k < threads ; k++)
+	{
+	if (started[k])
+		pthread_join(ids[k], NULL);
+	else
+		gtk_graph_density_bin(&jobs[k]);
+	}
+
+for (k = 1 ; k < threads ; k++)
+	for (i = 0 ; i < size ; i++)
+		t->density_counts[i] += jobs[k].counts[i];
+}
+
+/* Count one slice of a trace, a block of the chunked data at a time */
+static void *gtk_graph_density_bin(void *data)
+{
+GtkGraphDensityJob *job = (GtkGraphDensityJob *) data;
+GtkGraphTrace *t = job->t;
+gint mask = (1 << t->chunk_shift) - 1;
+gint i = job->start, end, k;
+gfloat *x, *y;
+gfloat px, py;
+
+while (i < job->end)
+	{
+	x = t->x_chunks[(i >> t->chunk_shift) - (t->first_point >> t->chunk_shift)];
+	y = t->y_chunks[(i >> t->chunk_shift) - (t->first_point >> t->chunk_shift)];
+	end = MIN(job->end, (i & ~mask) + mask + 1);
+	for (k = i & mask ; i < end ; i++, k++)
+		{
+		px = (x[k] - job->x_min) * job->x_scale;
+		py = (job->y_max - y[k]) * job->y_scale;
+		if (px >= 0 && px < job->width && py >= 0 && py < job->height)	/* NaNs fail too */
+			job->counts[(gint) py * job->width + (gint) px]++;
+		}
+	}
+return NULL;
+}
+
+/* Shade the counts in t's colour over what earlier traces left on the image.  Opacity
+ * goes with the log of the count, from GTK_GRAPH_DENSITY_FLOOR for one point up to
+ * solid for the busiest pixel */
+static void gtk_graph_density_shade(GtkGraph *graph, GtkGraphTrace *t)
+{
+guchar *data = cairo_image_surface_get_data(graph->density);
+gint stride = cairo_image_surface_get_stride(graph->density);
+gfloat red = t->format->line_color.red / 65535.0;
+gfloat green = t->format->line_color.green / 65535.0;
+gfloat blue = t->format->line_color.blue / 65535.0;
+guint32 *pixel, *counts = t->density_counts, max = 0;
+gfloat alpha, keep, log_max;
+gint i, row, col;
+
+for (i = 0 ; i < user_width * user_height ; i++)
+	max = MAX(max, counts[i]);
+if (max == 0)
+	return;
+log_max = logf(1.0 + max);
+
+for (row = 0 ; row < user_height ; row++)
+	{
+	pixel = (guint32 *) (data + row * stride);
+	for (col = 0 ; col < user_width ; col++, pixel++, counts++)
+		{
+		if (*counts == 0)
+			continue;
+		alpha = GTK_GRAPH_DENSITY_FLOOR + (1.0 - GTK_GRAPH_DENSITY_FLOOR) * logf(1.0 + *counts) / log_max;
+		keep = 1.0 - alpha;		/* premultiplied OVER */
+		*pixel = ((guint32) rint(alpha * 255 + keep * (*pixel >> 24)) << 24)
+			| ((guint32) rint(red * alpha * 255 + keep * ((*pixel >> 16) & 0xff)) << 16)
+			| ((guint32) rint(green * alpha * 255 + keep * ((*pixel >> 8) & 0xff)) << 8)
+			| (guint32) rint(blue * alpha * 255 + keep * (*pixel & 0xff));
+		}
+	}
+}
+
+/* Threads to bin a big trace with, one per processor */
+static gint gtk_graph_density_threads(void)
+{
+glong processors = sysconf(_SC_NPROCESSORS_ONLN);
+
+if (processors < 1)
+	return 1;
+return MIN(processors, GTK_GRAPH_DENSITY_MAX_THREADS);
+}
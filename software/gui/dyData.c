@@ -0,0 +1,351 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "dyData.h"
+
+static int dyDataAppendTrace (struct dyDataTrace * trace, const float* x, const float* y, uint32_t n, float xMin, float xMax);
+static dyDataChange dyDataUpdateLimits (struct dyDataTrace * trace, float xMin, float xMax, float yMin, float yMax);
+static dyDataChange dyDataUpdateScale (struct dyDataSet * set);
+static void dyDataExtents (const float* data, uint32_t n, float* min, float* max);
+static void dyDataNotify (struct dyDataTrace * trace, dyDataChange changes);
+
+struct dyDataSet * dyDataNew (void) {
+	struct dyDataSet * set = malloc(sizeof(struct dyDataSet));
+
+	set->traces = NULL;
+	set->traceCount = 0;
+	set->xDataMax = 0;
+	set->xDataMin = 0;
+	set->yDataMax = 0;
+	set->yDataMin = 0;
+	set->history = 0;
+	set->window = 0;
+	set->hysteresis = 0;
+	set->yScaleMin = 0;
+	set->yScaleMax = 0;
+	set->observer.changed = NULL;
+	set->observer.context = NULL;
+	return set;
+}
+
+struct dyChannelGroup * dyDataNewGroup (void) {
+	struct dyChannelGroup * group = malloc(sizeof(struct dyChannelGroup));
+
+	sampleColumnInit(&group->xData);
+	group->traces = NULL;
+	group->traceCount = 0;
+	return group;
+}
+
+// a trace that takes its x values from group (a new group of its own if NULL).  every
+// trace in a group has to be given the same x values in the same order.  a trace
+// that joins late starts from wherever the group has got to
+struct dyDataTrace * dyDataAddTrace (struct dyDataSet * set, struct dyChannelGroup * group, void * user) {
+	struct dyDataTrace * trace = malloc(sizeof(struct dyDataTrace));
+
+	if (group == NULL)
+		group = dyDataNewGroup();
+	group->traces = realloc(group->traces, sizeof(struct dyDataTrace*)*(group->traceCount+1));
+	group->traces[group->traceCount++] = trace;
+	set->traces = realloc(set->traces, sizeof(struct dyDataTrace*)*(set->traceCount+1));
+	set->traces[set->traceCount++] = trace;
+
+	trace->set = set;
+	trace->group = group;
+	sampleColumnInit(&trace->yData);
+	trace->yData.start = trace->yData.end = group->xData.end;
+	trace->dataCurr = group->xData.end;
+	trace->xDataMax = 0;
+	trace->xDataMin = 0;
+	trace->yDataMax = 0;
+	trace->yDataMin = 0;
+	minMaxPyramidInit(&trace->pyramid);
+	minMaxPyramidDiscard(&trace->pyramid, group->xData.end);
+	trace->changes = 0;
+	trace->user = user;
+	return trace;
+}
+
+void dyDataSetObserver (struct dyDataSet * set, void (*changed) (struct dyDataTrace*, dyDataChange, void*), void * context) {
+	set->observer.changed = changed;
+	set->observer.context = context;
+}
+
+// keep only the last history worth of x on every trace appended to from now on, 0 keeps
+// everything.  for live monitoring where memory would otherwise grow for as long as it runs
+void dyDataSetHistory (struct dyDataSet * set, float history) {
+	set->history = history;
+}
+
+// scale y to the last window of x instead of everything, 0 turns it off.
+// yScaleMin/Max are brought up to date straight away
+void dyDataSetWindow (struct dyDataSet * set, float window, float hysteresis) {
+	set->window = window;
+	set->hysteresis = hysteresis;
+	if (window > 0)
+		dyDataUpdateScale (set);
+}
+
+// append n points to one trace.  returns non zero if the trace is full
+int dyDataAppend (struct dyDataTrace * trace, const float* x, const float* y, uint32_t n) {
+	return dyDataAppendMulti (&trace, 1, x, &y, n);
+}
+
+// append n points to several traces that were sampled together.  y[i] is the
+// column for traces[i], x is shared so its extents are only found once, and
+// each set's windowed y scale is worked out once all of them have their block.
+// returns non zero if any of the traces was full
+int dyDataAppendMulti (struct dyDataTrace ** traces, uint32_t traceCount, const float* x, const float* const* y, uint32_t n) {
+	float xMin, xMax;
+	uint32_t i, j;
+	int full = 0;
+
+	if (n == 0)
+		return 0;
+
+	dyDataExtents (x, n, &xMin, &xMax);
+	for (i=0; i<traceCount; i++)
+		if (dyDataAppendTrace (traces[i], x, y[i], n, xMin, xMax))
+			full = -1;
+
+	// the traces are nearly always all in one set, the first one finds its scale
+	for (i=0; i<traceCount; i++) {
+		struct dyDataSet* set = traces[i]->set;
+		dyDataChange scale;
+
+		for (j=0; j<i && traces[j]->set != set; j++);
+		if (j < i || set->window <= 0)
+			continue;
+		scale = dyDataUpdateScale (set);
+		for (j=i; j<traceCount; j++)
+			if (traces[j]->set == set && traces[j]->changes)
+				traces[j]->changes |= scale;
+	}
+
+	for (i=0; i<traceCount; i++)
+		if (traces[i]->changes)
+			dyDataNotify (traces[i], traces[i]->changes);
+	return full;
+}
+
+// the first sample held for both x and y
+uint32_t dyDataHeldStart (const struct dyDataTrace * trace) {
+	return (trace->yData.start > trace->group->xData.start) ? trace->yData.start : trace->group->xData.start;
+}
+
+// index of the smallest and largest y in start .. end-1, from the pyramid instead of scanning them
+void dyDataRange (const struct dyDataTrace * trace, uint32_t start, uint32_t end, uint32_t* minIndex, uint32_t* maxIndex) {
+	minMaxPyramidQuery(&trace->pyramid, &trace->yData, start, end, minIndex, maxIndex);
+}
+
+// the held samples with x from xMin to xMax split into at most columns equal
+// runs, and the min and max y of each: what a plot that many pixels wide needs.
+// returns how many runs, fewer than columns when there aren't that many samples
+uint32_t dyDataDecimate (const struct dyDataTrace * trace, float xMin, float xMax, uint32_t columns, float* min, float* max) {
+	const struct sampleColumn* xData = &trace->group->xData;
+	uint32_t held = dyDataHeldStart(trace);
+	uint32_t start, end, count, c, lo, hi;
+
+	if (trace->dataCurr <= held)
+		return 0;
+	start = sampleColumnFind(xData, xMin);
+	end = sampleColumnFind(xData, xMax);
+	if (end < xData->end && sampleColumnAt(xData, end) <= xMax)
+		end++; // Find is the first >= xMax, take it if it's on the edge
+	if (start < held)
+		start = held;
+	if (end > trace->dataCurr)
+		end = trace->dataCurr;
+	if (end <= start)
+		return 0;
+
+	count = end - start;
+	if (columns > count)
+		columns = count;
+	for (c=0; c<columns; c++) {
+		dyDataRange (trace, start + (uint64_t)count*c/columns, start + (uint64_t)count*(c+1)/columns, &lo, &hi);
+		min[c] = sampleColumnAt(&trace->yData, lo);
+		max[c] = sampleColumnAt(&trace->yData, hi);
+	}
+	return columns;
+}
+
+// copy a block onto the end of a trace, dropping anything older than the
+// history if there is one.  x only gets copied if no other trace in the group
+// has added it yet.  what changed is left in trace->changes for the caller to
+// tell once the scale is done.  returns non zero if the trace is full
+static int dyDataAppendTrace (struct dyDataTrace * trace, const float* x, const float* y, uint32_t n, float xMin, float xMax) {
+	struct dyDataSet* set = trace->set;
+	struct dyChannelGroup* group = trace->group;
+	float** xChunks = group->xData.chunks;
+	uint32_t xChunkStart = group->xData.start >> SAMPLE_COLUMN_CHUNK_SHIFT;
+	float** yChunks = trace->yData.chunks;
+	uint32_t yChunkStart = trace->yData.start >> SAMPLE_COLUMN_CHUNK_SHIFT;
+	dyDataChange changes = DY_DATA_APPENDED;
+	float yMin, yMax;
+	uint32_t i;
+
+	trace->changes = 0;
+	if (trace->dataCurr - trace->yData.start + n > DY_DATA_MAX_TRACE_LENGTH) {
+		perror("\n***** DYDATA ERROR: Too many data points\n\n");
+		return -1;
+	}
+
+	// chunks never move so this is just a copy, no matter how long the trace is
+	if (group->xData.end == trace->dataCurr) {
+		if (sampleColumnAppend(&group->xData, x, n))
+			return -1;
+	} else if (group->xData.end != trace->dataCurr + n) {
+		perror("\n***** DYDATA ERROR: Trace is out of step with its channel group\n\n");
+		return -1;
+	}
+	if (sampleColumnAppend(&trace->yData, y, n))
+		return -1;
+	trace->dataCurr += n;
+
+	minMaxPyramidUpdate(&trace->pyramid, &trace->yData);
+
+	// x can only go once every trace in the group is done with it
+	if (set->history > 0) {
+		uint32_t keep = sampleColumnFind(&group->xData, sampleColumnAt(&group->xData, trace->dataCurr-1) - set->history);
+
+		if (keep > trace->dataCurr-1)
+			keep = trace->dataCurr-1;
+		sampleColumnDiscard(&trace->yData, keep);
+		minMaxPyramidDiscard(&trace->pyramid, keep);
+		trace->xDataMin = sampleColumnAt(&group->xData, keep);
+
+		for (i=0; i<group->traceCount; i++)
+			if (group->traces[i]->yData.start < keep)
+				keep = group->traces[i]->yData.start;
+		sampleColumnDiscard(&group->xData, keep);
+	}
+
+	// anything holding on to chunk tables that moved has to be told
+	if (group->xData.chunks != xChunks || (group->xData.start >> SAMPLE_COLUMN_CHUNK_SHIFT) != xChunkStart) {
+		for (i=0; i<group->traceCount; i++)
+			if (group->traces[i] != trace)
+				dyDataNotify (group->traces[i], DY_DATA_MOVED);
+		changes |= DY_DATA_MOVED;
+	}
+	if (trace->yData.chunks != yChunks || (trace->yData.start >> SAMPLE_COLUMN_CHUNK_SHIFT) != yChunkStart)
+		changes |= DY_DATA_MOVED;
+
+	dyDataExtents (y, n, &yMin, &yMax);
+	changes |= dyDataUpdateLimits (trace, xMin, xMax, yMin, yMax);
+	trace->changes = changes;
+	return 0;
+}
+
+// keep track of min and max data in x and y, for the trace and the set
+static dyDataChange dyDataUpdateLimits (struct dyDataTrace * trace, float xMin, float xMax, float yMin, float yMax) {
+	struct dyDataSet* set = trace->set;
+	dyDataChange changes = 0;
+
+	if (xMax > trace->xDataMax) {
+		trace->xDataMax = xMax;
+		if (xMax > set->xDataMax) {
+			set->xDataMax = xMax;
+			changes |= DY_DATA_X_MAX_CHANGED;
+		}
+	}
+
+	// with a history the oldest data keeps going, so the left edge follows the right
+	if (set->history > 0 && set->xDataMax - set->history > set->xDataMin) {
+		set->xDataMin = set->xDataMax - set->history;
+		changes |= DY_DATA_X_MIN_CHANGED;
+	}
+
+	if (xMin < trace->xDataMin) {
+		trace->xDataMin = xMin;
+		if (xMin < set->xDataMin) {
+			set->xDataMin = xMin;
+			changes |= DY_DATA_X_MIN_CHANGED;
+		}
+	}
+
+	if (yMax > trace->yDataMax) {
+		trace->yDataMax = yMax;
+		if (yMax > set->yDataMax) {
+			set->yDataMax = yMax;
+			changes |= DY_DATA_Y_CHANGED;
+		}
+	}
+
+	if (yMin < trace->yDataMin) {
+		trace->yDataMin = yMin;
+		if (yMin < set->yDataMin) {
+			set->yDataMin = yMin;
+			changes |= DY_DATA_Y_CHANGED;
+		}
+	}
+
+	return changes;
+}
+
+// y min/max of every trace over the newest window of x.  each is a binary
+// search for where the window starts and a pyramid query, O(log n) however
+// much the window holds, and it's done once per append call rather than per
+// trace or sample.  every trace is looked at, not just the one that got samples, so a
+// trace that has stopped getting them slides out of the window too
+static dyDataChange dyDataUpdateScale (struct dyDataSet * set) {
+	float lo = 0, hi = 0, pad;
+	uint32_t i, start, min, max;
+	int found = 0;
+
+	for (i=0; i<set->traceCount; i++) {
+		struct dyDataTrace* trace = set->traces[i];
+		uint32_t held = dyDataHeldStart(trace);
+
+		start = sampleColumnFind(&trace->group->xData, set->xDataMax - set->window);
+		if (start < held)
+			start = held;
+		if (start >= trace->dataCurr)
+			continue;
+		dyDataRange (trace, start, trace->dataCurr, &min, &max);
+		if (!found || sampleColumnAt(&trace->yData, min) < lo)
+			lo = sampleColumnAt(&trace->yData, min);
+		if (!found || sampleColumnAt(&trace->yData, max) > hi)
+			hi = sampleColumnAt(&trace->yData, max);
+		found = 1;
+	}
+	if (!found)
+		return 0;
+
+	// flat, there's no range to take a margin from so it gets a fixed one.
+	// after that it's like any other range, the scale left from a spike
+	// comes back in around it
+	if (hi <= lo) {
+		lo -= DY_DATA_FLAT_PAD;
+		hi += DY_DATA_FLAT_PAD;
+	}
+
+	if (lo >= set->yScaleMin && hi <= set->yScaleMax &&
+		set->yScaleMax - set->yScaleMin <= (1 + 2*set->hysteresis)*(hi - lo))
+		return 0;
+	pad = set->hysteresis*(hi - lo)/2;
+	set->yScaleMin = lo - pad;
+	set->yScaleMax = hi + pad;
+	return DY_DATA_Y_SCALE_CHANGED;
+}
+
+// one pass min/max.  kept branch free so gcc can vectorize it
+static void dyDataExtents (const float* data, uint32_t n, float* min, float* max) {
+	float lo = data[0];
+	float hi = data[0];
+	uint32_t i;
+
+	for (i=1; i<n; i++) {
+		lo = (data[i] < lo) ? data[i] : lo;
+		hi = (data[i] > hi) ? data[i] : hi;
+	}
+	*min = lo;
+	*max = hi;
+}
+
+static void dyDataNotify (struct dyDataTrace * trace, dyDataChange changes) {
+	if (trace->set->observer.changed != NULL)
+		trace->set->observer.changed (trace, changes, trace->set->observer.context);
+}
@@ -0,0 +1,106 @@
+#ifndef __DY_DATA_H__
+#define __DY_DATA_H__
+
+#include <stdint.h>
+
+#include "sampleColumn.h"
+#include "minMaxPyramid.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+// the data behind a dyGraph with nothing of GTK in it: samples, extents, the
+// history window, a y scale for the latest window of x and min/max queries
+// over any stretch of a trace.  a dyGraph watches one of these through its
+// observer and moves the axes and redraws when it's told something changed.
+// anything that only wants the numbers (a headless ingest, a benchmark) can
+// use one on its own with no observer.
+// not thread safe, the sample columns share one chunk pool.
+
+#define DY_DATA_MAX_TRACE_LENGTH 10000000
+#define DY_DATA_FLAT_PAD 1.0f    // y either side of a window that's all one value, a count of the raw channels
+
+struct dyDataSet;
+struct dyDataTrace;
+
+typedef enum
+{
+DY_DATA_APPENDED        = 1 << 0, // the trace got samples
+DY_DATA_X_MAX_CHANGED   = 1 << 1, // the set's extents moved
+DY_DATA_X_MIN_CHANGED   = 1 << 2,
+DY_DATA_Y_CHANGED       = 1 << 3,
+DY_DATA_MOVED           = 1 << 4, // the trace's chunk tables moved, anything holding on to them needs the new ones
+DY_DATA_Y_SCALE_CHANGED = 1 << 5, // the windowed y scale moved
+}dyDataChange;
+
+// told after every append, and about every other trace in the group whose x
+// chunks moved because of it (those can be in other sets)
+struct dyDataObserver {
+	void (*changed) (struct dyDataTrace* trace, dyDataChange changes, void* context);
+	void* context;
+};
+
+// traces sampled together (e.g. every channel of one fcu packet) keep one copy
+// of their x values here instead of one each.  traces can be in different sets
+struct dyChannelGroup {
+	struct sampleColumn xData;   // the first trace to get a block of samples appends its x, the rest just check it's there
+	struct dyDataTrace** traces;
+	uint32_t traceCount;
+};
+
+struct dyDataTrace {
+	struct dyDataSet* set;
+	struct dyChannelGroup* group; // x values, shared with the rest of the group
+	struct sampleColumn yData;    // pooled fixed size chunks, appending never moves what's already there
+	uint32_t dataCurr;            // samples ever added to the group when this trace last got some, held ones start at yData.start
+	float xDataMax;
+	float xDataMin;
+	float yDataMax;
+	float yDataMin;
+	struct minMaxPyramid pyramid; // min/max of yData at every zoom level, lets a huge trace draw in O(pixels)
+	dyDataChange changes;         // what the append in progress did to it, told once the set's y scale is known
+	void* user;                   // for the observer to find its own end of the trace
+};
+
+struct dyDataSet {
+	struct dyDataTrace** traces;
+	uint32_t traceCount;
+
+	float xDataMax;
+	float yDataMax;
+	float xDataMin;
+	float yDataMin;
+
+	float history; // only keep this much x (seconds for live data) per trace, 0 keeps everything
+
+	// y over just the newest window of x, so an old spike doesn't flatten
+	// the live view forever.  the scale grows as soon as the data leaves it
+	// and shrinks once the window's range is hysteresis smaller, with
+	// hysteresis/2 of margin either side so it doesn't jitter.  a window that's
+	// flat counts as DY_DATA_FLAT_PAD either side of its one value
+	float window;     // width of x, 0 is off
+	float hysteresis; // fraction of the range
+	float yScaleMin;
+	float yScaleMax;
+
+	struct dyDataObserver observer;
+};
+
+struct dyDataSet * dyDataNew (void);
+struct dyChannelGroup * dyDataNewGroup (void);
+struct dyDataTrace * dyDataAddTrace (struct dyDataSet * set, struct dyChannelGroup * group, void * user);
+void dyDataSetObserver (struct dyDataSet * set, void (*changed) (struct dyDataTrace*, dyDataChange, void*), void * context);
+void dyDataSetHistory (struct dyDataSet * set, float history);
+void dyDataSetWindow (struct dyDataSet * set, float window, float hysteresis);
+int dyDataAppend (struct dyDataTrace * trace, const float* x, const float* y, uint32_t n);
+int dyDataAppendMulti (struct dyDataTrace ** traces, uint32_t traceCount, const float* x, const float* const* y, uint32_t n);
+uint32_t dyDataHeldStart (const struct dyDataTrace * trace);
+void dyDataRange (const struct dyDataTrace * trace, uint32_t start, uint32_t end, uint32_t* minIndex, uint32_t* maxIndex);
+uint32_t dyDataDecimate (const struct dyDataTrace * trace, float xMin, float xMax, uint32_t columns, float* min, float* max);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __DY_DATA_H__ */
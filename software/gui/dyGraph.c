@@ -19,9 +19,11 @@
 #include "gtkgraph.h"
 #include "dyGraph.h"
 
-#define INITIAL_TRACE_DATA_LENGTH 100
-#define MAX_TRACE_DATA_LENGTH 10000000
 #define MAX_TRACE_GRAPH_LENGTH 1000
+#define SPECTRUM_AVERAGES 8     // segments a spectrum trace is averaged over
+#define SPECTRUM_RANGE_DB 80    // how far below the peak the y axis goes
+#define SPECTRUM_STEP_DB 10     // the y axis moves in these so it isn't rescaled every segment
+#define SPECTRUM_FLOOR 1e-12    // power a dB is taken of at least, an empty bin is -120 dB
 
 static void traceEnableToggleCB (GtkToggleButton* checkBox, struct handlerData* data);
 static void globalEnableToggleCB (GtkToggleButton* checkBox, struct dyGraph* graphInfo);
@@ -33,6 +35,12 @@ static gint pointerMotionCB (GtkWidget *widget, GdkEventMotion *event, struct dy
 static void scaleXToggleCB (GtkToggleButton* toggleButton, struct dyGraph* graphInfo);
 static void scaleYToggleCB (GtkToggleButton* toggleButton, struct dyGraph* graphInfo);
 static void panXToggleCB (GtkToggleButton* toggleButton, struct dyGraph* graphInfo);
+static void dyGraphDataChanged (struct dyDataTrace* data, dyDataChange changes, void* context);
+static void dyGraphShowTrace (struct dyGraph* graphInfo, struct dyTrace* trace, uint32_t end);
+static void dyGraphScaleY (struct dyGraph* graphInfo);
+static void dyGraphTraceRange (gpointer data, gint start, gint end, gint* minIndex, gint* maxIndex);
+static void dyGraphShowSpectrum (struct dyGraph* graphInfo, struct dyTrace* trace);
+static uint8_t dyGraphScaleSpectrum (struct dyGraph* graphInfo);
 
 void dyGraphRedrawAll (struct dyGraph * graphInfo);
 void dyGraphRedrawTrace (struct dyGraph* graphInfo, struct dyTrace* trace);
@@ -155,11 +163,22 @@ struct dyGraph * dyGraphInit (char* title, char* subTitle, char* xLabel, char* y
 	graphInfo->autoScaleX = settings & DYGRAPH_AUTO_SCALE_X;
 	graphInfo->autoScaleY = settings & DYGRAPH_AUTO_SCALE_Y;
 	graphInfo->autoPanX = settings & DYGRAPH_AUTO_PAN_X;
-	
-	graphInfo->xDataMax = 0;
-	graphInfo->xDataMin = 0;
-	graphInfo->yDataMax = 0;
-	graphInfo->yDataMin = 0;
+	graphInfo->windowScaleY = (settings & DYGRAPH_AUTO_SCALE_Y_WINDOW) != 0;
+	graphInfo->frequencies = NULL;
+	graphInfo->spectrumSize = 0;
+	graphInfo->sampleRate = 0;
+	graphInfo->spectrumMin = yMin;
+	graphInfo->spectrumMax = yMax;
+
+	if (settings & DYGRAPH_ANTIALIAS)
+		gtk_graph_set_renderer(graph, GTK_GRAPH_RENDER_CAIRO);
+	if (settings & DYGRAPH_DENSITY)
+		gtk_graph_set_renderer(graph, GTK_GRAPH_RENDER_DENSITY);
+	
+	graphInfo->data = dyDataNew();
+	dyDataSetObserver(graphInfo->data, dyGraphDataChanged, graphInfo);
+	if (graphInfo->windowScaleY)
+		dyDataSetWindow(graphInfo->data, xMax, 0);
 
 	graphInfo->traces = (struct dyTrace**)malloc(sizeof(struct dyTrace*)*256);
 	graphInfo->traceCount = 0;
@@ -167,7 +186,19 @@ struct dyGraph * dyGraphInit (char* title, char* subTitle, char* xLabel, char* y
 	return graphInfo;
 }
 
+// a trace with its own x values
 struct dyTrace * dyGraphAddTrace (struct dyGraph * graphInfo, GtkGraphLineType type, gint width, GdkColor line_color, char * name) {
+	return dyGraphAddGroupTrace (graphInfo, NULL, type, width, line_color, name);
+}
+
+// traces sampled together share one copy of their x values, see dyData.h
+struct dyChannelGroup * dyGraphNewGroup (void) {
+	return dyDataNewGroup();
+}
+
+// a trace that takes its x values from group (a new group of its own if NULL).  every
+// trace in a group has to be given the same x values in the same order
+struct dyTrace * dyGraphAddGroupTrace (struct dyGraph * graphInfo, struct dyChannelGroup * group, GtkGraphLineType type, gint width, GdkColor line_color, char * name) {
 
 //******************* Stuff to do after initialization **********************
 	
@@ -257,17 +288,18 @@ struct dyTrace * dyGraphAddTrace (struct dyGraph * graphInfo, GtkGraphLineType t
 	graphInfo->traces[graphInfo->traceCount]->name = name;
 	graphInfo->traces[graphInfo->traceCount]->enableToggle = enableToggle;
 	graphInfo->traces[graphInfo->traceCount]->enableToggleAlign = enableToggleAlign;
-	graphInfo->traces[graphInfo->traceCount]->xData = (float*)malloc(sizeof(float)*INITIAL_TRACE_DATA_LENGTH);
-	graphInfo->traces[graphInfo->traceCount]->yData = (float*)malloc(sizeof(float)*INITIAL_TRACE_DATA_LENGTH);
-	graphInfo->traces[graphInfo->traceCount]->dataLength = INITIAL_TRACE_DATA_LENGTH;
-	graphInfo->traces[graphInfo->traceCount]->dataCurr = 0;
-	
-	graphInfo->traces[graphInfo->traceCount]->xDataMax = 0;
-	graphInfo->traces[graphInfo->traceCount]->xDataMin = 0;
-	graphInfo->traces[graphInfo->traceCount]->yDataMax = 0;
-	graphInfo->traces[graphInfo->traceCount]->yDataMin = 0;
+	graphInfo->traces[graphInfo->traceCount]->graphInfo = graphInfo;
+
+	// the samples go in the graph's data set
+	graphInfo->traces[graphInfo->traceCount]->data = dyDataAddTrace(graphInfo->data, group, graphInfo->traces[graphInfo->traceCount]);
+	graphInfo->traces[graphInfo->traceCount]->drawnCurr = graphInfo->traces[graphInfo->traceCount]->data->dataCurr;
 	
 	graphInfo->traces[graphInfo->traceCount]->enabled = 1;	
+	graphInfo->traces[graphInfo->traceCount]->spectrum = NULL;
+	graphInfo->traces[graphInfo->traceCount]->spectrumDb = NULL;
+	graphInfo->traces[graphInfo->traceCount]->frequencies = NULL;
+
+	gtk_graph_trace_set_range_func(graphInfo->graph, trace, dyGraphTraceRange, graphInfo->traces[graphInfo->traceCount]->data);
 	
 	// set up handler for enable checkbox
 	struct handlerData* data = malloc(sizeof(struct handlerData));
@@ -276,8 +308,8 @@ struct dyTrace * dyGraphAddTrace (struct dyGraph * graphInfo, GtkGraphLineType t
 	g_signal_connect (enableToggle, "toggled", G_CALLBACK (traceEnableToggleCB), data);
 	
 	if (graphInfo->traceCount <255) {
-		return graphInfo->traces[graphInfo->traceCount];
 		graphInfo->traceCount++;
+		return graphInfo->traces[graphInfo->traceCount - 1];
 	}
 	else {
 		perror("\n***** DYGRAPH ERROR: Too many traces\n\n");
@@ -286,76 +318,253 @@ struct dyTrace * dyGraphAddTrace (struct dyGraph * graphInfo, GtkGraphLineType t
 }
 
 void dyGraphAddData (struct dyGraph * graphInfo, struct dyTrace * trace, float x, float y) {
-	
-	if (trace->dataCurr > MAX_TRACE_DATA_LENGTH) {
-		perror("\n***** DYGRAPH ERROR: Too many data points\n\n");
-		return;
+	dyGraphAddDataBatch (graphInfo, trace, &x, &y, 1);
+}
+
+// append n points to one trace.  the data set works out the limits once for the
+// whole block and tells us, only one redraw is queued
+void dyGraphAddDataBatch (struct dyGraph * graphInfo, struct dyTrace * trace, const float* x, const float* y, uint32_t n) {
+	dyDataAppend (trace->data, x, y, n);
+}
+
+// append n points to several traces that were sampled together.  y[i] is the
+// column for traces[i], x is shared so its extents are only found once.  the
+// graph is redrawn once on the next frame tick whatever the trace count
+void dyGraphAddDataMulti (struct dyGraph * graphInfo, struct dyTrace ** traces, uint8_t traceCount, const float* x, const float* const* y, uint32_t n) {
+	struct dyDataTrace* data[256];
+	uint8_t i;
+
+	for (i=0; i<traceCount; i++)
+		data[i] = traces[i]->data;
+	dyDataAppendMulti (data, traceCount, x, y, n);
+}
+
+// keep only the last history worth of x on every trace added from now on, 0 keeps everything.
+// for live monitoring where memory would otherwise grow for as long as it runs
+void dyGraphSetHistory (struct dyGraph * graphInfo, float history) {
+	dyDataSetHistory (graphInfo->data, history);
+}
+
+// with DYGRAPH_AUTO_SCALE_Y_WINDOW, the y axis only follows the visible window
+// shrinking once it's this fraction smaller, so it doesn't jitter.  0 follows it exactly
+void dyGraphSetScaleHysteresis (struct dyGraph * graphInfo, float hysteresis) {
+	dyDataSetWindow (graphInfo->data, graphInfo->data->window, hysteresis);
+}
+
+// a graph of the power spectral density of its traces (see spectrum.h) against
+// frequency, up to sampleRate/2, in dB.  each trace is its own size point welch
+// estimate, fed with dyGraphAddSpectrumData rather than the time graph calls.
+// sampleRate is a starting point, dyGraphSetSpectrumRate moves traces to the
+// rate their samples really come at
+struct dyGraph * dyGraphInitSpectrum (char* title, char* subTitle, float sampleRate, uint16_t size, dyGraphType type) {
+	struct dyGraph * graphInfo = dyGraphInit (title, subTitle, "Hz", "dB", sampleRate/2, -SPECTRUM_RANGE_DB, 0, type, DYGRAPH_AUTO_SCALE_Y);
+	uint32_t bin;
+
+	graphInfo->spectrumSize = size;
+	graphInfo->sampleRate = sampleRate;
+	graphInfo->frequencies = malloc(sizeof(float)*(size/2 + 1));
+	for (bin=0; bin<=size/2u; bin++)
+		graphInfo->frequencies[bin] = bin*sampleRate/size;
+	return graphInfo;
+}
+
+struct dyTrace * dyGraphAddSpectrumTrace (struct dyGraph * graphInfo, GtkGraphLineType type, gint width, GdkColor line_color, char * name) {
+	struct dyTrace* trace;
+
+	if (graphInfo->frequencies == NULL) {
+		perror("\n***** DYGRAPH ERROR: Not a spectrum graph\n\n");
+		return 0;
 	}
-	
-	// keep track of min and max data in x and y
-	if (x > trace->xDataMax) {
-		trace->xDataMax = x;
-		if (x > graphInfo->xDataMax) {
-			graphInfo->xDataMax = x;
-			if (graphInfo->globalEnable && trace->enabled && graphInfo->autoPanX)
-				gtk_graph_axis_set_limits (graphInfo->graph, GTK_GRAPH_AXIS_INDEPENDANT, graphInfo->xDataMax, graphInfo->xDataMax - (graphInfo->graph->independant->axis_max - graphInfo->graph->independant->axis_min));
-			else if (graphInfo->globalEnable && trace->enabled && graphInfo->autoScaleX)
-				gtk_graph_axis_set_limits (graphInfo->graph, GTK_GRAPH_AXIS_INDEPENDANT, graphInfo->xDataMax, graphInfo->xDataMin);
-		}
+	trace = dyGraphAddTrace (graphInfo, type, width, line_color, name);
+	if (trace == 0)
+		return 0;
+
+	trace->spectrum = malloc(sizeof(struct spectrum));
+	if (spectrumInit (trace->spectrum, graphInfo->spectrumSize, graphInfo->spectrumSize/2, graphInfo->sampleRate, SPECTRUM_AVERAGES)) {
+		free(trace->spectrum);
+		trace->spectrum = NULL;
+		return 0;
 	}
-	
-	if (x < trace->xDataMin) {
-		trace->xDataMin = x;
-		if (x < graphInfo->xDataMin) {
-			graphInfo->xDataMin = x;
-			if (graphInfo->globalEnable && trace->enabled && graphInfo->autoScaleX  && !graphInfo->autoPanX)
-				gtk_graph_axis_set_limits (graphInfo->graph, GTK_GRAPH_AXIS_INDEPENDANT, graphInfo->xDataMax, graphInfo->xDataMin);
-		}
+	trace->spectrumDb = malloc(sizeof(float)*(graphInfo->spectrumSize/2 + 1));
+	trace->frequencies = malloc(sizeof(float)*(graphInfo->spectrumSize/2 + 1));
+	memcpy(trace->frequencies, graphInfo->frequencies, sizeof(float)*(graphInfo->spectrumSize/2 + 1));
+	gtk_graph_trace_set_range_func(graphInfo->graph, trace->trace, NULL, NULL); // flat data from now on
+	return trace;
+}
+
+// n more samples for each of traceCount spectrum traces, y[i] for traces[i].  a
+// trace is only redrawn when a segment finished, every hop samples
+void dyGraphAddSpectrumData (struct dyGraph * graphInfo, struct dyTrace ** traces, uint8_t traceCount, const float* const* y, uint32_t n) {
+	uint8_t i, changed = 0;
+
+	for (i=0; i<traceCount; i++) {
+		if (spectrumAdd (traces[i]->spectrum, y[i], n) == 0 || !(graphInfo->globalEnable && traces[i]->enabled))
+			continue;
+		dyGraphShowSpectrum (graphInfo, traces[i]);
+		changed = 1;
 	}
+	if (changed && graphInfo->autoScaleY && dyGraphScaleSpectrum (graphInfo))
+		dyGraphScaleY (graphInfo);
+}
 
-	if (y > trace->yDataMax) {
-		trace->yDataMax = y;
-		if (y > graphInfo->yDataMax) {
-			graphInfo->yDataMax = y;
-			if (graphInfo->globalEnable && trace->enabled && graphInfo->autoScaleY)
-				gtk_graph_axis_set_limits (graphInfo->graph, GTK_GRAPH_AXIS_DEPENDANT, graphInfo->yDataMax, graphInfo->yDataMin);
-		}
+// traceCount spectrum traces' samples turn out to be 1/sampleRate apart.  their
+// bins move to the new frequencies, their legend entries say the rate and the
+// x axis goes up to half the fastest trace's rate
+void dyGraphSetSpectrumRate (struct dyGraph * graphInfo, struct dyTrace ** traces, uint8_t traceCount, float sampleRate) {
+	char legend[64];
+	uint32_t bin;
+	uint8_t i;
+
+	for (i=0; i<traceCount; i++) {
+		spectrumSetRate (traces[i]->spectrum, sampleRate);
+		for (bin=0; bin<=traces[i]->spectrum->size/2; bin++)
+			traces[i]->frequencies[bin] = spectrumFrequency (traces[i]->spectrum, bin);
+		snprintf (legend, sizeof(legend), "%s (%.3g Hz)", traces[i]->name, sampleRate);
+		gtk_graph_trace_format_title (graphInfo->graph, traces[i]->trace, legend);
+		if (traces[i]->spectrum->segments > 0 && graphInfo->globalEnable && traces[i]->enabled)
+			dyGraphShowSpectrum (graphInfo, traces[i]);
 	}
-		
-	if (y < trace->yDataMin) {
-		trace->yDataMin = y;
-		if (y < graphInfo->yDataMin) {
-			graphInfo->yDataMin = y;
-			if (graphInfo->globalEnable && trace->enabled && graphInfo->autoScaleY)
-				gtk_graph_axis_set_limits (graphInfo->graph, GTK_GRAPH_AXIS_DEPENDANT, graphInfo->yDataMax, graphInfo->yDataMin);
+
+	graphInfo->sampleRate = 0;
+	for (i=0; i<graphInfo->traceCount; i++)
+		if (graphInfo->traces[i]->spectrum != NULL && graphInfo->traces[i]->spectrum->sampleRate > graphInfo->sampleRate)
+			graphInfo->sampleRate = graphInfo->traces[i]->spectrum->sampleRate;
+	gtk_graph_axis_set_limits (graphInfo->graph, GTK_GRAPH_AXIS_INDEPENDANT, graphInfo->sampleRate/2, 0);
+	if (graphInfo->autoScaleY && dyGraphScaleSpectrum (graphInfo))
+		dyGraphScaleY (graphInfo);
+}
+
+// the trace's psd in dB to the graph
+static void dyGraphShowSpectrum (struct dyGraph* graphInfo, struct dyTrace* trace) {
+	struct spectrum* s = trace->spectrum;
+	uint32_t bin, bins = s->size/2 + 1;
+	float min = 1e30, max = -1e30;
+
+	for (bin=0; bin<bins; bin++) {
+		trace->spectrumDb[bin] = 10*log10f(s->psd[bin] > SPECTRUM_FLOOR ? s->psd[bin] : SPECTRUM_FLOOR);
+		if (trace->spectrumDb[bin] < min)
+			min = trace->spectrumDb[bin];
+		if (trace->spectrumDb[bin] > max)
+			max = trace->spectrumDb[bin];
+	}
+	gtk_graph_trace_set_data(graphInfo->graph, trace->trace, trace->frequencies, trace->spectrumDb, 0, s->sampleRate/2, min, max, bins);
+}
+
+// y limits for the enabled spectrum traces: up to the highest peak and
+// SPECTRUM_RANGE_DB below it at most (bin 0 has had the mean taken out, it's
+// left out), in whole SPECTRUM_STEP_DB.  1 if they moved
+static uint8_t dyGraphScaleSpectrum (struct dyGraph* graphInfo) {
+	float min = 1e30, max = -1e30;
+	uint32_t bin;
+	uint8_t i;
+
+	for (i=0; i<graphInfo->traceCount; i++) {
+		struct dyTrace* trace = graphInfo->traces[i];
+		if (trace->spectrum == NULL || !trace->enabled || trace->spectrum->segments == 0)
+			continue;
+		for (bin=1; bin<=trace->spectrum->size/2; bin++) {
+			if (trace->spectrumDb[bin] < min)
+				min = trace->spectrumDb[bin];
+			if (trace->spectrumDb[bin] > max)
+				max = trace->spectrumDb[bin];
 		}
 	}
-	
-	// dynamic array basically - grow by factor of 2 if too small
-	if (trace->dataCurr >= trace->dataLength) {
-		trace->dataLength = trace->dataLength*2;
-		trace->xData = realloc(trace->xData, sizeof(float*)*(trace->dataLength));
-		trace->yData = realloc(trace->yData, sizeof(float*)*(trace->dataLength));
+	if (max < min)
+		return 0;
+
+	max = ceilf(max/SPECTRUM_STEP_DB)*SPECTRUM_STEP_DB;
+	min = floorf(min/SPECTRUM_STEP_DB)*SPECTRUM_STEP_DB;
+	if (min < max - SPECTRUM_RANGE_DB)
+		min = max - SPECTRUM_RANGE_DB;
+	if (min == graphInfo->spectrumMin && max == graphInfo->spectrumMax)
+		return 0;
+	graphInfo->spectrumMin = min;
+	graphInfo->spectrumMax = max;
+	return 1;
+}
+
+// lets the graph widget find the min/max of a run of samples from the pyramid instead of scanning them
+static void dyGraphTraceRange (gpointer data, gint start, gint end, gint* minIndex, gint* maxIndex) {
+	uint32_t lo, hi;
+
+	dyDataRange ((struct dyDataTrace*) data, start, end, &lo, &hi);
+	*minIndex = lo;
+	*maxIndex = hi;
+}
+
+// the data set's observer.  move the axes if we are auto scaling / panning, hand
+// the graph the new samples and give it new chunk tables when they've moved.  a
+// trace moved by another in its group can be on another graph, that's fine,
+// each set tells its own graph
+static void dyGraphDataChanged (struct dyDataTrace* data, dyDataChange changes, void* context) {
+	struct dyGraph* graphInfo = (struct dyGraph*) context;
+	struct dyTrace* trace = (struct dyTrace*) data->user;
+	struct dyDataSet* set = graphInfo->data;
+	uint8_t active = graphInfo->globalEnable && trace->enabled;
+
+	if (!(changes & DY_DATA_APPENDED)) {
+		if (changes & DY_DATA_MOVED)
+			dyGraphShowTrace(graphInfo, trace, trace->drawnCurr);
+		return;
 	}
-	trace->xData[trace->dataCurr] = x;
-	trace->yData[trace->dataCurr] = y;
-	trace->dataCurr++;
-	
-	//~ printf ("%d, %d, %p, %p\n", trace->dataCurr, trace->dataLength, trace->xData, trace->yData);
-	
-	if (graphInfo->globalEnable && trace->enabled)
+
+	if (active && (changes & DY_DATA_X_MAX_CHANGED) && graphInfo->autoPanX)
+		gtk_graph_axis_set_limits (graphInfo->graph, GTK_GRAPH_AXIS_INDEPENDANT, set->xDataMax, set->xDataMax - (graphInfo->graph->independant->axis_max - graphInfo->graph->independant->axis_min));
+	else if (active && (changes & (DY_DATA_X_MAX_CHANGED | DY_DATA_X_MIN_CHANGED)) && graphInfo->autoScaleX && !graphInfo->autoPanX)
+		gtk_graph_axis_set_limits (graphInfo->graph, GTK_GRAPH_AXIS_INDEPENDANT, set->xDataMax, set->xDataMin);
+
+	// the window is whatever x is showing, zoomed or not
+	if (graphInfo->windowScaleY && set->window != graphInfo->graph->independant->axis_max - graphInfo->graph->independant->axis_min) {
+		dyDataSetWindow (set, graphInfo->graph->independant->axis_max - graphInfo->graph->independant->axis_min, set->hysteresis);
+		changes |= DY_DATA_Y_SCALE_CHANGED;
+	}
+
+	if (active && (changes & (graphInfo->windowScaleY ? DY_DATA_Y_SCALE_CHANGED : DY_DATA_Y_CHANGED)) && graphInfo->autoScaleY)
+		dyGraphScaleY (graphInfo);
+
+	if (active)
 		dyGraphRedrawTrace (graphInfo, trace);
+	else if (changes & DY_DATA_MOVED)
+		dyGraphShowTrace(graphInfo, trace, trace->drawnCurr);
+}
+
+// y axis to everything there is, or just the window's worth, or a spectrum's range
+static void dyGraphScaleY (struct dyGraph* graphInfo) {
+	if (graphInfo->frequencies != NULL)
+		gtk_graph_axis_set_limits (graphInfo->graph, GTK_GRAPH_AXIS_DEPENDANT, graphInfo->spectrumMax, graphInfo->spectrumMin);
+	else if (graphInfo->windowScaleY)
+		gtk_graph_axis_set_limits (graphInfo->graph, GTK_GRAPH_AXIS_DEPENDANT, graphInfo->data->yScaleMax, graphInfo->data->yScaleMin);
+	else
+		gtk_graph_axis_set_limits (graphInfo->graph, GTK_GRAPH_AXIS_DEPENDANT, graphInfo->data->yDataMax, graphInfo->data->yDataMin);
 }
 
-// does not reload data from xData and yData
+// does not reload data from xData and yData.  the redraw happens on the next frame tick
 void dyGraphRedrawAll (struct dyGraph* graphInfo) {
-	gtk_graph_redraw_all((GtkWidget*)graphInfo->graph);
+	gtk_graph_queue_redraw(graphInfo->graph, GTK_GRAPH_DIRTY_AXES);
 }
 
-// reloads data from xData and yData
+// reloads data from xData and yData.  set_data queues the redraw
 void dyGraphRedrawTrace (struct dyGraph* graphInfo, struct dyTrace* trace) {
-	gtk_graph_trace_set_data(graphInfo->graph, trace->trace, trace->xData, trace->yData, trace->xDataMin, trace->xDataMax, trace->yDataMin, trace->yDataMax, trace->dataCurr);
-	gtk_graph_redraw_all((GtkWidget*)graphInfo->graph);
+	if (trace->spectrum != NULL)
+		dyGraphShowSpectrum(graphInfo, trace);
+	else
+		dyGraphShowTrace(graphInfo, trace, trace->data->dataCurr);
+}
+
+// hands the graph the held samples up to end (what it already had when a trace is disabled).
+// traces in a group pass the same x table so the graph only has to find the visible part once
+static void dyGraphShowTrace (struct dyGraph* graphInfo, struct dyTrace* trace, uint32_t end) {
+	struct dyDataTrace* data = trace->data;
+	struct sampleColumn* xData = &data->group->xData;
+	uint32_t start = dyDataHeldStart(data);
+
+	if (end < start)
+		end = start;
+	trace->drawnCurr = end;
+	gtk_graph_trace_set_chunked_data(graphInfo->graph, trace->trace,
+		xData->chunks + ((start >> SAMPLE_COLUMN_CHUNK_SHIFT) - (xData->start >> SAMPLE_COLUMN_CHUNK_SHIFT)),
+		data->yData.chunks + ((start >> SAMPLE_COLUMN_CHUNK_SHIFT) - (data->yData.start >> SAMPLE_COLUMN_CHUNK_SHIFT)),
+		SAMPLE_COLUMN_CHUNK_SHIFT, start, end - start, data->xDataMin, data->xDataMax, data->yDataMin, data->yDataMax);
 }
 
 //this will have to serve for all trace enable checkboxes
@@ -366,19 +575,22 @@ static void traceEnableToggleCB (GtkToggleButton* toggleButton, struct handlerDa
 
 static void globalEnableToggleCB (GtkToggleButton* toggleButton, struct dyGraph* graphInfo) {
 	graphInfo->globalEnable = gtk_toggle_button_get_active (toggleButton);
-	gtk_graph_axis_set_limits (graphInfo->graph, GTK_GRAPH_AXIS_DEPENDANT, graphInfo->yDataMax, graphInfo->yDataMin);
+	dyGraphScaleY (graphInfo);
 	dyGraphRedrawAll(graphInfo);
 }
 
 static void scaleXToggleCB (GtkToggleButton* toggleButton, struct dyGraph* graphInfo) {
 	graphInfo->autoScaleX = gtk_toggle_button_get_active (toggleButton);
-	gtk_graph_axis_set_limits (graphInfo->graph, GTK_GRAPH_AXIS_INDEPENDANT, graphInfo->xDataMax, graphInfo->xDataMin);
+	if (graphInfo->frequencies != NULL)
+		gtk_graph_axis_set_limits (graphInfo->graph, GTK_GRAPH_AXIS_INDEPENDANT, graphInfo->sampleRate/2, 0);
+	else
+		gtk_graph_axis_set_limits (graphInfo->graph, GTK_GRAPH_AXIS_INDEPENDANT, graphInfo->data->xDataMax, graphInfo->data->xDataMin);
 	dyGraphRedrawAll(graphInfo);
 }
 
 static void scaleYToggleCB (GtkToggleButton* toggleButton, struct dyGraph* graphInfo) {
 	graphInfo->autoScaleY = gtk_toggle_button_get_active (toggleButton);
-	gtk_graph_axis_set_limits (graphInfo->graph, GTK_GRAPH_AXIS_DEPENDANT, graphInfo->yDataMax, graphInfo->yDataMin);
+	dyGraphScaleY (graphInfo);
 	dyGraphRedrawAll(graphInfo);
 }
 
@@ -4,27 +4,34 @@
 #include <stdint.h>
 #include <gtk/gtk.h>
 #include "gtkgraph.h"
+#include "dyData.h"
+#include "spectrum.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif /* __cplusplus */
 
+struct dyGraph;
+struct dyTrace;
+
+// the widgets for a dyDataSet (dyData.h), which holds the samples.  the graph
+// observes its set and moves the axes and redraws when the data changes
+
 struct dyTrace {
 	gint trace;
 	char* name;
 	GtkWidget* enableToggle;
 	GtkWidget* enableToggleAlign;
+	struct dyGraph* graphInfo;
 
-	float* xData;
-	float* yData;
-	uint32_t dataLength;
-	uint32_t dataCurr;
-	float xDataMax;
-	float xDataMin;
-	float yDataMax;
-	float yDataMin;
+	struct dyDataTrace* data;     // the samples, in graphInfo->data
+	uint32_t drawnCurr;           // data->dataCurr when the graph was last given the trace
 
 	uint8_t enabled; // boolean - trace enabled
+
+	struct spectrum* spectrum;    // spectrum graphs only, what's drawn instead of the samples
+	float* spectrumDb;            // its psd in dB, handed to the graph
+	float* frequencies;           // its bins in Hz, at its own sample rate
 };
 
 struct dyGraph {
@@ -38,16 +45,21 @@ struct dyGraph {
 	struct dyTrace** traces;
 	volatile uint8_t traceCount;
 
-	float xDataMax;
-	float yDataMax;
-	float xDataMin;
-	float yDataMin;
+	struct dyDataSet* data; // samples and extents of every trace
 
 	uint8_t globalEnable; // boolean - enable for all traces
 
 	uint8_t autoScaleX;
 	uint8_t autoPanX;
 	uint8_t autoScaleY;
+	uint8_t windowScaleY; // auto scale y to the visible window of x rather than everything
+
+	// a spectrum graph (dyGraphInitSpectrum) plots its traces' psd, not their samples
+	float* frequencies;   // the bins at the rate it was made with, NULL on a time graph
+	uint16_t spectrumSize;
+	float sampleRate;     // of its fastest trace, the x axis goes up to half of it
+	float spectrumMin;    // dB the y axis auto scales to
+	float spectrumMax;
 	
 	float xZoomFactor;
 	float yZoomFactor;
@@ -77,11 +89,24 @@ typedef enum
 DYGRAPH_AUTO_SCALE_X = 1 << 0,
 DYGRAPH_AUTO_SCALE_Y = 1 << 1,
 DYGRAPH_AUTO_PAN_X   = 1 << 2,
+DYGRAPH_ANTIALIAS    = 1 << 3, // cairo renderer, scrolls instead of redrawing while auto panning
+DYGRAPH_AUTO_SCALE_Y_WINDOW = 1 << 4, // auto scale y to just what's visible, for auto panned live data
+DYGRAPH_DENSITY      = 1 << 5, // heat map of where the points fall, for whole flights of data
 }dyGraphSettings;
 
 struct dyGraph * dyGraphInit (char* title, char* subTitle, char* xLabel, char* yLabel, float xMax, float yMin, float yMax, dyGraphType type, dyGraphSettings settings);
 struct dyTrace * dyGraphAddTrace (struct dyGraph * graphInfo, GtkGraphLineType type, gint width, GdkColor line_color, char * name);
+struct dyChannelGroup * dyGraphNewGroup (void);
+struct dyTrace * dyGraphAddGroupTrace (struct dyGraph * graphInfo, struct dyChannelGroup * group, GtkGraphLineType type, gint width, GdkColor line_color, char * name);
 void dyGraphAddData (struct dyGraph * graphInfo, struct dyTrace * trace, float x, float y);
+void dyGraphAddDataBatch (struct dyGraph * graphInfo, struct dyTrace * trace, const float* x, const float* y, uint32_t n);
+void dyGraphAddDataMulti (struct dyGraph * graphInfo, struct dyTrace ** traces, uint8_t traceCount, const float* x, const float* const* y, uint32_t n);
+void dyGraphSetHistory (struct dyGraph * graphInfo, float history);
+void dyGraphSetScaleHysteresis (struct dyGraph * graphInfo, float hysteresis);
+struct dyGraph * dyGraphInitSpectrum (char* title, char* subTitle, float sampleRate, uint16_t size, dyGraphType type);
+struct dyTrace * dyGraphAddSpectrumTrace (struct dyGraph * graphInfo, GtkGraphLineType type, gint width, GdkColor line_color, char * name);
+void dyGraphAddSpectrumData (struct dyGraph * graphInfo, struct dyTrace ** traces, uint8_t traceCount, const float* const* y, uint32_t n);
+void dyGraphSetSpectrumRate (struct dyGraph * graphInfo, struct dyTrace ** traces, uint8_t traceCount, float sampleRate);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,474 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "flightLog.h"
+
+#define INITIAL_INDEX_SIZE 64
+
+#define ROUND8(n) (((n) + 7) & ~7)
+
+static uint32_t flightLogCrc (const uint8_t* data, size_t length);
+static int flightLogWrite (int fd, const void* data, size_t length);
+static int flightLogAddChunk (struct flightLogIndexEntry** index, uint32_t* chunkCount, uint32_t* indexSize, const struct flightLogIndexEntry* entry);
+static int flightLogReadIndex (struct flightLogReader* log);
+static void flightLogRebuildIndex (struct flightLogReader* log);
+static uint32_t flightLogChunkOf (const struct flightLogReader* log, uint64_t record);
+
+// starts a new log, replacing whatever was at path.  returns non zero on failure
+int flightLogCreate (struct flightLogWriter* log, const char* path, const char* packetName, uint16_t frameLength, const struct flightLogField* fields, uint32_t fieldCount) {
+	struct flightLogHeader header;
+	struct timespec now;
+	uint8_t padding[8] = {0};
+
+	memset(log, 0, sizeof(struct flightLogWriter));
+	log->fd = -1;
+
+	if (fieldCount > FLIGHT_LOG_MAX_FIELDS) {
+		fprintf(stderr, "\n***** FLIGHT LOG ERROR: %u fields, at most %d\n\n", fieldCount, FLIGHT_LOG_MAX_FIELDS);
+		return -1;
+	}
+
+	log->frameLength = frameLength;
+	log->recordSize = ROUND8(sizeof(double) + frameLength);
+	log->buffer = malloc(sizeof(struct flightLogChunkHeader) + (size_t)log->recordSize*FLIGHT_LOG_CHUNK_RECORDS);
+	if (log->buffer == NULL) {
+		perror("\n***** FLIGHT LOG ERROR: malloc failed\n\n");
+		return -1;
+	}
+
+	log->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (log->fd < 0) {
+		perror("\n***** FLIGHT LOG ERROR: open failed\n\n");
+		free(log->buffer);
+		log->buffer = NULL;
+		return -1;
+	}
+
+	memset(&header, 0, sizeof(struct flightLogHeader));
+	memcpy(header.magic, FLIGHT_LOG_MAGIC, sizeof(header.magic));
+	header.version = FLIGHT_LOG_VERSION;
+	header.byteOrder = FLIGHT_LOG_BYTE_ORDER;
+	header.headerSize = ROUND8(sizeof(struct flightLogHeader) + sizeof(struct flightLogField)*fieldCount);
+	header.frameLength = frameLength;
+	header.recordSize = log->recordSize;
+	header.fieldCount = fieldCount;
+	clock_gettime(CLOCK_REALTIME, &now);
+	header.wallTime = now.tv_sec + now.tv_nsec*1e-9;
+	header.monotonicTime = flightLogNow();
+	strncpy(header.packetName, packetName, FLIGHT_LOG_NAME_LENGTH-1);
+
+	if (flightLogWrite(log->fd, &header, sizeof(struct flightLogHeader)) ||
+		flightLogWrite(log->fd, fields, sizeof(struct flightLogField)*fieldCount) ||
+		flightLogWrite(log->fd, padding, header.headerSize - sizeof(struct flightLogHeader) - sizeof(struct flightLogField)*fieldCount)) {
+		close(log->fd);
+		free(log->buffer);
+		log->fd = -1;
+		log->buffer = NULL;
+		return -1;
+	}
+
+	log->offset = header.headerSize;
+	return 0;
+}
+
+// buffers one frame.  the chunk is written once it's full or its oldest record
+// is FLIGHT_LOG_FLUSH_SECONDS old.  returns non zero if a write failed
+int flightLogAppend (struct flightLogWriter* log, double rxTime, const uint8_t* frame) {
+	uint8_t* record = log->buffer + sizeof(struct flightLogChunkHeader) + (size_t)log->recordSize*log->buffered;
+
+	if (log->buffered == 0)
+		log->chunkTime = rxTime;
+
+	memcpy(record, &rxTime, sizeof(double));
+	memcpy(record + sizeof(double), frame, log->frameLength);
+	memset(record + sizeof(double) + log->frameLength, 0, log->recordSize - sizeof(double) - log->frameLength);
+	log->buffered++;
+	log->records++;
+
+	if (log->buffered == FLIGHT_LOG_CHUNK_RECORDS || rxTime - log->chunkTime >= FLIGHT_LOG_FLUSH_SECONDS)
+		return flightLogFlush(log);
+	return 0;
+}
+
+// for when nothing is arriving, so the last few frames still reach the disk
+int flightLogIdle (struct flightLogWriter* log, double now) {
+	if (log->buffered > 0 && now - log->chunkTime >= FLIGHT_LOG_FLUSH_SECONDS)
+		return flightLogFlush(log);
+	return 0;
+}
+
+// writes the buffered records out as one chunk, in a single write
+int flightLogFlush (struct flightLogWriter* log) {
+	struct flightLogChunkHeader* chunk = (struct flightLogChunkHeader*) log->buffer;
+	const uint8_t* records = log->buffer + sizeof(struct flightLogChunkHeader);
+	size_t length = (size_t)log->recordSize*log->buffered;
+	struct flightLogIndexEntry entry;
+
+	if (log->buffered == 0)
+		return 0;
+
+	chunk->magic = FLIGHT_LOG_CHUNK_MAGIC;
+	chunk->records = log->buffered;
+	chunk->crc = flightLogCrc(records, length);
+	chunk->reserved = 0;
+	memcpy(&chunk->firstTime, records, sizeof(double));
+	memcpy(&chunk->lastTime, records + (size_t)log->recordSize*(log->buffered-1), sizeof(double));
+
+	if (flightLogWrite(log->fd, log->buffer, sizeof(struct flightLogChunkHeader) + length))
+		return -1;
+
+	entry.offset = log->offset;
+	entry.firstRecord = log->records - log->buffered;
+	entry.firstTime = chunk->firstTime;
+	entry.lastTime = chunk->lastTime;
+	entry.records = log->buffered;
+	entry.reserved = 0;
+
+	log->offset += sizeof(struct flightLogChunkHeader) + length;
+	log->buffered = 0;
+	return flightLogAddChunk(&log->index, &log->chunkCount, &log->indexSize, &entry);
+}
+
+// writes the last chunk, the index and the trailer and closes the file
+int flightLogClose (struct flightLogWriter* log) {
+	struct flightLogTrailer trailer;
+	int error = 0;
+
+	if (log->fd < 0)
+		return -1;
+
+	error |= flightLogFlush(log);
+
+	trailer.magic = FLIGHT_LOG_TRAILER_MAGIC;
+	trailer.chunkCount = log->chunkCount;
+	trailer.indexOffset = log->offset;
+	trailer.crc = flightLogCrc((const uint8_t*) log->index, sizeof(struct flightLogIndexEntry)*log->chunkCount);
+	trailer.reserved = 0;
+
+	if (!error) {
+		error |= flightLogWrite(log->fd, log->index, sizeof(struct flightLogIndexEntry)*log->chunkCount);
+		error |= flightLogWrite(log->fd, &trailer, sizeof(struct flightLogTrailer));
+	}
+	if (fsync(log->fd) < 0 && errno != EINVAL) {
+		perror("\n***** FLIGHT LOG ERROR: fsync failed\n\n");
+		error = -1;
+	}
+	close(log->fd);
+
+	free(log->buffer);
+	free(log->index);
+	log->fd = -1;
+	log->buffer = NULL;
+	log->index = NULL;
+	return error ? -1 : 0;
+}
+
+// maps a log for reading.  a log that was never closed is read up to its last
+// complete chunk.  returns non zero if it isn't a usable log
+int flightLogOpen (struct flightLogReader* log, const char* path) {
+	struct stat st;
+
+	memset(log, 0, sizeof(struct flightLogReader));
+	log->fd = open(path, O_RDONLY);
+	if (log->fd < 0) {
+		perror("\n***** FLIGHT LOG ERROR: open failed\n\n");
+		return -1;
+	}
+	if (fstat(log->fd, &st) < 0 || st.st_size < (off_t) sizeof(struct flightLogHeader)) {
+		fprintf(stderr, "\n***** FLIGHT LOG ERROR: %s is too short to be a log\n\n", path);
+		close(log->fd);
+		log->fd = -1;
+		return -1;
+	}
+
+	log->size = st.st_size;
+	log->map = mmap(NULL, log->size, PROT_READ, MAP_SHARED, log->fd, 0);
+	if (log->map == MAP_FAILED) {
+		perror("\n***** FLIGHT LOG ERROR: mmap failed\n\n");
+		close(log->fd);
+		log->fd = -1;
+		log->map = NULL;
+		return -1;
+	}
+	log->header = (const struct flightLogHeader*) log->map;
+	log->fields = (const struct flightLogField*) (log->map + sizeof(struct flightLogHeader));
+
+	if (memcmp(log->header->magic, FLIGHT_LOG_MAGIC, sizeof(log->header->magic)) != 0 ||
+		log->header->byteOrder != FLIGHT_LOG_BYTE_ORDER ||
+		log->header->version != FLIGHT_LOG_VERSION ||
+		log->header->fieldCount > FLIGHT_LOG_MAX_FIELDS ||
+		log->header->headerSize > log->size ||
+		log->header->headerSize < sizeof(struct flightLogHeader) + sizeof(struct flightLogField)*log->header->fieldCount ||
+		log->header->recordSize != ROUND8(sizeof(double) + log->header->frameLength)) {
+		fprintf(stderr, "\n***** FLIGHT LOG ERROR: %s isn't a version %d log\n\n", path, FLIGHT_LOG_VERSION);
+		flightLogCloseReader(log);
+		return -1;
+	}
+
+	if (flightLogReadIndex(log) != 0)
+		flightLogRebuildIndex(log);
+
+	if (log->chunkCount > 0)
+		log->records = log->index[log->chunkCount-1].firstRecord + log->index[log->chunkCount-1].records;
+	return 0;
+}
+
+void flightLogCloseReader (struct flightLogReader* log) {
+	if (log->map != NULL)
+		munmap((void*) log->map, log->size);
+	if (log->fd >= 0)
+		close(log->fd);
+	free(log->index);
+	memset(log, 0, sizeof(struct flightLogReader));
+	log->fd = -1;
+}
+
+// first record received at or after time, or log->records if there isn't one.
+// a binary search of the index then of the chunk, so O(log n)
+uint64_t flightLogFind (const struct flightLogReader* log, double time) {
+	uint32_t lo = 0, hi = log->chunkCount, mid;
+	uint64_t first, last, middle;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo)/2;
+		if (log->index[mid].lastTime < time)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo == log->chunkCount)
+		return log->records;
+
+	first = log->index[lo].firstRecord;
+	last = first + log->index[lo].records;
+	while (first < last) {
+		middle = first + (last - first)/2;
+		if (flightLogTime(log, middle) < time)
+			first = middle + 1;
+		else
+			last = middle;
+	}
+	return first;
+}
+
+// host receive time of a record, CLOCK_MONOTONIC seconds
+double flightLogTime (const struct flightLogReader* log, uint64_t record) {
+	double time;
+	memcpy(&time, flightLogFrame(log, record) - sizeof(double), sizeof(double));
+	return time;
+}
+
+// the raw frame, straight out of the mapping.  record must be < log->records
+const uint8_t* flightLogFrame (const struct flightLogReader* log, uint64_t record) {
+	const struct flightLogIndexEntry* chunk = &log->index[flightLogChunkOf(log, record)];
+	return log->map + chunk->offset + sizeof(struct flightLogChunkHeader) + (record - chunk->firstRecord)*log->header->recordSize + sizeof(double);
+}
+
+const struct flightLogField* flightLogFindField (const struct flightLogReader* log, const char* name) {
+	uint32_t i;
+	for (i=0; i<log->header->fieldCount; i++)
+		if (strncmp(log->fields[i].name, name, FLIGHT_LOG_NAME_LENGTH) == 0)
+			return &log->fields[i];
+	return NULL;
+}
+
+static const uint8_t fieldSizes[] = {1, 1, 2, 2, 4, 4, 4};
+
+// one value of a field, whatever its type
+double flightLogValue (const struct flightLogField* field, const uint8_t* frame, uint8_t element) {
+	const uint8_t* p;
+	int8_t s8; int16_t s16; uint16_t u16; int32_t s32; uint32_t u32; float f;
+
+	if (field->type > FLIGHT_LOG_FLOAT || element >= field->count)
+		return 0;
+	p = frame + field->offset + fieldSizes[field->type]*element;
+
+	switch (field->type) {
+		case FLIGHT_LOG_INT8:   memcpy(&s8, p, 1);  return s8;
+		case FLIGHT_LOG_UINT8:  return *p;
+		case FLIGHT_LOG_INT16:  memcpy(&s16, p, 2); return s16;
+		case FLIGHT_LOG_UINT16: memcpy(&u16, p, 2); return u16;
+		case FLIGHT_LOG_INT32:  memcpy(&s32, p, 4); return s32;
+		case FLIGHT_LOG_UINT32: memcpy(&u32, p, 4); return u32;
+		default:                memcpy(&f, p, 4);   return f;
+	}
+}
+
+// the other way, for building frames.  integers are rounded, not clamped
+void flightLogSetValue (const struct flightLogField* field, uint8_t* frame, uint8_t element, double value) {
+	uint8_t* p;
+	int8_t s8; uint8_t u8; int16_t s16; uint16_t u16; int32_t s32; uint32_t u32; float f;
+
+	if (field->type > FLIGHT_LOG_FLOAT || element >= field->count)
+		return;
+	p = frame + field->offset + fieldSizes[field->type]*element;
+	if (field->type != FLIGHT_LOG_FLOAT)
+		value += (value < 0) ? -0.5 : 0.5;
+
+	switch (field->type) {
+		case FLIGHT_LOG_INT8:   s8 = value;  memcpy(p, &s8, 1);  break;
+		case FLIGHT_LOG_UINT8:  u8 = value;  *p = u8;            break;
+		case FLIGHT_LOG_INT16:  s16 = value; memcpy(p, &s16, 2); break;
+		case FLIGHT_LOG_UINT16: u16 = value; memcpy(p, &u16, 2); break;
+		case FLIGHT_LOG_INT32:  s32 = value; memcpy(p, &s32, 4); break;
+		case FLIGHT_LOG_UINT32: u32 = value; memcpy(p, &u32, 4); break;
+		default:                f = value;   memcpy(p, &f, 4);   break;
+	}
+}
+
+// the clock rxTimes are taken from
+double flightLogNow (void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec*1e-9;
+}
+
+// reflected CRC-32 (the zlib one)
+static uint32_t flightLogCrc (const uint8_t* data, size_t length) {
+	static uint32_t table[256];
+	uint32_t crc = 0xFFFFFFFF;
+	size_t i;
+
+	if (table[1] == 0) {
+		uint32_t n, c;
+		int k;
+		for (n=0; n<256; n++) {
+			c = n;
+			for (k=0; k<8; k++)
+				c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+			table[n] = c;
+		}
+	}
+
+	for (i=0; i<length; i++)
+		crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	return crc ^ 0xFFFFFFFF;
+}
+
+// write() until it's all gone
+static int flightLogWrite (int fd, const void* data, size_t length) {
+	const uint8_t* p = data;
+	ssize_t written;
+
+	while (length > 0) {
+		written = write(fd, p, length);
+		if (written < 0) {
+			if (errno == EINTR)
+				continue;
+			perror("\n***** FLIGHT LOG ERROR: write failed\n\n");
+			return -1;
+		}
+		p += written;
+		length -= written;
+	}
+	return 0;
+}
+
+static int flightLogAddChunk (struct flightLogIndexEntry** index, uint32_t* chunkCount, uint32_t* indexSize, const struct flightLogIndexEntry* entry) {
+	if (*chunkCount >= *indexSize) {
+		uint32_t size = *indexSize ? *indexSize*2 : INITIAL_INDEX_SIZE;
+		struct flightLogIndexEntry* newIndex = realloc(*index, sizeof(struct flightLogIndexEntry)*size);
+		if (newIndex == NULL) {
+			perror("\n***** FLIGHT LOG ERROR: realloc failed\n\n");
+			return -1;
+		}
+		*index = newIndex;
+		*indexSize = size;
+	}
+	(*index)[(*chunkCount)++] = *entry;
+	return 0;
+}
+
+// the index the writer left at the end.  returns non zero if there isn't a good one
+static int flightLogReadIndex (struct flightLogReader* log) {
+	struct flightLogTrailer trailer[1];
+	size_t length;
+
+	// copied out like the record times, records can be any size so nothing after them is aligned
+	if (log->size < log->header->headerSize + sizeof(struct flightLogTrailer))
+		return -1;
+	memcpy(trailer, log->map + log->size - sizeof(struct flightLogTrailer), sizeof(struct flightLogTrailer));
+	if (trailer->magic != FLIGHT_LOG_TRAILER_MAGIC)
+		return -1;
+
+	length = sizeof(struct flightLogIndexEntry)*(size_t)trailer->chunkCount;
+	if (trailer->indexOffset < log->header->headerSize || trailer->indexOffset + length + sizeof(struct flightLogTrailer) != log->size)
+		return -1;
+	if (trailer->crc != flightLogCrc(log->map + trailer->indexOffset, length))
+		return -1;
+
+	log->index = malloc(length ? length : 1);
+	if (log->index == NULL) {
+		perror("\n***** FLIGHT LOG ERROR: malloc failed\n\n");
+		return -1;
+	}
+	memcpy(log->index, log->map + trailer->indexOffset, length);
+	log->chunkCount = trailer->chunkCount;
+	return 0;
+}
+
+// no trailer, so the recorder died.  walk the chunks and stop at the first one
+// that is torn or fails its crc
+static void flightLogRebuildIndex (struct flightLogReader* log) {
+	uint64_t offset = log->header->headerSize;
+	uint64_t records = 0;
+	uint32_t indexSize = 0;
+
+	free(log->index);
+	log->index = NULL;
+	log->chunkCount = 0;
+	log->recovered = 1;
+
+	while (offset + sizeof(struct flightLogChunkHeader) <= log->size) {
+		struct flightLogChunkHeader chunk[1];
+		uint64_t length;
+		struct flightLogIndexEntry entry;
+
+		memcpy(chunk, log->map + offset, sizeof(struct flightLogChunkHeader)); // not aligned either
+		length = (uint64_t)chunk->records*log->header->recordSize;
+
+		if (chunk->magic != FLIGHT_LOG_CHUNK_MAGIC || chunk->records == 0 || chunk->records > FLIGHT_LOG_CHUNK_RECORDS)
+			break;
+		if (offset + sizeof(struct flightLogChunkHeader) + length > log->size)
+			break;
+		if (chunk->crc != flightLogCrc(log->map + offset + sizeof(struct flightLogChunkHeader), length))
+			break;
+
+		entry.offset = offset;
+		entry.firstRecord = records;
+		entry.firstTime = chunk->firstTime;
+		entry.lastTime = chunk->lastTime;
+		entry.records = chunk->records;
+		entry.reserved = 0;
+		if (flightLogAddChunk(&log->index, &log->chunkCount, &indexSize, &entry))
+			break;
+
+		offset += sizeof(struct flightLogChunkHeader) + length;
+		records += chunk->records;
+	}
+
+	fprintf(stderr, "flight log wasn't closed, recovered %u chunks (%llu frames)\n", log->chunkCount, (unsigned long long) records);
+}
+
+// chunk holding a record
+static uint32_t flightLogChunkOf (const struct flightLogReader* log, uint64_t record) {
+	uint32_t lo = 0, hi = log->chunkCount - 1, mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo + 1)/2;
+		if (log->index[mid].firstRecord <= record)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+	return lo;
+}
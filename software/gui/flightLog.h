@@ -0,0 +1,142 @@
+#ifndef __FLIGHT_LOG_H__
+#define __FLIGHT_LOG_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+// binary flight data log.  every validated frame is stored raw with the time
+// the host received it, so nothing the FCU sends is lost and a log can be
+// replayed through the same code as the serial port.
+//
+// file layout (host byte order):
+//   header    magic, version, packet layout (field names, offsets, types)
+//   chunks    chunk header + up to FLIGHT_LOG_CHUNK_RECORDS fixed size records
+//             {double rxTime; uint8_t frame[frameLength];}, crc checked
+//   index     one entry per chunk: where it is, its first record and times
+//   trailer   magic, chunk count, where the index starts, crc
+//
+// chunks are written whole with one write() each, so after a crash the log is
+// good up to the last complete chunk.  a log with no trailer (the recorder was
+// killed) is still readable, the index is rebuilt by walking the chunks.
+
+#define FLIGHT_LOG_MAGIC "FALCNLOG"
+#define FLIGHT_LOG_VERSION 1
+#define FLIGHT_LOG_BYTE_ORDER 0x01020304
+#define FLIGHT_LOG_CHUNK_MAGIC 0x4B4E4843 // "CHNK"
+#define FLIGHT_LOG_TRAILER_MAGIC 0x58444E49 // "INDX"
+
+#define FLIGHT_LOG_CHUNK_RECORDS 8192    // ~600kB of 64 byte frames per write
+#define FLIGHT_LOG_FLUSH_SECONDS 1.0     // a chunk is written early once its oldest record is this old
+#define FLIGHT_LOG_MAX_FIELDS 64
+#define FLIGHT_LOG_NAME_LENGTH 24
+
+typedef enum
+{
+FLIGHT_LOG_INT8,
+FLIGHT_LOG_UINT8,
+FLIGHT_LOG_INT16,
+FLIGHT_LOG_UINT16,
+FLIGHT_LOG_INT32,
+FLIGHT_LOG_UINT32,
+FLIGHT_LOG_FLOAT,
+}flightLogType;
+
+// where a value lives in the frame
+struct flightLogField {
+	char name[FLIGHT_LOG_NAME_LENGTH];
+	uint16_t offset;
+	uint8_t type;    // flightLogType
+	uint8_t count;   // > 1 for arrays
+};
+
+struct flightLogHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t byteOrder;
+	uint32_t headerSize;     // bytes to the first chunk
+	uint32_t frameLength;
+	uint32_t recordSize;     // sizeof(double) + frameLength rounded up to 8
+	uint32_t fieldCount;
+	double wallTime;         // CLOCK_REALTIME when the log was started
+	double monotonicTime;    // CLOCK_MONOTONIC at the same moment, rxTimes are on this clock
+	char packetName[FLIGHT_LOG_NAME_LENGTH];
+	// followed by fieldCount struct flightLogField
+};
+
+struct flightLogChunkHeader {
+	uint32_t magic;
+	uint32_t records;
+	uint32_t crc;            // of the records
+	uint32_t reserved;
+	double firstTime;
+	double lastTime;
+};
+
+struct flightLogIndexEntry {
+	uint64_t offset;         // of the chunk header
+	uint64_t firstRecord;
+	double firstTime;
+	double lastTime;
+	uint32_t records;
+	uint32_t reserved;
+};
+
+struct flightLogTrailer {
+	uint32_t magic;
+	uint32_t chunkCount;
+	uint64_t indexOffset;
+	uint32_t crc;            // of the index
+	uint32_t reserved;
+};
+
+struct flightLogWriter {
+	int fd;
+	uint32_t frameLength;
+	uint32_t recordSize;
+	uint8_t* buffer;         // chunk header + records waiting to be written
+	uint32_t buffered;
+	uint64_t offset;         // where the next chunk goes
+	uint64_t records;        // written or buffered so far
+	double chunkTime;        // rxTime of the oldest buffered record
+	struct flightLogIndexEntry* index;
+	uint32_t chunkCount;
+	uint32_t indexSize;
+};
+
+struct flightLogReader {
+	int fd;
+	const uint8_t* map;
+	size_t size;
+	const struct flightLogHeader* header;
+	const struct flightLogField* fields;
+	struct flightLogIndexEntry* index;
+	uint32_t chunkCount;
+	uint64_t records;
+	uint8_t recovered;       // no trailer, the index was rebuilt
+};
+
+int flightLogCreate (struct flightLogWriter* log, const char* path, const char* packetName, uint16_t frameLength, const struct flightLogField* fields, uint32_t fieldCount);
+int flightLogAppend (struct flightLogWriter* log, double rxTime, const uint8_t* frame);
+int flightLogFlush (struct flightLogWriter* log);
+int flightLogIdle (struct flightLogWriter* log, double now);
+int flightLogClose (struct flightLogWriter* log);
+
+int flightLogOpen (struct flightLogReader* log, const char* path);
+void flightLogCloseReader (struct flightLogReader* log);
+uint64_t flightLogFind (const struct flightLogReader* log, double time);
+double flightLogTime (const struct flightLogReader* log, uint64_t record);
+const uint8_t* flightLogFrame (const struct flightLogReader* log, uint64_t record);
+const struct flightLogField* flightLogFindField (const struct flightLogReader* log, const char* name);
+double flightLogValue (const struct flightLogField* field, const uint8_t* frame, uint8_t element);
+void flightLogSetValue (const struct flightLogField* field, uint8_t* frame, uint8_t element, double value);
+double flightLogNow (void);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __FLIGHT_LOG_H__ */
@@ -0,0 +1,144 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include "frameDecoder.h"
+
+#define RING_MASK (FRAME_DECODER_RING_LENGTH-1)
+#define READ_CHUNK_LENGTH 4096
+
+static int frameDecoderProcess (struct frameDecoder* decoder);
+
+void frameDecoderInit (struct frameDecoder* decoder, uint16_t frameLength, frameDecoderSettings settings, frameDecoderCB callback, void* userData) {
+
+	if (frameLength < 2 || frameLength > FRAME_DECODER_MAX_FRAME_LENGTH) {
+		fprintf(stderr, "\n***** FRAME DECODER ERROR: bad frame length %d\n\n", frameLength);
+		frameLength = FRAME_DECODER_MAX_FRAME_LENGTH;
+	}
+
+	decoder->frameLength = frameLength;
+	decoder->startByte = FRAME_DECODER_START_BYTE;
+	decoder->checkParity = (settings & FRAME_DECODER_CHECK_PARITY) ? 1 : 0;
+	decoder->variableLength = (settings & FRAME_DECODER_VARIABLE_LENGTH) ? 1 : 0;
+	decoder->callback = callback;
+	decoder->userData = userData;
+
+	frameDecoderReset(decoder);
+}
+
+// forget any partial frame and clear the counters
+void frameDecoderReset (struct frameDecoder* decoder) {
+	decoder->head = 0;
+	decoder->tail = 0;
+	memset(&decoder->stats, 0, sizeof(struct frameDecoderStats));
+}
+
+// XOR of every payload byte.  this is the same value the IMU's parity_byte()
+// produces - XORing 16 bit words then folding the top byte onto the bottom one
+// is the XOR of all the bytes, whichever order they are in.
+uint8_t frameDecoderParity (const uint8_t* frame, uint16_t length) {
+	uint8_t parity = 0;
+	uint16_t i;
+	for (i=2; i<length; i++)
+		parity ^= frame[i];
+	return parity;
+}
+
+// feed raw bytes in.  returns the number of frames emitted
+int frameDecoderPush (struct frameDecoder* decoder, const uint8_t* data, int length) {
+	int frames = 0;
+
+	decoder->stats.bytesReceived += length;
+
+	while (length > 0) {
+		// after processing there are always fewer than frameLength bytes left in the ring, so there is room
+		uint32_t space = FRAME_DECODER_RING_LENGTH - (decoder->head - decoder->tail);
+		uint32_t n = ((uint32_t) length < space) ? (uint32_t) length : space;
+		uint32_t i;
+
+		for (i=0; i<n; i++)
+			decoder->ring[(decoder->head + i) & RING_MASK] = data[i];
+		decoder->head += n;
+		data += n;
+		length -= n;
+
+		frames += frameDecoderProcess(decoder);
+	}
+
+	return frames;
+}
+
+// drain everything the (non-blocking) fd has ready.  returns frames emitted or -1 on a read error
+int frameDecoderRead (struct frameDecoder* decoder, int fd) {
+	uint8_t rxBuffer[READ_CHUNK_LENGTH];
+	int frames = 0;
+	int bytesRead;
+
+	do {
+		bytesRead = read(fd, rxBuffer, READ_CHUNK_LENGTH);
+		if (bytesRead < 0) {
+			if (errno == EAGAIN || errno == EINTR)
+				break;
+			return -1;
+		}
+		frames += frameDecoderPush(decoder, rxBuffer, bytesRead);
+	} while (bytesRead == READ_CHUNK_LENGTH);
+
+	return frames;
+}
+
+// the state machine.  hunting for a start byte, then waiting for a whole frame,
+// then checking it.  a frame that fails the parity check only gives up its start
+// byte so a real frame hiding inside it is still found.
+static int frameDecoderProcess (struct frameDecoder* decoder) {
+	int frames = 0;
+
+	while (decoder->head != decoder->tail) {
+
+		// hunting
+		if (decoder->ring[decoder->tail & RING_MASK] != decoder->startByte) {
+			decoder->tail++;
+			decoder->stats.bytesDropped++;
+			continue;
+		}
+
+		// collecting.  a length that can't be right means this wasn't a start byte after all
+		uint16_t length = decoder->frameLength;
+		if (decoder->variableLength) {
+			if (decoder->head - decoder->tail < 3)
+				break;
+			length = decoder->ring[(decoder->tail + 2) & RING_MASK];
+			if (length < 3 || length > decoder->frameLength) {
+				decoder->tail++;
+				decoder->stats.resyncs++;
+				continue;
+			}
+		}
+		if (decoder->head - decoder->tail < length)
+			break;
+
+		uint16_t i;
+		for (i=0; i<length; i++)
+			decoder->frame[i] = decoder->ring[(decoder->tail + i) & RING_MASK];
+
+		// validating
+		if (decoder->checkParity && decoder->frame[1] != frameDecoderParity(decoder->frame, length)) {
+			decoder->tail++;
+			decoder->stats.framesCorrupt++;
+			decoder->stats.resyncs++;
+			continue;
+		}
+
+		decoder->tail += length;
+		decoder->stats.framesDecoded++;
+		frames++;
+
+		if (decoder->callback)
+			decoder->callback(decoder->frame, length, decoder->userData);
+	}
+
+	return frames;
+}
@@ -0,0 +1,63 @@
+#ifndef __FRAME_DECODER_H__
+#define __FRAME_DECODER_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+// streaming decoder for the fixed length packets the FCU and IMU send over the
+// serial links:  [start byte][parity byte][payload ...]
+// or for variable length ones that carry it:  [start byte][parity byte][length][payload ...]
+// bytes can be fed in whatever sized pieces read() returns.  every complete
+// frame is handed to the callback, nothing blocks waiting for more bytes.
+
+#define FRAME_DECODER_START_BYTE 0xAA
+#define FRAME_DECODER_MAX_FRAME_LENGTH 256
+#define FRAME_DECODER_RING_LENGTH 4096 // must be a power of 2 and at least 2 frames long
+
+typedef enum
+{
+FRAME_DECODER_CHECK_PARITY = 1 << 0, // drop frames whose parity byte doesn't match the payload
+FRAME_DECODER_VARIABLE_LENGTH = 1 << 1, // the byte after parity is the frame's whole length, frameLength is the longest allowed
+}frameDecoderSettings;
+
+typedef void (*frameDecoderCB) (const uint8_t* frame, uint16_t length, void* userData);
+
+struct frameDecoderStats {
+	uint32_t bytesReceived;
+	uint32_t framesDecoded;
+	uint32_t framesCorrupt;  // parity failures (each one costs a resync)
+	uint32_t bytesDropped;   // bytes thrown away while hunting for a start byte
+	uint32_t resyncs;        // times a candidate start byte turned out to be bogus
+};
+
+struct frameDecoder {
+	uint8_t ring[FRAME_DECODER_RING_LENGTH];
+	uint32_t head; // next byte written
+	uint32_t tail; // oldest byte not yet consumed
+
+	uint8_t frame[FRAME_DECODER_MAX_FRAME_LENGTH]; // linear copy of the frame being validated
+	uint16_t frameLength;
+	uint8_t startByte;
+	uint8_t checkParity;
+	uint8_t variableLength;
+
+	frameDecoderCB callback;
+	void* userData;
+
+	struct frameDecoderStats stats;
+};
+
+void frameDecoderInit (struct frameDecoder* decoder, uint16_t frameLength, frameDecoderSettings settings, frameDecoderCB callback, void* userData);
+void frameDecoderReset (struct frameDecoder* decoder);
+int frameDecoderPush (struct frameDecoder* decoder, const uint8_t* data, int length);
+int frameDecoderRead (struct frameDecoder* decoder, int fd);
+uint8_t frameDecoderParity (const uint8_t* frame, uint16_t length);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __FRAME_DECODER_H__ */
@@ -237,18 +237,23 @@
 
 /*
  * Individual Data Series for Plotting
+ * values and their timestamps are kept in fixed size rings, oldest at i_head,
+ * so adding a value never moves or allocates anything
 */
 typedef struct _GLG_SERIES {
     gint        cb_id;
     gint        i_series_id;    /* is this series number 1 2 or 3, ZERO based */
     gint        i_point_count;  /* 1 based */
     gint        i_max_points;   /* 1 based */
+    gint        i_capacity;     /* ring length, i_max_points + 1 */
+    gint        i_head;         /* ring index of the oldest point */
     gchar       ch_legend_text[GLG_MAX_STRING];
     gchar       ch_legend_color[GLG_MAX_STRING];
     GdkColor    legend_color;
     gdouble     d_max_value;
     gdouble     d_min_value;
-    gdouble    *lg_point_dvalue;    /* array of doubles y values zero based, x = index */
+    gdouble    *lg_point_dvalue;    /* ring of y values, x = age order */
+    gint64     *lg_point_time;      /* ring of g_get_monotonic_time() of each value */
     GdkPoint   *point_pos;      /* last gdk position each point - recalc on evey draw */
 } GLG_SERIES, *PGLG_SERIES;
 
@@ -285,8 +290,7 @@ typedef struct _GlgLineGraphPrivate
     /* data points and tooltip info */
     gint        i_points_available;
     gint        i_num_series;   /* 1 based */
-    GList      *lg_series;      /* double-linked list of data series PGLG_SERIES */
-    GList      *lg_series_time; /* time_t of each sample */
+    GPtrArray  *lg_series;      /* PGLG_SERIES indexed by series number */
 
     /* actual size of graph area */
     GdkRectangle page_box;      /* entire window size */    
@@ -1468,12 +1472,15 @@ static void glg_line_graph_draw_y_grid_labels (GlgLineGraph *graph)
 
 /*
  * Draws one data series points to chart
+ * the ring is turned into points in two straight passes, oldest to the end of
+ * the storage then the start of the storage up to the newest
  * returns number of points processed
 */
 static gint glg_line_graph_data_series_draw (GlgLineGraph *graph, PGLG_SERIES psd)
 {
 	GlgLineGraphPrivate *priv;
-    gint        v_index = 0;
+    gint        v_index = 0, r_index = 0, r_end = 0, pass = 0;
+    gdouble     x_step = 0.0, y_scale = 0.0, y_base = 0.0;
     GdkPoint   *point_pos = NULL;
 
     if (glg_flag_debug)
@@ -1491,6 +1498,8 @@ static gint glg_line_graph_data_series_draw (GlgLineGraph *graph, PGLG_SERIES ps
                                 GDK_LINE_SOLID, GDK_CAP_BUTT, GDK_JOIN_MITER);
 
     point_pos = psd->point_pos;
+    y_scale = (gdouble) priv->plot_box.height / (gdouble) priv->y_range.i_max_scale;
+    y_base = (gdouble) (priv->plot_box.y + priv->plot_box.height);
 
 /* trap first and only point */
     if (psd->i_point_count == 0)
@@ -1500,11 +1509,7 @@ static gint glg_line_graph_data_series_draw (GlgLineGraph *graph, PGLG_SERIES ps
     if (psd->i_point_count == 1)
     {
         point_pos[0].x = priv->plot_box.x;
-        point_pos[0].y =
-            (priv->plot_box.y + priv->plot_box.height) -
-            ((psd->lg_point_dvalue[0] *
-              (gdouble) ((gdouble) priv->plot_box.height /
-                         (gdouble) priv->y_range.i_max_scale)));
+        point_pos[0].y = y_base - (psd->lg_point_dvalue[psd->i_head] * y_scale);
 
         gdk_draw_arc (GTK_WIDGET(graph)->window, priv->series_gc, TRUE,
                       point_pos[0].x , 
@@ -1513,14 +1518,26 @@ static gint glg_line_graph_data_series_draw (GlgLineGraph *graph, PGLG_SERIES ps
         return 1;
     }
 
-    for (v_index = 0; v_index < psd->i_point_count; v_index++)
+    x_step = (gdouble) priv->plot_box.width / (gdouble) priv->x_range.i_max_scale;
+
+    r_index = psd->i_head;
+    r_end = MIN (psd->i_head + psd->i_point_count, psd->i_capacity);
+    for (pass = 0; pass < 2; pass++)
     {
-        point_pos[v_index].x = priv->plot_box.x + (v_index * (priv->plot_box.width / priv->x_range.i_max_scale));
-        point_pos[v_index].y = priv->plot_box.y + 
-                               (priv->plot_box.height - 
-                               (psd->lg_point_dvalue[v_index] * 
-                               (gdouble) ((gdouble) priv->plot_box.height / (gdouble) priv->y_range.i_max_scale)));
+        for (; r_index < r_end; r_index++, v_index++)
+        {
+            point_pos[v_index].x = priv->plot_box.x + (gint) (v_index * x_step);
+            point_pos[v_index].y = y_base - (psd->lg_point_dvalue[r_index] * y_scale);
+        }
+        r_index = 0;
+        r_end = psd->i_point_count - v_index;
+    }
 
+    /* markers only while there is room between the points for them */
+    if (x_step >= 4.0)
+    {
+        for (v_index = 0; v_index < psd->i_point_count; v_index++)
+        {
             gdk_draw_arc (GTK_WIDGET(graph)->window, priv->series_gc, TRUE,
                           point_pos[v_index].x - 1,
                           point_pos[v_index].y - 2 , 
@@ -1529,11 +1546,12 @@ static gint glg_line_graph_data_series_draw (GlgLineGraph *graph, PGLG_SERIES ps
                           point_pos[v_index].x - 1,
                           point_pos[v_index].y - 2 , 
                           3., 3., 0, 360 * 64);
+        }
     }
 
     gdk_draw_lines (GTK_WIDGET(graph)->window, priv->series_gc, point_pos, psd->i_point_count);
 
-    return v_index;
+    return psd->i_point_count;
 }
 
 /*
@@ -1544,7 +1562,7 @@ static gint glg_line_graph_data_series_draw_all (GlgLineGraph *graph, gboolean r
 {
 	GlgLineGraphPrivate *priv;
     PGLG_SERIES  psd = NULL;
-    GList      *data_sets = NULL;
+    gint        i_series = 0;
     gint        v_index = 0;
 
     if (glg_flag_debug)
@@ -1555,17 +1573,19 @@ static gint glg_line_graph_data_series_draw_all (GlgLineGraph *graph, gboolean r
 
 	priv = GLG_LINE_GRAPH_GET_PRIVATE (graph);
     
+    if (priv->lg_series == NULL)
+    {
+        return 0;
+    }
 
-    data_sets = g_list_first (priv->lg_series);
-    while (data_sets)
+    for (i_series = 0; i_series < (gint) priv->lg_series->len; i_series++)
     {
-        psd = data_sets->data;
+        psd = g_ptr_array_index (priv->lg_series, i_series);
         if (psd != NULL)
         {                       /* found */
             glg_line_graph_data_series_draw (graph, psd);
             v_index++;
         }
-        data_sets = g_list_next (data_sets);
     }
 
     if (glg_flag_debug)
@@ -1584,6 +1604,7 @@ static gint glg_line_graph_data_series_draw_all (GlgLineGraph *graph, gboolean r
  * Add a single y value to the requested data series.
  * auto indexes the value if x-scale max is reached (appends to the end)
  * The X value is implied to be the current count of Y-values added.
+ * Once the series is full the oldest value is dropped, in constant time.
  *
  * Returns: gboolean  TRUE if value was added, FALSE if add failed.
  */
@@ -1591,9 +1612,7 @@ extern gboolean glg_line_graph_data_series_add_value (GlgLineGraph *graph, gint
 {
 	GlgLineGraphPrivate *priv;
     PGLG_SERIES  psd = NULL;
-    GList      *data_sets = NULL;
     gint        v_index = 0;
-    gboolean    b_found = FALSE;
 
     if (glg_flag_debug)
     {
@@ -1603,64 +1622,41 @@ extern gboolean glg_line_graph_data_series_add_value (GlgLineGraph *graph, gint
 
 	priv = GLG_LINE_GRAPH_GET_PRIVATE (graph);
     
-    data_sets = g_list_first (priv->lg_series);
-    while (data_sets)
-    {
-        psd = data_sets->data;
-        if (psd->i_series_id == i_series_number)
-        {                       /* found */
-            b_found = TRUE;
-            break;
-        }
-        data_sets = g_list_next (data_sets);
-    }
-
-    if (!b_found)
+    if (priv->lg_series == NULL || i_series_number < 0 || i_series_number >= (gint) priv->lg_series->len)
     {
         g_message ("glg_line_graph_data_series_add_value(%d): Invalid data series number",
                    i_series_number);
         return FALSE;
     }
+    psd = g_ptr_array_index (priv->lg_series, i_series_number);
 
     if (y_value > priv->y_range.i_max_scale)
     {
         y_value = (gdouble) priv->y_range.i_max_scale;
     }
 
-    if (psd->i_point_count == psd->i_max_points + 1)
+    if (psd->i_point_count == psd->i_capacity)
     {
-        for (v_index = 0; v_index < psd->i_max_points; v_index++)
-        {
-            psd->lg_point_dvalue[v_index] = psd->lg_point_dvalue[v_index + 1];
-        }
-        psd->lg_point_dvalue[psd->i_max_points] = y_value;
+        /* full - the newest value takes the oldest one's slot */
+        v_index = psd->i_head;
+        psd->i_head = (psd->i_head + 1 == psd->i_capacity) ? 0 : psd->i_head + 1;
     }
     else
     {
-        psd->lg_point_dvalue[psd->i_point_count++] = y_value;
+        v_index = psd->i_head + psd->i_point_count++;
+        if (v_index >= psd->i_capacity)
+        {
+            v_index -= psd->i_capacity;
+        }
     }
+    psd->lg_point_dvalue[v_index] = y_value;
+    psd->lg_point_time[v_index] = g_get_monotonic_time ();
 
     psd->d_max_value = MAX (y_value, psd->d_max_value);
     psd->d_min_value = MIN (y_value, psd->d_min_value);
 
     priv->i_points_available = MAX (priv->i_points_available, psd->i_point_count);
 
-    /* record current time with data points */
-    if (psd->i_series_id == priv->i_num_series - 1)
-    {
-        GList      *gl_remove = NULL;
-
-        if (g_list_length (priv->lg_series_time) == psd->i_max_points +1 )
-        {
-            gl_remove = g_list_first (priv->lg_series_time);
-            priv->lg_series_time =
-                g_list_remove_all (priv->lg_series_time, gl_remove->data);
-        }
-        priv->lg_series_time =
-            g_list_append (priv->lg_series_time, GINT_TO_POINTER ((time_t) time (NULL)));
-            
-    }
-
     if (glg_flag_debug)
     {
         g_debug
@@ -1679,7 +1675,6 @@ static gint glg_line_graph_data_series_remove_all (GlgLineGraph *graph)
 {
 	GlgLineGraphPrivate *priv;
     PGLG_SERIES  psd = NULL;
-    GList      *data_sets = NULL;
     gint        i_count = 0;
 
     if (glg_flag_debug)
@@ -1690,20 +1685,19 @@ static gint glg_line_graph_data_series_remove_all (GlgLineGraph *graph)
 
 	priv = GLG_LINE_GRAPH_GET_PRIVATE (graph);
     
-    data_sets = g_list_first (priv->lg_series);
-    while (data_sets)
+    if (priv->lg_series != NULL)
     {
-        psd = data_sets->data;
-        g_free (psd->lg_point_dvalue);
-        g_free (psd->point_pos);
-        g_free (psd);
-        data_sets = g_list_next (data_sets);
-        i_count++;
+        for (i_count = 0; i_count < (gint) priv->lg_series->len; i_count++)
+        {
+            psd = g_ptr_array_index (priv->lg_series, i_count);
+            g_free (psd->lg_point_dvalue);
+            g_free (psd->lg_point_time);
+            g_free (psd->point_pos);
+            g_free (psd);
+        }
+        g_ptr_array_free (priv->lg_series, TRUE);
     }
-    g_list_free (priv->lg_series);
-    g_list_free (priv->lg_series_time);
     priv->lg_series = NULL;
-    priv->lg_series_time = NULL;
     priv->i_num_series = 0;
     priv->i_points_available = 0;    
 
@@ -1723,7 +1717,8 @@ static gint glg_line_graph_data_series_remove_all (GlgLineGraph *graph)
  *
  * Allocates space for another data series of y-values and returns the 
  * series number of this dataset added which you must keep track of
- * to add values.
+ * to add values.  The series holds x-scale max + 1 values, set the
+ * ranges before adding series.
  *
  * Returns: gint  The series number of this dataset added ( range 0 thru n )
  */
@@ -1746,24 +1741,33 @@ extern gint glg_line_graph_data_series_add (GlgLineGraph *graph, const gchar *pc
     psd = (PGLG_SERIES) g_new0 (GLG_SERIES, 1);
     g_return_val_if_fail (psd != NULL, -1);
 
-    psd->lg_point_dvalue = (gdouble *) g_new0 (gdouble, (priv->x_range.i_max_scale + 4));
+    /*
+     * we position x to ticks onlys, 
+     * so force chart to scroll at maximum ticks vs value */
+    psd->i_max_points = priv->x_range.i_max_scale;;
+    psd->i_capacity = psd->i_max_points + 1;
+    psd->i_head = 0;
+
+    psd->lg_point_dvalue = (gdouble *) g_new0 (gdouble, psd->i_capacity);
     g_return_val_if_fail (psd->lg_point_dvalue != NULL, -1);
 
-    psd->point_pos = g_new0 (GdkPoint, (priv->x_range.i_max_scale + 4));
+    psd->lg_point_time = (gint64 *) g_new0 (gint64, psd->i_capacity);
+    g_return_val_if_fail (psd->lg_point_time != NULL, -1);
+
+    psd->point_pos = g_new0 (GdkPoint, psd->i_capacity);
     g_return_val_if_fail (psd->point_pos != NULL, -1);
 
     g_snprintf (psd->ch_legend_text, sizeof (psd->ch_legend_text), "%s", pch_legend_text);
     
-    /*
-     * we position x to ticks onlys, 
-     * so force chart to scroll at maximum ticks vs value */
-    psd->i_max_points = priv->x_range.i_max_scale;;
-    
     gdk_color_parse (pch_color_text, &psd->legend_color);
     g_snprintf (psd->ch_legend_color, sizeof (psd->ch_legend_color), "%s", pch_color_text);
     psd->cb_id = GLG_SERIES_ID;
 
-    priv->lg_series = g_list_append (priv->lg_series, psd);
+    if (priv->lg_series == NULL)
+    {
+        priv->lg_series = g_ptr_array_new ();
+    }
+    g_ptr_array_add (priv->lg_series, psd);
     psd->i_series_id = priv->i_num_series++;
 
     if (glg_flag_debug)
@@ -61,10 +61,24 @@ static void gtk_graph_destroy (GtkObject *object);
 static void gtk_graph_create_pixmap (GtkGraph *graph);
 static void gtk_graph_set_grid_clipping_rectangles(GtkGraph *graph);
 static void gtk_graph_plot_axes (GtkGraph *graph);
+static void gtk_graph_plot_frame (GtkGraph *graph);
 static void gtk_graph_plot_axes_titles (GtkGraph *graph);
+static void gtk_graph_fit_axes_labels (GtkGraph *graph);
 static void gtk_graph_plot_title (GtkGraph *graph);
 static void gtk_graph_plot_legend(GtkGraph *graph);
+static void gtk_graph_render_legend(GtkGraph *graph);
+static gchar *gtk_graph_axis_label_format (GtkGraphAxis *axis);
 static void gtk_graph_plot_traces (GtkGraph *graph);
+static void gtk_graph_plot_xy_traces (GtkGraph *graph);
+static void gtk_graph_bind (GtkGraph *graph);
+static void gtk_graph_reset_user_area (GtkGraph *graph);
+static void gtk_graph_render (GtkGraph *graph);
+static gboolean gtk_graph_redraw_tick (gpointer data);
+
+/* Redraw scheduler: graphs waiting for the next frame and the timeout that will draw them */
+static GSList *dirty_graphs = NULL;
+static guint redraw_source = 0;
+static guint redraw_interval = 1000 / GTK_GRAPH_DEFAULT_FRAME_RATE;
 //~ static int rint(float f);
 
 /**
@@ -173,8 +187,10 @@ GtkWidget* gtk_graph_new (GtkGraphType type)
   graph->graph_type = type;
   graph->traces = NULL;
   graph->num_traces = 0;
+  graph->traces_size = 0;
   graph->annotations = NULL;
   graph->num_annotations = 0;
+  graph->annotations_size = 0;
   graph->smith_Z0 = 50.0;
 
   if (type == POLAR)
@@ -208,6 +224,25 @@ GtkWidget* gtk_graph_new (GtkGraphType type)
   graph->legend_visible = TRUE;
   graph->legend_position = GTK_GRAPH_NORTH_WEST;
 
+  graph->pixmap = NULL;
+  graph->background = NULL;
+  graph->frame = NULL;
+  graph->legend = NULL;
+  memset(graph->fonts, 0, sizeof(graph->fonts));
+  memset(graph->labels, 0, sizeof(graph->labels));
+  graph->true_width = 0;
+  graph->true_height = 0;
+  graph->dirty = GTK_GRAPH_DIRTY_AXES;
+  graph->window.x_chunks = NULL;
+  graph->window.edges = NULL;
+  graph->window.num_edges = 0;
+  graph->window.edges_size = 0;
+  graph->renderer = GTK_GRAPH_RENDER_GDK;
+  graph->layer = NULL;
+  graph->density = NULL;
+  graph->density_counts = NULL;
+  graph->density_counts_size = 0;
+
   return GTK_WIDGET(graph);
 }
 
@@ -297,16 +332,15 @@ void gtk_graph_draw (GtkWidget *widget)
     g_return_if_fail (widget != NULL);  /* --- Check for obvious problems --- */
     g_return_if_fail (GTK_IS_GRAPH (widget));
 	g_return_if_fail (GTK_WIDGET_REALIZED(widget));
-               
-    // Clear the graph first 
-  	
- 	gdk_draw_rectangle(buffer, Whitecontext, TRUE, 0, 0, true_width-1, true_height-1);
-   	gdk_draw_rectangle(buffer, BlueandWcontext, FALSE, 0, 0, true_width-1, true_height-1);
+	g_return_if_fail (graph->pixmap != NULL);
 
- 	gtk_graph_plot_title (graph);   /* Title First - since this may affect the screen area available
-									* to draw on an hence it will adjust user_origin_y and user_height */
+	gtk_graph_bind (graph);
+	gtk_graph_reset_user_area (graph);
+               
+	gtk_graph_plot_frame (graph);	/* Cleared, with the border and titles, from the saved copy unless they've
+									* changed.  The titles take their space off user_origin_y and user_height */
 	
-	gtk_graph_plot_axes_titles(graph); /* user_origin_y and user_height can also be changed here */
+	gtk_graph_fit_axes_labels(graph); /* then the tick labels take theirs, they depend on the data */
   	
 	/* all user_(origin_x, origin_y, height and width) should now be fixed and we can now
 	*  scale the axes and set the clipping rectange for the grid */
@@ -327,7 +361,8 @@ void gtk_graph_draw (GtkWidget *widget)
 		default:
 			
 			gtk_graph_plot_axes (graph);   /* Now plot the axes to screen, */
-			gtk_graph_plot_traces (graph);  /* then the data traces themselves */
+			gdk_draw_pixmap(graph->background, BandWcontext, buffer, 0, 0, 0, 0, true_width, true_height); /* keep them for trace only redraws */
+			gtk_graph_plot_xy_traces (graph);  /* then the data traces themselves */
 			break;
 		}
 	gtk_graph_plot_annotations(graph);
@@ -335,12 +370,29 @@ void gtk_graph_draw (GtkWidget *widget)
 		
     /* Once all relevant information has been transfered into the buffer then copy to screen */
     gdk_draw_pixmap(widget->window, BandWcontext, buffer,0, 0, 0, 0, true_width, true_height);
+    graph->dirty = 0;
 }
 
+/* Redraw only the traces, annotations and legend over the saved axes.  Falls back to
+ * a full draw if the axes themselves are out of date */
 void gtk_graph_redraw_traces(GtkWidget *widget) {
-	gdk_draw_rectangle(buffer, Whitecontext, TRUE, user_origin_x, user_origin_y, user_width, user_height);
-	gtk_graph_plot_traces ((GtkGraph*)widget);
+	GtkGraph *graph = GTK_GRAPH (widget);
+
+	g_return_if_fail (GTK_WIDGET_REALIZED(widget));
+
+	if (graph->graph_type != XY || graph->pixmap == NULL || (graph->dirty & GTK_GRAPH_DIRTY_AXES)) {
+		gtk_graph_create_pixmap(graph);
+		gtk_graph_draw(widget);
+		return;
+	}
+
+	gtk_graph_bind (graph);
+	gdk_draw_pixmap(buffer, BandWcontext, graph->background, 0, 0, 0, 0, true_width, true_height);
+	gtk_graph_plot_xy_traces (graph);
+	gtk_graph_plot_annotations(graph);
+	gtk_graph_plot_legend (graph);
 	gdk_draw_pixmap(widget->window, BandWcontext, buffer,0, 0, 0, 0, true_width, true_height);
+	graph->dirty = 0;
 }
 
 void gtk_graph_redraw_all(GtkWidget *widget) {
@@ -348,6 +400,112 @@ void gtk_graph_redraw_all(GtkWidget *widget) {
 	gtk_graph_draw(widget);
 }
 
+/**
+ * gtk_graph_queue_redraw:
+ * @graph:  the #GtkGraph that needs redrawing
+ * @flags:	which parts of @graph are out of date
+ *
+ * Marks @graph dirty.  Nothing is drawn straight away, every dirty graph is
+ * drawn once on the next frame tick so the cost of drawing is bounded by the
+ * frame rate rather than by how often data or mouse events arrive.
+ */
+void gtk_graph_queue_redraw (GtkGraph *graph, GtkGraphDirtyFlags flags)
+{
+	g_return_if_fail (graph != NULL);
+	g_return_if_fail (GTK_IS_GRAPH (graph));
+
+	graph->dirty |= flags;
+
+	if (g_slist_find(dirty_graphs, graph) == NULL)
+		dirty_graphs = g_slist_prepend(dirty_graphs, graph);
+
+	if (redraw_source == 0)
+		redraw_source = g_timeout_add(redraw_interval, gtk_graph_redraw_tick, NULL);
+}
+
+/**
+ * gtk_graph_set_frame_rate:
+ * @fps:  frames per second
+ *
+ * Sets the maximum rate that queued redraws are carried out at.  The default is
+ * %GTK_GRAPH_DEFAULT_FRAME_RATE.
+ */
+void gtk_graph_set_frame_rate (guint fps)
+{
+	g_return_if_fail (fps > 0);
+	redraw_interval = 1000 / fps;
+}
+
+/**
+ * gtk_graph_set_renderer:
+ * @graph:  the #GtkGraph
+ * @renderer:	how to draw its traces
+ *
+ * Switches an XY graph between drawing its traces with GDK, drawing them
+ * anti-aliased with cairo onto a layer that is scrolled rather than redrawn
+ * while the graph auto pans, and shading them as a density map.  Traces with
+ * markers are always drawn with GDK.
+ */
+void gtk_graph_set_renderer (GtkGraph *graph, GtkGraphRenderer renderer)
+{
+	g_return_if_fail (graph != NULL);
+	g_return_if_fail (GTK_IS_GRAPH (graph));
+
+	graph->renderer = renderer;
+	if (renderer != GTK_GRAPH_RENDER_CAIRO)
+		gtk_graph_trace_layer_free (graph);
+	if (renderer != GTK_GRAPH_RENDER_DENSITY)
+		gtk_graph_density_free (graph);
+	gtk_graph_queue_redraw(graph, GTK_GRAPH_DIRTY_TRACES | GTK_GRAPH_DIRTY_FORMAT);
+}
+
+/* gtk_graph_redraw_tick: draw everything queued since the last tick.  The timeout
+ * removes itself and is added again by the next gtk_graph_queue_redraw() so an idle
+ * graph costs nothing */
+static gboolean gtk_graph_redraw_tick (gpointer data)
+{
+	GSList *list = dirty_graphs;
+	GSList *tmp;
+
+	dirty_graphs = NULL;
+	redraw_source = 0;
+
+	for (tmp = list; tmp != NULL; tmp = tmp->next) {
+		GtkGraph *graph = GTK_GRAPH(tmp->data);
+		if (graph->dirty && GTK_WIDGET_REALIZED(graph))  /* unrealized graphs get drawn when first exposed */
+			gtk_graph_render(graph);
+	}
+	g_slist_free(list);
+
+	return FALSE;
+}
+
+/* gtk_graph_render: bring the window up to date doing as little work as the dirty flags allow */
+static void gtk_graph_render (GtkGraph *graph)
+{
+	GtkWidget *widget = GTK_WIDGET(graph);
+
+	gtk_graph_create_pixmap(graph);
+	if (graph->dirty & GTK_GRAPH_DIRTY_AXES)
+		gtk_graph_draw(widget);
+	else if (graph->dirty & GTK_GRAPH_DIRTY_TRACES)
+		gtk_graph_redraw_traces(widget);
+	else
+		gdk_draw_pixmap(widget->window, BandWcontext, graph->pixmap, 0, 0, 0, 0, graph->true_width, graph->true_height);
+}
+
+/* gtk_graph_bind: the drawing code works on the globals, point them at this graph */
+static void gtk_graph_bind (GtkGraph *graph)
+{
+	buffer = graph->pixmap;
+	true_width = graph->true_width;
+	true_height = graph->true_height;
+	user_width = graph->user_width;
+	user_height = graph->user_height;
+	user_origin_x = graph->user_origin_x;
+	user_origin_y = graph->user_origin_y;
+}
+
 /* gtk_graph_size_request: How big should the widget be?  */
 static void gtk_graph_size_request (GtkWidget *widget, GtkRequisition *req)
 {
@@ -405,8 +563,7 @@ static gint gtk_graph_expose (GtkWidget *widget, GdkEventExpose *event)
     if (event->count > 0)
         return (FALSE);
 
-    gtk_graph_create_pixmap (GTK_GRAPH(widget));
-    gtk_graph_draw (widget);    /* --- Draw the graph --- */
+    gtk_graph_render (GTK_GRAPH(widget));    /* --- Draw the graph, or just copy it if nothing has changed --- */
     return (FALSE);
 }
 
@@ -421,12 +578,38 @@ static void gtk_graph_destroy (GtkObject *object)
     graph = GTK_GRAPH (object);    /* --- Convert to graph object --- */
 	g_free (graph->dependant);
 	g_free (graph->independant);
+	graph->dependant = NULL;
+	graph->independant = NULL;
+
+	dirty_graphs = g_slist_remove(dirty_graphs, graph);
+	if (buffer == graph->pixmap)
+		buffer = NULL;
+	if (graph->pixmap)
+		gdk_pixmap_unref (graph->pixmap);
+	if (graph->background)
+		gdk_pixmap_unref (graph->background);
+	if (graph->frame)
+		gdk_pixmap_unref (graph->frame);
+	if (graph->legend)
+		gdk_pixmap_unref (graph->legend);
+	graph->pixmap = NULL;
+	graph->background = NULL;
+	graph->frame = NULL;
+	graph->legend = NULL;
+	gtk_graph_label_cache_free (graph);
+	g_free (graph->window.edges);
+	graph->window.edges = NULL;
+	graph->window.edges_size = 0;
+	gtk_graph_trace_layer_free (graph);
+	gtk_graph_density_free (graph);
 
     /* --- Call parent destroy --- */
     GTK_OBJECT_CLASS (parent_class)->destroy (object);
 }
 
 
+/* gtk_graph_create_pixmap: make sure this graph has backing pixmaps the size of its
+ * window.  They are only thrown away when the size changes */
 static void gtk_graph_create_pixmap (GtkGraph *graph)
 {
 GtkWidget *widget;
@@ -438,23 +621,38 @@ g_return_if_fail (GTK_IS_GRAPH (graph));
     {
     widget = GTK_WIDGET (graph);
 
-    if (buffer)
-	   gdk_pixmap_unref (buffer);
-
-    buffer = gdk_pixmap_new (widget->window, widget->allocation.width, widget->allocation.height, -1);
-	true_width = widget->allocation.width;
-    true_height = widget->allocation.height;
+	if (graph->pixmap != NULL && graph->true_width == widget->allocation.width && graph->true_height == widget->allocation.height)
+		return;
+
+    if (graph->pixmap)
+	   gdk_pixmap_unref (graph->pixmap);
+    if (graph->background)
+	   gdk_pixmap_unref (graph->background);
+    if (graph->frame)
+	   gdk_pixmap_unref (graph->frame);
+	graph->frame = NULL;	/* drawn again at the new size */
+
+    graph->pixmap = gdk_pixmap_new (widget->window, widget->allocation.width, widget->allocation.height, -1);
+    graph->background = gdk_pixmap_new (widget->window, widget->allocation.width, widget->allocation.height, -1);
+	graph->true_width = widget->allocation.width;
+    graph->true_height = widget->allocation.height;
+	graph->dirty |= GTK_GRAPH_DIRTY_AXES;
+
+	gtk_graph_bind (graph);
+	gtk_graph_reset_user_area (graph);
+	}
+}
 
+/* gtk_graph_reset_user_area: start the plot area at the full window less margins, the
+ * titles and labels then take their space out of it as they are drawn */
+static void gtk_graph_reset_user_area (GtkGraph *graph)
+{
 	if (graph->graph_type == XY)
 		{
 		user_origin_x = margin;
 		user_origin_y = margin / 2.0;
 		user_height = true_height - user_origin_y - margin;
 		user_width = true_width - user_origin_x - 2.0 * margin;
-		graph->user_height = user_height;
-		graph->user_width = user_width;
-		graph->user_origin_x = user_origin_x;
-		graph->user_origin_y = user_origin_y;
 		}
 	else
 		{	
@@ -462,13 +660,11 @@ g_return_if_fail (GTK_IS_GRAPH (graph));
 		user_origin_y = 3 * margin;
 		user_height = true_height - 5.0 * margin;
 		user_width = true_width - 4.0 * margin;
-		graph->user_height = user_height;
-		graph->user_width = user_width;
-		graph->user_origin_x = user_origin_x;
-		graph->user_origin_y = user_origin_y;
 		}
-
-	}
+	graph->user_height = user_height;
+	graph->user_width = user_width;
+	graph->user_origin_x = user_origin_x;
+	graph->user_origin_y = user_origin_y;
 }
 
 static void gtk_graph_set_grid_clipping_rectangles(GtkGraph *graph)
@@ -486,14 +682,13 @@ gdk_gc_set_clip_rectangle(Gridcontext, &rect);
 
 /* These settings are intial guesses.  The exact values will be known once the axes
 *  have been scaled */
-tmp = graph->traces;
 for (n = 0 ; n < graph->num_traces ; n++)
 	{
+	tmp = graph->traces[n];
 	gdk_gc_set_clip_origin(tmp->format->line_gc, 0, 0);		/* Set the clipping for each trace */
 	gdk_gc_set_clip_rectangle(tmp->format->line_gc, &rect);
 	gdk_gc_set_clip_origin(tmp->format->marker_gc, 0, 0);		/* Set the clipping for each trace */
 	gdk_gc_set_clip_rectangle(tmp->format->marker_gc, &rect);
-	tmp = tmp->next;	/* and then move onto the next trace */
 	}
 	
 }
@@ -502,19 +697,17 @@ static void gtk_graph_plot_axes (GtkGraph *graph)
 {
 gint x_baseline, y_baseline, x_coord, y_coord;
 gint i, j, text_width, text_height;
-gchar *tbuffer, *format_string = NULL;
+gchar *tbuffer, *x_format, *y_format;
 gfloat min_tick_value;
 
-PangoFontDescription *fontdesc = NULL;
 PangoLayout *layout = NULL;
 
 g_return_if_fail (graph != NULL);
 g_return_if_fail (GTK_IS_GRAPH (graph));
 g_return_if_fail (GTK_WIDGET_REALIZED (graph));
 	
-fontdesc = pango_font_description_from_string("Sans 10");
-layout = gtk_widget_create_pango_layout(GTK_WIDGET(graph), NULL);
-pango_layout_set_font_description(layout, fontdesc);	
+x_format = gtk_graph_axis_label_format(graph->independant);
+y_format = gtk_graph_axis_label_format(graph->dependant);
 
 /* Draw the X axis */
 
@@ -542,27 +735,12 @@ switch (graph->dependant->crossing_type)
 for (i = 0 ; i <= graph->independant->n_maj_tick ; i++)
 	{
 	x_coord = user_origin_x -1 + i * graph->independant->pxls_per_maj_tick;
-	switch(graph->independant->format)
-		{
-		case ENGINEERING:
-			format_string = g_strdup_printf("%%.%de", graph->independant->precision);
-			break;
-		case SCIENTIFIC:
-			format_string = g_strdup_printf("%%.%de", graph->independant->precision);
-			break;
-		case FLOATING_POINT:
-		default:
-			format_string = g_strdup_printf("%%.%df", graph->independant->precision);
-			break;
-		}
-	tbuffer = g_strdup_printf(format_string, graph->independant->axis_min + i*graph->independant->maj_tick );
-	g_free(format_string);
+	tbuffer = g_strdup_printf(x_format, graph->independant->axis_min + i*graph->independant->maj_tick );
 	if (graph->independant->grid_visible)
 		gdk_draw_line(buffer, Gridcontext, x_coord, user_origin_y, x_coord, user_origin_y + graph->dependant->pxls_per_maj_tick * graph->dependant->n_maj_tick);
 	gdk_draw_line(buffer, BandWcontext, x_coord, x_baseline, x_coord, x_baseline + MAJ_TICK_LEN);
-	pango_layout_set_text(layout, tbuffer, -1);
+	layout = gtk_graph_label(graph, GTK_GRAPH_FONT_LABEL, tbuffer, &text_width, &text_height);
 	g_free(tbuffer);
-	pango_layout_get_pixel_size(layout, &text_width, &text_height);
 	gdk_draw_layout(buffer, BandWcontext, x_coord - text_width / 2, x_baseline + MAJ_TICK_LEN + 2, layout);
 	for (j = 1 ; j <= graph->independant->n_min_tick ; j++)
 		{
@@ -600,27 +778,12 @@ switch (graph->independant->crossing_type)
 for (i = 0 ; i <= graph->dependant->n_maj_tick ; i++)
 	{
 	y_coord = user_origin_y + i * graph->dependant->pxls_per_maj_tick;
-	switch(graph->dependant->format)
-		{
-		case ENGINEERING:
-			format_string = g_strdup_printf("%%.%de", graph->dependant->precision);
-			break;
-		case SCIENTIFIC:
-			format_string = g_strdup_printf("%%.%de", graph->dependant->precision);
-			break;
-		case FLOATING_POINT:
-		default:
-			format_string = g_strdup_printf( "%%.%df", graph->dependant->precision);
-			break;
-		}
-	tbuffer = g_strdup_printf(format_string, graph->dependant->axis_max - i*graph->dependant->maj_tick );
-	g_free(format_string);
+	tbuffer = g_strdup_printf(y_format, graph->dependant->axis_max - i*graph->dependant->maj_tick );
 	if (graph->dependant->grid_visible)
 		gdk_draw_line(buffer, Gridcontext, y_baseline-1, y_coord, y_baseline + graph->independant->pxls_per_maj_tick * graph->independant->n_maj_tick, y_coord);
 	gdk_draw_line(buffer, BandWcontext, y_baseline-1, y_coord, y_baseline - MAJ_TICK_LEN, y_coord);
-	pango_layout_set_text(layout, tbuffer, -1);
+	layout = gtk_graph_label(graph, GTK_GRAPH_FONT_LABEL, tbuffer, &text_width, &text_height);
 	g_free(tbuffer);
-	pango_layout_get_pixel_size(layout, &text_width, &text_height);
 	gdk_draw_layout(buffer, BandWcontext, y_baseline - MAJ_TICK_LEN - 2 - text_width, y_coord - text_height / 2, layout);
 	for (j = 1 ; j <= graph->dependant->n_min_tick ; j++)
 		{
@@ -635,26 +798,98 @@ for (i = 0 ; i <= graph->dependant->n_maj_tick ; i++)
 
 gdk_draw_line (buffer, BandWcontext, user_origin_x-1, x_baseline, user_origin_x-1  + graph->independant->pxls_per_maj_tick * graph->independant->n_maj_tick, x_baseline);
 gdk_draw_line (buffer, BandWcontext, y_baseline, user_origin_y, y_baseline, user_origin_y + graph->dependant->pxls_per_maj_tick * graph->dependant->n_maj_tick);
-pango_font_description_free(fontdesc);
-g_object_unref(layout);
+g_free(x_format);
+g_free(y_format);
+}
+
+/* gtk_graph_axis_label_format: printf format for an axis' tick labels, free it after */
+static gchar *gtk_graph_axis_label_format (GtkGraphAxis *axis)
+{
+switch(axis->format)
+	{
+	case ENGINEERING:
+	case SCIENTIFIC:
+		return g_strdup_printf("%%.%de", axis->precision);
+	case FLOATING_POINT:
+	default:
+		return g_strdup_printf("%%.%df", axis->precision);
+	}
+}
+
+/* gtk_graph_plot_frame: the cleared graph with its border and titles.  Kept in graph->frame and
+ * only drawn again when the size or a title changes, along with the plotting area they leave */
+static void gtk_graph_plot_frame (GtkGraph *graph)
+{
+g_return_if_fail (graph != NULL);
+g_return_if_fail (GTK_IS_GRAPH (graph));
+g_return_if_fail (GTK_WIDGET_REALIZED (graph));
+
+if (graph->frame == NULL || (graph->dirty & GTK_GRAPH_DIRTY_TITLES))
+	{
+	if (graph->frame == NULL)
+		graph->frame = gdk_pixmap_new (GTK_WIDGET(graph)->window, true_width, true_height, -1);
+	buffer = graph->frame;
+
+	gdk_draw_rectangle(buffer, Whitecontext, TRUE, 0, 0, true_width-1, true_height-1);
+	gdk_draw_rectangle(buffer, BlueandWcontext, FALSE, 0, 0, true_width-1, true_height-1);
+
+	gtk_graph_plot_title (graph);   /* Title First - since this may affect the screen area available
+									* to draw on an hence it will adjust user_origin_y and user_height */
+	gtk_graph_plot_axes_titles(graph); /* user_origin_y and user_height can also be changed here */
+
+	graph->frame_origin_y = user_origin_y;
+	graph->frame_height = user_height;
+	buffer = graph->pixmap;
+	}
+
+gdk_draw_pixmap(buffer, BandWcontext, graph->frame, 0, 0, 0, 0, true_width, true_height);
+user_origin_y = graph->frame_origin_y;
+user_height = graph->frame_height;
+graph->user_origin_y = user_origin_y;
+graph->user_height = user_height;
 }
+
 /* gtk_graph_plot_axes_titles */
 static void gtk_graph_plot_axes_titles (GtkGraph *graph)
 {
-gint text_width, text_height, y_range, label_len;
-PangoFontDescription *fontdesc = NULL;
+gint text_width, text_height;
 PangoLayout *layout = NULL;
+
+g_return_if_fail (graph != NULL);
+g_return_if_fail (GTK_IS_GRAPH (graph));
+g_return_if_fail (GTK_WIDGET_REALIZED (graph));
+
+if (graph->dependant->title != NULL)
+	{
+	layout = gtk_graph_label(graph, GTK_GRAPH_FONT_LABEL, graph->dependant->title, &text_width, &text_height);
+	gdk_draw_layout(buffer, BandWcontext, margin, user_origin_y, layout);
+	user_origin_y += (text_height + margin / 2.0);
+	}
+/* Nothing should affect user_origin_y from here, so thus calculate user_height from it */
+	
+user_height = true_height - user_origin_y - margin / 2.0;
+
+if (graph->independant->title != NULL)
+	{
+	layout = gtk_graph_label(graph, GTK_GRAPH_FONT_LABEL, graph->independant->title, &text_width, &text_height);
+	gdk_draw_layout(buffer, BandWcontext, user_origin_x + user_width / 2 - text_width / 2, user_origin_y + user_height - text_height, layout);
+	user_height -= text_height;		
+	}
+}
+
+/* gtk_graph_fit_axes_labels: take room for the tick labels out of the plotting area.  They
+ * depend on the data so this is done every time the axes are drawn, but the text is only
+ * measured once */
+static void gtk_graph_fit_axes_labels (GtkGraph *graph)
+{
+gint text_width, text_height, y_range, label_len;
 gint i;
 gchar *label_buffer = NULL, *format_string = NULL;
 gfloat global_X_max = -1E99, global_Y_max= -1E99, global_X_min=1E99, global_Y_min=1E99;
-GtkGraphTrace *t = graph->traces;
+GtkGraphTrace *t;
 g_return_if_fail (graph != NULL);
 g_return_if_fail (GTK_IS_GRAPH (graph));
 g_return_if_fail (GTK_WIDGET_REALIZED (graph));
-	
-fontdesc = pango_font_description_from_string("Sans 10");
-layout = gtk_widget_create_pango_layout(GTK_WIDGET(graph), NULL);
-pango_layout_set_font_description(layout, fontdesc);		
 
 /* Dichotomy: we need axis_max and axis_min to determine values of crossing points and
 *  positions of maximum label length but we can't determine them till after we know the
@@ -662,6 +897,7 @@ pango_layout_set_font_description(layout, fontdesc);
 
 for (i = 0 ; i < graph->num_traces ; i++)
 	{
+	t = graph->traces[i];
 	if (t->xmax > global_X_max)
 		global_X_max = t->xmax;
 	if (t->xmin < global_X_min)
@@ -670,35 +906,11 @@ for (i = 0 ; i < graph->num_traces ; i++)
 		global_Y_max = t->ymax;
 	if (t->ymin < global_Y_min)
 		global_Y_min = t->ymin;
-	t = t->next;
-	}
-	
-if (graph->dependant->title != NULL)
-	{
-	pango_layout_set_text(layout, graph->dependant->title, -1);
-	pango_layout_get_pixel_size(layout, &text_width, &text_height);
-	gdk_draw_layout(buffer, BandWcontext, margin, user_origin_y, layout);
-	user_origin_y += (text_height + margin / 2.0);
-	}
-/* Nothing should affect user_origin_y from here, so thus calculate user_height from it */
-	
-user_height = true_height - user_origin_y - margin / 2.0;
-
-if (graph->independant->title != NULL)
-	{
-	pango_layout_set_text(layout, graph->independant->title, -1);
-	pango_layout_get_pixel_size(layout, &text_width, &text_height);
-	gdk_draw_layout(buffer, BandWcontext, user_origin_x + user_width / 2 - text_width / 2, user_origin_y + user_height - text_height, layout);
-	user_height -= text_height;		
-	graph->user_height = user_height;
 	}
 
 /* Calculate the height of the X-axis label text Since this may need to be subtracted
 	from the user_height variable if the X-axis crosses the Y-axis somewhere the minumum */
-label_buffer = g_strdup_printf("1234567890E+1");
-pango_layout_set_text(layout, label_buffer, -1);
-pango_layout_get_pixel_size(layout, &text_width, &text_height);
-g_free(label_buffer);
+gtk_graph_label(graph, GTK_GRAPH_FONT_LABEL, "1234567890E+1", &text_width, &text_height);
 
 /* If the crossing_value is within a specified value (10% of the total range) of the axis_max
 	minumum then we need to reduce user_height to account for the text height.  If the crossing_value is more than 5%
@@ -718,28 +930,14 @@ graph->user_origin_y = user_origin_y;
 text labels on the Y-axis affects the position of the x-origin and width, so now conduct
 the same sort of exercise as above. The maximum width of the Y-axis label text will occur
 at the axis maximum (or possibly the minimum due to the extra length of a minus sign */
-switch(graph->dependant->format)
-	{
-	case FLOATING_POINT:
-		format_string = g_strdup_printf( "%%.%df", graph->dependant->precision);
-		break;
-	case ENGINEERING:
-		format_string = g_strdup_printf("%%.%de", graph->dependant->precision);
-		break;
-	case SCIENTIFIC:
-		format_string = g_strdup_printf("%%.%de", graph->dependant->precision);
-		break;
-	}
+format_string = gtk_graph_axis_label_format(graph->dependant);
 label_buffer = g_strdup_printf(format_string, global_Y_max);
-pango_layout_set_text(layout, label_buffer, -1);
-pango_layout_get_pixel_size(layout, &text_width, &text_height);
+gtk_graph_label(graph, GTK_GRAPH_FONT_LABEL, label_buffer, &text_width, &text_height);
 g_free(label_buffer);
 label_len = text_width;
 	
 label_buffer = g_strdup_printf(format_string, global_Y_min);
-
-pango_layout_set_text(layout, label_buffer, -1);
-pango_layout_get_pixel_size(layout, &text_width, &text_height);	
+gtk_graph_label(graph, GTK_GRAPH_FONT_LABEL, label_buffer, &text_width, &text_height);
 g_free(label_buffer);	
 g_free(format_string);	
 
@@ -748,33 +946,53 @@ user_width -= (MAX(text_width, label_len) + MAJ_TICK_LEN);
 	
 graph->user_width = user_width;
 graph->user_origin_x = user_origin_x;
-	
-pango_font_description_free(fontdesc);
-g_object_unref(layout);	
 }
 
 /* gtk_graph_plot_traces: Draw the graph traces on the pixmap.*/
+/* XY traces go through the cairo layer or density map if either is in use, anything they can't draw through GDK */
+static void gtk_graph_plot_xy_traces (GtkGraph *graph)
+{
+if (graph->renderer == GTK_GRAPH_RENDER_CAIRO)
+	gtk_graph_trace_layer_plot (graph);
+else if (graph->renderer == GTK_GRAPH_RENDER_DENSITY)
+	gtk_graph_density_plot (graph);
+gtk_graph_plot_traces (graph);
+}
+
 static void gtk_graph_plot_traces (GtkGraph *graph)
 {
-gint i = 0, n;
+gint i = 0, j, n;
 GtkGraphTrace *tmp;
 GdkPoint *pts = NULL;
 GdkRectangle clip_rect;
+gint bottom;
 
 g_return_if_fail (graph != NULL);
 g_return_if_fail (GTK_IS_GRAPH (graph));
 g_return_if_fail (GTK_WIDGET_REALIZED (graph));
 
-tmp = graph->traces;
+bottom = (int) rint((graph->dependant->axis_max - graph->dependant->axis_min) * graph->dependant->scale_factor) + user_origin_y;
+graph->window.x_chunks = NULL;	/* only shared within one pass, the data may have changed since the last */
+
 for (n = 0 ; n < graph->num_traces ; n++)
 	{
+	tmp = graph->traces[n];
 	/* Make sure that there is some data in the trace */
-	if (tmp->Xdata == NULL || tmp->Ydata == NULL) 
+	if (tmp->x_chunks == NULL || tmp->y_chunks == NULL || tmp->num_points == 0) 
+		continue;
+
+	/* already on the cairo layer or density map */
+	if (graph->renderer != GTK_GRAPH_RENDER_GDK && tmp->format->marker_type == GTK_GRAPH_MARKER_NONE)
+		continue;
+
+	/* Only draw what's visible, a few points per pixel column */
+	gtk_graph_trace_decimate(graph, tmp);
+	if (tmp->num_decimated == 0)
 		continue;
 
 	/* Assign the storage for the co-ordinates of each data point */
 
-	pts = (GdkPoint *) g_malloc ((tmp->num_points) * sizeof(GdkPoint));
+	pts = (GdkPoint *) g_malloc ((tmp->num_decimated) * sizeof(GdkPoint));
 
 	/* Set a clipping rectangle for each trace */
 	
@@ -787,22 +1005,19 @@ for (n = 0 ; n < graph->num_traces ; n++)
 
 	/* Calculate the positions of the co-ordinates */
 	
-	gint j=0;
-	
-	for (i = 0 ; i < tmp->num_points ; i++)
+	for (i = 0 ; i < tmp->num_decimated ; i++)
 	{
-		//~ printf ("** if=%d **\n", tmp->incrementFactor);
-		pts[i].x = (int) rint((tmp->Xdata[j] - graph->independant->axis_min ) * graph->independant->scale_factor) + user_origin_x;
-		pts[i].y = (int) rint((graph->dependant->axis_max - tmp->Ydata[j] ) * graph->dependant->scale_factor) + user_origin_y;
-		if (tmp->Ydata[i] < graph->dependant->axis_min)  /* Implement Crude bottom end clipping */
-			pts[i].y = (int) rint((graph->dependant->axis_max - graph->dependant->axis_min) * graph->dependant->scale_factor) + user_origin_y;
+		j = tmp->decimated[i];
+		pts[i].x = (int) rint((GTK_GRAPH_TRACE_X(tmp, j) - graph->independant->axis_min ) * graph->independant->scale_factor) + user_origin_x;
+		pts[i].y = (int) rint((graph->dependant->axis_max - GTK_GRAPH_TRACE_Y(tmp, j) ) * graph->dependant->scale_factor) + user_origin_y;
+		if (GTK_GRAPH_TRACE_Y(tmp, j) < graph->dependant->axis_min)  /* Implement Crude bottom end clipping */
+			pts[i].y = bottom;
 		//~ printf ("pts[%d].x = %d  pts[%d].y = %d\n", i, pts[i].x, i, pts[i].y);
-		j+=tmp->incrementFactor;
 	}
 
-	gdk_draw_lines (buffer,tmp->format->line_gc, pts, tmp->num_points);/* Draw the lines */	
+	gdk_draw_lines (buffer,tmp->format->line_gc, pts, tmp->num_decimated);/* Draw the lines */	
 
-	for (i = 0 ; i < tmp->num_points ; i++)/* and then draw the markers */	
+	for (i = 0 ; i < tmp->num_decimated ; i++)/* and then draw the markers */	
         if (tmp->format->marker_type != GTK_GRAPH_MARKER_NONE)
 		{
 			gdk_gc_set_clip_origin(tmp->format->marker_gc, pts[i].x - tmp->format->marker_size, pts[i].y - tmp->format->marker_size);
@@ -811,16 +1026,12 @@ for (n = 0 ; n < graph->num_traces ; n++)
 
 	/* Free up all storage after use */
 	g_free(pts);
-	
-	/* and then move onto the next trace */
-	tmp = tmp->next;
 	}
 }
 
 static void gtk_graph_plot_title (GtkGraph *graph)
 {
 gint text_width, text_height;	
-PangoFontDescription *fontdesc = NULL;
 PangoLayout *layout = NULL;
 
 g_return_if_fail (graph != NULL);
@@ -830,13 +1041,8 @@ g_return_if_fail (GTK_WIDGET_REALIZED (graph));
 if (graph->title == NULL)
 	return;
 
-fontdesc = pango_font_description_from_string("Sans 11");
-layout = gtk_widget_create_pango_layout(GTK_WIDGET(graph), graph->title);
-pango_layout_set_font_description(layout, fontdesc);
-pango_layout_get_pixel_size(layout, &text_width, &text_height);
-
+layout = gtk_graph_label(graph, GTK_GRAPH_FONT_TITLE, graph->title, &text_width, &text_height);
 gdk_draw_layout(buffer, BandWcontext, true_width / 2.0 - text_width / 2.0, user_origin_y , layout);
-pango_font_description_free(fontdesc);
 
 user_origin_y += text_height;
 user_height -= text_height;
@@ -844,20 +1050,11 @@ user_height -= text_height;
 if (graph->subtitle == NULL)
 	return;
 	
-fontdesc = pango_font_description_from_string("Sans 10");
-pango_layout_set_text(layout, graph->subtitle, -1);
-pango_layout_set_font_description(layout, fontdesc);	
-pango_layout_get_pixel_size(layout, &text_width, &text_height);
+layout = gtk_graph_label(graph, GTK_GRAPH_FONT_LABEL, graph->subtitle, &text_width, &text_height);
 gdk_draw_layout(buffer, BandWcontext, true_width / 2.0 - text_width / 2.0, user_origin_y, layout);
 
 user_origin_y += text_height;
 user_height -= text_height;
-
-graph->user_height = user_height;
-graph->user_origin_y = user_origin_y;
-
-pango_font_description_free(fontdesc);
-g_object_unref(layout);
 }
 
 /**
@@ -882,19 +1079,15 @@ if (graph->subtitle != NULL)
 
 graph->title = g_strdup(title);
 graph->subtitle = g_strdup(subtitle);
+gtk_graph_queue_redraw(graph, GTK_GRAPH_DIRTY_AXES | GTK_GRAPH_DIRTY_TITLES);
 }
   
 
+/* gtk_graph_plot_legend: paste the legend over the traces.  It's only drawn again when
+ * the traces are added to or restyled */
 static void gtk_graph_plot_legend (GtkGraph *graph)                  
 {
-gint text_height, text_width;	
-PangoFontDescription *fontdesc = NULL;
-PangoLayout *layout = NULL;
-
-gint i, ypos = 0, max_len = 0, len = 0;
-gint legend_x = 0, legend_y = 0, legend_width = 0, legend_height = 0, legend_margin;
-gchar *text_buffer = NULL;
-GtkGraphTrace *tmp;
+gint legend_x = 0, legend_y = 0, legend_width, legend_height, legend_margin = 4;
 
 g_return_if_fail (graph != NULL);
 g_return_if_fail (GTK_IS_GRAPH (graph));
@@ -902,37 +1095,12 @@ g_return_if_fail (GTK_WIDGET_REALIZED (graph));
 if (graph->legend_visible == FALSE)
 	return;
 
-fontdesc = pango_font_description_from_string("Sans 8");
-layout = gtk_widget_create_pango_layout(GTK_WIDGET(graph), NULL);
-pango_layout_set_font_description(layout, fontdesc);
-
-legend_margin = 4;
-	
-tmp = graph->traces;
-for (i = 0 ; i < graph->num_traces ; i++)
-	{
-	if (tmp->format->legend_text == NULL)
-		{
-		pango_layout_set_text(layout, "Trace 00", -1);
-		pango_layout_get_pixel_size(layout, &len, &text_height);
-		}
-	else
-		{
-		pango_layout_set_text(layout, tmp->format->legend_text, -1);
-		pango_layout_get_pixel_size(layout, &text_width, &text_height);
-		}
-	if (text_width > max_len)
-		max_len = text_width;
-	}
-
-if (graph->legend_position != GTK_GRAPH_NORTH && graph->legend_position != GTK_GRAPH_SOUTH)
-    {
-	legend_width = max_len + 40;
-	legend_height = graph->num_traces * (text_height + legend_margin);
-    }
-else
-	{
-	}
+if (graph->legend == NULL || (graph->dirty & (GTK_GRAPH_DIRTY_FORMAT | GTK_GRAPH_DIRTY_TITLES)))
+	gtk_graph_render_legend (graph);
+if (graph->legend == NULL)
+	return;
+legend_width = graph->legend_width;
+legend_height = graph->legend_height;
     
 switch (graph->legend_position)
     {
@@ -977,37 +1145,77 @@ switch (graph->legend_position)
         break;
     }
 
-gdk_draw_rectangle(buffer, Whitecontext, TRUE, legend_x, legend_y, legend_width, legend_height);
-gdk_draw_rectangle(buffer, BandWcontext, FALSE, legend_x, legend_y, legend_width, legend_height);
+gdk_draw_pixmap(buffer, BandWcontext, graph->legend, 0, 0, legend_x, legend_y, legend_width + 1, legend_height + 1);
+}
+
+/* gtk_graph_render_legend: draw the legend box into graph->legend.  North and south
+ * legends aren't laid out yet so there's nothing to draw for them */
+static void gtk_graph_render_legend (GtkGraph *graph)
+{
+gint text_height = 0, text_width;
+PangoLayout *layout = NULL;
+
+gint i, ypos = 0, max_len = 0;
+gint legend_width = 0, legend_height = 0, legend_margin;
+gchar *text_buffer = NULL;
+GtkGraphTrace *tmp;
+
+legend_margin = 4;
+	
+for (i = 0 ; i < graph->num_traces ; i++)
+	{
+	tmp = graph->traces[i];
+	if (tmp->format->legend_text == NULL)
+		gtk_graph_label(graph, GTK_GRAPH_FONT_LEGEND, "Trace 00", &text_width, &text_height);
+	else
+		gtk_graph_label(graph, GTK_GRAPH_FONT_LEGEND, tmp->format->legend_text, &text_width, &text_height);
+	if (text_width > max_len)
+		max_len = text_width;
+	}
+
+if (graph->legend_position != GTK_GRAPH_NORTH && graph->legend_position != GTK_GRAPH_SOUTH)
+    {
+	legend_width = max_len + 40;
+	legend_height = graph->num_traces * (text_height + legend_margin);
+    }
+
+if (graph->legend != NULL && (legend_width != graph->legend_width || legend_height != graph->legend_height))
+	{
+	gdk_pixmap_unref (graph->legend);
+	graph->legend = NULL;
+	}
+if (legend_width == 0 || legend_height == 0)
+	return;
+if (graph->legend == NULL)
+	graph->legend = gdk_pixmap_new (GTK_WIDGET(graph)->window, legend_width + 1, legend_height + 1, -1);
+graph->legend_width = legend_width;
+graph->legend_height = legend_height;
+
+gdk_draw_rectangle(graph->legend, Whitecontext, TRUE, 0, 0, legend_width, legend_height);
+gdk_draw_rectangle(graph->legend, BandWcontext, FALSE, 0, 0, legend_width, legend_height);
 
-tmp = graph->traces;
 for (i = 0 ; i < graph->num_traces ; i++)
 	{
+	tmp = graph->traces[i];
     ypos =	(legend_margin + text_height) * (2 * i + 1) / 2  ;
 
-	gdk_draw_line(buffer, tmp->format->line_gc, legend_x + legend_margin, legend_y + ypos, legend_x + 25, legend_y + ypos);
+	gdk_gc_set_clip_rectangle(tmp->format->line_gc, NULL);	/* clipped to the plot, it's set again before the traces are drawn */
+	gdk_draw_line(graph->legend, tmp->format->line_gc, legend_margin, ypos, 25, ypos);
 	if (tmp->format->marker_type != GTK_GRAPH_MARKER_NONE)
 		{
-		gdk_gc_set_clip_origin(tmp->format->marker_gc, legend_x + 15 - tmp->format->marker_size, legend_y + ypos - tmp->format->marker_size);
-        gdk_draw_pixmap(buffer, tmp->format->marker_gc, tmp->format->marker, 0, 0, legend_x + 15 - tmp->format->marker_size, legend_y + ypos - tmp->format->marker_size, -1, -1);
+		gdk_gc_set_clip_origin(tmp->format->marker_gc, 15 - tmp->format->marker_size, ypos - tmp->format->marker_size);
+        gdk_draw_pixmap(graph->legend, tmp->format->marker_gc, tmp->format->marker, 0, 0, 15 - tmp->format->marker_size, ypos - tmp->format->marker_size, -1, -1);
 		}
 	
-	if  (text_buffer != NULL);
-		free(text_buffer);
-
 	if (tmp->format->legend_text == NULL)
 		text_buffer = g_strdup_printf("Trace %d", i);
 	else
 		text_buffer = g_strdup_printf("%s", tmp->format->legend_text);
 
-	pango_layout_set_text(layout, text_buffer, -1);
-	pango_layout_get_pixel_size(layout, &len, &text_height);
-	gdk_draw_layout(buffer, BandWcontext, legend_x + 35, legend_y + ypos - text_height /2, layout);	
-	
-	tmp=tmp->next;
+	layout = gtk_graph_label(graph, GTK_GRAPH_FONT_LEGEND, text_buffer, &text_width, &text_height);
+	gdk_draw_layout(graph->legend, BandWcontext, 35, ypos - text_height /2, layout);	
+	g_free(text_buffer);
 	}
-pango_font_description_free(fontdesc);
-g_object_unref(layout);
 }
 
 /**
@@ -1026,6 +1234,12 @@ g_return_if_fail (GTK_IS_GRAPH (graph));
 
 graph->legend_visible = is_visible;
 graph->legend_position = position;
+
+/* the cached legend is laid out for its position and goes stale while hidden */
+if (graph->legend != NULL)
+	gdk_pixmap_unref (graph->legend);
+graph->legend = NULL;
+gtk_graph_queue_redraw(graph, GTK_GRAPH_DIRTY_TRACES);
 }
 
 /* libm.a version of rint() doesn't seem to link with dev-cpp so here's my own */
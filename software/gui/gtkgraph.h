@@ -253,6 +253,50 @@ GTK_GRAPH_WEST          =   1 << 6,/*! Right Edge Centred Vertically*/
 GTK_GRAPH_NORTH_WEST    =   1 << 7 /*! Top Left Corner */
 } GtkGraphPosition;
 
+/*! Enumerated type passed to gtk_graph_queue_redraw() to say which part of a graph is out of date */
+typedef enum
+{
+GTK_GRAPH_DIRTY_TRACES = 1 << 0,
+GTK_GRAPH_DIRTY_AXES = 1 << 1,
+GTK_GRAPH_DIRTY_FORMAT = 1 << 2,
+GTK_GRAPH_DIRTY_TITLES = 1 << 3
+} GtkGraphDirtyFlags;
+/*! \var GtkGraphDirtyFlags GTK_GRAPH_DIRTY_TRACES
+ * Trace data or annotations have changed, the axes can be reused */
+/*! \var GtkGraphDirtyFlags GTK_GRAPH_DIRTY_AXES
+ * Limits, formatting or size have changed, the grid, ticks and labels are
+ * drawn again over the saved titles and the traces on top of them */
+/*! \var GtkGraphDirtyFlags GTK_GRAPH_DIRTY_FORMAT
+ * Traces have been added, restyled or had their data replaced rather than
+ * appended to, so nothing already drawn of them can be kept */
+/*! \var GtkGraphDirtyFlags GTK_GRAPH_DIRTY_TITLES
+ * A title, axis title or legend entry has changed, the saved copies they
+ * are drawn on have to be drawn again */
+
+/*! Fonts a graph draws its text in, each with its own cache of laid out strings */
+#define GTK_GRAPH_NUM_FONTS 4
+
+/*! Enumerated type passed to gtk_graph_set_renderer() */
+typedef enum
+{
+GTK_GRAPH_RENDER_GDK,
+GTK_GRAPH_RENDER_CAIRO,
+GTK_GRAPH_RENDER_DENSITY
+} GtkGraphRenderer;
+/*! \var GtkGraphRenderer GTK_GRAPH_RENDER_GDK
+ * Traces are drawn in full with GDK every time (default) */
+/*! \var GtkGraphRenderer GTK_GRAPH_RENDER_CAIRO
+ * XY traces are drawn anti-aliased onto a layer of their own with cairo.  When
+ * the only change is new data and the x axis sliding along (auto panning) the
+ * layer is scrolled and just the newly exposed strip is drawn */
+/*! \var GtkGraphRenderer GTK_GRAPH_RENDER_DENSITY
+ * XY traces are drawn as a heat map: the points in each pixel are counted and
+ * the pixel shaded by the log of the count.  For millions of points, which
+ * needn't be in x order.  While the axes stay put only new points are counted */
+
+/*! Default number of times per second queued redraws are carried out */
+#define GTK_GRAPH_DEFAULT_FRAME_RATE 30
+
 /* --- Defining data structures. ---  */
 
 /*!GtkGraphAxis describes the content and formatting of each axis.
@@ -285,6 +329,10 @@ gfloat scale_factor;
 } GtkGraphAxis;
 
 
+/*! Callback that finds the indices of the smallest and largest y values in
+ * points start .. end-1 of a trace, see gtk_graph_trace_set_range_func() */
+typedef void (*GtkGraphRangeFunc) (gpointer data, gint start, gint end, gint *min_index, gint *max_index);
+
 /*!GtkGraphTraceFormat structure contains all of the formatting information
  * for the formatting of individual traces.  This is an opaque structure and
  * its contents should not be written to directly.  Instead please use the
@@ -307,6 +355,10 @@ GdkGC *mask_gc;
 GtkGraphLineType line_type;
 GdkGC *line_gc;
 gboolean line_visible;
+GdkColor line_color;		/* what line_gc was set up with, for the cairo renderer */
+gint line_width;
+gint8 dash_list[4];
+gint num_dashes;
 	
 gchar *legend_text;
 } GtkGraphTraceFormat;
@@ -335,7 +387,6 @@ struct _GtkGraphAnnotation
 GtkGraphAnnotationType type;
 gfloat value;
 gchar *text;
-GtkGraphAnnotation *next;
 }; 
 
 /*! \struct GtkGraphTrace structure contains the data describing each individual trace
@@ -351,16 +402,50 @@ struct _GtkGraphTrace
 gfloat *Xdata;
 gfloat *Ydata;
 gint num_points;
-gint incrementFactor;
+gfloat **x_chunks;			/* the data as 2^chunk_shift point blocks, flat data is one big block */
+gfloat **y_chunks;
+gint chunk_shift;
+gint first_point;			/* index of the oldest point, points are first_point .. first_point + num_points - 1 */
 gfloat xmax;
 gfloat xmin;
 gfloat ymax;
 gfloat ymin;
+
+gint *decimated;			/* indices of the points actually drawn on an XY graph */
+gint num_decimated;
+gint decimated_size;
+gint layer_end;				/* first_point + num_points when last drawn on the cairo layer */
+gint density_start;			/* first_point and first_point + num_points when last binned by the density renderer */
+gint density_end;
+guint32 *density_counts;	/* its points per pixel, kept while the axes and size stay the same */
+gboolean decimation_valid;	/* cleared when the data changes */
+gfloat decimated_axis_min;	/* the part of the x axis the decimation was done for */
+gfloat decimated_axis_max;
+gfloat decimated_scale;
+GtkGraphRangeFunc range_func;	/* optional fast min/max lookup used when decimating */
+gpointer range_data;
+
 GtkGraphTraceFormat *format;
-GtkGraphTrace *next;
 } ;
 
 
+/*! GtkGraphXWindow is the part of a trace's x data that is visible at the
+ * current x axis limits, split into pixel columns.  Traces given the same
+ * chunked x data (a channel group) only have it worked out once per redraw */
+typedef struct
+{
+gfloat **x_chunks;			/* the x data it was found for, NULL if none yet */
+gint first_point;
+gint num_points;
+gfloat span_min;			/* and the part of the x axis */
+gfloat span_max;
+gint lo;					/* visible points are lo .. hi-1, plus one either side */
+gint hi;
+gint *edges;				/* column c is points edges[c] .. edges[c+1]-1, only if there are too many to draw them all */
+gint num_edges;
+gint edges_size;
+} GtkGraphXWindow;
+
 /*! GtkGraph structure is the parent structure of a GtkGraph This is an opaque
  * structure and its contents should not be written to directly. A GtkGraph is 
  * created with gtk_graph_new() and its components are modified using the
@@ -369,10 +454,12 @@ GtkGraphTrace *next;
 typedef struct 
 {
 GtkWidget drawing_area;		/* We need a windowed widget to act as placeholder   */
-GtkGraphTrace *traces;
+GtkGraphTrace **traces;		/* indexed by trace id, the traces themselves never move */
 gint num_traces;
-GtkGraphAnnotation *annotations;
+gint traces_size;
+GtkGraphAnnotation **annotations;	/* likewise by annotation id */
 gint num_annotations;	
+gint annotations_size;
 GtkGraphAxis *dependant;
 GtkGraphAxis *independant;
 GtkGraphType graph_type;
@@ -387,6 +474,36 @@ gint user_width;
 gint user_height;
 gint user_origin_x;
 gint user_origin_y;
+
+GdkPixmap *pixmap;		/* this graph's own backing store */
+GdkPixmap *background;	/* copy of the axes and grid with no traces on it (XY only) */
+GdkPixmap *frame;		/* the border and titles, only drawn when they or the size change */
+gint frame_origin_y;	/* what's left for the plot below the titles */
+gint frame_height;
+GdkPixmap *legend;		/* the legend, pasted over the traces */
+gint legend_width;
+gint legend_height;
+PangoFontDescription *fonts[GTK_GRAPH_NUM_FONTS];
+GHashTable *labels[GTK_GRAPH_NUM_FONTS];	/* text in each font already laid out, see label_cache.c */
+gint true_width;
+gint true_height;
+guint dirty;			/* GtkGraphDirtyFlags waiting for the next redraw tick */
+GtkGraphXWindow window;	/* visible part of the last x data decimated, reused by traces sharing it */
+
+GtkGraphRenderer renderer;
+cairo_surface_t *layer;	/* XY traces drawn by the cairo renderer, transparent everywhere else */
+gfloat layer_x_min;		/* the x at the layer's left edge */
+gfloat layer_x_scale;	/* and the axes it was drawn with, anything but x sliding means a full redraw */
+gfloat layer_y_min;
+gfloat layer_y_max;
+gfloat layer_y_scale;
+cairo_surface_t *density;	/* XY traces shaded by the density renderer */
+gfloat density_x_min;	/* the axes the traces' counts were binned with */
+gfloat density_x_scale;
+gfloat density_y_max;
+gfloat density_y_scale;
+guint32 *density_counts;	/* points per pixel for each binning thread but the first */
+gint density_counts_size;
 } GtkGraph;
 
 
@@ -434,6 +551,26 @@ gint gtk_graph_trace_new(GtkGraph *graph);
  *  \param n the number of points in the x and y arrays */
 void gtk_graph_trace_set_data(GtkGraph *graph, gint trace_id, gfloat *xd, gfloat *yd, gfloat xMin, gfloat xMax, gfloat yMin, gfloat yMax, gint n);
 
+/*! \brief Used to allocate a data set held in fixed size blocks to an XY trace
+ *  \param graph the GtkGraph that contains the trace being modified
+ *  \param trace_id the unique integer identifier of the trace as returned by
+ *  gtk_graph_trace_new()
+ *  \param x_chunks table of blocks of \a x co-ordinates, each 2^chunk_shift points long
+ *  \param y_chunks table of blocks of \a y co-ordinates, laid out the same way
+ *  \param chunk_shift log2 of the number of points in a block
+ *  \param first the index of the first point, x_chunks[0] holds the block it falls in
+ *  \param n the number of points */
+void gtk_graph_trace_set_chunked_data(GtkGraph *graph, gint trace_id, gfloat **x_chunks, gfloat **y_chunks, gint chunk_shift, gint first, gint n, gfloat xMin, gfloat xMax, gfloat yMin, gfloat yMax);
+
+/*! \brief Give a trace a faster way of finding the min and max of a range of its
+ *  data than scanning it, e.g. a precomputed summary.  Used when decimating
+ *  \param graph the GtkGraph that contains the trace being modified
+ *  \param trace_id the unique integer identifier of the trace as returned by
+ *  gtk_graph_trace_new()
+ *  \param func the lookup function, or NULL to scan the data
+ *  \param data passed to \a func */
+void gtk_graph_trace_set_range_func(GtkGraph *graph, gint trace_id, GtkGraphRangeFunc func, gpointer data);
+
 /*! \brief Change the formatting of the lines used to draw a particular trace
  *  \param graph the GtkGraph that contains the trace being modified
  *  \param trace_id the unique integer identifier of the trace as returned by
@@ -539,6 +676,21 @@ void gtk_graph_smith_set_Z0(GtkGraph *graph, gfloat Z0);
 void gtk_graph_redraw_traces (GtkWidget *widget);
 void gtk_graph_redraw_all (GtkWidget *widget);
 
+/*! \brief Mark part of a graph as out of date.  All queued graphs are redrawn
+ * together on the next frame tick, however many times they were queued
+ * \param graph the GtkGraph that needs redrawing
+ * \param flags which parts are out of date, see #GtkGraphDirtyFlags */
+void gtk_graph_queue_redraw (GtkGraph *graph, GtkGraphDirtyFlags flags);
+
+/*! \brief Set how many times per second queued redraws are carried out
+ * \param fps frames per second, e.g. 30 or 60 */
+void gtk_graph_set_frame_rate (guint fps);
+
+/*! \brief Choose how the traces of an XY graph are drawn
+ * \param graph the GtkGraph
+ * \param renderer see #GtkGraphRenderer */
+void gtk_graph_set_renderer (GtkGraph *graph, GtkGraphRenderer renderer);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
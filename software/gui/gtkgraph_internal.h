@@ -22,10 +22,35 @@ extern GdkGC *BlueandWcontext;
 extern GdkGC *Whitecontext;
 extern GdkGC *Gridcontext;
 
+/* The fonts behind GTK_GRAPH_NUM_FONTS */
+typedef enum
+{
+GTK_GRAPH_FONT_LEGEND,		/* Sans 8 */
+GTK_GRAPH_FONT_ANNOTATION,	/* Sans 9 */
+GTK_GRAPH_FONT_LABEL,		/* Sans 10, tick labels, axis titles and the subtitle */
+GTK_GRAPH_FONT_TITLE		/* Sans 11 */
+} GtkGraphFont;
+
+/* Point i of an XY trace, i runs from first_point */
+#define GTK_GRAPH_TRACE_X(t, i) ((t)->x_chunks[((i) >> (t)->chunk_shift) - ((t)->first_point >> (t)->chunk_shift)][(i) & ((1 << (t)->chunk_shift) - 1)])
+#define GTK_GRAPH_TRACE_Y(t, i) ((t)->y_chunks[((i) >> (t)->chunk_shift) - ((t)->first_point >> (t)->chunk_shift)][(i) & ((1 << (t)->chunk_shift) - 1)])
+#define GTK_GRAPH_FLAT_CHUNK_SHIFT 30	/* flat arrays are one block big enough for any trace */
+
 /* Function prototypes in axis.c */
 void gtk_graph_axis_scale_axis(GtkGraph *graph, gint user_width, gint user_height);
 /* Function prototypes in trace.c */
 void gtk_graph_trace_create_markers(GtkGraph *graph);
+void gtk_graph_trace_decimate(GtkGraph *graph, GtkGraphTrace *trace);
+void gtk_graph_trace_decimate_span(GtkGraph *graph, GtkGraphTrace *trace, gfloat span_min, gfloat span_max);
+/* Function prototypes in trace_layer.c */
+void gtk_graph_trace_layer_plot(GtkGraph *graph);
+void gtk_graph_trace_layer_free(GtkGraph *graph);
+/* Function prototypes in density.c */
+void gtk_graph_density_plot(GtkGraph *graph);
+void gtk_graph_density_free(GtkGraph *graph);
+/* Function prototypes in label_cache.c */
+PangoLayout *gtk_graph_label(GtkGraph *graph, GtkGraphFont font, const gchar *text, gint *width, gint *height);
+void gtk_graph_label_cache_free(GtkGraph *graph);
 /* Function prototypes in polar.c */
 void gtk_graph_polar_plot_axes(GtkGraph *graph);
 void gtk_graph_polar_plot_traces(GtkGraph *graph);
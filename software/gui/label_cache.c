@@ -0,0 +1,91 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "gtkgraph.h"
+#include "gtkgraph_internal.h"
+
+/* Text on a graph goes through here.  Each of the few fonts a graph uses has
+ * its description made once, and every string drawn in one keeps its
+ * PangoLayout and pixel size, so drawing the same tick labels, titles and
+ * annotations again is a hash lookup rather than laying the text out again.
+ * A font's cache is emptied when it fills up, the labels on an auto panning
+ * axis are new numbers every frame and would otherwise grow it forever. */
+
+#define GTK_GRAPH_LABEL_CACHE_SIZE 256
+
+typedef struct
+{
+PangoLayout *layout;
+gint width;
+gint height;
+} GtkGraphLabel;
+
+/* Declaration of all local functions */
+
+static void gtk_graph_label_free(gpointer data);
+
+static const gchar *font_names[GTK_GRAPH_NUM_FONTS] = {"Sans 8", "Sans 9", "Sans 10", "Sans 11"};
+
+/* Externally referenceable functions */
+
+/**
+ * gtk_graph_label:
+ * @graph:  the #GtkGraph the text is drawn on
+ * @font:	which of the graph's fonts
+ * @text:	the text
+ * @width:	set to its width in pixels
+ * @height:	and height
+ *
+ * Returns: a layout of @text ready to draw.  It belongs to the cache and is
+ * only good until the next call, draw it straight away.
+ */
+PangoLayout *gtk_graph_label(GtkGraph *graph, GtkGraphFont font, const gchar *text, gint *width, gint *height)
+{
+GtkGraphLabel *label;
+
+if (graph->labels[font] == NULL)
+	{
+	graph->fonts[font] = pango_font_description_from_string(font_names[font]);
+	graph->labels[font] = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, gtk_graph_label_free);
+	}
+
+label = g_hash_table_lookup(graph->labels[font], text);
+if (label == NULL)
+	{
+	if (g_hash_table_size(graph->labels[font]) >= GTK_GRAPH_LABEL_CACHE_SIZE)
+		g_hash_table_remove_all(graph->labels[font]);
+
+	label = g_new(GtkGraphLabel, 1);
+	label->layout = gtk_widget_create_pango_layout(GTK_WIDGET(graph), text);
+	pango_layout_set_font_description(label->layout, graph->fonts[font]);
+	pango_layout_get_pixel_size(label->layout, &label->width, &label->height);
+	g_hash_table_insert(graph->labels[font], g_strdup(text), label);
+	}
+
+*width = label->width;
+*height = label->height;
+return label->layout;
+}
+
+void gtk_graph_label_cache_free(GtkGraph *graph)
+{
+gint font;
+
+for (font = 0 ; font < GTK_GRAPH_NUM_FONTS ; font++)
+	{
+	if (graph->labels[font] != NULL)
+		g_hash_table_destroy(graph->labels[font]);
+	if (graph->fonts[font] != NULL)
+		pango_font_description_free(graph->fonts[font]);
+	graph->labels[font] = NULL;
+	graph->fonts[font] = NULL;
+	}
+}
+
+static void gtk_graph_label_free(gpointer data)
+{
+GtkGraphLabel *label = data;
+
+g_object_unref(label->layout);
+g_free(label);
+}
@@ -0,0 +1,158 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "linkMonitor.h"
+
+static double linkMonitorStart (struct linkMonitor* monitor, uint16_t sequence, uint16_t tick, double rxTime);
+
+void linkMonitorInit (struct linkMonitor* monitor) {
+	memset(monitor, 0, sizeof(struct linkMonitor));
+}
+
+// one frame's stamps and when it came in.  returns its sample time: seconds
+// on the FCU's clock since the first frame, carried on across FCU restarts
+double linkMonitorFrame (struct linkMonitor* monitor, uint16_t sequence, uint16_t tick, double rxTime) {
+	struct linkMonitorStats* stats = &monitor->stats;
+	uint16_t ahead = sequence - monitor->sequence, behind = monitor->sequence - 1 - sequence;
+	double elapsed, wraps, sampleTime, arrival, spacing, delay;
+	int64_t ticks;
+
+	stats->frames++;
+	if (!monitor->synced)
+		return linkMonitorStart(monitor, sequence, tick, rxTime);
+
+	// the frame we just had over again, nothing was lost or reordered
+	if (behind == 0) {
+		stats->duplicates++;
+		return monitor->sampleTime;
+	}
+
+	// overtaken by a later one, it was counted lost then but wasn't.  it goes
+	// where it belongs and changes nothing else
+	if (behind <= LINK_MONITOR_REORDER) {
+		stats->late++;
+		if (stats->lost > 0)
+			stats->lost--;
+		return monitor->anchor + (double)(monitor->ticks - (uint16_t)(monitor->tick - tick))/PACKET_TICK_HZ;
+	}
+
+	// the tick wraps every 65 seconds, our own clock says how many times it
+	// went round while nothing came in
+	elapsed = rxTime - monitor->rxTime;
+	ticks = (uint16_t)(tick - monitor->tick);
+	wraps = floor((elapsed*PACKET_TICK_HZ - ticks)/65536 + 0.5);
+	if (wraps > 0)
+		ticks += (int64_t) wraps*65536;
+
+	// a sequence number from well behind us or a clock that jumped is a new
+	// count.  or a broken frame that got past the parity check, so it only
+	// counts once the next frame carries on from it
+	if (ahead >= 0x8000 || fabs((double) ticks/PACKET_TICK_HZ - elapsed) > LINK_MONITOR_MAX_SLIP) {
+		if (monitor->stray && sequence == monitor->straySequence + 1 &&
+		    fabs((double)(uint16_t)(tick - monitor->strayTick)/PACKET_TICK_HZ - (rxTime - monitor->strayRxTime)) <= LINK_MONITOR_MAX_SLIP) {
+			stats->strays--;
+			stats->restarts++;
+			return linkMonitorStart(monitor, sequence, tick, rxTime);
+		}
+		monitor->stray = 1;
+		monitor->straySequence = sequence;
+		monitor->strayTick = tick;
+		monitor->strayRxTime = rxTime;
+		stats->strays++;
+		return monitor->sampleTime + elapsed;
+	}
+	monitor->stray = 0;
+
+	if (ahead > 0) {
+		stats->lost += ahead;
+		linkHistogramAdd(&stats->gaps, ahead);
+	}
+
+	monitor->ticks += ticks;
+	sampleTime = monitor->anchor + (double) monitor->ticks/PACKET_TICK_HZ;
+
+	// how much the arrival spacing differs from the send spacing
+	arrival = rxTime - monitor->rxTime;
+	spacing = sampleTime - monitor->sampleTime;
+	stats->jitter += (fabs(arrival - spacing) - stats->jitter)/16;
+	linkHistogramAdd(&stats->interarrival, arrival*1e6);
+	linkHistogramAdd(&stats->jitters, fabs(arrival - spacing)*1e6);
+
+	// the quickest delay creeps up a little all the time, so the two clocks
+	// drifting apart or a one off fast frame don't leave it stuck low
+	monitor->delay += LINK_MONITOR_DRIFT*arrival;
+	delay = rxTime - sampleTime;
+	if (delay < monitor->delay)
+		monitor->delay = delay;
+	stats->latency = delay - monitor->delay;
+	linkHistogramAdd(&stats->latencies, stats->latency*1e6);
+
+	monitor->sequence = sequence + 1;
+	monitor->tick = tick;
+	monitor->sampleTime = sampleTime;
+	monitor->rxTime = rxTime;
+	return sampleTime;
+}
+
+// the first frame, or the first since the FCU restarted.  time carries on
+// from where it was by our clock
+static double linkMonitorStart (struct linkMonitor* monitor, uint16_t sequence, uint16_t tick, double rxTime) {
+	if (monitor->synced)
+		monitor->anchor = monitor->sampleTime + (rxTime - monitor->rxTime);
+	monitor->synced = 1;
+	monitor->stray = 0;
+	monitor->ticks = 0;
+	monitor->delay = rxTime - monitor->anchor;
+	monitor->sequence = sequence + 1;
+	monitor->tick = tick;
+	monitor->sampleTime = monitor->anchor;
+	monitor->rxTime = rxTime;
+	return monitor->sampleTime;
+}
+
+void linkMonitorPrint (const struct linkMonitorStats* stats, FILE* out) {
+	fprintf(out, "link: %llu frames, %llu lost (%.2f%%), %llu late, %llu duplicates, %llu strays, %u restarts, jitter %.1f ms, latency %.1f ms\n",
+		(unsigned long long) stats->frames, (unsigned long long) stats->lost,
+		stats->frames + stats->lost ? 100.0*stats->lost/(stats->frames + stats->lost) : 0,
+		(unsigned long long) stats->late, (unsigned long long) stats->duplicates, (unsigned long long) stats->strays, stats->restarts, stats->jitter*1e3, stats->latency*1e3);
+	linkHistogramPrint(&stats->gaps, "lost in a row", "frames", out);
+	linkHistogramPrint(&stats->interarrival, "interarrival", "us", out);
+	linkHistogramPrint(&stats->jitters, "jitter", "us", out);
+	linkHistogramPrint(&stats->latencies, "latency", "us", out);
+}
+
+void linkHistogramAdd (struct linkHistogram* histogram, double value) {
+	int bin = 0;
+
+	if (value >= 1) {
+		frexp(value, &bin); // value is in [2^(bin-1), 2^bin)
+		if (bin >= LINK_MONITOR_BINS)
+			bin = LINK_MONITOR_BINS - 1;
+	}
+	histogram->bins[bin]++;
+	histogram->count++;
+	if (value > histogram->max)
+		histogram->max = value;
+}
+
+// the bins with anything in them, one a line
+void linkHistogramPrint (const struct linkHistogram* histogram, const char* name, const char* unit, FILE* out) {
+	int bin;
+
+	if (histogram->count == 0)
+		return;
+	fprintf(out, "  %s (%s), max %.0f\n", name, unit, histogram->max);
+	for (bin=0; bin<LINK_MONITOR_BINS; bin++) {
+		if (histogram->bins[bin] == 0)
+			continue;
+		if (bin == 0)
+			fprintf(out, "    %10s < %-10.0f", "", 1.0);
+		else if (bin == LINK_MONITOR_BINS - 1)
+			fprintf(out, "    %10.0f+ %-10s", ldexp(1, bin-1), "");
+		else
+			fprintf(out, "    %10.0f - %-10.0f", ldexp(1, bin-1), ldexp(1, bin));
+		fprintf(out, " %10u  %5.1f%%\n", histogram->bins[bin], 100.0*histogram->bins[bin]/histogram->count);
+	}
+}
@@ -0,0 +1,77 @@
+#ifndef __LINK_MONITOR_H__
+#define __LINK_MONITOR_H__
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "packetSchema.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+// keeps track of a link from the sequence number and FCU tick every frame
+// carries (PACKET_STAMP_FIELDS) and the CLOCK_MONOTONIC time it came in.
+// it gives each frame its real time, on the FCU's clock, so lost frames leave
+// a gap instead of squashing the plot together, and counts what the link is
+// doing: frames lost, how unevenly they arrive and how long they took.
+//
+// there's no shared clock, so a frame's true one way delay can't be known.
+// latency here is how much longer than the quickest recent frame a frame
+// took, which is what grows when something between the FCU and us backs up.
+
+#define LINK_MONITOR_BINS 24             // histogram bin k counts values in [2^(k-1), 2^k), bin 0 is below 1
+#define LINK_MONITOR_REORDER 16          // a frame 1 to this many behind is late, further back the FCU restarted
+#define LINK_MONITOR_MAX_SLIP 2.0        // seconds the FCU's clock may disagree with ours between frames before we call it a restart
+#define LINK_MONITOR_DRIFT 200e-6        // seconds a second the quickest delay is let creep up, covers the two crystals drifting apart
+
+// counts of a value on a log scale, microseconds for times, frames for drops
+struct linkHistogram {
+	uint32_t bins[LINK_MONITOR_BINS];
+	uint64_t count;
+	double max;
+};
+
+struct linkMonitorStats {
+	uint64_t frames;
+	uint64_t lost;                       // gaps in the sequence numbers
+	uint64_t late;                       // came in behind a later frame
+	uint64_t duplicates;                 // the same sequence number as the frame before
+	uint64_t strays;                     // stamps that fit nothing, a broken frame that got past the parity check
+	uint32_t restarts;                   // the FCU started counting again
+	double jitter;                       // smoothed interarrival jitter (RFC 3550), seconds
+	double latency;                      // of the last frame, seconds over the quickest
+	struct linkHistogram gaps;           // frames lost in a row
+	struct linkHistogram interarrival;   // us between frames arriving
+	struct linkHistogram jitters;        // us the arrival spacing differed from the send spacing
+	struct linkHistogram latencies;      // us over the quickest
+};
+
+struct linkMonitor {
+	int synced;
+	uint16_t sequence;      // expected next
+	uint16_t tick;          // last one seen
+	int64_t ticks;          // unwrapped, since the anchor
+	double anchor;          // sample time of ticks == 0
+	double sampleTime;      // of the last frame, seconds on the FCU's clock since the link came up
+	double rxTime;          // of the last frame
+	double delay;           // quickest recent rxTime - sampleTime
+	int stray;              // the last frame looked like a restart, the next one says whether it was
+	uint16_t straySequence;
+	uint16_t strayTick;
+	double strayRxTime;
+	struct linkMonitorStats stats;
+};
+
+void linkMonitorInit (struct linkMonitor* monitor);
+double linkMonitorFrame (struct linkMonitor* monitor, uint16_t sequence, uint16_t tick, double rxTime);
+void linkMonitorPrint (const struct linkMonitorStats* stats, FILE* out);
+
+void linkHistogramAdd (struct linkHistogram* histogram, double value);
+void linkHistogramPrint (const struct linkHistogram* histogram, const char* name, const char* unit, FILE* out);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __LINK_MONITOR_H__ */
@@ -7,13 +7,21 @@
 #include <glib.h>
 #include <math.h>
 #include <fcntl.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/stat.h>
 #include "gtkgraph.h"
 #include "dyGraph.h"
 #include "joystick.h"
 
 #include "uart.h"
-
-#define RX_BUFFER_LENGTH 10000
+#include "frameDecoder.h"
+#include "serialIngest.h"
+#include "flightLog.h"
+#include "replay.h"
+#include "packets.h"
+#include "telemetryBus.h"
+#include "relay.h"
 
 struct dyTrace* acclXTrace;
 struct dyTrace* acclYTrace;
@@ -44,40 +52,57 @@ struct dyGraph * dyGraphRawAccelerometer;
 struct dyGraph * dyGraphRawGyro;
 struct dyGraph * dyGraphOrientation;
 struct dyGraph * dyGraphPid;
+struct dyGraph * dyGraphSpectrum;
+
+struct dyTrace* spectrumTraces[6]; // accel x y z then gyro x y z
+
+// the accel or gyro half of the spectrum.  it only gets samples that really
+// came in, at a rate measured on the FCU's clock rather than assumed
+struct spectrumFeed {
+	struct dyTrace** traces; // three of spectrumTraces
+	int column;              // the first of their columns in graphPackets
+	int channel;             // TELEMETRY_CHANNEL_ a mux frame carries them in
+	double start;            // sample time the current measurement began at, < 0 for none
+	uint32_t count;          // samples since then
+	float rate;              // Hz the traces are labelled with, 0 until it's been measured
+};
+struct spectrumFeed spectrumFeeds[2] = {
+	{spectrumTraces, 0, TELEMETRY_CHANNEL_accel, -1, 0, 0},
+	{spectrumTraces + 3, 3, TELEMETRY_CHANNEL_gyro, -1, 0, 0},
+};
 
 static gint testUpdate (void);
 
 // ***************** Serial Stuff *********************
 
-struct fcu_pkt_t
-{
-    volatile uint8_t start;
-    volatile uint8_t parity;
-    volatile int16_t x_gyro;
-    volatile int16_t x_gyro_tmp;
-    volatile int16_t y_gyro;
-    volatile int16_t z_gyro;
-    volatile int16_t z_gyro_tmp;
-    volatile int16_t z_accel;
-    volatile int16_t x_accel;
-    volatile int16_t y_accel;
-    volatile int16_t roll;
-    volatile int16_t pitch;
-    volatile int16_t yaw;
-    volatile int16_t rollTarget;
-    volatile int16_t pitchTarget;
-    volatile int16_t yawTarget;
-    volatile int16_t motor1;
-    volatile int16_t motor2;
-    volatile int16_t motor3;
-    volatile int16_t motor4;
-};
-
-float graphTime = 0;
 int uartfd; 
 struct dyGraph* graph;
-
-void graphPacket (struct fcu_pkt_t * packet, float time);
+struct serialIngest ingest;
+struct replay replay;
+struct telemetryBusReader bus;
+struct relayClient relayLink;
+int replaying = 0;
+int onBus = 0;                    // following ingestd instead of opening the port
+int onRelay = 0;                  // following a relayd, maybe on another machine
+packetType livePacket = PACKET_FCU;
+struct spscQueue* telemetryQueue; // serial or replay, whichever is feeding us (not the bus)
+uint32_t drainLimit;              // most samples to graph in one go
+
+#define DISPLAY_RATE 30           // Hz the plots are fed and redrawn at
+#define INGEST_QUEUE_LENGTH 4096  // frames buffered between the serial thread and the gui
+#define REPLAY_QUEUE_LENGTH 65536 // room for a fast replay to get well ahead of the display
+#define DRAIN_BATCH 256
+#define LINK_REPORT_SECONDS 5     // how often the link counts are printed
+#define SCALE_HYSTERESIS 0.2      // y range has to shrink this much before the axes follow it in
+#define SPECTRUM_SIZE 256         // points per spectrum segment
+#define SPECTRUM_START_RATE 50    // Hz the spectrum is labelled at until its rate has been measured
+#define SPECTRUM_RATE_SECONDS 2   // of the FCU's clock, what each measurement of a spectrum's rate is over
+#define SPECTRUM_RATE_CHANGE 0.05 // fraction the rate has to move by for the frequency axis to follow
+
+struct linkHistogram displayLatency; // us from a frame arriving to it being plotted
+
+void graphPackets (struct telemetrySample * samples, uint32_t n);
+static void spectrumFeedAdd (struct spectrumFeed* feed, const struct telemetrySample* samples, float (*columns)[DRAIN_BATCH], uint32_t n);
 guint readSerial (void);
 
 // joystick stuff
@@ -103,12 +128,100 @@ volatile int16_t pitch_offset, roll_offset;
 
 int main (int argc, char **argv)
 {	
-	if (argc != 2) {
-		printf ("Usage: graph <serial port device (ex /dev/ttyUSB0)\n>");
+	struct stat source;
+
+	// a plain file is a recording, anything else is the serial port
+	replaying = (argc > 1 && stat(argv[1], &source) == 0 && S_ISREG(source.st_mode));
+	onBus = (!replaying && argc == 2 && strcmp(argv[1], "bus") == 0);
+	onRelay = (!replaying && argc == 3 && strcmp(argv[1], "relay") == 0);
+
+	if (argc < 2 || (replaying && argc > 4)) {
+		printf ("Usage: graph <serial port device (ex /dev/ttyUSB0)> [coded, if the FCU sends compressed telemetry]\n"
+			"       graph <serial port device> mux [channel=Hz ...] (ex gyro=100 pid=10 battery=0)\n"
+			"       graph bus, to follow ingestd alongside record and anything else\n"
+			"       graph relay <host[:port]>, to follow a relayd from another machine\n"
+			"       graph <recorded flight> [replay speed, 1 = real time or max] [start seconds]\n");
 		exit(-1);
 	} 
 
-	uartfd = initUART(argv[1]);
+	if (onBus) {
+		if (telemetryBusAttach (&bus, TELEMETRY_BUS_NAME))
+			exit(-1);
+		livePacket = bus.header->packet;
+		if (livePacket == PACKET_IMU) {
+			printf ("The bus carries IMU frames, there's nothing here to plot them\n");
+			exit(-1);
+		}
+		drainLimit = bus.header->slotCount;
+	} else if (onRelay) {
+		static const char* plotted[] = {"x accel", "y accel", "z accel", "x gyro", "y gyro", "z gyro", "roll", "pitch", "yaw", "channels"};
+		uint64_t mask = 0;
+		int i;
+
+		if (relayClientConnect (&relayLink, argv[2]))
+			exit(-1);
+		livePacket = relayLink.packet;
+		if (livePacket == PACKET_IMU) {
+			printf ("The relay carries IMU frames, there's nothing here to plot them\n");
+			exit(-1);
+		}
+		// only what gets plotted crosses the network
+		for (i=0; i<(int)(sizeof(plotted)/sizeof(plotted[0])); i++)
+			mask |= relayFieldMask (livePacket, plotted[i]);
+		if (relayClientSubscribe (&relayLink, mask, 1))
+			exit(-1);
+		drainLimit = INGEST_QUEUE_LENGTH;
+	} else if (replaying) {
+		const struct flightLogField* fcuFields;
+		int fcuFieldCount;
+		double speed = 1;
+
+		// names line up with the fields record puts in its logs, so a recording plays back into these plots.
+		// an IMU recording's gyro rates go on the gyro traces, it has no attitude
+		fcuFields = packetFields(PACKET_FCU, &fcuFieldCount);
+		if (argc > 2)
+			speed = (strcmp(argv[2], "max") == 0) ? REPLAY_MAX_SPEED : atof(argv[2]);
+		if (replayStart (&replay, argv[1], fcuFields, fcuFieldCount, FCU_PACKET_LENGTH, speed, REPLAY_QUEUE_LENGTH)) {
+			printf ("Couldn't replay %s\n", argv[1]);
+			exit(-1);
+		}
+		if (argc > 3)
+			replaySeek (&replay, atof(argv[3]));
+		printf ("replaying %.1f seconds of flight\n", replayDuration(&replay));
+		telemetryQueue = &replay.queue;
+		drainLimit = telemetryQueue->capacity;
+	} else {
+		serialIngestLink link = SERIAL_INGEST_RAW;
+		int i;
+
+		if (argc > 2 && strcmp(argv[2], "coded") == 0)
+			link = SERIAL_INGEST_CODED;
+		else if (argc > 2 && strcmp(argv[2], "mux") == 0) {
+			link = SERIAL_INGEST_MUX;
+			livePacket = PACKET_TELEMETRY;
+		}
+
+		uartfd = initUART(argv[1]);
+		if (serialIngestStart (&ingest, uartfd, (link == SERIAL_INGEST_MUX) ? TELEMETRY_PACKET_LENGTH : FCU_PACKET_LENGTH,
+				FRAME_DECODER_CHECK_PARITY, link, INGEST_QUEUE_LENGTH)) {
+			printf ("Couldn't start the serial thread\n");
+			exit(-1);
+		}
+		telemetryQueue = &ingest.queue;
+		drainLimit = telemetryQueue->capacity;
+
+		// channel=Hz asks the FCU for that channel at that rate from now on
+		for (i=3; link == SERIAL_INGEST_MUX && i<argc; i++) {
+			char command[64];
+			char* rate = strchr(argv[i], '=');
+			if (rate == NULL || rate == argv[i]) {
+				printf ("Expected channel=Hz, not %s\n", argv[i]);
+				continue;
+			}
+			snprintf (command, sizeof(command), "rate_%.*s %s", (int)(rate - argv[i]), argv[i], rate + 1);
+			serialIngestSend (&ingest, command);
+		}
+	}
 	
 	// joystick
 
@@ -123,6 +236,7 @@ int main (int argc, char **argv)
 	GtkWidget *windowRawAccelerometer;
 	GtkWidget *windowRawGyro;
 	GtkWidget *windowOrientation;
+	GtkWidget *windowSpectrum;
 	//~ GtkWidget *windowPid;
 	
 	gtk_init (&argc, &argv);
@@ -130,16 +244,19 @@ int main (int argc, char **argv)
 	windowRawAccelerometer = gtk_window_new (GTK_WINDOW_TOPLEVEL);
 	windowRawGyro = gtk_window_new (GTK_WINDOW_TOPLEVEL);
 	windowOrientation = gtk_window_new (GTK_WINDOW_TOPLEVEL);
+	windowSpectrum = gtk_window_new (GTK_WINDOW_TOPLEVEL);
 	//~ windowPid = gtk_window_new (GTK_WINDOW_TOPLEVEL);
 	
 	gtk_window_set_title (GTK_WINDOW(windowRawAccelerometer), "Falcon - Accelerometer");
 	gtk_window_set_title (GTK_WINDOW(windowRawGyro), "Falcon - Gyroscopes");
 	gtk_window_set_title (GTK_WINDOW(windowOrientation), "Falcon - Kalman Filter Output");
+	gtk_window_set_title (GTK_WINDOW(windowSpectrum), "Falcon - Vibration Spectrum");
 	//~ gtk_window_set_title (GTK_WINDOW(windowPid), "Falcon - Kalman Filter Output");
 	
 	gtk_widget_show(windowRawAccelerometer);
 	gtk_widget_show(windowRawGyro);
 	gtk_widget_show(windowOrientation);
+	gtk_widget_show(windowSpectrum);
 	//~ gtk_widget_show(windowPid);
 	
 	//~ g_signal_connect (windowRawAccelerometer, "destroy", G_CALLBACK (gtk_main_quit), NULL);
@@ -152,34 +269,52 @@ int main (int argc, char **argv)
     
     //******************* Make dyGraphs **********************
     
-    dyGraphRawAccelerometer = dyGraphInit ("Raw Accelerometer Readings", "", "Time", "", 5, -5, 5, DYGRAPH_SIMPLE, DYGRAPH_AUTO_PAN_X | DYGRAPH_AUTO_SCALE_Y );
-    dyGraphRawGyro = dyGraphInit ("Raw Gyroscope Readings", "", "Time", "", 5, -5, 5, DYGRAPH_SIMPLE, DYGRAPH_AUTO_PAN_X | DYGRAPH_AUTO_SCALE_Y);
-    dyGraphOrientation = dyGraphInit ("Orientation Estimate", "", "Time", "", 5, -5, 5, DYGRAPH_SIMPLE, DYGRAPH_AUTO_PAN_X | DYGRAPH_AUTO_SCALE_Y);
+    dyGraphRawAccelerometer = dyGraphInit ("Raw Accelerometer Readings", "", "Time", "", 5, -5, 5, DYGRAPH_SIMPLE, DYGRAPH_AUTO_PAN_X | DYGRAPH_AUTO_SCALE_Y | DYGRAPH_AUTO_SCALE_Y_WINDOW | DYGRAPH_ANTIALIAS);
+    dyGraphRawGyro = dyGraphInit ("Raw Gyroscope Readings", "", "Time", "", 5, -5, 5, DYGRAPH_SIMPLE, DYGRAPH_AUTO_PAN_X | DYGRAPH_AUTO_SCALE_Y | DYGRAPH_AUTO_SCALE_Y_WINDOW | DYGRAPH_ANTIALIAS);
+    dyGraphOrientation = dyGraphInit ("Orientation Estimate", "", "Time", "", 5, -5, 5, DYGRAPH_SIMPLE, DYGRAPH_AUTO_PAN_X | DYGRAPH_AUTO_SCALE_Y | DYGRAPH_AUTO_SCALE_Y_WINDOW | DYGRAPH_ANTIALIAS);
+    dyGraphSpectrum = dyGraphInitSpectrum ("Vibration Spectrum", "", SPECTRUM_START_RATE, SPECTRUM_SIZE, DYGRAPH_SIMPLE);
     //~ dyGraphPid = dyGraphInit ("PID Feedback Control", "", "Time", "", 5, -5, 5, DYGRAPH_SIMPLE, DYGRAPH_AUTO_PAN_X | DYGRAPH_AUTO_SCALE_Y);
+
+    // a spike (motors spinning up) only stretches y while it's on screen
+    dyGraphSetScaleHysteresis(dyGraphRawAccelerometer, SCALE_HYSTERESIS);
+    dyGraphSetScaleHysteresis(dyGraphRawGyro, SCALE_HYSTERESIS);
+    dyGraphSetScaleHysteresis(dyGraphOrientation, SCALE_HYSTERESIS);
 	
 	gtk_container_add(GTK_CONTAINER(windowRawAccelerometer), (GtkWidget*)dyGraphRawAccelerometer->table); // add the graph to the window
 	gtk_container_add(GTK_CONTAINER(windowRawGyro), (GtkWidget*)dyGraphRawGyro->table); // add the graph to the window
 	gtk_container_add(GTK_CONTAINER(windowOrientation), (GtkWidget*)dyGraphOrientation->table); // add the graph to the window
+	gtk_container_add(GTK_CONTAINER(windowSpectrum), (GtkWidget*)dyGraphSpectrum->table); // add the graph to the window
 	//~ gtk_container_add(GTK_CONTAINER(windowPid), (GtkWidget*)dyGraphPid->table); // add the graph to the window
 	
     gtk_widget_show(dyGraphRawAccelerometer->table);
     gtk_widget_show(dyGraphRawGyro->table);
     gtk_widget_show(dyGraphOrientation->table);
+    gtk_widget_show(dyGraphSpectrum->table);
     //~ gtk_widget_show(dyGraphPid->table);
     
     //******************** Add Traces **********************
     
-    acclXTrace = dyGraphAddTrace (dyGraphRawAccelerometer, SOLID, 2, BLUE, "Accel X");
-    acclYTrace = dyGraphAddTrace (dyGraphRawAccelerometer, SOLID, 2, GREEN, "Accel Y");
-    acclZTrace = dyGraphAddTrace (dyGraphRawAccelerometer, SOLID, 2, RED, "Accel Z");
+    // every trace below comes from the same packet so they all share one copy of the time
+    struct dyChannelGroup* packetGroup = dyGraphNewGroup();
+
+    acclXTrace = dyGraphAddGroupTrace (dyGraphRawAccelerometer, packetGroup, SOLID, 2, BLUE, "Accel X");
+    acclYTrace = dyGraphAddGroupTrace (dyGraphRawAccelerometer, packetGroup, SOLID, 2, GREEN, "Accel Y");
+    acclZTrace = dyGraphAddGroupTrace (dyGraphRawAccelerometer, packetGroup, SOLID, 2, RED, "Accel Z");
     
-    gyroXTrace = dyGraphAddTrace (dyGraphRawGyro, SOLID, 2, BLUE, "Gyro X");
-    gyroYTrace = dyGraphAddTrace (dyGraphRawGyro, SOLID, 2, GREEN, "Gyro Y");
-    gyroZTrace = dyGraphAddTrace (dyGraphRawGyro, SOLID, 2, RED, "Gyro Z");
+    gyroXTrace = dyGraphAddGroupTrace (dyGraphRawGyro, packetGroup, SOLID, 2, BLUE, "Gyro X");
+    gyroYTrace = dyGraphAddGroupTrace (dyGraphRawGyro, packetGroup, SOLID, 2, GREEN, "Gyro Y");
+    gyroZTrace = dyGraphAddGroupTrace (dyGraphRawGyro, packetGroup, SOLID, 2, RED, "Gyro Z");
     
-    eulerRollTrace = dyGraphAddTrace (dyGraphOrientation, SOLID, 2, BLUE, "Roll");
-    eulerPitchTrace = dyGraphAddTrace (dyGraphOrientation, SOLID, 2, GREEN, "Pitch");
-    eulerYawTrace = dyGraphAddTrace (dyGraphOrientation, SOLID, 2, RED, "Yaw");
+    eulerRollTrace = dyGraphAddGroupTrace (dyGraphOrientation, packetGroup, SOLID, 2, BLUE, "Roll");
+    eulerPitchTrace = dyGraphAddGroupTrace (dyGraphOrientation, packetGroup, SOLID, 2, GREEN, "Pitch");
+    eulerYawTrace = dyGraphAddGroupTrace (dyGraphOrientation, packetGroup, SOLID, 2, RED, "Yaw");
+
+    spectrumTraces[0] = dyGraphAddSpectrumTrace (dyGraphSpectrum, SOLID, 2, BLUE, "Accel X");
+    spectrumTraces[1] = dyGraphAddSpectrumTrace (dyGraphSpectrum, SOLID, 2, GREEN, "Accel Y");
+    spectrumTraces[2] = dyGraphAddSpectrumTrace (dyGraphSpectrum, SOLID, 2, RED, "Accel Z");
+    spectrumTraces[3] = dyGraphAddSpectrumTrace (dyGraphSpectrum, DOTTED, 2, BLUE, "Gyro X");
+    spectrumTraces[4] = dyGraphAddSpectrumTrace (dyGraphSpectrum, DOTTED, 2, GREEN, "Gyro Y");
+    spectrumTraces[5] = dyGraphAddSpectrumTrace (dyGraphSpectrum, DOTTED, 2, RED, "Gyro Z");
     
     //~ pidRollTrace = dyGraphAddTrace (dyGraphPid, SOLID, 2, BLUE, "Roll");
     //~ pidPitchTrace = dyGraphAddTrace (dyGraphPid, SOLID, 2, GREEN, "Pitch");
@@ -227,13 +362,35 @@ int main (int argc, char **argv)
 	//~ dyGraphPid = dyGraphPid;
 
     //~ g_timeout_add (100, (GSourceFunc) testUpdate, NULL);    
-    g_timeout_add(1, (GSourceFunc) readSerial, NULL);   
+    gtk_graph_set_frame_rate(DISPLAY_RATE);
+    g_timeout_add(1000/DISPLAY_RATE, (GSourceFunc) readSerial, NULL);   
     //~ g_timeout_add(1, (GSourceFunc) joystick, NULL);   
     
     //******************* GTK main **********************
     
     gtk_main ();
 
+	if (replaying)
+		replayStop (&replay);
+	else {
+		struct linkMonitorStats stats;
+		if (onRelay) {
+			printf ("relay: %llu samples, %llu dropped by the relay\n",
+				(unsigned long long) relayLink.samples, (unsigned long long) relayLink.dropped);
+			relayClientClose (&relayLink);
+			linkHistogramPrint (&displayLatency, "arrival to plot", "us", stdout);
+			return 0;
+		}
+		if (onBus) {
+			telemetryBusLinkStats (&bus, &stats);
+			telemetryBusDetach (&bus);
+		} else {
+			serialIngestLinkStats (&ingest, &stats);
+			serialIngestStop (&ingest);
+		}
+		linkMonitorPrint (&stats, stdout);
+		linkHistogramPrint (&displayLatency, "arrival to plot", "us", stdout);
+	}
 	return 0;
 }
 
@@ -338,50 +495,87 @@ static gint joystick (void)
 // testUpdate is called every time the testTimer timeout is triggered (every 500mS currently)
 static gint testUpdate (void) 
 {
-	dyGraphAddData(dyGraphRawAccelerometer, acclXTrace, (float)(acclXTrace->dataCurr), (90.)*sin((float)(acclXTrace->dataCurr/10.)) );
-	dyGraphAddData(dyGraphRawAccelerometer, acclYTrace, (float)(acclYTrace->dataCurr), (60.)*sin((float)(acclYTrace->dataCurr/10.)) );
-	dyGraphAddData(dyGraphRawAccelerometer, acclZTrace, (float)(acclZTrace->dataCurr), (30.)*sin((float)(acclZTrace->dataCurr/10.)) );
+	dyGraphAddData(dyGraphRawAccelerometer, acclXTrace, (float)(acclXTrace->data->dataCurr), (90.)*sin((float)(acclXTrace->data->dataCurr/10.)) );
+	dyGraphAddData(dyGraphRawAccelerometer, acclYTrace, (float)(acclYTrace->data->dataCurr), (60.)*sin((float)(acclYTrace->data->dataCurr/10.)) );
+	dyGraphAddData(dyGraphRawAccelerometer, acclZTrace, (float)(acclZTrace->data->dataCurr), (30.)*sin((float)(acclZTrace->data->dataCurr/10.)) );
     
-	dyGraphAddData(dyGraphRawGyro, gyroXTrace, (float)(gyroXTrace->dataCurr), (90.)*sin((float)(gyroXTrace->dataCurr/10.)) );
-	dyGraphAddData(dyGraphRawGyro, gyroYTrace, (float)(gyroYTrace->dataCurr), (60.)*sin((float)(gyroYTrace->dataCurr/10.)) );
-	dyGraphAddData(dyGraphRawGyro, gyroZTrace, (float)(gyroZTrace->dataCurr), (30.)*sin((float)(gyroZTrace->dataCurr/10.)) );
-
-	dyGraphAddData(dyGraphOrientation, eulerRollTrace, (float)(eulerRollTrace->dataCurr), (90.)*sin((float)(eulerRollTrace->dataCurr/10.)) );
-	dyGraphAddData(dyGraphOrientation, eulerPitchTrace, (float)(eulerPitchTrace->dataCurr), (60.)*sin((float)(eulerPitchTrace->dataCurr/10.)) );
-	dyGraphAddData(dyGraphOrientation, eulerYawTrace, (float)(eulerYawTrace->dataCurr), (30.)*sin((float)(eulerYawTrace->dataCurr/10.)) );	
-
-	//~ dyGraphAddData(dyGraphPid, pidRollTrace, (float)(pidRollTrace->dataCurr), (90.)*sin((float)(pidRollTrace->dataCurr/10.)) );
-	//~ dyGraphAddData(dyGraphPid, pidPitchTrace, (float)(pidPitchTrace->dataCurr), (60.)*sin((float)(pidPitchTrace->dataCurr/10.)) );
-	//~ dyGraphAddData(dyGraphPid, pidYawTrace, (float)(pidYawTrace->dataCurr), (30.)*sin((float)(pidYawTrace->dataCurr/10.)) );	
-	//~ dyGraphAddData(dyGraphPid, pidRollTargetTrace, (float)(pidRollTargetTrace->dataCurr), (90.)*sin((float)(pidRollTargetTrace->dataCurr/10.)) );
-	//~ dyGraphAddData(dyGraphPid, pidPitchTargetTrace, (float)(pidPitchTargetTrace->dataCurr), (60.)*sin((float)(pidPitchTargetTrace->dataCurr/10.)) );
-	//~ dyGraphAddData(dyGraphPid, pidYawTargetTrace, (float)(pidYawTargetTrace->dataCurr), (30.)*sin((float)(pidYawTargetTrace->dataCurr/10.)) );	
-	//~ dyGraphAddData(dyGraphPid, motor1Trace, (float)(motor1Trace->dataCurr), (90.)*sin((float)(motor1Trace->dataCurr/10.)) );
-	//~ dyGraphAddData(dyGraphPid, motor2Trace, (float)(motor2Trace->dataCurr), (60.)*sin((float)(motor2Trace->dataCurr/10.)) );
-	//~ dyGraphAddData(dyGraphPid, motor3Trace, (float)(motor3Trace->dataCurr), (30.)*sin((float)(motor3Trace->dataCurr/10.)) );	
-	//~ dyGraphAddData(dyGraphPid, motor4Trace, (float)(motor4Trace->dataCurr), (30.)*sin((float)(motor4Trace->dataCurr/10.)) );	
+	dyGraphAddData(dyGraphRawGyro, gyroXTrace, (float)(gyroXTrace->data->dataCurr), (90.)*sin((float)(gyroXTrace->data->dataCurr/10.)) );
+	dyGraphAddData(dyGraphRawGyro, gyroYTrace, (float)(gyroYTrace->data->dataCurr), (60.)*sin((float)(gyroYTrace->data->dataCurr/10.)) );
+	dyGraphAddData(dyGraphRawGyro, gyroZTrace, (float)(gyroZTrace->data->dataCurr), (30.)*sin((float)(gyroZTrace->data->dataCurr/10.)) );
+
+	dyGraphAddData(dyGraphOrientation, eulerRollTrace, (float)(eulerRollTrace->data->dataCurr), (90.)*sin((float)(eulerRollTrace->data->dataCurr/10.)) );
+	dyGraphAddData(dyGraphOrientation, eulerPitchTrace, (float)(eulerPitchTrace->data->dataCurr), (60.)*sin((float)(eulerPitchTrace->data->dataCurr/10.)) );
+	dyGraphAddData(dyGraphOrientation, eulerYawTrace, (float)(eulerYawTrace->data->dataCurr), (30.)*sin((float)(eulerYawTrace->data->dataCurr/10.)) );	
+
+	//~ dyGraphAddData(dyGraphPid, pidRollTrace, (float)(pidRollTrace->data->dataCurr), (90.)*sin((float)(pidRollTrace->data->dataCurr/10.)) );
+	//~ dyGraphAddData(dyGraphPid, pidPitchTrace, (float)(pidPitchTrace->data->dataCurr), (60.)*sin((float)(pidPitchTrace->data->dataCurr/10.)) );
+	//~ dyGraphAddData(dyGraphPid, pidYawTrace, (float)(pidYawTrace->data->dataCurr), (30.)*sin((float)(pidYawTrace->data->dataCurr/10.)) );	
+	//~ dyGraphAddData(dyGraphPid, pidRollTargetTrace, (float)(pidRollTargetTrace->data->dataCurr), (90.)*sin((float)(pidRollTargetTrace->data->dataCurr/10.)) );
+	//~ dyGraphAddData(dyGraphPid, pidPitchTargetTrace, (float)(pidPitchTargetTrace->data->dataCurr), (60.)*sin((float)(pidPitchTargetTrace->data->dataCurr/10.)) );
+	//~ dyGraphAddData(dyGraphPid, pidYawTargetTrace, (float)(pidYawTargetTrace->data->dataCurr), (30.)*sin((float)(pidYawTargetTrace->data->dataCurr/10.)) );	
+	//~ dyGraphAddData(dyGraphPid, motor1Trace, (float)(motor1Trace->data->dataCurr), (90.)*sin((float)(motor1Trace->data->dataCurr/10.)) );
+	//~ dyGraphAddData(dyGraphPid, motor2Trace, (float)(motor2Trace->data->dataCurr), (60.)*sin((float)(motor2Trace->data->dataCurr/10.)) );
+	//~ dyGraphAddData(dyGraphPid, motor3Trace, (float)(motor3Trace->data->dataCurr), (30.)*sin((float)(motor3Trace->data->dataCurr/10.)) );	
+	//~ dyGraphAddData(dyGraphPid, motor4Trace, (float)(motor4Trace->data->dataCurr), (30.)*sin((float)(motor4Trace->data->dataCurr/10.)) );	
 	
 	return TRUE; // return true to continue timeout
 }
 
-void graphPacket (struct fcu_pkt_t * packet, float time) {
-    
-    static uint8_t anothercounterthinggy = 0;
-    
-    if (anothercounterthinggy%5 == 0) {
-		dyGraphAddData(dyGraphRawAccelerometer, acclXTrace, time, (float)(packet->x_accel) );
-		dyGraphAddData(dyGraphRawAccelerometer, acclYTrace, time, (float)(packet->y_accel) );
-		dyGraphAddData(dyGraphRawAccelerometer, acclZTrace, time, (float)(packet->z_accel) );
-		
-		dyGraphAddData(dyGraphRawGyro, gyroXTrace, time, (float)(packet->x_gyro) );
-		dyGraphAddData(dyGraphRawGyro, gyroYTrace, time, (float)(packet->y_gyro) );
-		dyGraphAddData(dyGraphRawGyro, gyroZTrace, time, (float)(packet->z_gyro) );
-
-		dyGraphAddData(dyGraphOrientation, eulerRollTrace, time, (float)(packet->roll) );
-		dyGraphAddData(dyGraphOrientation, eulerPitchTrace, time, (float)(packet->pitch) );
-		dyGraphAddData(dyGraphOrientation, eulerYawTrace, time, (float)(packet->yaw) );
+// splits a batch of packets into columns and hands each graph all of its traces in one go
+void graphPackets (struct telemetrySample * samples, uint32_t n) {
+	static float time[DRAIN_BATCH];
+	static float columns[10][DRAIN_BATCH];
+	const float* accel[3] = {columns[0], columns[1], columns[2]};
+	const float* gyro[3] = {columns[3], columns[4], columns[5]};
+	const float* euler[3] = {columns[6], columns[7], columns[8]};
+	uint32_t i;
+
+	if (livePacket == PACKET_TELEMETRY) {
+		float* fields[TELEMETRY_FIELD_COUNT] = {NULL};
+		fields[TELEMETRY_FIELD_x_accel] = columns[0];
+		fields[TELEMETRY_FIELD_y_accel] = columns[1];
+		fields[TELEMETRY_FIELD_z_accel] = columns[2];
+		fields[TELEMETRY_FIELD_x_gyro] = columns[3];
+		fields[TELEMETRY_FIELD_y_gyro] = columns[4];
+		fields[TELEMETRY_FIELD_z_gyro] = columns[5];
+		fields[TELEMETRY_FIELD_roll] = columns[6];
+		fields[TELEMETRY_FIELD_pitch] = columns[7];
+		fields[TELEMETRY_FIELD_yaw] = columns[8];
+		fields[TELEMETRY_FIELD_channels] = columns[9];
+		telemetryPacketDecode(samples->frame, sizeof(struct telemetrySample), n, fields);
+	} else {
+		float* fields[FCU_FIELD_COUNT] = {NULL};
+		fields[FCU_FIELD_x_accel] = columns[0];
+		fields[FCU_FIELD_y_accel] = columns[1];
+		fields[FCU_FIELD_z_accel] = columns[2];
+		fields[FCU_FIELD_x_gyro] = columns[3];
+		fields[FCU_FIELD_y_gyro] = columns[4];
+		fields[FCU_FIELD_z_gyro] = columns[5];
+		fields[FCU_FIELD_roll] = columns[6];
+		fields[FCU_FIELD_pitch] = columns[7];
+		fields[FCU_FIELD_yaw] = columns[8];
+		fcuPacketDecode(samples->frame, sizeof(struct telemetrySample), n, fields);
 	}
-	
+
+	// the FCU's own clock, so a lost frame is a gap rather than the rest of the plot sliding over
+	for (i=0; i<n; i++)
+		time[i] = samples[i].sampleTime;
+	if (!replaying) {
+		double now = serialIngestNow();
+		for (i=0; i<n; i++)
+			linkHistogramAdd(&displayLatency, (now - samples[i].rxTime)*1e6);
+	}
+
+	struct dyTrace* accelTraces[3] = {acclXTrace, acclYTrace, acclZTrace};
+	struct dyTrace* gyroTraces[3] = {gyroXTrace, gyroYTrace, gyroZTrace};
+	struct dyTrace* eulerTraces[3] = {eulerRollTrace, eulerPitchTrace, eulerYawTrace};
+
+	dyGraphAddDataMulti(dyGraphRawAccelerometer, accelTraces, 3, time, accel, n);
+	dyGraphAddDataMulti(dyGraphRawGyro, gyroTraces, 3, time, gyro, n);
+	dyGraphAddDataMulti(dyGraphOrientation, eulerTraces, 3, time, euler, n);
+	spectrumFeedAdd(&spectrumFeeds[0], samples, columns, n);
+	spectrumFeedAdd(&spectrumFeeds[1], samples, columns, n);
+
 	//~ dyGraphAddData(dyGraphPid, pidRollTrace, time, (float)(packet->roll) );
 	//~ dyGraphAddData(dyGraphPid, pidPitchTrace, time, (float)(packet->pitch) );
 	//~ dyGraphAddData(dyGraphPid, pidYawTrace, time, (float)(packet->yaw) );
@@ -396,29 +590,101 @@ void graphPacket (struct fcu_pkt_t * packet, float time) {
 	//~ printf ("%d\t%d\t%d\n", packet->x_accel, packet->y_accel, packet->z_accel);
 }
 
-guint readSerial (void) {
-	unsigned char rxBuffer[RX_BUFFER_LENGTH];
-	
-	int bytesRead = read (uartfd, rxBuffer, RX_BUFFER_LENGTH-1);
-	int i;
-	for (i=0; i<bytesRead; i++) {
-		if (rxBuffer[i] == 0xAA) {
-			int j=0;
-			while (i<bytesRead) { // if 0xAA was found at index in rxBuffer other than 0, shift everything over so that 0xAA is at 0
-				rxBuffer[j] = rxBuffer[i];
-				j++;
-				i++;
-			}
-			while (j<sizeof(struct fcu_pkt_t)) {
-				int dataBytesRead = read (uartfd, rxBuffer+j, RX_BUFFER_LENGTH-j-1);
-				j += dataBytesRead;
-				usleep(100);
+// the samples of a batch that are new to one half of the spectrum.  a mux
+// frame holds every channel's last value and only the ones it carried count,
+// any other frame is a new sample.  the rate is how many come in
+// SPECTRUM_RATE_SECONDS of the FCU's clock, the bins follow it when it moves
+static void spectrumFeedAdd (struct spectrumFeed* feed, const struct telemetrySample* samples, float (*columns)[DRAIN_BATCH], uint32_t n) {
+	static float fresh[3][DRAIN_BATCH];
+	const float* y[3] = {fresh[0], fresh[1], fresh[2]};
+	uint32_t i, m = 0;
+	int k;
+
+	for (i=0; i<n; i++) {
+		if (livePacket == PACKET_TELEMETRY && !((uint32_t) columns[9][i] & (1u << feed->channel)))
+			continue;
+		for (k=0; k<3; k++)
+			fresh[k][m] = columns[feed->column + k][i];
+		m++;
+
+		// a clock that went backwards is the FCU starting over
+		if (feed->start < 0 || samples[i].sampleTime < feed->start) {
+			feed->start = samples[i].sampleTime;
+			feed->count = 0;
+			continue;
+		}
+		feed->count++;
+		if (samples[i].sampleTime - feed->start >= SPECTRUM_RATE_SECONDS) {
+			float rate = feed->count / (samples[i].sampleTime - feed->start);
+			if (feed->rate == 0 || fabsf(rate - feed->rate) > SPECTRUM_RATE_CHANGE*feed->rate) {
+				feed->rate = rate;
+				dyGraphSetSpectrumRate(dyGraphSpectrum, feed->traces, 3, rate);
 			}
-			graphTime += .1;
-			graphPacket ((struct fcu_pkt_t*)rxBuffer, graphTime);
-			//~ printf ("packet\n");
-			break;
+			feed->start = samples[i].sampleTime;
+			feed->count = 0;
+		}
+	}
+	dyGraphAddSpectrumData(dyGraphSpectrum, feed->traces, 3, y, m);
+}
+
+// runs at the display rate and graphs whatever the serial (or replay) thread
+// queued up since last time.  never more than a queue's worth, so a replay
+// running flat out can't keep us from drawing
+guint readSerial (void) {
+	static struct telemetrySample samples[DRAIN_BATCH];
+	static uint32_t overruns = 0;
+	static double nextReport = 0;
+	uint32_t n, total = 0;
+
+	do {
+		if (replaying)
+			n = replayDrain (&replay, samples, DRAIN_BATCH);
+		else if (onBus)
+			n = telemetryBusRead (&bus, samples, DRAIN_BATCH);
+		else if (onRelay)
+			n = relayClientRead (&relayLink, samples, DRAIN_BATCH);
+		else
+			n = serialIngestDrain (&ingest, samples, DRAIN_BATCH);
+		graphPackets (samples, n);
+		total += n;
+	} while (n == DRAIN_BATCH && total < drainLimit);
+
+	if (onBus) {
+		if (bus.overruns != overruns) {
+			overruns = bus.overruns;
+			fprintf(stderr, "readSerial: gui fell behind the bus, %llu frames skipped\n", (unsigned long long) bus.lost);
+		}
+		if (total == 0 && !telemetryBusAlive (&bus)) {
+			printf ("ingestd stopped\n");
+			gtk_main_quit ();
+			return FALSE;
+		}
+	} else if (onRelay) {
+		if (total == 0 && !relayLink.connected) {
+			printf ("relay went away\n");
+			gtk_main_quit ();
+			return FALSE;
 		}
+	} else if (telemetryQueue->overruns != overruns) {
+		overruns = telemetryQueue->overruns;
+		fprintf(stderr, "readSerial: gui fell behind, %u frames dropped (queue high water %u)\n", overruns, telemetryQueue->highWater);
+	}
+
+	if (onRelay && serialIngestNow() >= nextReport) {
+		// the link counts stay with ingestd, all we know is what the relay dropped
+		printf ("relay: %llu samples, %llu dropped by the relay\n",
+			(unsigned long long) relayLink.samples, (unsigned long long) relayLink.dropped);
+		nextReport = serialIngestNow() + LINK_REPORT_SECONDS;
+	} else if (!replaying && serialIngestNow() >= nextReport) {
+		struct linkMonitorStats stats;
+		if (onBus)
+			telemetryBusLinkStats (&bus, &stats);
+		else
+			serialIngestLinkStats (&ingest, &stats);
+		printf ("link: %llu frames, %llu lost, %llu late, %llu duplicates, %llu strays, %u restarts, jitter %.1f ms, latency %.1f ms\n",
+			(unsigned long long) stats.frames, (unsigned long long) stats.lost, (unsigned long long) stats.late,
+			(unsigned long long) stats.duplicates, (unsigned long long) stats.strays, stats.restarts, stats.jitter*1e3, stats.latency*1e3);
+		nextReport = serialIngestNow() + LINK_REPORT_SECONDS;
 	}
 	return TRUE;
 }
@@ -0,0 +1,183 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "minMaxPyramid.h"
+
+#define INITIAL_LEVEL_LENGTH 64
+
+#define SAMPLE(index) sampleColumnAt(column, index)
+
+static int minMaxPyramidPush (struct minMaxPyramidLevel* level, uint32_t minIndex, uint32_t maxIndex);
+
+void minMaxPyramidInit (struct minMaxPyramid* pyramid) {
+	memset(pyramid, 0, sizeof(struct minMaxPyramid));
+}
+
+void minMaxPyramidFree (struct minMaxPyramid* pyramid) {
+	int i;
+	for (i=0; i<MIN_MAX_PYRAMID_LEVELS; i++) {
+		free(pyramid->levels[i].minIndex);
+		free(pyramid->levels[i].maxIndex);
+	}
+	minMaxPyramidInit(pyramid);
+}
+
+// summarise column samples from pyramid->count up to column->end.  it must be
+// the same column every time, only the new samples are looked at.  returns non
+// zero if memory ran out
+int minMaxPyramidUpdate (struct minMaxPyramid* pyramid, const struct sampleColumn* column) {
+	const uint32_t baseSize = 1 << MIN_MAX_PYRAMID_BASE_LEVEL;
+
+	while (pyramid->count + baseSize <= column->end) {
+		uint32_t start = pyramid->count;
+		uint32_t minIndex = start, maxIndex = start;
+		uint32_t i;
+		int l;
+
+		// bottom level comes straight from the samples
+		for (i=start+1; i<start+baseSize; i++) {
+			if (SAMPLE(i) < SAMPLE(minIndex))
+				minIndex = i;
+			if (SAMPLE(i) > SAMPLE(maxIndex))
+				maxIndex = i;
+		}
+		if (minMaxPyramidPush(&pyramid->levels[0], minIndex, maxIndex))
+			return -1;
+		pyramid->count += baseSize;
+
+		// every time a level gets an even number of buckets the last two make one on the level above
+		for (l=1; l<MIN_MAX_PYRAMID_LEVELS && (pyramid->levels[l-1].length & 1) == 0; l++) {
+			struct minMaxPyramidLevel* below = &pyramid->levels[l-1];
+			uint32_t a = below->length-2 - below->base;
+			uint32_t b = below->length-1 - below->base;
+
+			// it starts before the oldest held sample.  a query can never ask for this
+			// bucket, it just has to exist, and the halves' indices can point into
+			// chunks that have gone back to the pool so they mustn't be looked at
+			if (((below->length-2) << (MIN_MAX_PYRAMID_BASE_LEVEL + l-1)) < column->start) {
+				if (minMaxPyramidPush(&pyramid->levels[l], below->minIndex[b], below->maxIndex[b]))
+					return -1;
+				continue;
+			}
+
+			// half of it has been discarded.  a query can never ask for this bucket, it just has to exist
+			if (below->length-2 < below->first)
+				a = b;
+
+			minIndex = (SAMPLE(below->minIndex[b]) < SAMPLE(below->minIndex[a])) ? below->minIndex[b] : below->minIndex[a];
+			maxIndex = (SAMPLE(below->maxIndex[b]) > SAMPLE(below->maxIndex[a])) ? below->maxIndex[b] : below->maxIndex[a];
+			if (minMaxPyramidPush(&pyramid->levels[l], minIndex, maxIndex))
+				return -1;
+		}
+	}
+
+	return 0;
+}
+
+// forget buckets that end before index, to go with sampleColumnDiscard
+void minMaxPyramidDiscard (struct minMaxPyramid* pyramid, uint32_t index) {
+	int l;
+
+	// nothing left that was summarised, start again from the next whole bucket
+	if (index >= pyramid->count) {
+		pyramid->count = (index + (1 << MIN_MAX_PYRAMID_BASE_LEVEL) - 1) & ~((1 << MIN_MAX_PYRAMID_BASE_LEVEL) - 1);
+		for (l=0; l<MIN_MAX_PYRAMID_LEVELS; l++) {
+			struct minMaxPyramidLevel* level = &pyramid->levels[l];
+			level->length = pyramid->count >> (MIN_MAX_PYRAMID_BASE_LEVEL + l);
+			level->base = level->first = level->length;
+		}
+		return;
+	}
+
+	for (l=0; l<MIN_MAX_PYRAMID_LEVELS; l++) {
+		struct minMaxPyramidLevel* level = &pyramid->levels[l];
+		uint32_t first = index >> (MIN_MAX_PYRAMID_BASE_LEVEL + l);
+
+		if (first > level->length)
+			first = level->length;
+		if (first <= level->first)
+			continue;
+		level->first = first;
+
+		// only compact once there's more dead space than live so it stays O(1) amortized
+		if (level->first - level->base >= level->length - level->first) {
+			uint32_t held = level->length - level->first;
+			memmove(level->minIndex, level->minIndex + (level->first - level->base), sizeof(uint32_t)*held);
+			memmove(level->maxIndex, level->maxIndex + (level->first - level->base), sizeof(uint32_t)*held);
+			level->base = level->first;
+		}
+	}
+}
+
+// index of the smallest and largest sample in column[start .. end).  the part of
+// the range that hasn't been summarised yet is scanned
+void minMaxPyramidQuery (const struct minMaxPyramid* pyramid, const struct sampleColumn* column, uint32_t start, uint32_t end, uint32_t* minIndex, uint32_t* maxIndex) {
+	uint32_t lo = start, hi = start;
+	uint32_t i = start;
+
+	while (i < end) {
+		int fit = 31 - __builtin_clz(end - i);            // log2 of the biggest bucket that fits
+		int align = i ? __builtin_ctz(i) : 31;           // log2 of the biggest bucket starting at i
+		int l = ((fit < align) ? fit : align) - MIN_MAX_PYRAMID_BASE_LEVEL;
+
+		if (l >= MIN_MAX_PYRAMID_LEVELS)
+			l = MIN_MAX_PYRAMID_LEVELS-1;
+
+		// biggest summarised bucket that starts here and fits in the range.  a
+		// bucket starting at or after column->start was never discarded
+		for (; l>=0; l--) {
+			uint32_t shift = MIN_MAX_PYRAMID_BASE_LEVEL + l;
+			uint32_t size = (uint32_t)1 << shift;
+			if ((i & (size-1)) == 0 && end - i >= size && (i >> shift) < pyramid->levels[l].length)
+				break;
+		}
+
+		if (l < 0) {
+			if (SAMPLE(i) < SAMPLE(lo))
+				lo = i;
+			if (SAMPLE(i) > SAMPLE(hi))
+				hi = i;
+			i++;
+		} else {
+			const struct minMaxPyramidLevel* level = &pyramid->levels[l];
+			uint32_t bucket = (i >> (MIN_MAX_PYRAMID_BASE_LEVEL + l)) - level->base;
+			if (SAMPLE(level->minIndex[bucket]) < SAMPLE(lo))
+				lo = level->minIndex[bucket];
+			if (SAMPLE(level->maxIndex[bucket]) > SAMPLE(hi))
+				hi = level->maxIndex[bucket];
+			i += (uint32_t)1 << (MIN_MAX_PYRAMID_BASE_LEVEL + l);
+		}
+	}
+
+	*minIndex = lo;
+	*maxIndex = hi;
+}
+
+static int minMaxPyramidPush (struct minMaxPyramidLevel* level, uint32_t minIndex, uint32_t maxIndex) {
+	uint32_t held = level->length - level->base;
+
+	if (held >= level->size) {
+		uint32_t size = level->size ? level->size*2 : INITIAL_LEVEL_LENGTH;
+		uint32_t* newMin = realloc(level->minIndex, sizeof(uint32_t)*size);
+		uint32_t* newMax;
+		if (newMin == NULL) {
+			perror("\n***** MIN MAX PYRAMID ERROR: realloc failed\n\n");
+			return -1;
+		}
+		level->minIndex = newMin;
+		newMax = realloc(level->maxIndex, sizeof(uint32_t)*size);
+		if (newMax == NULL) {
+			perror("\n***** MIN MAX PYRAMID ERROR: realloc failed\n\n");
+			return -1;
+		}
+		level->maxIndex = newMax;
+		level->size = size;
+	}
+
+	level->minIndex[held] = minIndex;
+	level->maxIndex[held] = maxIndex;
+	level->length++;
+	return 0;
+}
@@ -0,0 +1,45 @@
+#ifndef __MIN_MAX_PYRAMID_H__
+#define __MIN_MAX_PYRAMID_H__
+
+#include <stdint.h>
+
+#include "sampleColumn.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+// multi-resolution summary of a growing array of samples.  level L holds the
+// index of the smallest and largest sample in every 2^(BASE+L) sample bucket
+// (first and last of a bucket are just its end indices).  appending is O(1)
+// amortized and the min/max of any index range takes O(log n), so drawing a
+// 10M point trace only touches a few entries per pixel column.
+
+#define MIN_MAX_PYRAMID_BASE_LEVEL 3 // smallest bucket is 8 samples, anything smaller is scanned
+#define MIN_MAX_PYRAMID_LEVELS 24    // largest bucket is 2^26 samples
+
+struct minMaxPyramidLevel {
+	uint32_t* minIndex;   // minIndex[0] is bucket number base
+	uint32_t* maxIndex;
+	uint32_t base;
+	uint32_t first;       // oldest bucket still held, older ones are waiting to be compacted away
+	uint32_t length;      // complete buckets, counting discarded ones
+	uint32_t size;        // allocated buckets
+};
+
+struct minMaxPyramid {
+	struct minMaxPyramidLevel levels[MIN_MAX_PYRAMID_LEVELS];
+	uint32_t count; // samples summarised so far
+};
+
+void minMaxPyramidInit (struct minMaxPyramid* pyramid);
+void minMaxPyramidFree (struct minMaxPyramid* pyramid);
+int minMaxPyramidUpdate (struct minMaxPyramid* pyramid, const struct sampleColumn* column);
+void minMaxPyramidDiscard (struct minMaxPyramid* pyramid, uint32_t index);
+void minMaxPyramidQuery (const struct minMaxPyramid* pyramid, const struct sampleColumn* column, uint32_t start, uint32_t end, uint32_t* minIndex, uint32_t* maxIndex);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __MIN_MAX_PYRAMID_H__ */
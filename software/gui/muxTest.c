@@ -0,0 +1,207 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "telemetryMux.h"
+
+// the telemetry mux on the host: frames round trip through the decoder, the
+// link's byte budget holds, an overloaded link starves the highest priority
+// numbers first and counts what they missed, lost frames show up as sequence
+// gaps.  returns the number of failures so a makefile can stop on it
+
+#define TEST_TICK_RATE 500
+#define TEST_LINK_BYTES 5760
+#define TEST_TICKS 20000     // 40 seconds of control loops
+
+static int failures = 0;
+
+static void testCheck (int ok, const char* what, int detail);
+static void testState (int16_t* state, uint32_t tick);
+static uint8_t testParity (const uint8_t* frame, uint16_t length);
+static void testRoundTrip (void);
+static void testBudget (void);
+static void testOverload (void);
+static void testLost (void);
+
+int main (void) {
+	testRoundTrip();
+	testBudget();
+	testOverload();
+	testLost();
+
+	if (failures)
+		printf ("%d failures\n", failures);
+	else
+		printf ("all passed\n");
+	return failures != 0;
+}
+
+static void testCheck (int ok, const char* what, int detail) {
+	if (!ok) {
+		printf ("FAILED: %s (%d)\n", what, detail);
+		failures++;
+	}
+}
+
+// every field different and changing every tick, so a stale or misplaced one shows
+static void testState (int16_t* state, uint32_t tick) {
+	int f;
+	for (f=0; f<TELEMETRY_MUX_FIELDS; f++)
+		state[f] = (int16_t)(tick*31 + f*1009);
+}
+
+static uint8_t testParity (const uint8_t* frame, uint16_t length) {
+	uint8_t parity = 0;
+	uint16_t i;
+	for (i=2; i<length; i++)
+		parity ^= frame[i];
+	return parity;
+}
+
+// every channel carried in a frame decodes to the values it was sent with, the
+// ones it didn't carry keep what they had
+static void testRoundTrip (void) {
+	struct telemetryMux mux;
+	struct telemetryMuxDecoder decoder;
+	uint8_t frame[TELEMETRY_MUX_MAX_FRAME_LENGTH];
+	int16_t state[TELEMETRY_MUX_FIELDS], decoded[TELEMETRY_MUX_FIELDS], before[TELEMETRY_MUX_FIELDS];
+	uint32_t records = 0, frames = 0, tick;
+	int length, count, c, f;
+
+	telemetryMuxInit (&mux, TEST_TICK_RATE, TEST_LINK_BYTES);
+	telemetryMuxSetRate (&mux, "pid", 10);
+	telemetryMuxDecoderInit (&decoder);
+	memset(decoded, 0, sizeof(decoded));
+
+	for (tick=0; tick<TEST_TICKS; tick++) {
+		testState (state, tick);
+		length = telemetryMuxTick (&mux, state, (uint16_t) tick, frame);
+		if (length == 0)
+			continue;
+		frames++;
+		testCheck (frame[0] == TELEMETRY_MUX_START_BYTE, "round trip start byte", tick);
+		testCheck (frame[1] == testParity(frame, length), "round trip parity", tick);
+		testCheck ((uint16_t)(frame[5] | (frame[6] << 8)) == (uint16_t) tick, "round trip tick", tick);
+
+		memcpy(before, decoded, sizeof(decoded));
+		count = telemetryMuxDecode (&decoder, frame, length, decoded);
+		testCheck (count > 0, "round trip records", tick);
+		records += count;
+		for (c=0; c<TELEMETRY_CHANNEL_COUNT; c++) {
+			const struct telemetryMuxChannel* channel = &mux.channels[c];
+			const int16_t* expect = (decoder.updated & (1u << c)) ? state : before;
+			for (f=channel->first; f<channel->first + channel->fields; f++)
+				testCheck (decoded[f] == expect[f], "round trip field", f);
+		}
+	}
+
+	testCheck (frames == mux.stats.frames && decoder.stats.frames == frames, "round trip frame count", frames);
+	testCheck (decoder.stats.records == records && decoder.stats.framesLost == 0 && decoder.stats.framesBad == 0, "round trip decoder stats", records);
+	for (c=0; c<TELEMETRY_CHANNEL_COUNT; c++)
+		testCheck (mux.channels[c].rate == 0 || mux.channels[c].sent > 0, "round trip channel sent", c);
+}
+
+// everything as fast as it goes down a slow link, the bytes sent never get ahead
+// of what the link carries by more than the one frame's worth of credit it may hold
+static void testBudget (void) {
+	static const uint16_t links[] = {300, 1000, 2500, TEST_LINK_BYTES};
+	struct telemetryMux mux;
+	uint8_t frame[TELEMETRY_MUX_MAX_FRAME_LENGTH];
+	int16_t state[TELEMETRY_MUX_FIELDS];
+	uint64_t bytes;
+	uint32_t tick;
+	int link, length, c;
+
+	for (link=0; link<(int)(sizeof(links)/sizeof(links[0])); link++) {
+		telemetryMuxInit (&mux, TEST_TICK_RATE, links[link]);
+		for (c=0; c<TELEMETRY_CHANNEL_COUNT; c++)
+			telemetryMuxSetRate (&mux, mux.channels[c].name, TEST_TICK_RATE);
+
+		bytes = 0;
+		for (tick=1; tick<=TEST_TICKS; tick++) {
+			testState (state, tick);
+			length = telemetryMuxTick (&mux, state, (uint16_t) tick, frame);
+			testCheck (length <= TELEMETRY_MUX_MAX_FRAME_LENGTH, "budget frame length", length);
+			bytes += length;
+			testCheck (bytes*TEST_TICK_RATE <= (uint64_t) links[link]*tick + (uint64_t) TELEMETRY_MUX_MAX_FRAME_LENGTH*TEST_TICK_RATE,
+				"budget bytes", links[link]);
+		}
+		testCheck (bytes == mux.stats.bytes, "budget stats", links[link]);
+		// and it uses the link, not much less than all of it
+		testCheck (bytes*TEST_TICK_RATE > (uint64_t) links[link]*TEST_TICKS*9/10, "budget used", links[link]);
+		testCheck (mux.stats.stalls > 0, "budget stalls", links[link]);
+	}
+}
+
+// every channel at 100 Hz down a link with room for the priority 1 channels and
+// a little more.  sends fall off with the priority number, the highest starves
+// and whatever a channel didn't send it counts as missed
+static void testOverload (void) {
+	struct telemetryMux mux;
+	uint8_t frame[TELEMETRY_MUX_MAX_FRAME_LENGTH];
+	int16_t state[TELEMETRY_MUX_FIELDS];
+	uint32_t tick, due;
+	int c, d;
+
+	telemetryMuxInit (&mux, TEST_TICK_RATE, 2500);
+	for (c=0; c<TELEMETRY_CHANNEL_COUNT; c++)
+		telemetryMuxSetRate (&mux, mux.channels[c].name, 100);
+	for (tick=0; tick<TEST_TICKS; tick++) {
+		testState (state, tick);
+		telemetryMuxTick (&mux, state, (uint16_t) tick, frame);
+	}
+
+	due = TEST_TICKS*100/TEST_TICK_RATE;
+	for (c=0; c<TELEMETRY_CHANNEL_COUNT; c++) {
+		const struct telemetryMuxChannel* channel = &mux.channels[c];
+		// the one still waiting on the last tick is neither
+		testCheck (channel->sent + channel->missed + 1 >= due && channel->sent + channel->missed <= due, "overload sent and missed add up", c);
+		for (d=0; d<TELEMETRY_CHANNEL_COUNT; d++)
+			if (channel->priority < mux.channels[d].priority)
+				testCheck (channel->sent >= mux.channels[d].sent, "overload lower number sends more", c*TELEMETRY_CHANNEL_COUNT + d);
+	}
+	testCheck (mux.channels[TELEMETRY_CHANNEL_battery].missed > due/2, "overload highest number starved", mux.channels[TELEMETRY_CHANNEL_battery].missed);
+}
+
+// frames dropped on the way show up as gaps in the sequence, a frame whose
+// records don't add up is refused and leaves the state alone
+static void testLost (void) {
+	struct telemetryMux mux;
+	struct telemetryMuxDecoder decoder;
+	uint8_t frame[TELEMETRY_MUX_MAX_FRAME_LENGTH];
+	int16_t state[TELEMETRY_MUX_FIELDS], decoded[TELEMETRY_MUX_FIELDS], before[TELEMETRY_MUX_FIELDS];
+	uint32_t sent = 0, dropped = 0, tick;
+	int length;
+
+	telemetryMuxInit (&mux, TEST_TICK_RATE, TEST_LINK_BYTES);
+	telemetryMuxDecoderInit (&decoder);
+	memset(decoded, 0, sizeof(decoded));
+
+	// long enough for the 16 bit sequence to wrap
+	for (tick=0; tick<1000000; tick++) {
+		testState (state, tick);
+		length = telemetryMuxTick (&mux, state, (uint16_t) tick, frame);
+		if (length == 0)
+			continue;
+		sent++;
+		if (sent > 1 && (sent % 97 == 0 || sent % 1001 < 3)) { // the first one syncs the decoder
+			dropped++;
+			continue;
+		}
+		telemetryMuxDecode (&decoder, frame, length, decoded);
+	}
+	testCheck (sent > 0x10000, "lost sequence wrapped", sent);
+	testCheck (decoder.stats.framesLost == dropped, "lost frames counted", decoder.stats.framesLost);
+	testCheck (decoder.stats.frames == sent - dropped, "lost frames decoded", decoder.stats.frames);
+
+	// a record cut short
+	testState (state, tick);
+	while ((length = telemetryMuxTick (&mux, state, (uint16_t) tick, frame)) == 0)
+		tick++;
+	memcpy(before, decoded, sizeof(decoded));
+	frame[2] = length - 1;
+	testCheck (telemetryMuxDecode (&decoder, frame, length - 1, decoded) == -1, "bad frame refused", length);
+	testCheck (decoder.stats.framesBad == 1, "bad frame counted", decoder.stats.framesBad);
+	testCheck (memcmp(before, decoded, sizeof(decoded)) == 0, "bad frame left state alone", 0);
+}
@@ -0,0 +1,175 @@
+#ifndef __PACKET_SCHEMA_H__
+#define __PACKET_SCHEMA_H__
+
+// the one description of every packet that goes over a wire.  the FCU and IMU
+// firmware and the ground station tools all build their structs, field tables
+// and decoders from these lists, so a new channel is one line here.
+//
+// this file is only macros, no includes and no types, so any of the compilers
+// can take it (the C28x on the IMU has 16 bit chars and no uint8_t).  the host
+// side of it (accessors, column decoders, flight log fields) is packets.h.
+//
+// every packet on the wire is [start byte][parity byte][fields ...] with the
+// fields packed, no padding.  X(type, name, label) for each field:
+//   type   INT16 or UINT16, PACKET_CTYPE_INT16 and FLIGHT_LOG_INT16 follow from it
+//   name   the struct member
+//   label  what the ground station calls it, flight logs match fields by this
+//          so keep labels stable once there are recordings of them
+
+#define PACKET_START_BYTE 0xAA
+#define PACKET_HEADER_LENGTH 2     // start and parity
+
+#define PACKET_CTYPE_INT16 int16_t
+#define PACKET_CTYPE_UINT16 uint16_t
+#define PACKET_SIZE_INT16 2
+#define PACKET_SIZE_UINT16 2
+
+// the FCU's clock, every FCU frame (or sample) carries a reading of it
+#define PACKET_TICK_HZ 1000
+
+// packet ids and layout versions.  the id isn't on the wire yet (the start
+// byte is shared so old firmware still talks to new tools), it names the
+// layout in flight logs.  bump the version whenever a list below changes.
+#define IMU_PACKET_ID 1
+#define IMU_PACKET_VERSION 1
+#define FCU_PACKET_ID 2
+#define FCU_PACKET_VERSION 2
+#define TELEMETRY_PACKET_ID 3
+#define TELEMETRY_PACKET_VERSION 3
+
+// IMU -> FCU over SPI, the C28x sends each 16 bit word high byte first.  the
+// order is the IMU's sensor[] (its adc channels, see make_fcu_packet) and what
+// the FCU's flight loop has always read them as.  firmware/fcu/imu.h once had
+// them in another order but that file isn't built, don't go by it
+#define IMU_PACKET_FIELDS(X) \
+	X(INT16, roll,      "roll") \
+	X(INT16, pitch_tmp, "pitch temp") \
+	X(INT16, pitch,     "pitch") \
+	X(INT16, yaw,       "yaw") \
+	X(INT16, yaw_tmp,   "yaw temp") \
+	X(INT16, z_accel,   "z accel") \
+	X(INT16, x_accel,   "x accel") \
+	X(INT16, y_accel,   "y accel")
+
+// FCU -> ground station over the xbee, AVR byte order (low byte first)
+#define FCU_PACKET_FIELDS(X) \
+	X(INT16, x_gyro,      "x gyro") \
+	X(INT16, x_gyro_tmp,  "x gyro temp") \
+	X(INT16, y_gyro,      "y gyro") \
+	X(INT16, z_gyro,      "z gyro") \
+	X(INT16, z_gyro_tmp,  "z gyro temp") \
+	X(INT16, z_accel,     "z accel") \
+	X(INT16, x_accel,     "x accel") \
+	X(INT16, y_accel,     "y accel") \
+	X(INT16, roll,        "roll") \
+	X(INT16, pitch,       "pitch") \
+	X(INT16, yaw,         "yaw") \
+	X(INT16, rollTarget,  "roll target") \
+	X(INT16, pitchTarget, "pitch target") \
+	X(INT16, yawTarget,   "yaw target") \
+	X(INT16, motor1,      "motor 1") \
+	X(INT16, motor2,      "motor 2") \
+	X(INT16, motor3,      "motor 3") \
+	X(INT16, motor4,      "motor 4") \
+	PACKET_STAMP_FIELDS(X)
+
+// counts every frame the FCU sends (so the ground station can see what it
+// lost) and when it was sent in PACKET_TICK_HZ ticks, both wrap at 16 bits
+#define PACKET_STAMP_FIELDS(X) \
+	X(UINT16, sequence,   "sequence") \
+	X(UINT16, tick,       "fcu tick")
+
+// FCU -> ground station telemetry channels (telemetryMux.h).  each channel is a
+// group of fields that always go together, at its own rate.
+// X(name, rate, priority, FIELDS)
+//   rate      Hz until the ground station asks for something else, 0 for off
+//   priority  lower goes first when two are due and the link can't take both
+#define TELEMETRY_CHANNELS(X) \
+	X(gyro,     50, 1, TELEMETRY_GYRO_FIELDS) \
+	X(attitude, 50, 1, TELEMETRY_ATTITUDE_FIELDS) \
+	X(accel,    25, 2, TELEMETRY_ACCEL_FIELDS) \
+	X(motors,   25, 2, TELEMETRY_MOTOR_FIELDS) \
+	X(targets,   5, 3, TELEMETRY_TARGET_FIELDS) \
+	X(pid,       0, 3, TELEMETRY_PID_FIELDS) \
+	X(battery,   1, 4, TELEMETRY_BATTERY_FIELDS)
+
+#define TELEMETRY_GYRO_FIELDS(X) \
+	X(INT16, x_gyro,  "x gyro") \
+	X(INT16, y_gyro,  "y gyro") \
+	X(INT16, z_gyro,  "z gyro")
+#define TELEMETRY_ATTITUDE_FIELDS(X) \
+	X(INT16, roll,    "roll") \
+	X(INT16, pitch,   "pitch") \
+	X(INT16, yaw,     "yaw")
+#define TELEMETRY_ACCEL_FIELDS(X) \
+	X(INT16, x_accel, "x accel") \
+	X(INT16, y_accel, "y accel") \
+	X(INT16, z_accel, "z accel")
+#define TELEMETRY_MOTOR_FIELDS(X) \
+	X(INT16, motor1,  "motor 1") \
+	X(INT16, motor2,  "motor 2") \
+	X(INT16, motor3,  "motor 3") \
+	X(INT16, motor4,  "motor 4")
+#define TELEMETRY_TARGET_FIELDS(X) \
+	X(INT16, rollTarget,  "roll target") \
+	X(INT16, pitchTarget, "pitch target") \
+	X(INT16, yawTarget,   "yaw target")
+#define TELEMETRY_PID_FIELDS(X) \
+	X(INT16, rollError,      "roll error") \
+	X(INT16, rollIntegral,   "roll integral") \
+	X(INT16, rollOutput,     "roll output") \
+	X(INT16, pitchError,     "pitch error") \
+	X(INT16, pitchIntegral,  "pitch integral") \
+	X(INT16, pitchOutput,    "pitch output") \
+	X(INT16, yawError,       "yaw error") \
+	X(INT16, yawIntegral,    "yaw integral") \
+	X(INT16, yawOutput,      "yaw output")
+#define TELEMETRY_BATTERY_FIELDS(X) \
+	X(INT16, battery, "battery mV")
+
+// every channel's fields, in channel order
+#define TELEMETRY_CHANNEL_FIELDS(X) \
+	TELEMETRY_GYRO_FIELDS(X) \
+	TELEMETRY_ATTITUDE_FIELDS(X) \
+	TELEMETRY_ACCEL_FIELDS(X) \
+	TELEMETRY_MOTOR_FIELDS(X) \
+	TELEMETRY_TARGET_FIELDS(X) \
+	TELEMETRY_PID_FIELDS(X) \
+	TELEMETRY_BATTERY_FIELDS(X)
+
+// the ground station holds the latest of every channel in one of these and
+// hands it on whenever any of them change, stamped from the mux frame.  bit n
+// of channels is set if channel n (TELEMETRY_CHANNEL_gyro ...) was in that
+// frame, the rest are held from earlier ones
+#define TELEMETRY_PACKET_FIELDS(X) \
+	TELEMETRY_CHANNEL_FIELDS(X) \
+	X(UINT16, channels,   "channels") \
+	PACKET_STAMP_FIELDS(X)
+
+// ---- generators
+
+#define PACKET_STRUCT_MEMBER(type, name, label) PACKET_CTYPE_##type name;
+#define PACKET_FIELD_SIZE(type, name, label) + PACKET_SIZE_##type
+#define PACKET_FIELD_ONE(type, name, label) + 1
+
+// struct tag { start; parity; fields } laid out exactly as on the wire
+#define PACKET_STRUCT(tag, FIELDS) \
+	struct tag { \
+		uint8_t start; \
+		uint8_t parity; \
+		FIELDS(PACKET_STRUCT_MEMBER) \
+	} __attribute__((packed))
+
+// bytes in a whole frame and fields in a packet, both compile time constants
+#define PACKET_LENGTH(FIELDS) (PACKET_HEADER_LENGTH FIELDS(PACKET_FIELD_SIZE))
+#define PACKET_FIELD_COUNT(FIELDS) (0 FIELDS(PACKET_FIELD_ONE))
+
+#define IMU_PACKET_LENGTH PACKET_LENGTH(IMU_PACKET_FIELDS)
+#define FCU_PACKET_LENGTH PACKET_LENGTH(FCU_PACKET_FIELDS)
+#define TELEMETRY_PACKET_LENGTH PACKET_LENGTH(TELEMETRY_PACKET_FIELDS)
+
+// where the i'th byte off the SPI belongs in a little endian struct.  a
+// receiver that stores each byte straight into its slot never has to swap
+#define IMU_PACKET_SPI_SLOT(i) ((i) < PACKET_HEADER_LENGTH ? (i) : ((i) ^ 1))
+
+#endif /* __PACKET_SCHEMA_H__ */
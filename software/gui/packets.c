@@ -0,0 +1,85 @@
+#include <stdint.h>
+#include <stddef.h>
+
+#include "packets.h"
+#include "flightLog.h"
+
+#define PACKET_STRING(x) #x
+#define PACKET_NAME(tag, version) #tag " v" PACKET_STRING(version)
+
+// the tables the flight log writes into its header and replay matches against
+#define PACKET_LOG_FIELD_IMU(type, name, label) {label, offsetof(struct imu_rx_pkt_t, name), FLIGHT_LOG_##type, 1},
+#define PACKET_LOG_FIELD_FCU(type, name, label) {label, offsetof(struct fcu_pkt_t, name), FLIGHT_LOG_##type, 1},
+#define PACKET_LOG_FIELD_TELEMETRY(type, name, label) {label, offsetof(struct telemetry_pkt_t, name), FLIGHT_LOG_##type, 1},
+static const struct flightLogField imuFields[] = { IMU_PACKET_FIELDS(PACKET_LOG_FIELD_IMU) };
+static const struct flightLogField fcuFields[] = { FCU_PACKET_FIELDS(PACKET_LOG_FIELD_FCU) };
+static const struct flightLogField telemetryFields[] = { TELEMETRY_PACKET_FIELDS(PACKET_LOG_FIELD_TELEMETRY) };
+
+// the schema's idea of the layout and the compiler's have to agree
+typedef char imuPacketLengthCheck[(sizeof(struct imu_rx_pkt_t) == IMU_PACKET_LENGTH) ? 1 : -1];
+typedef char fcuPacketLengthCheck[(sizeof(struct fcu_pkt_t) == FCU_PACKET_LENGTH) ? 1 : -1];
+typedef char telemetryPacketLengthCheck[(sizeof(struct telemetry_pkt_t) == TELEMETRY_PACKET_LENGTH) ? 1 : -1];
+
+const struct flightLogField* packetFields (packetType packet, int* count) {
+	if (packet == PACKET_IMU) {
+		*count = IMU_FIELD_COUNT;
+		return imuFields;
+	}
+	if (packet == PACKET_TELEMETRY) {
+		*count = TELEMETRY_FIELD_COUNT;
+		return telemetryFields;
+	}
+	*count = FCU_FIELD_COUNT;
+	return fcuFields;
+}
+
+const char* packetTypeName (packetType packet) {
+	if (packet == PACKET_IMU)
+		return PACKET_NAME(imu_rx_pkt_t, IMU_PACKET_VERSION);
+	if (packet == PACKET_TELEMETRY)
+		return PACKET_NAME(telemetry_pkt_t, TELEMETRY_PACKET_VERSION);
+	return PACKET_NAME(fcu_pkt_t, FCU_PACKET_VERSION);
+}
+
+uint16_t packetLength (packetType packet) {
+	if (packet == PACKET_IMU)
+		return IMU_PACKET_LENGTH;
+	if (packet == PACKET_TELEMETRY)
+		return TELEMETRY_PACKET_LENGTH;
+	return FCU_PACKET_LENGTH;
+}
+
+// frame by frame, every wanted field of a frame while it's in cache
+#define PACKET_DECODE_IMU(type, name, label) \
+	if (columns[IMU_FIELD_##name] != NULL) \
+		columns[IMU_FIELD_##name][i] = (float) PACKET_READ_##type(frames + offsetof(struct imu_rx_pkt_t, name));
+#define PACKET_DECODE_FCU(type, name, label) \
+	if (columns[FCU_FIELD_##name] != NULL) \
+		columns[FCU_FIELD_##name][i] = (float) PACKET_READ_##type(frames + offsetof(struct fcu_pkt_t, name));
+#define PACKET_DECODE_TELEMETRY(type, name, label) \
+	if (columns[TELEMETRY_FIELD_##name] != NULL) \
+		columns[TELEMETRY_FIELD_##name][i] = (float) PACKET_READ_##type(frames + offsetof(struct telemetry_pkt_t, name));
+
+void imuPacketDecode (const uint8_t* frames, size_t stride, uint32_t n, float* const columns[IMU_FIELD_COUNT]) {
+	uint32_t i;
+
+	for (i=0; i<n; i++, frames += stride) {
+		IMU_PACKET_FIELDS(PACKET_DECODE_IMU)
+	}
+}
+
+void fcuPacketDecode (const uint8_t* frames, size_t stride, uint32_t n, float* const columns[FCU_FIELD_COUNT]) {
+	uint32_t i;
+
+	for (i=0; i<n; i++, frames += stride) {
+		FCU_PACKET_FIELDS(PACKET_DECODE_FCU)
+	}
+}
+
+void telemetryPacketDecode (const uint8_t* frames, size_t stride, uint32_t n, float* const columns[TELEMETRY_FIELD_COUNT]) {
+	uint32_t i;
+
+	for (i=0; i<n; i++, frames += stride) {
+		TELEMETRY_PACKET_FIELDS(PACKET_DECODE_TELEMETRY)
+	}
+}
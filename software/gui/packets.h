@@ -0,0 +1,73 @@
+#ifndef __PACKETS_H__
+#define __PACKETS_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "packetSchema.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+// host side of packetSchema.h: the packet structs, field accessors that read
+// straight out of a received frame, flight log field tables and decoders that
+// split a batch of frames into per field columns in one pass.
+
+PACKET_STRUCT(imu_rx_pkt_t, IMU_PACKET_FIELDS);
+PACKET_STRUCT(fcu_pkt_t, FCU_PACKET_FIELDS);
+PACKET_STRUCT(telemetry_pkt_t, TELEMETRY_PACKET_FIELDS);
+
+// index of every field, in schema order: IMU_FIELD_roll, FCU_FIELD_motor1 ...
+#define PACKET_FIELD_IMU(type, name, label) IMU_FIELD_##name,
+#define PACKET_FIELD_FCU(type, name, label) FCU_FIELD_##name,
+#define PACKET_FIELD_TELEMETRY(type, name, label) TELEMETRY_FIELD_##name,
+enum { IMU_PACKET_FIELDS(PACKET_FIELD_IMU) IMU_FIELD_COUNT };
+enum { FCU_PACKET_FIELDS(PACKET_FIELD_FCU) FCU_FIELD_COUNT };
+enum { TELEMETRY_PACKET_FIELDS(PACKET_FIELD_TELEMETRY) TELEMETRY_FIELD_COUNT };
+
+// frames arrive in host byte order (the FCU is little endian too) but are not
+// aligned, these read a field without copying the frame.  ex:
+//   int16_t roll = FCU_PACKET_GET(frame, roll);
+// UINT16 fields come back as int16_t too, cast them (uint16_t sequence = ...)
+#define PACKET_GET(tag, frame, name) packetGetInt16((const uint8_t*)(frame) + offsetof(struct tag, name))
+#define IMU_PACKET_GET(frame, name) PACKET_GET(imu_rx_pkt_t, frame, name)
+#define FCU_PACKET_GET(frame, name) PACKET_GET(fcu_pkt_t, frame, name)
+#define TELEMETRY_PACKET_GET(frame, name) PACKET_GET(telemetry_pkt_t, frame, name)
+
+static inline int16_t packetGetInt16 (const uint8_t* data) {
+	int16_t value;
+	memcpy(&value, data, sizeof(value));
+	return value;
+}
+
+// by schema type, for the generators: PACKET_READ_##type(data)
+#define PACKET_READ_INT16(data) packetGetInt16(data)
+#define PACKET_READ_UINT16(data) ((uint16_t) packetGetInt16(data))
+
+typedef enum
+{
+PACKET_IMU,
+PACKET_FCU,
+PACKET_TELEMETRY,
+}packetType;
+
+struct flightLogField;
+
+// every field of a packet as flight log fields, and its name for a log header ("fcu_pkt_t v1")
+const struct flightLogField* packetFields (packetType packet, int* count);
+const char* packetTypeName (packetType packet);
+uint16_t packetLength (packetType packet);
+
+// n frames, stride bytes apart, into columns[field][frame].  columns has a
+// slot for every field (FCU_FIELD_COUNT), leave the ones you don't want NULL
+void imuPacketDecode (const uint8_t* frames, size_t stride, uint32_t n, float* const columns[IMU_FIELD_COUNT]);
+void fcuPacketDecode (const uint8_t* frames, size_t stride, uint32_t n, float* const columns[FCU_FIELD_COUNT]);
+void telemetryPacketDecode (const uint8_t* frames, size_t stride, uint32_t n, float* const columns[TELEMETRY_FIELD_COUNT]);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __PACKETS_H__ */
@@ -219,11 +219,11 @@ g_return_if_fail (GTK_IS_GRAPH (graph));
 g_return_if_fail (GTK_WIDGET_REALIZED (graph));
 g_return_if_fail (graph->graph_type == POLAR);
 	
-tmp = graph->traces;
 for (n = 0 ; n < graph->num_traces ; n++)
 	{
-	/* Make sure that there is some data in the trace */
-	if (tmp->Xdata == NULL || tmp->Ydata == NULL) 
+	tmp = graph->traces[n];
+	/* Make sure that there is some data in the trace (chunked data is XY only) */
+	if (tmp->Xdata == NULL || tmp->Ydata == NULL || tmp->num_points == 0) 
 		continue;
 
 	/* Assign the storage for the co-ordinates of each data point */
@@ -279,7 +279,6 @@ for (n = 0 ; n < graph->num_traces ; n++)
 			}
 
 	g_free(pts);// Free up all storage after use 
-	tmp = tmp->next;// and then move onto the next trace 
 	
 	}
 
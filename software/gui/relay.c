@@ -0,0 +1,248 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "relay.h"
+#include "frameDecoder.h"
+#include "flightLog.h"
+
+#define RELAY_HELLO_TIMEOUT 5     // seconds a server gets to say hello
+
+static uint32_t relayClientDecode (struct relayClient* client, const uint8_t* payload, uint16_t length, struct telemetrySample* samples, double rxTime);
+static int relayReadAll (int fd, uint8_t* data, uint32_t length);
+
+// telemetryMux channels by name, for relayFieldMask
+#define RELAY_CHANNEL(name, rate, priority, FIELDS) {#name, PACKET_FIELD_COUNT(FIELDS)},
+static const struct {
+	const char* name;
+	uint8_t fields;
+} relayChannels[] = { TELEMETRY_CHANNELS(RELAY_CHANNEL) };
+
+// "host" or "host:port".  waits for the server's hello, then everything after
+// is non-blocking.  returns 0 on success
+int relayClientConnect (struct relayClient* client, const char* address) {
+	struct addrinfo hints, *found, *each;
+	struct timeval timeout = {RELAY_HELLO_TIMEOUT, 0};
+	char host[256], port[16];
+	uint8_t hello[RELAY_HEADER_LENGTH + RELAY_HELLO_LENGTH];
+	const char* colon = strrchr(address, ':');
+	uint32_t magic;
+	uint16_t version;
+	int one = 1, error;
+
+	memset(client, 0, sizeof(struct relayClient));
+	snprintf(host, sizeof(host), "%.*s", colon ? (int)(colon - address) : (int) strlen(address), address);
+	snprintf(port, sizeof(port), "%d", colon ? atoi(colon + 1) : RELAY_DEFAULT_PORT);
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	error = getaddrinfo(host, port, &hints, &found);
+	if (error) {
+		fprintf(stderr, "\n***** RELAY ERROR: %s: %s\n\n", address, gai_strerror(error));
+		return -1;
+	}
+	client->fd = -1;
+	for (each = found; each != NULL && client->fd < 0; each = each->ai_next) {
+		client->fd = socket(each->ai_family, each->ai_socktype, each->ai_protocol);
+		if (client->fd >= 0 && connect(client->fd, each->ai_addr, each->ai_addrlen)) {
+			close(client->fd);
+			client->fd = -1;
+		}
+	}
+	freeaddrinfo(found);
+	if (client->fd < 0) {
+		perror("\n***** RELAY ERROR: connect failed, is relayd running?\n\n");
+		return -1;
+	}
+
+	setsockopt(client->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	setsockopt(client->fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	if (relayReadAll(client->fd, hello, sizeof(hello)) || hello[0] != RELAY_HELLO) {
+		fprintf(stderr, "\n***** RELAY ERROR: %s didn't say hello\n\n", address);
+		close(client->fd);
+		return -1;
+	}
+	memcpy(&magic, hello + 4, 4);
+	memcpy(&version, hello + 8, 2);
+	if (magic != RELAY_MAGIC || version != RELAY_VERSION) {
+		fprintf(stderr, "\n***** RELAY ERROR: %s isn't a relay this build understands\n\n", address);
+		close(client->fd);
+		return -1;
+	}
+	client->packet = hello[10];
+	memcpy(&client->frameLength, hello + 12, 2);
+	client->fields = packetFields(client->packet, &client->fieldCount);
+	if (hello[11] != client->fieldCount || client->frameLength != packetLength(client->packet) ||
+		strncmp((const char*) hello + 14, packetTypeName(client->packet), RELAY_NAME_LENGTH) != 0) {
+		fprintf(stderr, "\n***** RELAY ERROR: %s sends %.*s, not what this build knows as %s\n\n",
+			address, RELAY_NAME_LENGTH, hello + 14, packetTypeName(client->packet));
+		close(client->fd);
+		return -1;
+	}
+
+	fcntl(client->fd, F_SETFL, fcntl(client->fd, F_GETFL) | O_NONBLOCK);
+	client->connected = 1;
+	return 0;
+}
+
+// the fields (bit n is field n of client->packet) and every how many samples.  returns 0 on success
+int relayClientSubscribe (struct relayClient* client, uint64_t mask, uint16_t decimation) {
+	uint8_t message[RELAY_HEADER_LENGTH + RELAY_SUBSCRIBE_LENGTH] = {RELAY_SUBSCRIBE, 0, RELAY_SUBSCRIBE_LENGTH, 0};
+
+	if (client->fieldCount < RELAY_MAX_FIELDS)
+		mask &= ((uint64_t) 1 << client->fieldCount) - 1;
+	memcpy(message + 4, &mask, 8);
+	memcpy(message + 12, &decimation, 2);
+	// small enough that a fresh socket always has room for it
+	if (write(client->fd, message, sizeof(message)) != sizeof(message)) {
+		perror("\n***** RELAY ERROR: write failed\n\n");
+		return -1;
+	}
+	return 0;
+}
+
+// whatever has come in, as telemetrySamples of client->packet with the fields
+// we didn't subscribe to left 0.  up to maxSamples (at least RELAY_MAX_BATCH),
+// the rest wait for the next call.  connected goes to 0 if the server goes away
+uint32_t relayClientRead (struct relayClient* client, struct telemetrySample* samples, uint32_t maxSamples) {
+	struct timespec now;
+	double rxTime;
+	uint32_t n = 0, offset = 0;
+	ssize_t got;
+
+	while (client->connected && client->length < sizeof(client->buffer)) {
+		got = read(client->fd, client->buffer + client->length, sizeof(client->buffer) - client->length);
+		if (got > 0) {
+			client->length += got;
+			client->bytes += got;
+			continue;
+		}
+		if (got == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+			client->connected = 0;
+		break;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	rxTime = now.tv_sec + now.tv_nsec*1e-9;
+
+	while (client->length - offset >= RELAY_HEADER_LENGTH) {
+		const uint8_t* message = client->buffer + offset;
+		uint16_t length, count;
+
+		memcpy(&length, message + 2, 2);
+		if (length > RELAY_MAX_MESSAGE - RELAY_HEADER_LENGTH) {
+			fprintf(stderr, "\n***** RELAY ERROR: %d byte message, lost our place in the stream\n\n", length);
+			client->connected = 0;
+			offset = client->length; // nothing after it can be trusted, don't look at it again
+			break;
+		}
+		if (client->length - offset < RELAY_HEADER_LENGTH + (uint32_t) length)
+			break;
+		if (message[0] == RELAY_SAMPLES) {
+			if (length < RELAY_SAMPLES_LENGTH) {
+				fprintf(stderr, "\n***** RELAY ERROR: %d byte samples message is too short for its header\n\n", length);
+				client->connected = 0;
+				offset = client->length;
+				break;
+			}
+			memcpy(&count, message + RELAY_HEADER_LENGTH + 12, 2);
+			if (n + count > maxSamples)
+				break;
+			n += relayClientDecode(client, message + RELAY_HEADER_LENGTH, length, samples + n, rxTime);
+		}
+		offset += RELAY_HEADER_LENGTH + length;
+	}
+
+	memmove(client->buffer, client->buffer + offset, client->length - offset);
+	client->length -= offset;
+	client->samples += n;
+	return n;
+}
+
+void relayClientClose (struct relayClient* client) {
+	close(client->fd);
+	client->connected = 0;
+}
+
+// a field by its label ("roll", "motor 1"), or for telemetry packets a whole
+// mux channel ("gyro", "pid").  0 if there's no such thing
+uint64_t relayFieldMask (packetType packet, const char* name) {
+	const struct flightLogField* fields;
+	int count, f, c, first = 0;
+
+	fields = packetFields(packet, &count);
+	for (f=0; f<count && f<RELAY_MAX_FIELDS; f++)
+		if (strcmp(fields[f].name, name) == 0)
+			return (uint64_t) 1 << f;
+
+	if (packet != PACKET_TELEMETRY)
+		return 0;
+	for (c=0; c<(int)(sizeof(relayChannels)/sizeof(relayChannels[0])); c++) {
+		if (strcmp(relayChannels[c].name, name) == 0)
+			return (((uint64_t) 1 << relayChannels[c].fields) - 1) << first;
+		first += relayChannels[c].fields;
+	}
+	return 0;
+}
+
+int relayMaskCount (uint64_t mask) {
+	int count = 0;
+	for (; mask; mask &= mask - 1)
+		count++;
+	return count;
+}
+
+static uint32_t relayClientDecode (struct relayClient* client, const uint8_t* payload, uint16_t length, struct telemetrySample* samples, double rxTime) {
+	uint64_t mask;
+	uint32_t dropped;
+	uint16_t count, i;
+	int fields, f;
+	const uint8_t* data = payload + RELAY_SAMPLES_LENGTH;
+
+	memcpy(&mask, payload, 8);
+	memcpy(&dropped, payload + 8, 4);
+	memcpy(&count, payload + 12, 2);
+	fields = relayMaskCount(mask);
+	if (length != RELAY_SAMPLES_LENGTH + (uint32_t) count*(8 + 2*fields))
+		return 0;
+	client->dropped += dropped;
+
+	for (i=0; i<count; i++) {
+		struct telemetrySample* sample = &samples[i];
+		memset(sample->frame, 0, client->frameLength);
+		memcpy(&sample->sampleTime, data, 8);
+		data += 8;
+		for (f=0; f<client->fieldCount && f<RELAY_MAX_FIELDS; f++) {
+			if (mask & ((uint64_t) 1 << f)) {
+				memcpy(sample->frame + client->fields[f].offset, data, 2);
+				data += 2;
+			}
+		}
+		sample->frame[0] = FRAME_DECODER_START_BYTE;
+		sample->frame[1] = frameDecoderParity(sample->frame, client->frameLength);
+		sample->length = client->frameLength;
+		sample->rxTime = rxTime;
+	}
+	return count;
+}
+
+// blocking, for the hello.  0 once length bytes are in
+static int relayReadAll (int fd, uint8_t* data, uint32_t length) {
+	while (length > 0) {
+		ssize_t got = read(fd, data, length);
+		if (got <= 0)
+			return -1;
+		data += got;
+		length -= got;
+	}
+	return 0;
+}
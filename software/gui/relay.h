@@ -0,0 +1,79 @@
+#ifndef __RELAY_H__
+#define __RELAY_H__
+
+#include <stdint.h>
+
+#include "serialIngest.h"
+#include "packets.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+// telemetry over TCP, so laptops other than the one with the radio can watch.
+// relayd follows the telemetry bus (telemetryBus.h) and serves it; this is the
+// wire format and the client end.
+//
+// every message is [type][0][payload length, 2 bytes][payload], everything
+// little endian.  when a client connects the server says hello:
+//   RELAY_HELLO      magic 4, version 2, packetType 1, field count 1,
+//                    frame length 2, packet name RELAY_NAME_LENGTH
+// and sends nothing more until the client subscribes:
+//   RELAY_SUBSCRIBE  field mask 8, decimation 2
+// bit n of the mask is field n of the packet (FCU_FIELD_roll ...), decimation
+// is every how many samples it wants (1 is all of them, 0 stops).  subscribing
+// again replaces the last one.  from then on:
+//   RELAY_SAMPLES    field mask 8, dropped 4, count 2, then count times
+//                    [sample time 8][each field in the mask, 2 bytes]
+// dropped counts samples the server threw away since the last message because
+// this client wasn't taking them fast enough.  nobody else waits for it.
+// sample times are the FCU's clock (telemetrySample.sampleTime), the receive
+// time a client hands on is when it got them, the server's clock means
+// nothing on another machine.
+
+#define RELAY_DEFAULT_PORT 5761
+#define RELAY_MAGIC 0x594C5246           // "FRLY"
+#define RELAY_VERSION 1
+#define RELAY_NAME_LENGTH 32
+#define RELAY_HEADER_LENGTH 4
+#define RELAY_MAX_BATCH 64               // samples a RELAY_SAMPLES carries at most
+#define RELAY_MAX_FIELDS 64              // bits in a mask
+#define RELAY_HELLO_LENGTH (10 + RELAY_NAME_LENGTH)
+#define RELAY_SUBSCRIBE_LENGTH 10
+#define RELAY_SAMPLES_LENGTH 14          // before the samples
+#define RELAY_MAX_MESSAGE (RELAY_HEADER_LENGTH + RELAY_SAMPLES_LENGTH + RELAY_MAX_BATCH*(8 + 2*RELAY_MAX_FIELDS))
+
+typedef enum
+{
+RELAY_HELLO = 1,
+RELAY_SUBSCRIBE,
+RELAY_SAMPLES,
+}relayMessage;
+
+struct relayClient {
+	int fd;
+	int connected;
+	packetType packet;
+	uint16_t frameLength;
+	const struct flightLogField* fields;
+	int fieldCount;
+	uint64_t dropped;                // server side, summed over every RELAY_SAMPLES
+	uint64_t samples;
+	uint64_t bytes;
+	uint32_t length;                 // of what's waiting in buffer
+	uint8_t buffer[2*RELAY_MAX_MESSAGE];
+};
+
+int relayClientConnect (struct relayClient* client, const char* address);
+int relayClientSubscribe (struct relayClient* client, uint64_t mask, uint16_t decimation);
+uint32_t relayClientRead (struct relayClient* client, struct telemetrySample* samples, uint32_t maxSamples);
+void relayClientClose (struct relayClient* client);
+
+uint64_t relayFieldMask (packetType packet, const char* name);
+int relayMaskCount (uint64_t mask);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __RELAY_H__ */
@@ -0,0 +1,409 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "replay.h"
+
+#define INITIAL_CSV_ROWS 4096
+#define IMU_LOG_PACKET "imu_rx_pkt_t "   // packetName of a log record made of IMU frames, less its version
+
+// the IMU calls its gyro rates roll, pitch and yaw.  the FCU sends those same
+// words on as x, y and z gyro and keeps roll, pitch and yaw for its attitude,
+// which an IMU recording doesn't have
+static const char* const imuNames[][2] = {
+	{"x gyro", "roll"},
+	{"y gyro", "pitch"},
+	{"z gyro", "yaw"},
+	{"roll", NULL},
+	{"pitch", NULL},
+	{"yaw", NULL},
+};
+
+static int replayOpenLog (struct replay* replay, const char* path, const struct flightLogField* layout, uint32_t fieldCount);
+static int replayLoadCsv (struct replay* replay, const char* path, const struct flightLogField* layout, uint32_t fieldCount);
+static double replayTime (const struct replay* replay, uint64_t record);
+static const uint8_t* replayFrame (struct replay* replay, uint64_t record);
+static uint64_t replayFind (const struct replay* replay, double time);
+static void replayFree (struct replay* replay);
+static const char* replayRecordedName (int imu, const char* name);
+static void* replayThread (void* arg);
+static void replayDecoded (const uint8_t* frame, uint16_t length, void* userData);
+
+// opens the recording and starts playing it from the beginning.  speed is a
+// multiple of real time or REPLAY_MAX_SPEED.  returns 0 on success
+int replayStart (struct replay* replay, const char* path, const struct flightLogField* layout, uint32_t fieldCount, uint16_t frameLength, double speed, uint32_t queueLength) {
+	char magic[sizeof(FLIGHT_LOG_MAGIC)-1] = {0};
+	FILE* file;
+	int error;
+
+	memset(replay, 0, sizeof(struct replay));
+	replay->log.fd = -1;
+
+	if (frameLength > SERIAL_INGEST_MAX_FRAME_LENGTH || fieldCount > FLIGHT_LOG_MAX_FIELDS) {
+		fprintf(stderr, "\n***** REPLAY ERROR: frame length %d is too long\n\n", frameLength);
+		return -1;
+	}
+	replay->frameLength = frameLength;
+	replay->speed = speed;
+
+	// a flight log starts with its magic, anything else had better be CSV
+	file = fopen(path, "r");
+	if (file == NULL) {
+		perror("\n***** REPLAY ERROR: fopen failed\n\n");
+		return -1;
+	}
+	if (fread(magic, 1, sizeof(magic), file) != sizeof(magic))
+		memset(magic, 0, sizeof(magic));
+	fclose(file);
+
+	replay->binary = (memcmp(magic, FLIGHT_LOG_MAGIC, sizeof(magic)) == 0);
+	if (replay->binary)
+		error = replayOpenLog(replay, path, layout, fieldCount);
+	else
+		error = replayLoadCsv(replay, path, layout, fieldCount);
+	if (error) {
+		replayFree(replay);
+		return -1;
+	}
+	if (replay->count == 0) {
+		fprintf(stderr, "\n***** REPLAY ERROR: %s has nothing in it to play\n\n", path);
+		replayFree(replay);
+		return -1;
+	}
+	replay->startTime = replayTime(replay, 0);
+
+	frameDecoderInit(&replay->decoder, frameLength, FRAME_DECODER_CHECK_PARITY, replayDecoded, replay);
+	if (spscQueueInit(&replay->queue, sizeof(struct telemetrySample), queueLength)) {
+		replayFree(replay);
+		return -1;
+	}
+
+	replay->running = 1;
+	if (pthread_create(&replay->thread, NULL, replayThread, replay)) {
+		perror("\n***** REPLAY ERROR: pthread_create failed\n\n");
+		replay->running = 0;
+		spscQueueFree(&replay->queue);
+		replayFree(replay);
+		return -1;
+	}
+
+	return 0;
+}
+
+void replayStop (struct replay* replay) {
+	if (!replay->running)
+		return;
+	replay->running = 0;
+	pthread_join(replay->thread, NULL);
+	spscQueueFree(&replay->queue);
+	replayFree(replay);
+}
+
+// gui side.  pull up to maxSamples waiting samples out in one go
+uint32_t replayDrain (struct replay* replay, struct telemetrySample* samples, uint32_t maxSamples) {
+	return spscQueuePopBatch(&replay->queue, samples, maxSamples);
+}
+
+// carry on from seconds into the recording.  whatever is already queued still
+// comes out first
+void replaySeek (struct replay* replay, double seconds) {
+	replay->seekTime = seconds;
+	__sync_synchronize();
+	replay->seekRequest = 1;
+}
+
+void replaySetSpeed (struct replay* replay, double speed) {
+	replay->speed = speed;
+	__sync_synchronize();
+	replay->anchorRequest = 1;
+}
+
+// seconds from the first record to the last
+double replayDuration (const struct replay* replay) {
+	return replayTime(replay, replay->count-1) - replay->startTime;
+}
+
+// seconds into the recording of the next record to be played
+double replayPosition (const struct replay* replay) {
+	uint64_t position = replay->position;
+	if (position >= replay->count)
+		return replayDuration(replay);
+	return replayTime(replay, position) - replay->startTime;
+}
+
+// matches the log's fields to the layout by name.  a log already in the layout is played as is
+static int replayOpenLog (struct replay* replay, const char* path, const struct flightLogField* layout, uint32_t fieldCount) {
+	const struct flightLogField* from;
+	const char* name;
+	uint32_t i, same = 0;
+	int imu;
+
+	if (flightLogOpen(&replay->log, path))
+		return -1;
+	replay->count = replay->log.records;
+	imu = (strncmp(replay->log.header->packetName, IMU_LOG_PACKET, strlen(IMU_LOG_PACKET)) == 0);
+
+	for (i=0; layout != NULL && i<fieldCount; i++) {
+		name = replayRecordedName(imu, layout[i].name);
+		from = (name != NULL) ? flightLogFindField(&replay->log, name) : NULL;
+		if (from == NULL)
+			continue;
+		if (from->offset == layout[i].offset && from->type == layout[i].type && from->count == layout[i].count)
+			same++;
+		replay->mapFrom[replay->mapCount] = from;
+		replay->mapTo[replay->mapCount] = &layout[i];
+		replay->mapCount++;
+	}
+
+	if (replay->log.header->frameLength == replay->frameLength && (layout == NULL || same == fieldCount)) {
+		replay->mapCount = 0;
+		return 0;
+	}
+	if (replay->mapCount == 0) {
+		fprintf(stderr, "\n***** REPLAY ERROR: %s has none of the fields we plot\n\n", path);
+		return -1;
+	}
+	return 0;
+}
+
+// reads the whole file into frames up front, it's only a few numbers a row.
+// record only writes IMU frames to CSV, so the columns are named the IMU's way
+static int replayLoadCsv (struct replay* replay, const char* path, const struct flightLogField* layout, uint32_t fieldCount) {
+	const struct flightLogField* columns[FLIGHT_LOG_MAX_FIELDS];
+	int columnCount = 0, timeColumn = -1, matched = 0;
+	uint64_t size = 0;
+	char* line = NULL;
+	size_t lineSize = 0;
+	char *p, *end, *name;
+	const char* recorded;
+	FILE* file;
+	int c;
+	uint32_t i;
+
+	file = fopen(path, "r");
+	if (file == NULL) {
+		perror("\n***** REPLAY ERROR: fopen failed\n\n");
+		return -1;
+	}
+
+	// the header names the columns
+	if (getline(&line, &lineSize, file) < 0) {
+		fprintf(stderr, "\n***** REPLAY ERROR: %s is empty\n\n", path);
+		fclose(file);
+		return -1;
+	}
+	for (name = strtok(line, ",\r\n"); name != NULL && columnCount < FLIGHT_LOG_MAX_FIELDS; name = strtok(NULL, ",\r\n")) {
+		while (isspace((unsigned char)*name))
+			name++;
+		for (end = name + strlen(name); end > name && isspace((unsigned char)end[-1]); end--)
+			*(end-1) = 0;
+
+		columns[columnCount] = NULL;
+		if (strcmp(name, "time") == 0)
+			timeColumn = columnCount;
+		for (i=0; layout != NULL && i<fieldCount; i++)
+			if ((recorded = replayRecordedName(1, layout[i].name)) != NULL && strncmp(recorded, name, FLIGHT_LOG_NAME_LENGTH) == 0) {
+				columns[columnCount] = &layout[i];
+				matched++;
+			}
+		columnCount++;
+	}
+	if (matched == 0) {
+		fprintf(stderr, "\n***** REPLAY ERROR: %s has none of the fields we plot\n\n", path);
+		free(line);
+		fclose(file);
+		return -1;
+	}
+
+	while (getline(&line, &lineSize, file) >= 0) {
+		uint8_t* frame;
+		double time = replay->count / REPLAY_CSV_RATE;
+
+		if (replay->count == size) {
+			uint64_t newSize = size ? size*2 : INITIAL_CSV_ROWS;
+			double* times = realloc(replay->csvTimes, sizeof(double)*newSize);
+			uint8_t* frames;
+			if (times == NULL) {
+				perror("\n***** REPLAY ERROR: realloc failed\n\n");
+				break;
+			}
+			replay->csvTimes = times;
+			frames = realloc(replay->csvFrames, (size_t)replay->frameLength*newSize);
+			if (frames == NULL) {
+				perror("\n***** REPLAY ERROR: realloc failed\n\n");
+				break;
+			}
+			replay->csvFrames = frames;
+			size = newSize;
+		}
+
+		frame = replay->csvFrames + (size_t)replay->frameLength*replay->count;
+		memset(frame, 0, replay->frameLength);
+
+		// rows that don't have a number in every column are skipped
+		for (c=0, p=line; c<columnCount; c++) {
+			double value = strtod(p, &end);
+			if (end == p)
+				break;
+			if (columns[c] != NULL)
+				flightLogSetValue(columns[c], frame, 0, value);
+			if (c == timeColumn)
+				time = value;
+			for (p=end; isspace((unsigned char)*p); p++);
+			if (*p == ',')
+				p++;
+		}
+		if (c < columnCount)
+			continue;
+
+		frame[0] = FRAME_DECODER_START_BYTE;
+		frame[1] = frameDecoderParity(frame, replay->frameLength);
+		replay->csvTimes[replay->count++] = time;
+	}
+
+	free(line);
+	fclose(file);
+	return 0;
+}
+
+static double replayTime (const struct replay* replay, uint64_t record) {
+	if (replay->binary)
+		return flightLogTime(&replay->log, record);
+	return replay->csvTimes[record];
+}
+
+// a record as a frame in our layout
+static const uint8_t* replayFrame (struct replay* replay, uint64_t record) {
+	const uint8_t* frame;
+	uint32_t i;
+
+	if (!replay->binary)
+		return replay->csvFrames + (size_t)replay->frameLength*record;
+
+	frame = flightLogFrame(&replay->log, record);
+	if (replay->mapCount == 0)
+		return frame;
+
+	memset(replay->frame, 0, replay->frameLength);
+	for (i=0; i<replay->mapCount; i++) {
+		uint8_t element;
+		for (element=0; element<replay->mapTo[i]->count && element<replay->mapFrom[i]->count; element++)
+			flightLogSetValue(replay->mapTo[i], replay->frame, element, flightLogValue(replay->mapFrom[i], frame, element));
+	}
+	replay->frame[0] = FRAME_DECODER_START_BYTE;
+	replay->frame[1] = frameDecoderParity(replay->frame, replay->frameLength);
+	return replay->frame;
+}
+
+// first record at or after time
+static uint64_t replayFind (const struct replay* replay, double time) {
+	uint64_t lo = 0, hi = replay->count, mid;
+
+	if (replay->binary)
+		return flightLogFind(&replay->log, time);
+
+	while (lo < hi) {
+		mid = lo + (hi - lo)/2;
+		if (replay->csvTimes[mid] < time)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+// name of the recorded field that feeds a field of the layout, NULL if none does
+static const char* replayRecordedName (int imu, const char* name) {
+	uint32_t i;
+
+	for (i=0; imu && i<sizeof(imuNames)/sizeof(imuNames[0]); i++)
+		if (strncmp(imuNames[i][0], name, FLIGHT_LOG_NAME_LENGTH) == 0)
+			return imuNames[i][1];
+	return name;
+}
+
+static void replayFree (struct replay* replay) {
+	if (replay->binary)
+		flightLogCloseReader(&replay->log);
+	free(replay->csvTimes);
+	free(replay->csvFrames);
+	replay->csvTimes = NULL;
+	replay->csvFrames = NULL;
+	replay->count = 0;
+}
+
+// plays records whose time has come, as many as the queue has room for.  the
+// recording's clock is pinned to ours at the start and after every seek or
+// change of speed
+static void* replayThread (void* arg) {
+	struct replay* replay = (struct replay*) arg;
+	uint64_t position = 0;
+	double wallAnchor = serialIngestNow();
+	double logAnchor = replay->startTime;
+
+	while (replay->running) {
+		double speed, due = 0;
+		uint32_t space;
+
+		if (replay->seekRequest) {
+			position = replayFind(replay, replay->startTime + replay->seekTime);
+			replay->seekRequest = 0;
+			replay->anchorRequest = 1;
+		}
+		if (replay->anchorRequest) {
+			replay->anchorRequest = 0;
+			wallAnchor = serialIngestNow();
+			logAnchor = (position < replay->count) ? replayTime(replay, position) : 0;
+		}
+		replay->position = position;
+
+		if (position >= replay->count) {
+			usleep(REPLAY_SLEEP_MS*1000);
+			continue;
+		}
+
+		speed = replay->speed;
+		if (speed > 0)
+			due = logAnchor + (serialIngestNow() - wallAnchor)*speed;
+
+		space = replay->queue.capacity - spscQueueCount(&replay->queue);
+		while (position < replay->count && space > 0) {
+			replay->sampleTime = replayTime(replay, position);
+			if (speed > 0 && replay->sampleTime > due)
+				break;
+			frameDecoderPush(&replay->decoder, replayFrame(replay, position), replay->frameLength);
+			position++;
+			space--;
+		}
+		replay->position = position;
+
+		// either the queue is full and the gui has to catch up or the next record isn't due yet
+		if (space == 0)
+			usleep(1000);
+		else if (position < replay->count && speed > 0) {
+			double wait = (replay->sampleTime - due) / speed;
+			if (wait > REPLAY_SLEEP_MS/1000.0)
+				wait = REPLAY_SLEEP_MS/1000.0;
+			usleep((useconds_t)(wait*1e6));
+		}
+	}
+
+	return NULL;
+}
+
+// decoder callback, runs on the replay thread
+static void replayDecoded (const uint8_t* frame, uint16_t length, void* userData) {
+	struct replay* replay = (struct replay*) userData;
+	struct telemetrySample sample;
+
+	sample.rxTime = replay->sampleTime;
+	sample.sampleTime = replay->sampleTime - replay->startTime;
+	sample.length = length;
+	memcpy(sample.frame, frame, length);
+
+	spscQueuePush(&replay->queue, &sample);
+}
@@ -0,0 +1,73 @@
+#ifndef __REPLAY_H__
+#define __REPLAY_H__
+
+#include <stdint.h>
+#include <pthread.h>
+
+#include "frameDecoder.h"
+#include "spscQueue.h"
+#include "serialIngest.h"
+#include "flightLog.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+// plays a recorded flight back in place of the serial port.  a thread pushes
+// the recorded frames through a frame decoder onto a queue of telemetrySamples,
+// exactly like serialIngest, at the recorded rate times a speed factor or as
+// fast as the gui will take them.  seeking is a binary search on receive time.
+//
+// binary flight logs and the CSV files record writes both work.  the frames
+// are rebuilt to the layout the caller asks for by matching field names, so an
+// IMU log plays into an FCU plot: its gyro rates, which the IMU calls roll,
+// pitch and yaw, go to x, y and z gyro and the fields it doesn't have stay 0
+// (the FCU's attitude among them).  CSV files are IMU recordings.  a CSV file
+// has no times unless it has a "time" column, its rows are REPLAY_CSV_RATE apart.
+
+#define REPLAY_MAX_SPEED 0        // speed that means don't wait at all
+#define REPLAY_CSV_RATE 100.0     // Hz, for CSV files without a time column
+#define REPLAY_SLEEP_MS 10        // longest the thread sleeps before looking at its requests
+
+struct replay {
+	// the recording, either a mapped log or a CSV file read into memory
+	uint8_t binary;
+	struct flightLogReader log;
+	double* csvTimes;
+	uint8_t* csvFrames;
+	uint64_t count;
+	double startTime;
+
+	// how recorded fields land in the frames we hand out
+	uint16_t frameLength;
+	uint32_t mapCount;
+	const struct flightLogField* mapFrom[FLIGHT_LOG_MAX_FIELDS];
+	const struct flightLogField* mapTo[FLIGHT_LOG_MAX_FIELDS];
+	uint8_t frame[SERIAL_INGEST_MAX_FRAME_LENGTH];
+
+	pthread_t thread;
+	volatile int running;
+	volatile double speed;
+	volatile double seekTime;
+	volatile int seekRequest;    // gui sets it, the thread clears it once it's moved
+	volatile int anchorRequest;  // speed changed, restart the clock from where we are
+	volatile uint64_t position;  // next record to play, written by the thread
+	double sampleTime;           // time stamp for the frame being decoded
+
+	struct frameDecoder decoder;
+	struct spscQueue queue;
+};
+
+int replayStart (struct replay* replay, const char* path, const struct flightLogField* layout, uint32_t fieldCount, uint16_t frameLength, double speed, uint32_t queueLength);
+void replayStop (struct replay* replay);
+uint32_t replayDrain (struct replay* replay, struct telemetrySample* samples, uint32_t maxSamples);
+void replaySeek (struct replay* replay, double seconds);
+void replaySetSpeed (struct replay* replay, double speed);
+double replayDuration (const struct replay* replay);
+double replayPosition (const struct replay* replay);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __REPLAY_H__ */
@@ -0,0 +1,127 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "sampleColumn.h"
+
+#define INITIAL_CHUNK_TABLE_SIZE 16
+
+// free chunks, linked through their first word
+static void* chunkPool = NULL;
+
+static float* sampleColumnChunkAlloc (void);
+static void sampleColumnChunkFree (float* chunk);
+
+void sampleColumnInit (struct sampleColumn* column) {
+	column->chunks = NULL;
+	column->chunkCount = 0;
+	column->chunkTableSize = 0;
+	column->start = 0;
+	column->end = 0;
+}
+
+// hands every chunk back to the pool
+void sampleColumnFree (struct sampleColumn* column) {
+	uint32_t i;
+	for (i=0; i<column->chunkCount; i++)
+		sampleColumnChunkFree(column->chunks[i]);
+	free(column->chunks);
+	sampleColumnInit(column);
+}
+
+// returns non zero if memory ran out, in which case nothing was appended
+int sampleColumnAppend (struct sampleColumn* column, const float* data, uint32_t n) {
+	uint32_t needed = ((column->end + n + SAMPLE_COLUMN_CHUNK_MASK) >> SAMPLE_COLUMN_CHUNK_SHIFT) - (column->start >> SAMPLE_COLUMN_CHUNK_SHIFT);
+
+	// only the table of chunk pointers ever gets reallocated, and it's tiny
+	if (needed > column->chunkTableSize) {
+		uint32_t size = column->chunkTableSize ? column->chunkTableSize : INITIAL_CHUNK_TABLE_SIZE;
+		float** chunks;
+		while (size < needed)
+			size *= 2;
+		chunks = realloc(column->chunks, sizeof(float*)*size);
+		if (chunks == NULL) {
+			perror("\n***** SAMPLE COLUMN ERROR: realloc failed\n\n");
+			return -1;
+		}
+		column->chunks = chunks;
+		column->chunkTableSize = size;
+	}
+
+	while (column->chunkCount < needed) {
+		float* chunk = sampleColumnChunkAlloc();
+		if (chunk == NULL) {
+			perror("\n***** SAMPLE COLUMN ERROR: malloc failed\n\n");
+			return -1;
+		}
+		column->chunks[column->chunkCount++] = chunk;
+	}
+
+	while (n > 0) {
+		uint32_t offset = column->end & SAMPLE_COLUMN_CHUNK_MASK;
+		uint32_t length = SAMPLE_COLUMN_CHUNK_LENGTH - offset;
+		if (length > n)
+			length = n;
+		memcpy(&sampleColumnAt(column, column->end), data, sizeof(float)*length);
+		column->end += length;
+		data += length;
+		n -= length;
+	}
+
+	return 0;
+}
+
+// forget every sample before index.  chunks are only given back once all of
+// their samples have gone
+void sampleColumnDiscard (struct sampleColumn* column, uint32_t index) {
+	uint32_t drop;
+
+	if (index <= column->start)
+		return;
+	if (index > column->end)
+		index = column->end;
+
+	drop = (index >> SAMPLE_COLUMN_CHUNK_SHIFT) - (column->start >> SAMPLE_COLUMN_CHUNK_SHIFT);
+	if (drop > column->chunkCount)
+		drop = column->chunkCount;
+	if (drop > 0) {
+		uint32_t i;
+		for (i=0; i<drop; i++)
+			sampleColumnChunkFree(column->chunks[i]);
+		memmove(column->chunks, column->chunks + drop, sizeof(float*)*(column->chunkCount - drop));
+		column->chunkCount -= drop;
+	}
+
+	column->start = index;
+}
+
+// first held index whose sample is >= value.  the column must be in ascending order
+uint32_t sampleColumnFind (const struct sampleColumn* column, float value) {
+	uint32_t lo = column->start, hi = column->end, mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo)/2;
+		if (sampleColumnAt(column, mid) < value)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+static float* sampleColumnChunkAlloc (void) {
+	float* chunk;
+
+	if (chunkPool == NULL)
+		return malloc(sizeof(float)*SAMPLE_COLUMN_CHUNK_LENGTH);
+
+	chunk = (float*) chunkPool;
+	chunkPool = *(void**) chunkPool;
+	return chunk;
+}
+
+static void sampleColumnChunkFree (float* chunk) {
+	*(void**) chunk = chunkPool;
+	chunkPool = chunk;
+}
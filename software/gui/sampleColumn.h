@@ -0,0 +1,40 @@
+#ifndef __SAMPLE_COLUMN_H__
+#define __SAMPLE_COLUMN_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+// a growable column of floats stored as fixed size chunks.  chunks come from a
+// pool and never move, so growing never copies samples and old chunks can be
+// handed back when only the most recent data is wanted.  samples keep the
+// index they were appended with for as long as they are held, held samples are
+// start .. end-1.  not thread safe, the pool is shared by every column.
+
+#define SAMPLE_COLUMN_CHUNK_SHIFT 16 // 64k samples (256kB) per chunk
+#define SAMPLE_COLUMN_CHUNK_LENGTH (1 << SAMPLE_COLUMN_CHUNK_SHIFT)
+#define SAMPLE_COLUMN_CHUNK_MASK (SAMPLE_COLUMN_CHUNK_LENGTH-1)
+
+struct sampleColumn {
+	float** chunks;         // chunks[i] holds samples from (start >> SHIFT) + i chunks in
+	uint32_t chunkCount;
+	uint32_t chunkTableSize;
+	uint32_t start;         // oldest sample still held
+	uint32_t end;           // one past the newest sample
+};
+
+#define sampleColumnAt(column, index) ((column)->chunks[((index) >> SAMPLE_COLUMN_CHUNK_SHIFT) - ((column)->start >> SAMPLE_COLUMN_CHUNK_SHIFT)][(index) & SAMPLE_COLUMN_CHUNK_MASK])
+
+void sampleColumnInit (struct sampleColumn* column);
+void sampleColumnFree (struct sampleColumn* column);
+int sampleColumnAppend (struct sampleColumn* column, const float* data, uint32_t n);
+void sampleColumnDiscard (struct sampleColumn* column, uint32_t index);
+uint32_t sampleColumnFind (const struct sampleColumn* column, float value);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __SAMPLE_COLUMN_H__ */
@@ -0,0 +1,216 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "serialIngest.h"
+#include "packets.h"
+
+static void* serialIngestThread (void* arg);
+static void serialIngestFrame (const uint8_t* frame, uint16_t length, void* userData);
+static void serialIngestBlock (const uint8_t* frame, uint16_t length, void* userData);
+static void serialIngestMux (const uint8_t* frame, uint16_t length, void* userData);
+static void serialIngestStamp (struct serialIngest* ingest, struct telemetrySample* sample);
+
+double serialIngestNow (void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+// takes over fd (from initUART) and starts the thread.  link is how the other
+// end sends its frames of frameLength.  returns 0 on success
+int serialIngestStart (struct serialIngest* ingest, int fd, uint16_t frameLength, frameDecoderSettings settings, serialIngestLink link, uint32_t queueLength) {
+
+	if (frameLength > SERIAL_INGEST_MAX_FRAME_LENGTH) {
+		fprintf(stderr, "\n***** SERIAL INGEST ERROR: frame length %d is too long\n\n", frameLength);
+		return -1;
+	}
+
+	ingest->fd = fd;
+	ingest->readTime = 0;
+	ingest->link = link;
+	ingest->frameLength = frameLength;
+	ingest->firstRxTime = -1;
+	ingest->stampOffset = 0;
+	if (link == SERIAL_INGEST_MUX)
+		ingest->stampOffset = offsetof(struct telemetry_pkt_t, sequence);
+	else if (frameLength == FCU_PACKET_LENGTH)
+		ingest->stampOffset = offsetof(struct fcu_pkt_t, sequence);
+	linkMonitorInit(&ingest->monitor);
+	if (link == SERIAL_INGEST_CODED) {
+		frameDecoderInit(&ingest->decoder, TELEMETRY_MAX_FRAME_LENGTH, settings | FRAME_DECODER_VARIABLE_LENGTH, serialIngestBlock, ingest);
+		ingest->decoder.startByte = TELEMETRY_START_BYTE;
+		telemetryDecoderInit(&ingest->telemetry, (frameLength - 2)/2);
+	} else if (link == SERIAL_INGEST_MUX) {
+		if (frameLength != TELEMETRY_PACKET_LENGTH) {
+			fprintf(stderr, "\n***** SERIAL INGEST ERROR: a mux link hands on %d byte frames, not %d\n\n", TELEMETRY_PACKET_LENGTH, frameLength);
+			return -1;
+		}
+		frameDecoderInit(&ingest->decoder, TELEMETRY_MUX_MAX_FRAME_LENGTH, settings | FRAME_DECODER_VARIABLE_LENGTH, serialIngestMux, ingest);
+		ingest->decoder.startByte = TELEMETRY_MUX_START_BYTE;
+		telemetryMuxDecoderInit(&ingest->mux);
+		memset(ingest->muxState, 0, sizeof(ingest->muxState));
+	} else
+		frameDecoderInit(&ingest->decoder, frameLength, settings, serialIngestFrame, ingest);
+	if (spscQueueInit(&ingest->queue, sizeof(struct telemetrySample), queueLength))
+		return -1;
+	pthread_mutex_init(&ingest->monitorLock, NULL);
+
+	ingest->running = 1;
+	if (pthread_create(&ingest->thread, NULL, serialIngestThread, ingest)) {
+		perror("\n***** SERIAL INGEST ERROR: pthread_create failed\n\n");
+		ingest->running = 0;
+		pthread_mutex_destroy(&ingest->monitorLock);
+		spscQueueFree(&ingest->queue);
+		return -1;
+	}
+
+	return 0;
+}
+
+// stops and joins the thread.  the fd stays open, it still belongs to whoever opened it
+void serialIngestStop (struct serialIngest* ingest) {
+	if (!ingest->running)
+		return;
+	ingest->running = 0;
+	pthread_join(ingest->thread, NULL);
+	pthread_mutex_destroy(&ingest->monitorLock);
+	spscQueueFree(&ingest->queue);
+}
+
+// a copy of the link counts as they are now, safe from any thread while running
+void serialIngestLinkStats (struct serialIngest* ingest, struct linkMonitorStats* stats) {
+	pthread_mutex_lock(&ingest->monitorLock);
+	*stats = ingest->monitor.stats;
+	pthread_mutex_unlock(&ingest->monitorLock);
+}
+
+// a command line for the FCU ("rate_gyro 100"), it runs them when it sees the \r.
+// any thread can call this, the ingest thread only ever reads.  returns 0 on success
+int serialIngestSend (struct serialIngest* ingest, const char* command) {
+	size_t length = strlen(command);
+	if (write(ingest->fd, command, length) != (ssize_t) length || write(ingest->fd, "\r", 1) != 1) {
+		perror("\n***** SERIAL INGEST ERROR: write failed\n\n");
+		return -1;
+	}
+	return 0;
+}
+
+// gui side.  pull up to maxSamples waiting samples out in one go
+uint32_t serialIngestDrain (struct serialIngest* ingest, struct telemetrySample* samples, uint32_t maxSamples) {
+	return spscQueuePopBatch(&ingest->queue, samples, maxSamples);
+}
+
+static void* serialIngestThread (void* arg) {
+	struct serialIngest* ingest = (struct serialIngest*) arg;
+	struct pollfd pfd;
+
+	pfd.fd = ingest->fd;
+	pfd.events = POLLIN;
+
+	while (ingest->running) {
+		int ready = poll(&pfd, 1, SERIAL_INGEST_POLL_MS);
+		if (ready < 0) {
+			if (errno == EINTR)
+				continue;
+			perror("\n***** SERIAL INGEST ERROR: poll failed\n\n");
+			break;
+		}
+		if (ready == 0)
+			continue;
+		if (pfd.revents & (POLLERR | POLLHUP | POLLNVAL)) {
+			fprintf(stderr, "\n***** SERIAL INGEST ERROR: serial port closed\n\n");
+			break;
+		}
+
+		ingest->readTime = serialIngestNow();
+		if (frameDecoderRead(&ingest->decoder, ingest->fd) < 0) {
+			perror("\n***** SERIAL INGEST ERROR: read failed\n\n");
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+// decoder callback, runs on the ingest thread
+static void serialIngestFrame (const uint8_t* frame, uint16_t length, void* userData) {
+	struct serialIngest* ingest = (struct serialIngest*) userData;
+	struct telemetrySample sample;
+
+	sample.rxTime = ingest->readTime;
+	sample.length = length;
+	memcpy(sample.frame, frame, length);
+	serialIngestStamp(ingest, &sample);
+
+	spscQueuePush(&ingest->queue, &sample); // a full queue counts an overrun and drops the sample
+}
+
+// decoder callback for a coded link.  every sample in the block goes on as the
+// frame the FCU would have sent uncoded, all with the block's receive time
+static void serialIngestBlock (const uint8_t* frame, uint16_t length, void* userData) {
+	struct serialIngest* ingest = (struct serialIngest*) userData;
+	int16_t samples[TELEMETRY_BLOCK_SAMPLES][TELEMETRY_MAX_FIELDS];
+	struct telemetrySample sample;
+	int count, i, f;
+
+	count = telemetryDecode(&ingest->telemetry, frame, length, samples);
+	for (i=0; i<count; i++) {
+		sample.rxTime = ingest->readTime;
+		sample.length = ingest->frameLength;
+		sample.frame[0] = FRAME_DECODER_START_BYTE;
+		for (f=0; f<ingest->telemetry.fields; f++) {
+			sample.frame[2 + 2*f] = (uint16_t) samples[i][f] & 0xFF;
+			sample.frame[3 + 2*f] = (uint16_t) samples[i][f] >> 8;
+		}
+		sample.frame[1] = frameDecoderParity(sample.frame, sample.length);
+		serialIngestStamp(ingest, &sample);
+		spscQueuePush(&ingest->queue, &sample);
+	}
+}
+
+// decoder callback for a mux link.  the frame's records update the held state
+// and the whole of it goes on, so a channel that wasn't in this frame repeats
+// its last value, with a bit for each one that was.  the stamps come from the
+// mux frame's header
+static void serialIngestMux (const uint8_t* frame, uint16_t length, void* userData) {
+	struct serialIngest* ingest = (struct serialIngest*) userData;
+	struct telemetrySample sample;
+	int f;
+
+	if (telemetryMuxDecode(&ingest->mux, frame, length, ingest->muxState) <= 0)
+		return;
+	sample.rxTime = ingest->readTime;
+	sample.length = ingest->frameLength;
+	sample.frame[0] = FRAME_DECODER_START_BYTE;
+	for (f=0; f<TELEMETRY_MUX_FIELDS; f++) {
+		sample.frame[2 + 2*f] = (uint16_t) ingest->muxState[f] & 0xFF;
+		sample.frame[3 + 2*f] = (uint16_t) ingest->muxState[f] >> 8;
+	}
+	sample.frame[offsetof(struct telemetry_pkt_t, channels)] = ingest->mux.updated & 0xFF;
+	sample.frame[offsetof(struct telemetry_pkt_t, channels) + 1] = (ingest->mux.updated >> 8) & 0xFF;
+	memcpy(sample.frame + ingest->stampOffset, frame + 3, 4); // sequence and tick, both little endian
+	sample.frame[1] = frameDecoderParity(sample.frame, sample.length);
+	serialIngestStamp(ingest, &sample);
+	spscQueuePush(&ingest->queue, &sample);
+}
+
+// the sample's time on the FCU's clock, and the link counts, from its stamps
+static void serialIngestStamp (struct serialIngest* ingest, struct telemetrySample* sample) {
+	if (ingest->firstRxTime < 0)
+		ingest->firstRxTime = sample->rxTime;
+	if (ingest->stampOffset == 0) {
+		sample->sampleTime = sample->rxTime - ingest->firstRxTime;
+		return;
+	}
+	pthread_mutex_lock(&ingest->monitorLock);
+	sample->sampleTime = linkMonitorFrame(&ingest->monitor, (uint16_t) packetGetInt16(sample->frame + ingest->stampOffset),
+		(uint16_t) packetGetInt16(sample->frame + ingest->stampOffset + 2), sample->rxTime);
+	pthread_mutex_unlock(&ingest->monitorLock);
+}
@@ -0,0 +1,75 @@
+#ifndef __SERIAL_INGEST_H__
+#define __SERIAL_INGEST_H__
+
+#include <stdint.h>
+#include <pthread.h>
+
+#include "frameDecoder.h"
+#include "spscQueue.h"
+#include "telemetryCodec.h"
+#include "telemetryMux.h"
+#include "linkMonitor.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+// a thread that owns the serial port.  it sleeps in poll() until bytes arrive,
+// runs them through the frame decoder and pushes every good frame, stamped with
+// the time it came in, onto a lock-free queue.  the gui drains the queue in
+// batches at its own display rate so a slow redraw never costs us bytes.
+// a coded link (telemetryCodec.h) is expanded back into ordinary frames here,
+// so nothing downstream knows the difference.  a multiplexed one
+// (telemetryMux.h) becomes a telemetry_pkt_t holding the latest of every
+// channel, one for each frame that comes in.  frames that carry a sequence
+// number and FCU tick go through a link monitor, which times them on the
+// FCU's clock and keeps the loss, jitter and latency counts.
+
+#define SERIAL_INGEST_MAX_FRAME_LENGTH 64
+#define SERIAL_INGEST_POLL_MS 100 // how often the thread checks it should stop
+
+typedef enum
+{
+SERIAL_INGEST_RAW,   // whole frames, frameLength long
+SERIAL_INGEST_CODED, // telemetry codec blocks of frameLength frames
+SERIAL_INGEST_MUX,   // telemetry mux frames, frameLength is TELEMETRY_PACKET_LENGTH
+}serialIngestLink;
+
+struct telemetrySample {
+	double rxTime;     // CLOCK_MONOTONIC seconds when the read that finished the frame returned
+	double sampleTime; // seconds since the link came up on the FCU's clock, lost frames leave gaps
+	uint16_t length;
+	uint8_t frame[SERIAL_INGEST_MAX_FRAME_LENGTH];
+};
+
+struct serialIngest {
+	int fd;
+	pthread_t thread;
+	volatile int running;
+	double readTime; // time stamp for frames out of the current read
+
+	struct frameDecoder decoder; // only touched by the ingest thread once started
+	serialIngestLink link;
+	uint16_t frameLength;        // of the frames handed on
+	struct telemetryDecoder telemetry;
+	struct telemetryMuxDecoder mux;
+	int16_t muxState[TELEMETRY_MUX_FIELDS]; // latest of every channel
+	uint16_t stampOffset;        // where the sequence and tick are in a frame handed on, 0 if it has none
+	double firstRxTime;          // without stamps, sample times count from here
+	pthread_mutex_t monitorLock; // the gui reads the counts while the thread updates them
+	struct linkMonitor monitor;
+	struct spscQueue queue;      // ingest thread produces, gui consumes
+};
+
+int serialIngestStart (struct serialIngest* ingest, int fd, uint16_t frameLength, frameDecoderSettings settings, serialIngestLink link, uint32_t queueLength);
+void serialIngestStop (struct serialIngest* ingest);
+int serialIngestSend (struct serialIngest* ingest, const char* command);
+void serialIngestLinkStats (struct serialIngest* ingest, struct linkMonitorStats* stats);
+uint32_t serialIngestDrain (struct serialIngest* ingest, struct telemetrySample* samples, uint32_t maxSamples);
+double serialIngestNow (void);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __SERIAL_INGEST_H__ */
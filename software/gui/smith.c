@@ -152,11 +152,11 @@ g_return_if_fail (GTK_IS_GRAPH (graph));
 g_return_if_fail (GTK_WIDGET_REALIZED (graph));
 g_return_if_fail (graph->graph_type == SMITH);
 	
-tmp = graph->traces;
 for (n = 0 ; n < graph->num_traces ; n++)
 	{
-	/* Make sure that there is some data in the trace */
-	if (tmp->Xdata == NULL || tmp->Ydata == NULL) 
+	tmp = graph->traces[n];
+	/* Make sure that there is some data in the trace (chunked data is XY only) */
+	if (tmp->Xdata == NULL || tmp->Ydata == NULL || tmp->num_points == 0) 
 		continue;
 
 	/* Assign the storage for the co-ordinates of each data point */
@@ -193,22 +193,21 @@ for (n = 0 ; n < graph->num_traces ; n++)
 			}
 
 	g_free(pts);// Free up all storage after use 
-	tmp = tmp->next;// and then move onto the next trace 
 	
 	}
 	
 }
 
-/**
- * gtk_graph_smith_set_Z0:
+/**
+ * gtk_graph_smith_set_Z0:
  * @graph:  the #GtkGraph containing the Smith Chart to be modified
  * @Z0: the unique identifier of the trace
- *
+ *
  * Sets the normalising value for Smith's Charts.  All Smith's Charts
  * are normalised to a particular value - A #GtkGraph defaults to a
  * normalisation of 50 Ohms.  This function allows the user to select
  * any @Z0 that they choose
- * 
+ * 
  */
 void gtk_graph_smith_set_Z0(GtkGraph *graph, gfloat Z0)
 {
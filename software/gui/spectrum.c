@@ -0,0 +1,188 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "spectrum.h"
+
+#define PI 3.14159265358979
+
+static void spectrumSegment (struct spectrum* s);
+static void spectrumFft (struct spectrum* s);
+
+// hop is usually size/2, averages how many segments the estimate is over.  -1 if
+// size isn't a power of two (at least 4) or the rest doesn't make sense
+int spectrumInit (struct spectrum* s, uint32_t size, uint32_t hop, float sampleRate, uint32_t averages) {
+	uint32_t half = size/2, bits = 0, i, j;
+	double power = 0;
+
+	if (size < 4 || size > SPECTRUM_MAX_SIZE || (size & (size - 1)) || hop == 0 || hop > size || sampleRate <= 0 || averages == 0) {
+		perror("\n***** SPECTRUM ERROR: Bad segment size, hop, rate or average count\n\n");
+		return -1;
+	}
+
+	s->size = size;
+	s->hop = hop;
+	s->averages = averages;
+	s->sampleRate = sampleRate;
+	s->window = malloc(sizeof(float)*size);
+	s->history = calloc(size, sizeof(float));
+	s->psd = calloc(half + 1, sizeof(float));
+	s->re = malloc(sizeof(float)*half);
+	s->im = malloc(sizeof(float)*half);
+	s->cosTable = malloc(sizeof(float)*half);
+	s->sinTable = malloc(sizeof(float)*half);
+	s->reverse = malloc(sizeof(uint32_t)*half);
+	s->head = 0;
+	s->filled = 0;
+	s->due = size;
+	s->segments = 0;
+
+	// periodic hann, the right one for overlapped segments
+	for (i=0; i<size; i++) {
+		s->window[i] = 0.5 - 0.5*cos(2*PI*i/size);
+		power += s->window[i]*s->window[i];
+	}
+	s->scale = 1.0/(sampleRate*power);
+
+	for (i=0; i<half; i++) {
+		s->cosTable[i] = cos(2*PI*i/size);
+		s->sinTable[i] = sin(2*PI*i/size);
+	}
+	while ((1u << bits) < half)
+		bits++;
+	for (i=0; i<half; i++) {
+		s->reverse[i] = 0;
+		for (j=0; j<bits; j++)
+			if (i & (1u << j))
+				s->reverse[i] |= 1u << (bits - 1 - j);
+	}
+	return 0;
+}
+
+void spectrumFree (struct spectrum* s) {
+	free(s->window);
+	free(s->history);
+	free(s->psd);
+	free(s->re);
+	free(s->im);
+	free(s->cosTable);
+	free(s->sinTable);
+	free(s->reverse);
+	s->window = s->history = s->psd = s->re = s->im = s->cosTable = s->sinTable = NULL;
+	s->reverse = NULL;
+}
+
+// feed n more samples.  returns how many segments that finished, the estimate
+// in psd only changes when it isn't 0
+uint32_t spectrumAdd (struct spectrum* s, const float* x, uint32_t n) {
+	uint32_t i, segments = 0;
+
+	for (i=0; i<n; i++) {
+		s->history[s->head] = x[i];
+		s->head = (s->head + 1) & (s->size - 1);
+		if (s->filled < s->size)
+			s->filled++;
+		if (--s->due == 0) {
+			spectrumSegment(s);
+			s->due = s->hop;
+			segments++;
+		}
+	}
+	return segments;
+}
+
+// the samples turn out to be 1/sampleRate apart, not what the spectrum was
+// made with.  the bins stay the same ones at new frequencies and the estimate
+// so far is rescaled to the new bin width rather than thrown away
+void spectrumSetRate (struct spectrum* s, float sampleRate) {
+	uint32_t bin;
+
+	if (sampleRate <= 0)
+		return;
+	for (bin=0; bin<=s->size/2; bin++)
+		s->psd[bin] *= s->sampleRate/sampleRate;
+	s->scale *= s->sampleRate/sampleRate;
+	s->sampleRate = sampleRate;
+}
+
+// centre of a psd bin in Hz
+float spectrumFrequency (const struct spectrum* s, uint32_t bin) {
+	return bin*s->sampleRate/s->size;
+}
+
+// transform the last size samples and average them into psd
+static void spectrumSegment (struct spectrum* s) {
+	uint32_t half = s->size/2, i, k, from;
+	float mean = 0, weight, zr, zi, cr, ci, er, ei, or, oi, xr, xi, power;
+
+	// oldest first, less the mean so a sensor's offset doesn't leak over the low bins
+	for (i=0; i<s->size; i++)
+		mean += s->history[i];
+	mean /= s->size;
+	from = s->head;
+	for (i=0; i<half; i++) {
+		s->re[i] = (s->history[(from + 2*i) & (s->size - 1)] - mean)*s->window[2*i];
+		s->im[i] = (s->history[(from + 2*i + 1) & (s->size - 1)] - mean)*s->window[2*i + 1];
+	}
+	spectrumFft(s);
+
+	s->segments++;
+	weight = 1.0/(s->segments < s->averages ? s->segments : s->averages);
+
+	// bins 0 and size/2 are real and come out of the first complex bin together
+	power = (s->re[0] + s->im[0])*(s->re[0] + s->im[0])*s->scale;
+	s->psd[0] += weight*(power - s->psd[0]);
+	power = (s->re[0] - s->im[0])*(s->re[0] - s->im[0])*s->scale;
+	s->psd[half] += weight*(power - s->psd[half]);
+
+	// the rest are the even and odd samples' spectra put back together,
+	// doubled for the negative frequencies a one sided density leaves out
+	for (k=1; k<half; k++) {
+		zr = s->re[k];
+		zi = s->im[k];
+		cr = s->re[half - k];
+		ci = -s->im[half - k];
+		er = (zr + cr)/2;
+		ei = (zi + ci)/2;
+		or = (zi - ci)/2;
+		oi = -(zr - cr)/2;
+		xr = er + or*s->cosTable[k] + oi*s->sinTable[k];
+		xi = ei + oi*s->cosTable[k] - or*s->sinTable[k];
+		power = 2*(xr*xr + xi*xi)*s->scale;
+		s->psd[k] += weight*(power - s->psd[k]);
+	}
+}
+
+// in place radix 2 complex fft of re/im, size/2 points.  the twiddles for
+// length len are every size/len'th entry of the tables
+static void spectrumFft (struct spectrum* s) {
+	uint32_t half = s->size/2, len, i, j, k, step;
+	float tr, ti, c, sn;
+
+	for (i=0; i<half; i++) {
+		j = s->reverse[i];
+		if (j > i) {
+			tr = s->re[i]; s->re[i] = s->re[j]; s->re[j] = tr;
+			ti = s->im[i]; s->im[i] = s->im[j]; s->im[j] = ti;
+		}
+	}
+
+	for (len=2; len<=half; len<<=1) {
+		step = s->size/len;
+		for (i=0; i<half; i+=len) {
+			for (j=0; j<len/2; j++) {
+				k = i + j + len/2;
+				c = s->cosTable[j*step];
+				sn = s->sinTable[j*step];
+				tr = s->re[k]*c + s->im[k]*sn;
+				ti = s->im[k]*c - s->re[k]*sn;
+				s->re[k] = s->re[i + j] - tr;
+				s->im[k] = s->im[i + j] - ti;
+				s->re[i + j] += tr;
+				s->im[i + j] += ti;
+			}
+		}
+	}
+}
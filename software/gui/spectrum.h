@@ -0,0 +1,55 @@
+#ifndef __SPECTRUM_H__
+#define __SPECTRUM_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+// power spectral density of a live signal, welch's way: every hop samples the
+// last size samples are detrended, hann windowed and put through a real fft,
+// and the segment's power is averaged into the estimate.  nothing is kept
+// beyond the last segment so the cost per sample doesn't grow with history,
+// a 256 point transform every 128 samples is a few microseconds.
+// the average is a plain mean of the first averages segments and an
+// exponential one after that, older segments fade out rather than drop off.
+// no GTK in here, dyGraph draws it
+
+#define SPECTRUM_MAX_SIZE 8192
+
+struct spectrum {
+	uint32_t size;      // samples per segment, a power of two
+	uint32_t hop;       // samples between segments, size/2 is the usual 50% overlap
+	uint32_t averages;  // segments in the average
+	float sampleRate;   // Hz
+
+	float* window;      // hann
+	float scale;        // segment power to one sided density, 1 / (sampleRate * sum of window squared)
+	float* history;     // the last size samples, a ring
+	uint32_t head;      // where the next sample goes
+	uint32_t filled;    // samples in history, up to size
+	uint32_t due;       // samples until the next segment
+
+	float* psd;         // size/2 + 1 bins from 0 to sampleRate/2, units^2/Hz
+	uint32_t segments;  // transformed so far
+
+	// the real fft is a complex one of size/2 points and a pass to untangle it
+	float* re;
+	float* im;
+	float* cosTable;    // cos and sin of 2 pi k / size, k < size/2
+	float* sinTable;
+	uint32_t* reverse;  // bit reversal of the size/2 indices
+};
+
+int spectrumInit (struct spectrum* s, uint32_t size, uint32_t hop, float sampleRate, uint32_t averages);
+void spectrumFree (struct spectrum* s);
+uint32_t spectrumAdd (struct spectrum* s, const float* x, uint32_t n);
+void spectrumSetRate (struct spectrum* s, float sampleRate);
+float spectrumFrequency (const struct spectrum* s, uint32_t bin);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __SPECTRUM_H__ */
@@ -0,0 +1,81 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "spscQueue.h"
+
+// capacity is rounded up to a power of 2.  returns 0 on success
+int spscQueueInit (struct spscQueue* queue, uint32_t elementSize, uint32_t capacity) {
+	uint32_t size = 1;
+	while (size < capacity)
+		size <<= 1;
+
+	queue->buffer = malloc((size_t)elementSize*size);
+	if (queue->buffer == NULL) {
+		perror("\n***** SPSC QUEUE ERROR: malloc failed\n\n");
+		return -1;
+	}
+
+	queue->elementSize = elementSize;
+	queue->capacity = size;
+	queue->mask = size-1;
+	queue->head = 0;
+	queue->tail = 0;
+	queue->highWater = 0;
+	queue->overruns = 0;
+	return 0;
+}
+
+void spscQueueFree (struct spscQueue* queue) {
+	free(queue->buffer);
+	queue->buffer = NULL;
+}
+
+// producer only.  returns 1 if queued, 0 if the queue was full and the element was dropped
+int spscQueuePush (struct spscQueue* queue, const void* element) {
+	uint32_t head = queue->head;
+	uint32_t used = head - queue->tail;
+
+	if (used >= queue->capacity) {
+		queue->overruns++;
+		return 0;
+	}
+
+	memcpy(queue->buffer + (size_t)(head & queue->mask)*queue->elementSize, element, queue->elementSize);
+	__sync_synchronize(); // element must be visible before the new head
+	queue->head = head+1;
+
+	if (used+1 > queue->highWater)
+		queue->highWater = used+1;
+	return 1;
+}
+
+// consumer only.  returns 1 if an element was copied out, 0 if empty
+int spscQueuePop (struct spscQueue* queue, void* element) {
+	return spscQueuePopBatch(queue, element, 1);
+}
+
+// consumer only.  copies out up to maxElements in one go and returns how many
+uint32_t spscQueuePopBatch (struct spscQueue* queue, void* elements, uint32_t maxElements) {
+	uint32_t tail = queue->tail;
+	uint32_t available = queue->head - tail;
+	uint32_t n, i;
+
+	if (available == 0)
+		return 0;
+	__sync_synchronize(); // don't read elements before we've seen head
+
+	n = (available < maxElements) ? available : maxElements;
+	for (i=0; i<n; i++)
+		memcpy((uint8_t*)elements + (size_t)i*queue->elementSize, queue->buffer + (size_t)((tail+i) & queue->mask)*queue->elementSize, queue->elementSize);
+
+	__sync_synchronize(); // finish reading before the producer may overwrite the slots
+	queue->tail = tail+n;
+	return n;
+}
+
+// approximate when called from the side that doesn't own the index being changed
+uint32_t spscQueueCount (struct spscQueue* queue) {
+	return queue->head - queue->tail;
+}
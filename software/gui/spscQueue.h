@@ -0,0 +1,44 @@
+#ifndef __SPSC_QUEUE_H__
+#define __SPSC_QUEUE_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+// lock-free single producer / single consumer ring of fixed size elements.
+// exactly one thread may push and exactly one thread may pop.  head is only
+// written by the producer and tail only by the consumer, so no locks are
+// needed, just barriers around publishing an index.
+
+#define SPSC_QUEUE_CACHE_LINE 64
+
+struct spscQueue {
+	uint8_t* buffer;
+	uint32_t elementSize;
+	uint32_t capacity; // power of 2
+	uint32_t mask;
+
+	char padHead[SPSC_QUEUE_CACHE_LINE];
+	volatile uint32_t head; // producer side
+	uint32_t highWater;     // most elements ever waiting, producer side
+	uint32_t overruns;      // elements thrown away because the queue was full, producer side
+
+	char padTail[SPSC_QUEUE_CACHE_LINE];
+	volatile uint32_t tail; // consumer side
+	char padEnd[SPSC_QUEUE_CACHE_LINE];
+};
+
+int spscQueueInit (struct spscQueue* queue, uint32_t elementSize, uint32_t capacity);
+void spscQueueFree (struct spscQueue* queue);
+int spscQueuePush (struct spscQueue* queue, const void* element);
+int spscQueuePop (struct spscQueue* queue, void* element);
+uint32_t spscQueuePopBatch (struct spscQueue* queue, void* elements, uint32_t maxElements);
+uint32_t spscQueueCount (struct spscQueue* queue);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __SPSC_QUEUE_H__ */
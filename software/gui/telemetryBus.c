@@ -0,0 +1,243 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "telemetryBus.h"
+
+static int telemetryBusStale (const char* name);
+
+// makes the bus and publishes from this process.  a bus left behind by a
+// publisher that died is cleared away, one whose publisher is still running
+// or still setting it up isn't.  slotCount is rounded up to a power of 2.  returns 0 on success
+int telemetryBusCreate (struct telemetryBus* bus, const char* name, packetType packet, uint16_t frameLength, uint32_t slotCount) {
+	struct telemetryBusHeader* header;
+	uint32_t slots = 1;
+
+	while (slots < slotCount)
+		slots <<= 1;
+
+	strncpy(bus->name, name, sizeof(bus->name)-1);
+	bus->name[sizeof(bus->name)-1] = '\0';
+	bus->size = sizeof(struct telemetryBusHeader) + (size_t)slots*sizeof(struct telemetryBusSlot);
+
+	bus->fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+	if (bus->fd < 0 && errno == EEXIST && telemetryBusStale(name)) {
+		shm_unlink(name);
+		bus->fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+	}
+	if (bus->fd < 0) {
+		if (errno == EEXIST)
+			fprintf(stderr, "\n***** TELEMETRY BUS ERROR: %s already has a publisher, or one is starting up\n\n", name);
+		else
+			perror("\n***** TELEMETRY BUS ERROR: shm_open failed\n\n");
+		return -1;
+	}
+
+	if (ftruncate(bus->fd, bus->size)) {
+		perror("\n***** TELEMETRY BUS ERROR: ftruncate failed\n\n");
+		goto fail;
+	}
+	header = mmap(NULL, bus->size, PROT_READ | PROT_WRITE, MAP_SHARED, bus->fd, 0);
+	if (header == MAP_FAILED) {
+		perror("\n***** TELEMETRY BUS ERROR: mmap failed\n\n");
+		goto fail;
+	}
+
+	// the memory comes zeroed, so every slot's stamp already says empty
+	header->version = TELEMETRY_BUS_VERSION;
+	header->slotSize = sizeof(struct telemetryBusSlot);
+	header->slotCount = slots;
+	header->mask = slots-1;
+	header->packet = packet;
+	header->frameLength = frameLength;
+	header->publisher = getpid();
+	__sync_synchronize(); // a reader that sees the magic sees all of the above
+	header->magic = TELEMETRY_BUS_MAGIC;
+
+	bus->header = header;
+	return 0;
+
+fail:
+	close(bus->fd);
+	shm_unlink(name);
+	return -1;
+}
+
+// publisher only.  n samples onto the ring, the oldest go if it's full
+void telemetryBusPublish (struct telemetryBus* bus, const struct telemetrySample* samples, uint32_t n) {
+	struct telemetryBusHeader* header = bus->header;
+	uint64_t head = header->head;
+	uint32_t i;
+
+	for (i=0; i<n; i++) {
+		struct telemetryBusSlot* slot = &header->slots[(head+i) & header->mask];
+		slot->stamp = 0;
+		__sync_synchronize(); // a reader sees the slot's being written before any of it changes
+		memcpy(&slot->sample, &samples[i], sizeof(struct telemetrySample));
+		__sync_synchronize(); // and all of it before the new stamp
+		slot->stamp = head+i+1;
+	}
+	__sync_synchronize();
+	header->head = head+n;
+}
+
+// publisher only.  the link counts readers see
+void telemetryBusPublishLink (struct telemetryBus* bus, const struct linkMonitorStats* stats) {
+	struct telemetryBusHeader* header = bus->header;
+
+	header->linkStamp++;
+	__sync_synchronize();
+	memcpy(&header->link, stats, sizeof(struct linkMonitorStats));
+	__sync_synchronize();
+	header->linkStamp++;
+}
+
+// tells readers nothing more is coming and takes the name away.  readers
+// still attached keep their mapping until they detach
+void telemetryBusDestroy (struct telemetryBus* bus) {
+	bus->header->closed = 1;
+	munmap(bus->header, bus->size);
+	close(bus->fd);
+	shm_unlink(bus->name);
+}
+
+// follows the bus from the newest sample on.  returns 0 on success
+int telemetryBusAttach (struct telemetryBusReader* reader, const char* name) {
+	const struct telemetryBusHeader* header;
+	struct stat info;
+
+	reader->fd = shm_open(name, O_RDONLY, 0);
+	if (reader->fd < 0) {
+		perror("\n***** TELEMETRY BUS ERROR: shm_open failed, is ingestd running?\n\n");
+		return -1;
+	}
+	if (fstat(reader->fd, &info) || (size_t) info.st_size < sizeof(struct telemetryBusHeader)) {
+		fprintf(stderr, "\n***** TELEMETRY BUS ERROR: %s isn't a telemetry bus\n\n", name);
+		close(reader->fd);
+		return -1;
+	}
+	reader->size = info.st_size;
+	header = mmap(NULL, reader->size, PROT_READ, MAP_SHARED, reader->fd, 0);
+	if (header == MAP_FAILED) {
+		perror("\n***** TELEMETRY BUS ERROR: mmap failed\n\n");
+		close(reader->fd);
+		return -1;
+	}
+
+	if (header->magic != TELEMETRY_BUS_MAGIC || header->version != TELEMETRY_BUS_VERSION ||
+		header->slotSize != sizeof(struct telemetryBusSlot) ||
+		reader->size < sizeof(struct telemetryBusHeader) + (size_t)header->slotCount*sizeof(struct telemetryBusSlot)) {
+		fprintf(stderr, "\n***** TELEMETRY BUS ERROR: %s is from a different build of ingestd\n\n", name);
+		munmap((void*) header, reader->size);
+		close(reader->fd);
+		return -1;
+	}
+	__sync_synchronize();
+
+	reader->header = header;
+	reader->cursor = header->head;
+	reader->lost = 0;
+	reader->overruns = 0;
+	return 0;
+}
+
+// copies out up to maxSamples, oldest first, and returns how many.  if the
+// publisher wrote over samples we hadn't read, lost and overruns say so
+uint32_t telemetryBusRead (struct telemetryBusReader* reader, struct telemetrySample* samples, uint32_t maxSamples) {
+	const struct telemetryBusHeader* header = reader->header;
+	uint64_t head = header->head, cursor;
+	uint32_t n = 0;
+
+	__sync_synchronize(); // don't look at slots before we've seen head
+
+	while (n < maxSamples && reader->cursor < head) {
+		const struct telemetryBusSlot* slot = &header->slots[reader->cursor & header->mask];
+		uint64_t stamp = slot->stamp;
+
+		__sync_synchronize();
+		if (stamp == reader->cursor+1) {
+			memcpy(&samples[n], (const void*) &slot->sample, sizeof(struct telemetrySample));
+			__sync_synchronize();
+			if (slot->stamp == stamp) {
+				reader->cursor++;
+				n++;
+				continue;
+			}
+		}
+
+		// written over.  start again an eighth of a ring clear of the publisher
+		// so we aren't caught again straight away
+		head = header->head;
+		__sync_synchronize();
+		cursor = head - header->slotCount + header->slotCount/8;
+		if (head < header->slotCount || cursor <= reader->cursor)
+			cursor = reader->cursor + 1; // it's mid batch and head hasn't caught up, this one's gone anyway
+		reader->lost += cursor - reader->cursor;
+		reader->overruns++;
+		reader->cursor = cursor;
+	}
+
+	return n;
+}
+
+// the link counts as the publisher last saw them
+void telemetryBusLinkStats (const struct telemetryBusReader* reader, struct linkMonitorStats* stats) {
+	const struct telemetryBusHeader* header = reader->header;
+	uint32_t stamp;
+
+	do {
+		stamp = header->linkStamp;
+		__sync_synchronize();
+		memcpy(stats, (const void*) &header->link, sizeof(struct linkMonitorStats));
+		__sync_synchronize();
+	} while ((stamp & 1) || stamp != header->linkStamp);
+}
+
+// 0 once the publisher has closed the bus or died without doing so
+int telemetryBusAlive (const struct telemetryBusReader* reader) {
+	if (reader->header->closed)
+		return 0;
+	return kill(reader->header->publisher, 0) == 0 || errno != ESRCH;
+}
+
+void telemetryBusDetach (struct telemetryBusReader* reader) {
+	munmap((void*) reader->header, reader->size);
+	close(reader->fd);
+}
+
+// left behind by a publisher that's no longer running.  only a whole bus
+// whose publisher is gone counts, one that's empty or has no magic yet may be
+// a publisher between shm_open and writing its header, so it's left alone.
+// quiet, a bus that isn't stale is reported by the caller
+static int telemetryBusStale (const char* name) {
+	const struct telemetryBusHeader* header;
+	struct stat info;
+	int fd, stale;
+
+	fd = shm_open(name, O_RDONLY, 0);
+	if (fd < 0)
+		return 0;
+	if (fstat(fd, &info) || (size_t) info.st_size < sizeof(struct telemetryBusHeader)) {
+		close(fd);
+		return 0;
+	}
+	header = mmap(NULL, sizeof(struct telemetryBusHeader), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (header == MAP_FAILED)
+		return 0;
+
+	stale = 0;
+	if (header->magic == TELEMETRY_BUS_MAGIC && header->version == TELEMETRY_BUS_VERSION) {
+		__sync_synchronize(); // the magic's there, so is the publisher
+		stale = (kill(header->publisher, 0) != 0 && errno == ESRCH);
+	}
+	munmap((void*) header, sizeof(struct telemetryBusHeader));
+	return stale;
+}
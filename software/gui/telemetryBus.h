@@ -0,0 +1,97 @@
+#ifndef __TELEMETRY_BUS_H__
+#define __TELEMETRY_BUS_H__
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "serialIngest.h"
+#include "linkMonitor.h"
+#include "packets.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+// live telemetry shared between processes.  one publisher (ingestd, which
+// owns the serial port) writes telemetrySamples into a ring in POSIX shared
+// memory and any number of readers (record, graph, anything else) follow it,
+// each with its own cursor.  readers map it read only and never write a thing,
+// so however many there are or however slow, the publisher never waits.
+//
+// the publisher doesn't wait for readers either: a reader that falls more
+// than a ring behind has lost what it missed.  it finds out when a slot it
+// wanted has been written over, jumps forward to the oldest sample that's
+// still safe and counts what it skipped.
+//
+// every slot has a stamp, the index of the sample in it plus one, or 0 while
+// the publisher is writing it.  a reader checks the stamp is the one it
+// expects before and after copying the slot out, so a torn copy is never
+// handed on.
+
+#define TELEMETRY_BUS_NAME "/falcon_telemetry"
+#define TELEMETRY_BUS_MAGIC 0x53554246       // "FBUS"
+#define TELEMETRY_BUS_VERSION 2
+#define TELEMETRY_BUS_SLOTS 16384            // 16 seconds of frames at 1kHz
+#define TELEMETRY_BUS_CACHE_LINE 64
+
+struct telemetryBusSlot {
+	volatile uint64_t stamp;
+	struct telemetrySample sample;
+};
+
+// what's in the shared memory.  everything above head is written once by
+// the publisher before anyone can attach
+struct telemetryBusHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t slotSize;       // sizeof(struct telemetryBusSlot) the publisher was built with
+	uint32_t slotCount;      // power of 2
+	uint32_t mask;
+	uint32_t packet;         // packetType of every frame on the bus
+	uint16_t frameLength;
+	pid_t publisher;
+	volatile uint32_t closed; // the publisher has gone, nothing more is coming
+
+	char padHead[TELEMETRY_BUS_CACHE_LINE];
+	volatile uint64_t head;   // samples ever published
+
+	char padLink[TELEMETRY_BUS_CACHE_LINE];
+	volatile uint32_t linkStamp; // odd while link is being written
+	struct linkMonitorStats link;
+
+	char padSlots[TELEMETRY_BUS_CACHE_LINE];
+	struct telemetryBusSlot slots[];
+};
+
+struct telemetryBus {
+	char name[64];
+	int fd;
+	size_t size;
+	struct telemetryBusHeader* header;
+};
+
+struct telemetryBusReader {
+	int fd;
+	size_t size;
+	const struct telemetryBusHeader* header;
+	uint64_t cursor;     // the next sample to read
+	uint64_t lost;       // samples written over before we got to them
+	uint32_t overruns;   // times we fell behind
+};
+
+int telemetryBusCreate (struct telemetryBus* bus, const char* name, packetType packet, uint16_t frameLength, uint32_t slotCount);
+void telemetryBusPublish (struct telemetryBus* bus, const struct telemetrySample* samples, uint32_t n);
+void telemetryBusPublishLink (struct telemetryBus* bus, const struct linkMonitorStats* stats);
+void telemetryBusDestroy (struct telemetryBus* bus);
+
+int telemetryBusAttach (struct telemetryBusReader* reader, const char* name);
+uint32_t telemetryBusRead (struct telemetryBusReader* reader, struct telemetrySample* samples, uint32_t maxSamples);
+void telemetryBusLinkStats (const struct telemetryBusReader* reader, struct linkMonitorStats* stats);
+int telemetryBusAlive (const struct telemetryBusReader* reader);
+void telemetryBusDetach (struct telemetryBusReader* reader);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __TELEMETRY_BUS_H__ */
@@ -0,0 +1,223 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "telemetryCodec.h"
+
+static int telemetryEncodeBlock (struct telemetryEncoder* encoder, uint8_t* frame);
+static uint16_t telemetryZigzag (int16_t delta);
+static int16_t telemetryUnzigzag (uint16_t value);
+static uint8_t telemetryWidth (uint16_t value);
+static uint8_t telemetryParity (const uint8_t* frame, uint16_t length);
+
+void telemetryEncoderInit (struct telemetryEncoder* encoder, uint8_t fields) {
+	memset(encoder, 0, sizeof(struct telemetryEncoder));
+	encoder->fields = (fields > TELEMETRY_MAX_FIELDS) ? TELEMETRY_MAX_FIELDS : fields;
+	encoder->keyframe = 1;
+}
+
+// queue one sample.  once a block is full it's encoded into frame (room for
+// TELEMETRY_MAX_FRAME_LENGTH) and its length returned, otherwise 0
+int telemetryEncoderAdd (struct telemetryEncoder* encoder, const int16_t* sample, uint8_t* frame) {
+	memcpy(encoder->block[encoder->count], sample, encoder->fields*sizeof(int16_t));
+	encoder->count++;
+	if (encoder->count < TELEMETRY_BLOCK_SAMPLES)
+		return 0;
+	return telemetryEncodeBlock(encoder, frame);
+}
+
+// send what's waiting now rather than when the block fills.  returns the frame length, 0 if there was nothing
+int telemetryEncoderFlush (struct telemetryEncoder* encoder, uint8_t* frame) {
+	int length = 0;
+	while (encoder->count > 0)
+		length = telemetryEncodeBlock(encoder, frame); // only a block too big for one frame leaves some behind
+	return length;
+}
+
+// takes as many waiting samples as fit in one frame, the rest stay for the next
+static int telemetryEncodeBlock (struct telemetryEncoder* encoder, uint8_t* frame) {
+	uint8_t widths[TELEMETRY_MAX_FIELDS];
+	uint8_t fields = encoder->fields, key = encoder->keyframe;
+	uint16_t length, bits;
+	uint32_t accumulator = 0;
+	uint8_t pending = 0;
+	int count = encoder->count, i, f;
+
+	// the widest delta of each field decides its width for the whole block.  if the
+	// block won't fit, drop samples off the end until it does (one keyframe always fits)
+	for (;;) {
+		const int16_t* before = key ? encoder->block[0] : encoder->previous;
+		memset(widths, 0, sizeof(widths));
+		for (i=key; i<count; i++) {
+			for (f=0; f<fields; f++) {
+				uint8_t width = telemetryWidth(telemetryZigzag(encoder->block[i][f] - before[f]));
+				if (width > widths[f])
+					widths[f] = width;
+			}
+			before = encoder->block[i];
+		}
+		// 16 doesn't fit in a nibble, so 15 means 16 and a field that needs 15 bits gets 16
+		for (bits=0, f=0; f<fields; f++) {
+			if (widths[f] == 15)
+				widths[f] = 16;
+			bits += widths[f];
+		}
+		length = TELEMETRY_HEADER_LENGTH + (key ? 2*fields : 0) + (fields + 1)/2 + (bits*(count - key) + 7)/8;
+		if (length <= TELEMETRY_MAX_FRAME_LENGTH || count == 1)
+			break;
+		count--;
+	}
+
+	frame[0] = TELEMETRY_START_BYTE;
+	frame[2] = (uint8_t) length;
+	frame[3] = encoder->sequence++;
+	frame[4] = (key ? TELEMETRY_KEYFRAME : 0) | count;
+	length = TELEMETRY_HEADER_LENGTH;
+
+	if (key) {
+		for (f=0; f<fields; f++) {
+			frame[length++] = (uint16_t) encoder->block[0][f] & 0xFF;
+			frame[length++] = (uint16_t) encoder->block[0][f] >> 8;
+		}
+	}
+
+	for (f=0; f<fields; f+=2) {
+		uint8_t low = (widths[f] == 16) ? 15 : widths[f];
+		uint8_t high = (f+1 < fields) ? ((widths[f+1] == 16) ? 15 : widths[f+1]) : 0;
+		frame[length++] = low | (high << 4);
+	}
+
+	// and the deltas
+	for (i=key; i<count; i++) {
+		const int16_t* before = (i == 0) ? encoder->previous : encoder->block[i-1];
+		for (f=0; f<fields; f++) {
+			accumulator |= (uint32_t) telemetryZigzag(encoder->block[i][f] - before[f]) << pending;
+			pending += widths[f];
+			while (pending >= 8) {
+				frame[length++] = accumulator & 0xFF;
+				accumulator >>= 8;
+				pending -= 8;
+			}
+		}
+	}
+	if (pending > 0)
+		frame[length++] = accumulator & 0xFF;
+
+	frame[1] = telemetryParity(frame, length);
+
+	// the last sample sent is what the next block is relative to
+	memcpy(encoder->previous, encoder->block[count-1], fields*sizeof(int16_t));
+	memmove(encoder->block[0], encoder->block[count], (encoder->count - count)*sizeof(encoder->block[0]));
+	encoder->count -= count;
+
+	encoder->blocksSinceKeyframe = key ? 0 : encoder->blocksSinceKeyframe + 1;
+	encoder->keyframe = (encoder->blocksSinceKeyframe + 1 >= TELEMETRY_KEYFRAME_BLOCKS);
+	return length;
+}
+
+void telemetryDecoderInit (struct telemetryDecoder* decoder, uint8_t fields) {
+	memset(decoder, 0, sizeof(struct telemetryDecoder));
+	decoder->fields = (fields > TELEMETRY_MAX_FIELDS) ? TELEMETRY_MAX_FIELDS : fields;
+}
+
+// one whole frame (start byte and parity already checked) back into samples.
+// returns how many went into samples (up to TELEMETRY_BLOCK_SAMPLES), 0 while
+// waiting for a keyframe or -1 if the frame doesn't make sense
+int telemetryDecode (struct telemetryDecoder* decoder, const uint8_t* frame, uint16_t length, int16_t samples[][TELEMETRY_MAX_FIELDS]) {
+	uint8_t widths[TELEMETRY_MAX_FIELDS];
+	uint8_t fields = decoder->fields, key, count, sequence;
+	uint16_t bits, offset = TELEMETRY_HEADER_LENGTH;
+	uint32_t accumulator = 0;
+	uint8_t pending = 0;
+	int i, f;
+
+	if (length < TELEMETRY_HEADER_LENGTH || frame[2] != length)
+		goto bad;
+	sequence = frame[3];
+	key = (frame[4] & TELEMETRY_KEYFRAME) ? 1 : 0;
+	count = frame[4] & TELEMETRY_COUNT_MASK;
+	if (count == 0 || count > TELEMETRY_BLOCK_SAMPLES)
+		goto bad;
+
+	decoder->stats.blocks++;
+	if (decoder->synced && sequence != decoder->sequence) {
+		decoder->stats.blocksLost += (uint8_t)(sequence - decoder->sequence);
+		decoder->synced = 0;
+	}
+	decoder->sequence = sequence + 1;
+	if (!decoder->synced && !key) {
+		decoder->stats.blocksSkipped++;
+		return 0;
+	}
+
+	if (key) {
+		if (offset + 2*fields > length)
+			goto bad;
+		for (f=0; f<fields; f++, offset+=2)
+			decoder->previous[f] = (int16_t)(frame[offset] | (frame[offset+1] << 8));
+		memcpy(samples[0], decoder->previous, fields*sizeof(int16_t));
+		decoder->stats.keyframes++;
+	}
+
+	if (offset + (fields + 1)/2 > length)
+		goto bad;
+	for (bits=0, f=0; f<fields; f++) {
+		widths[f] = (frame[offset + f/2] >> ((f & 1) ? 4 : 0)) & 0x0F;
+		if (widths[f] == 15)
+			widths[f] = 16;
+		bits += widths[f];
+	}
+	offset += (fields + 1)/2;
+	if (offset + (bits*(count - key) + 7)/8 != length)
+		goto bad;
+
+	for (i=key; i<count; i++) {
+		for (f=0; f<fields; f++) {
+			uint16_t value;
+			while (pending < widths[f]) {
+				accumulator |= (uint32_t) frame[offset++] << pending;
+				pending += 8;
+			}
+			value = accumulator & (((uint32_t) 1 << widths[f]) - 1);
+			accumulator >>= widths[f];
+			pending -= widths[f];
+			decoder->previous[f] += telemetryUnzigzag(value);
+		}
+		memcpy(samples[i], decoder->previous, fields*sizeof(int16_t));
+	}
+
+	decoder->synced = 1;
+	decoder->stats.samples += count;
+	return count;
+
+bad:
+	decoder->stats.blocksBad++;
+	decoder->synced = 0;
+	return -1;
+}
+
+// small deltas either way become small numbers, -1 -> 1, 1 -> 2, -2 -> 3 ...
+static uint16_t telemetryZigzag (int16_t delta) {
+	return ((uint16_t) delta << 1) ^ (uint16_t)(delta >> 15);
+}
+
+static int16_t telemetryUnzigzag (uint16_t value) {
+	return (int16_t)((value >> 1) ^ (uint16_t)-(int16_t)(value & 1));
+}
+
+// bits needed to hold value
+static uint8_t telemetryWidth (uint16_t value) {
+	uint8_t width = 0;
+	while (value) {
+		width++;
+		value >>= 1;
+	}
+	return width;
+}
+
+static uint8_t telemetryParity (const uint8_t* frame, uint16_t length) {
+	uint8_t parity = 0;
+	uint16_t i;
+	for (i=2; i<length; i++)
+		parity ^= frame[i];
+	return parity;
+}
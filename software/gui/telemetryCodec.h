@@ -0,0 +1,76 @@
+#ifndef __TELEMETRY_CODEC_H__
+#define __TELEMETRY_CODEC_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+// squeezes a stream of int16 samples (the fields of an fcu_pkt_t) into fewer
+// bytes for the xbee link.  most channels barely move between samples, so
+// instead of 2 bytes each we send how far each one moved, in as few bits as
+// that block needs.  plain C with no allocation so the FCU builds it too.
+//
+// a block frame:
+//   [start][parity][length][sequence][flags]
+//   [keyframe: the first sample, 2 bytes a field, low byte first]
+//   [bits per field for this block, a nibble each, 15 means 16]
+//   [the other samples: zigzagged deltas from the sample before, bit packed
+//    low bit first, every field of a sample before the next sample]
+// parity is the XOR of everything after it, the same as the raw frames.
+//
+// a keyframe goes out every TELEMETRY_KEYFRAME_BLOCKS blocks.  the decoder
+// notices a lost block from the sequence number and skips the following
+// deltas until the next keyframe, so a lost block costs a few hundred ms of
+// data, not a drifted plot.
+
+#define TELEMETRY_START_BYTE 0xAB           // raw frames use 0xAA, the two never share a link
+#define TELEMETRY_HEADER_LENGTH 5
+#define TELEMETRY_MAX_FIELDS 24
+#define TELEMETRY_MAX_FRAME_LENGTH 255      // the length has to fit in a byte
+#define TELEMETRY_BLOCK_SAMPLES 8           // samples per block, latency is this many sample periods
+#define TELEMETRY_KEYFRAME_BLOCKS 16        // most blocks between keyframes
+
+#define TELEMETRY_KEYFRAME 0x80             // flags: the block starts with a whole sample
+#define TELEMETRY_COUNT_MASK 0x0F           // flags: samples in the block
+
+struct telemetryEncoder {
+	uint8_t fields;
+	uint8_t count;                          // samples waiting in block
+	uint8_t sequence;
+	uint8_t blocksSinceKeyframe;
+	uint8_t keyframe;                       // next block starts with a keyframe
+	int16_t previous[TELEMETRY_MAX_FIELDS]; // last sample sent
+	int16_t block[TELEMETRY_BLOCK_SAMPLES][TELEMETRY_MAX_FIELDS];
+};
+
+struct telemetryDecoderStats {
+	uint32_t blocks;
+	uint32_t keyframes;
+	uint32_t samples;
+	uint32_t blocksLost;     // gaps in the sequence numbers
+	uint32_t blocksSkipped;  // arrived fine but came after a loss, waiting for a keyframe
+	uint32_t blocksBad;      // parity was fine but the contents didn't add up
+};
+
+struct telemetryDecoder {
+	uint8_t fields;
+	uint8_t synced;          // have a keyframe and nothing lost since
+	uint8_t sequence;        // the one expected next
+	int16_t previous[TELEMETRY_MAX_FIELDS];
+	struct telemetryDecoderStats stats;
+};
+
+void telemetryEncoderInit (struct telemetryEncoder* encoder, uint8_t fields);
+int telemetryEncoderAdd (struct telemetryEncoder* encoder, const int16_t* sample, uint8_t* frame);
+int telemetryEncoderFlush (struct telemetryEncoder* encoder, uint8_t* frame);
+
+void telemetryDecoderInit (struct telemetryDecoder* decoder, uint8_t fields);
+int telemetryDecode (struct telemetryDecoder* decoder, const uint8_t* frame, uint16_t length, int16_t samples[][TELEMETRY_MAX_FIELDS]);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __TELEMETRY_CODEC_H__ */
@@ -0,0 +1,211 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "telemetryMux.h"
+
+static struct telemetryMuxChannel* telemetryMuxFind (struct telemetryMux* mux, const char* channel);
+static void telemetryMuxSetPeriod (struct telemetryMux* mux, struct telemetryMuxChannel* channel, uint16_t rate);
+static uint8_t telemetryMuxParity (const uint8_t* frame, uint16_t length);
+
+#define TELEMETRY_MUX_CHANNEL_INFO(name, rate, priority, FIELDS) {#name, rate, priority, PACKET_FIELD_COUNT(FIELDS)},
+static const struct {
+	const char* name;
+	uint16_t rate;
+	uint8_t priority;
+	uint8_t fields;
+} telemetryMuxChannelInfo[TELEMETRY_CHANNEL_COUNT] = { TELEMETRY_CHANNELS(TELEMETRY_MUX_CHANNEL_INFO) };
+
+// every channel at its schema rate and priority, the first samples all due on the first tick
+void telemetryMuxInit (struct telemetryMux* mux, uint16_t tickRate, uint16_t bytesPerSecond) {
+	uint8_t first = 0;
+	int c;
+
+	memset(mux, 0, sizeof(struct telemetryMux));
+	mux->tickRate = tickRate;
+	mux->bytesPerSecond = bytesPerSecond;
+	for (c=0; c<TELEMETRY_CHANNEL_COUNT; c++) {
+		struct telemetryMuxChannel* channel = &mux->channels[c];
+		channel->name = telemetryMuxChannelInfo[c].name;
+		channel->first = first;
+		channel->fields = telemetryMuxChannelInfo[c].fields;
+		channel->priority = telemetryMuxChannelInfo[c].priority;
+		telemetryMuxSetPeriod(mux, channel, telemetryMuxChannelInfo[c].rate);
+		first += channel->fields;
+	}
+}
+
+// by name ("gyro").  returns 0, or -1 if there's no such channel
+int telemetryMuxSetRate (struct telemetryMux* mux, const char* channel, uint16_t rate) {
+	struct telemetryMuxChannel* found = telemetryMuxFind(mux, channel);
+	if (found == NULL)
+		return -1;
+	telemetryMuxSetPeriod(mux, found, rate);
+	return 0;
+}
+
+int telemetryMuxSetPriority (struct telemetryMux* mux, const char* channel, uint8_t priority) {
+	struct telemetryMuxChannel* found = telemetryMuxFind(mux, channel);
+	if (found == NULL)
+		return -1;
+	found->priority = priority;
+	return 0;
+}
+
+// one control loop.  state holds every field of TELEMETRY_CHANNEL_FIELDS in
+// order and tick is the FCU's clock.  whatever is due and fits goes into frame
+// (room for TELEMETRY_MUX_MAX_FRAME_LENGTH) and its length is returned, otherwise 0
+int telemetryMuxTick (struct telemetryMux* mux, const int16_t* state, uint16_t tick, uint8_t* frame) {
+	uint32_t limit = (uint32_t) TELEMETRY_MUX_MAX_FRAME_LENGTH*mux->tickRate;
+	uint16_t length = TELEMETRY_MUX_HEADER_LENGTH;
+	uint32_t sent = 0; // bit per channel already in this frame
+	int c, f;
+
+	mux->now += TELEMETRY_MUX_TIME_SCALE;
+	mux->credit += mux->bytesPerSecond;
+	if (mux->credit > limit)
+		mux->credit = limit; // a quiet spell doesn't buy a burst the uart can't take
+
+	// a sample still waiting when the next one falls due has missed its
+	// deadline.  it's dropped, the next one carries the newer values anyway
+	for (c=0; c<TELEMETRY_CHANNEL_COUNT; c++) {
+		struct telemetryMuxChannel* channel = &mux->channels[c];
+		while (channel->rate != 0 && (int32_t)(mux->now - channel->due) >= (int32_t) channel->period) {
+			channel->due += channel->period;
+			channel->missed++;
+		}
+	}
+
+	for (;;) {
+		struct telemetryMuxChannel* next = NULL;
+		uint16_t cost;
+
+		// of the channels that are due and not already in this frame, the lowest
+		// priority number, then the nearest deadline (the next sample falling due)
+		for (c=0; c<TELEMETRY_CHANNEL_COUNT; c++) {
+			struct telemetryMuxChannel* channel = &mux->channels[c];
+			if (channel->rate == 0 || (sent & ((uint32_t) 1 << c)) || (int32_t)(mux->now - channel->due) < 0)
+				continue;
+			if (next == NULL || channel->priority < next->priority ||
+			   (channel->priority == next->priority &&
+			    (int32_t)((channel->due + channel->period) - (next->due + next->period)) < 0))
+				next = channel;
+		}
+		if (next == NULL)
+			break;
+
+		cost = 1 + 2*next->fields;
+		if (length + cost > TELEMETRY_MUX_MAX_FRAME_LENGTH || (uint32_t)(length + cost)*mux->tickRate > mux->credit) {
+			mux->stats.stalls++;
+			break;
+		}
+
+		c = next - mux->channels;
+		frame[length++] = c;
+		for (f=next->first; f<next->first + next->fields; f++) {
+			frame[length++] = (uint16_t) state[f] & 0xFF;
+			frame[length++] = (uint16_t) state[f] >> 8;
+		}
+		sent |= (uint32_t) 1 << c;
+		next->sent++;
+		next->due += next->period;
+	}
+
+	if (sent == 0)
+		return 0;
+
+	frame[0] = TELEMETRY_MUX_START_BYTE;
+	frame[2] = (uint8_t) length;
+	frame[3] = mux->sequence & 0xFF;
+	frame[4] = mux->sequence >> 8;
+	frame[5] = tick & 0xFF;
+	frame[6] = tick >> 8;
+	frame[1] = telemetryMuxParity(frame, length);
+	mux->sequence++;
+
+	mux->credit -= (uint32_t) length*mux->tickRate;
+	mux->stats.frames++;
+	mux->stats.bytes += length;
+	return length;
+}
+
+void telemetryMuxDecoderInit (struct telemetryMuxDecoder* decoder) {
+	memset(decoder, 0, sizeof(struct telemetryMuxDecoder));
+}
+
+// one whole frame (start byte and parity already checked) into state, which
+// holds the latest of every field and keeps the ones this frame didn't carry.
+// returns the number of records, or -1 if the frame doesn't make sense (state
+// is only touched if it does)
+int telemetryMuxDecode (struct telemetryMuxDecoder* decoder, const uint8_t* frame, uint16_t length, int16_t* state) {
+	uint16_t offset = TELEMETRY_MUX_HEADER_LENGTH;
+	uint32_t updated = 0;
+	uint16_t sequence;
+	int records = 0, f;
+
+	if (length < TELEMETRY_MUX_HEADER_LENGTH || frame[2] != length)
+		goto bad;
+
+	// check the whole frame first, a half applied one would mix two points in time
+	while (offset < length) {
+		uint8_t c = frame[offset];
+		if (c >= TELEMETRY_CHANNEL_COUNT || offset + 1 + 2*telemetryMuxChannelInfo[c].fields > length)
+			goto bad;
+		offset += 1 + 2*telemetryMuxChannelInfo[c].fields;
+	}
+
+	decoder->stats.frames++;
+	sequence = frame[3] | (frame[4] << 8);
+	if (decoder->synced && (uint16_t)(sequence - decoder->sequence) < 0x8000) // further than that back is the FCU starting over
+		decoder->stats.framesLost += (uint16_t)(sequence - decoder->sequence);
+	decoder->sequence = sequence + 1;
+	decoder->synced = 1;
+
+	for (offset = TELEMETRY_MUX_HEADER_LENGTH; offset < length; records++) {
+		uint8_t c = frame[offset++], first = 0;
+		int i;
+		for (i=0; i<c; i++)
+			first += telemetryMuxChannelInfo[i].fields;
+		for (f=first; f<first + telemetryMuxChannelInfo[c].fields; f++, offset+=2)
+			state[f] = (int16_t)(frame[offset] | (frame[offset+1] << 8));
+		updated |= (uint32_t) 1 << c;
+	}
+
+	decoder->updated = updated;
+	decoder->stats.records += records;
+	return records;
+
+bad:
+	decoder->stats.framesBad++;
+	return -1;
+}
+
+static struct telemetryMuxChannel* telemetryMuxFind (struct telemetryMux* mux, const char* channel) {
+	int c;
+	for (c=0; c<TELEMETRY_CHANNEL_COUNT; c++)
+		if (strcmp(mux->channels[c].name, channel) == 0)
+			return &mux->channels[c];
+	return NULL;
+}
+
+// faster than the tick doesn't mean anything, so that's as fast as it goes.
+// a channel turned on falls due straight away, one sped up within its new period
+static void telemetryMuxSetPeriod (struct telemetryMux* mux, struct telemetryMuxChannel* channel, uint16_t rate) {
+	if (rate > mux->tickRate)
+		rate = mux->tickRate;
+	channel->rate = rate;
+	if (rate == 0)
+		return;
+	channel->period = (uint32_t) mux->tickRate*TELEMETRY_MUX_TIME_SCALE/rate;
+	if ((int32_t)(channel->due - (mux->now + channel->period)) > 0)
+		channel->due = mux->now + channel->period;
+	if ((int32_t)(channel->due - mux->now) < 0)
+		channel->due = mux->now;
+}
+
+static uint8_t telemetryMuxParity (const uint8_t* frame, uint16_t length) {
+	uint8_t parity = 0;
+	uint16_t i;
+	for (i=2; i<length; i++)
+		parity ^= frame[i];
+	return parity;
+}
@@ -0,0 +1,99 @@
+#ifndef __TELEMETRY_MUX_H__
+#define __TELEMETRY_MUX_H__
+
+#include <stdint.h>
+
+#include "packetSchema.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+// sends each telemetry channel (TELEMETRY_CHANNELS in packetSchema.h) at its
+// own rate instead of the whole fcu_pkt_t at one.  the FCU calls
+// telemetryMuxTick once per control loop with the latest values of every
+// field; the mux works out which channels are due, fits as many as the link
+// has bytes for into one frame and leaves the rest for the next tick.
+//
+// a channel falls due every 1/rate seconds and has until the next one falls
+// due to get it out.  when more is due than the link can take the lower
+// priority number goes first, then the nearer deadline; a sample that misses
+// its deadline is dropped and counted, so an overloaded link starves the
+// highest numbers first and the counts say so.  the ground station changes
+// rates and priorities while flying ("rate_gyro 100", "prio_pid 1", 0 Hz
+// turns a channel off).
+//
+// a frame:
+//   [start][parity][length][sequence, 2 bytes][tick, 2 bytes]
+//   [channel id][its fields, 2 bytes each, low byte first] ...
+// parity is the XOR of everything after it, like every other frame.  sequence
+// counts frames and tick is the FCU's clock when this one was put together
+// (PACKET_STAMP_FIELDS).  each record stands alone so a lost frame only loses
+// its own samples.
+// plain C with no allocation so the FCU builds it too.
+
+#define TELEMETRY_MUX_START_BYTE 0xAC       // 0xAA raw, 0xAB coded, the three never share a link
+#define TELEMETRY_MUX_HEADER_LENGTH 7
+#define TELEMETRY_MUX_MAX_FRAME_LENGTH 64   // one tick's worth, short enough to not hold up the uart
+#define TELEMETRY_MUX_FIELDS PACKET_FIELD_COUNT(TELEMETRY_CHANNEL_FIELDS)
+#define TELEMETRY_MUX_TIME_SCALE 256        // fractions of a tick deadlines are kept in
+
+// TELEMETRY_CHANNEL_gyro, TELEMETRY_CHANNEL_attitude ... the id on the wire
+#define TELEMETRY_MUX_CHANNEL_ID(name, rate, priority, FIELDS) TELEMETRY_CHANNEL_##name,
+enum { TELEMETRY_CHANNELS(TELEMETRY_MUX_CHANNEL_ID) TELEMETRY_CHANNEL_COUNT };
+
+struct telemetryMuxChannel {
+	const char* name;
+	uint8_t first;      // index of its first field in the state telemetryMuxTick gets
+	uint8_t fields;
+	uint8_t priority;
+	uint16_t rate;      // Hz, 0 is off
+	uint32_t period;    // ticks between samples, in TELEMETRY_MUX_TIME_SCALE'ths
+	uint32_t due;       // in the same units as now
+	uint32_t sent;
+	uint32_t missed;    // samples it never got a chance to send
+};
+
+struct telemetryMuxStats {
+	uint32_t frames;
+	uint32_t bytes;
+	uint32_t stalls;    // ticks that left something due because the link was full
+};
+
+struct telemetryMux {
+	uint16_t tickRate;         // telemetryMuxTick calls a second
+	uint16_t bytesPerSecond;   // what the link can carry, the mux never sends more
+	uint32_t credit;           // bytes it may send, times tickRate
+	uint32_t now;
+	uint16_t sequence;
+	struct telemetryMuxChannel channels[TELEMETRY_CHANNEL_COUNT];
+	struct telemetryMuxStats stats;
+};
+
+struct telemetryMuxDecoderStats {
+	uint32_t frames;
+	uint32_t records;
+	uint32_t framesLost;   // gaps in the sequence numbers
+	uint32_t framesBad;    // parity was fine but the records didn't add up
+};
+
+struct telemetryMuxDecoder {
+	uint8_t synced;
+	uint16_t sequence;     // the one expected next
+	uint32_t updated;      // bit per channel, which ones the last frame carried
+	struct telemetryMuxDecoderStats stats;
+};
+
+void telemetryMuxInit (struct telemetryMux* mux, uint16_t tickRate, uint16_t bytesPerSecond);
+int telemetryMuxSetRate (struct telemetryMux* mux, const char* channel, uint16_t rate);
+int telemetryMuxSetPriority (struct telemetryMux* mux, const char* channel, uint8_t priority);
+int telemetryMuxTick (struct telemetryMux* mux, const int16_t* state, uint16_t tick, uint8_t* frame);
+
+void telemetryMuxDecoderInit (struct telemetryMuxDecoder* decoder);
+int telemetryMuxDecode (struct telemetryMuxDecoder* decoder, const uint8_t* frame, uint16_t length, int16_t* state);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __TELEMETRY_MUX_H__ */
@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <math.h>
 #include "gtkgraph.h"
 #include "gtkgraph_internal.h"
 
@@ -8,6 +9,8 @@
 /* Declaration of all local functions */
 
 GtkGraphTrace *gtk_graph_trace_allocate(void);
+static gint gtk_graph_trace_lower_bound(GtkGraphTrace *t, gint lo, gint hi, gfloat value);
+static GtkGraphXWindow *gtk_graph_trace_x_window(GtkGraph *graph, GtkGraphTrace *t, gfloat span_min, gfloat span_max, gint limit);
 
 /* Externally referenceable functions */
 
@@ -25,13 +28,21 @@ if (tmp == (GtkGraphTrace *) NULL)
 tmp->Xdata = NULL;
 tmp->Ydata = NULL;
 tmp->num_points = 0;
-tmp->incrementFactor = 1;
+tmp->x_chunks = NULL;
+tmp->y_chunks = NULL;
+tmp->chunk_shift = GTK_GRAPH_FLAT_CHUNK_SHIFT;
+tmp->first_point = 0;
+tmp->decimated = NULL;
+tmp->num_decimated = 0;
+tmp->decimated_size = 0;
+tmp->decimation_valid = FALSE;
+tmp->range_func = NULL;
+tmp->range_data = NULL;
 tmp->xmax = 0;
 tmp->xmin = 0;
 tmp->ymax = 0;
 tmp->ymin = 0;
 tmp->format = (GtkGraphTraceFormat *) g_malloc (sizeof(GtkGraphTraceFormat));
-tmp->next = NULL;
 
 tmp->format->marker_type = GTK_GRAPH_MARKER_NONE;
 tmp->format->marker = NULL;
@@ -43,6 +54,13 @@ tmp->format->marker_size = 5;
 	
 tmp->format->line_type = SOLID;
 tmp->format->line_visible = TRUE;
+tmp->format->line_color.red = tmp->format->line_color.green = tmp->format->line_color.blue = 0;
+tmp->format->line_width = 0;
+tmp->format->num_dashes = 0;
+tmp->layer_end = 0;
+tmp->density_start = 0;
+tmp->density_end = 0;
+tmp->density_counts = NULL;
 tmp->format->line_gc = NULL;
 	
 tmp->format->legend_text = NULL;
@@ -64,8 +82,7 @@ return(tmp);
 gint gtk_graph_trace_new(GtkGraph *graph)
 {
 
-int i;
-GtkGraphTrace *new_trace, *tmp;
+GtkGraphTrace *new_trace;
 GtkWidget *widget = NULL;
 
 g_return_val_if_fail (graph != NULL, FALSE);
@@ -89,15 +106,14 @@ new_trace->format->mask_gc = gdk_gc_new(widget->window);
 
 gdk_gc_set_line_attributes(new_trace->format->line_gc, 0, GDK_LINE_SOLID, GDK_CAP_BUTT, GDK_JOIN_ROUND);
 
-if (graph->traces == NULL)
-	graph->traces = new_trace;
-else
+if (graph->num_traces >= graph->traces_size)
 	{
-	for (i = 0, tmp = graph->traces; tmp->next != NULL ; tmp = tmp->next , i++)  // Should advance us to last item in list
-        ;
-	tmp->next = new_trace;
+	graph->traces_size = graph->traces_size * 2 + 4;
+	graph->traces = (GtkGraphTrace **) g_realloc(graph->traces, graph->traces_size * sizeof(GtkGraphTrace *));
 	}
+graph->traces[graph->num_traces] = new_trace;
 graph->num_traces += 1;
+gtk_graph_queue_redraw(graph, GTK_GRAPH_DIRTY_AXES | GTK_GRAPH_DIRTY_FORMAT); /* sets up clipping for the new trace */
 return graph->num_traces - 1;
 }
 /**
@@ -106,72 +122,295 @@ return graph->num_traces - 1;
  * @trace_id: 	the unique identifier of the trace
  * @xd:	an array containing the x co-ordinates of each data point
  * @yd: an array containing the y co-ordinates of each data point
+ * @xMin: @xMax: @yMin: @yMax: the extents of the data
  * @n:	the number of data points
  *
  * Assigns to trace @trace_id the co-ordinate pairs stored within
  * the @xd and @yd data arrays.  Note @xd and @yd must be @n data
- * points long
+ * points long.  The arrays are not copied so they must stay valid
+ * until the next call.  On XY graphs @xd must be in ascending order,
+ * only the part inside the x axis limits is looked at when drawing
+ * and it is decimated to a few points per pixel column, see
+ * gtk_graph_trace_decimate()
  */
 void gtk_graph_trace_set_data(GtkGraph *graph, gint trace_id, gfloat *xd, gfloat *yd, gfloat xMin, gfloat xMax, gfloat yMin, gfloat yMax, gint n)
 {
 	GtkGraphTrace *t;
-	gint i;
 	
 	g_return_if_fail (graph != NULL);
 	g_return_if_fail (GTK_IS_GRAPH (graph));
 	g_return_if_fail (graph->traces != NULL);
-	g_return_if_fail (trace_id < graph->num_traces);
+	g_return_if_fail (trace_id >= 0 && trace_id < graph->num_traces);
 
-	float timestep = (xd[n-1] - xd[0])/n;
-	
-	int min_index;
-	int n_in_window;
-	
-	if (xd[0] < graph-> independant->axis_min)
-		min_index = (graph->independant->axis_min - xd[0]) / timestep;
-	else
-		min_index = 0;
-		
-	if (xd[n-1] >= graph->independant->axis_max && xd[0] <= graph->independant->axis_min)
-		n_in_window = ((graph->independant->axis_max - graph->independant->axis_min) / timestep) -1;
-	else if (xd[n-1] >= graph->independant->axis_max)
-		n_in_window = (graph->independant->axis_max - xd[0]) / timestep;
-	else if (xd[0] <= graph->independant->axis_min)
-		n-1 - min_index;
-	else
-		n_in_window = n;
-	
-	if (n_in_window < 0)
-		n_in_window = 1;
-	
-	//~ printf ("%f (%d %f) - %f (%d %f)\n", graph->independant->axis_min, min_index, xd[min_index], (graph->independant->axis_max - graph->independant->axis_min), n_in_window, xd[n_in_window-1]);
-	
-	t = graph->traces;
-	for (i = 0 ; i < trace_id ; i++) // linked list of traces - find the one that we want to update
-		t = t->next;
-		
-	if (n_in_window<=1000) {			
-		t->num_points = n_in_window;
-		t->incrementFactor = 1;
-	} else {		
-		t->incrementFactor = n_in_window/1000;
-		t->num_points = n_in_window/(t->incrementFactor);
-	}
-	
-	//~ printf ("n=%d if=%d np=%d\n", n, t->incrementFactor, t->num_points);
-	
-	t->Xdata = xd+min_index;
-	t->Ydata = yd+min_index;
+	t = graph->traces[trace_id];
+
+	t->Xdata = xd;
+	t->Ydata = yd;
+	t->num_points = n;
+	t->x_chunks = (xd != NULL) ? &t->Xdata : NULL;
+	t->y_chunks = (yd != NULL) ? &t->Ydata : NULL;
+	t->chunk_shift = GTK_GRAPH_FLAT_CHUNK_SHIFT;
+	t->first_point = 0;
+	t->decimation_valid = FALSE;
 
 	t->ymax = yMax;
 	t->ymin = yMin;
 	t->xmax = xMax;
 	t->xmin = xMin;
+
+	gtk_graph_queue_redraw(graph, GTK_GRAPH_DIRTY_TRACES | GTK_GRAPH_DIRTY_FORMAT); /* the arrays may be different data altogether */
+}
+
+/**
+ * gtk_graph_trace_set_chunked_data:
+ * @graph:  the #GtkGraph containing the trace to be modified
+ * @trace_id: 	the unique identifier of the trace
+ * @x_chunks: @y_chunks:	tables of blocks of x and y co-ordinates
+ * @chunk_shift:	each block holds 2^@chunk_shift points
+ * @first:	the index of the oldest point
+ * @n:	the number of points
+ * @xMin: @xMax: @yMin: @yMax: the extents of the data
+ *
+ * Like gtk_graph_trace_set_data() but for data that grows a block at a time
+ * rather than being reallocated.  Point i (from @first to @first + @n - 1)
+ * is element i % 2^@chunk_shift of block i / 2^@chunk_shift - @first / 2^@chunk_shift,
+ * so the owner can drop whole blocks off the front as well as add them to the
+ * end.  The tables are not copied.  Points that have been passed before are
+ * assumed not to have changed, so the cairo renderer only draws new ones.
+ * Only XY graphs can draw chunked data.
+ */
+void gtk_graph_trace_set_chunked_data(GtkGraph *graph, gint trace_id, gfloat **x_chunks, gfloat **y_chunks, gint chunk_shift, gint first, gint n, gfloat xMin, gfloat xMax, gfloat yMin, gfloat yMax)
+{
+GtkGraphTrace *t;
+
+g_return_if_fail (graph != NULL);
+g_return_if_fail (GTK_IS_GRAPH (graph));
+g_return_if_fail (graph->traces != NULL);
+g_return_if_fail (trace_id >= 0 && trace_id < graph->num_traces);
+
+t = graph->traces[trace_id];
+
+t->Xdata = NULL;	/* keeps polar and smith plots away from it */
+t->Ydata = NULL;
+t->x_chunks = x_chunks;
+t->y_chunks = y_chunks;
+t->chunk_shift = chunk_shift;
+t->first_point = first;
+t->num_points = n;
+t->decimation_valid = FALSE;
+
+t->ymax = yMax;
+t->ymin = yMin;
+t->xmax = xMax;
+t->xmin = xMin;
+
+gtk_graph_queue_redraw(graph, GTK_GRAPH_DIRTY_TRACES);
+}
+
+/* first index in [lo, hi) whose x is >= value, or hi.  x must be ascending */
+static gint gtk_graph_trace_lower_bound(GtkGraphTrace *t, gint lo, gint hi, gfloat value)
+{
+gint mid;
+
+while (lo < hi)
+	{
+	mid = lo + (hi - lo) / 2;
+	if (GTK_GRAPH_TRACE_X(t, mid) < value)
+		lo = mid + 1;
+	else
+		hi = mid;
+	}
+return lo;
+}
+
+/**
+ * gtk_graph_trace_set_range_func:
+ * @graph:  the #GtkGraph containing the trace to be modified
+ * @trace_id: 	the unique identifier of the trace
+ * @func:	finds the smallest and largest y in a range of the data, or NULL
+ * @data:	passed to @func
+ *
+ * Lets the owner of a long trace supply a summary of its data so decimating
+ * costs a lookup per pixel column instead of a pass over every visible point.
+ */
+void gtk_graph_trace_set_range_func(GtkGraph *graph, gint trace_id, GtkGraphRangeFunc func, gpointer data)
+{
+GtkGraphTrace *t;
+
+g_return_if_fail (graph != NULL);
+g_return_if_fail (GTK_IS_GRAPH (graph));
+g_return_if_fail (graph->traces != NULL);
+g_return_if_fail (trace_id >= 0 && trace_id < graph->num_traces);
+
+t = graph->traces[trace_id];
+
+t->range_func = func;
+t->range_data = data;
+t->decimation_valid = FALSE;
+}
+
+/* Finds the part of t's x data between span_min and span_max and, if there
+ * are more than limit points in it, where each pixel column starts.  Only
+ * depends on x, so traces sharing their x data (same chunks, same points)
+ * reuse graph->window */
+static GtkGraphXWindow *gtk_graph_trace_x_window(GtkGraph *graph, GtkGraphTrace *t, gfloat span_min, gfloat span_max, gint limit)
+{
+GtkGraphXWindow *w = &graph->window;
+gfloat axis_min = graph->independant->axis_min;
+gfloat scale = graph->independant->scale_factor;
+gint i, end, col;
+
+if (w->x_chunks == t->x_chunks && w->first_point == t->first_point && w->num_points == t->num_points && w->span_min == span_min && w->span_max == span_max)
+	return w;
+
+w->x_chunks = t->x_chunks;
+w->first_point = t->first_point;
+w->num_points = t->num_points;
+w->span_min = span_min;
+w->span_max = span_max;
+
+w->lo = gtk_graph_trace_lower_bound(t, t->first_point, t->first_point + t->num_points, span_min);
+w->hi = gtk_graph_trace_lower_bound(t, w->lo, t->first_point + t->num_points, span_max);
+if (w->lo > t->first_point)
+	w->lo--;
+if (w->hi < t->first_point + t->num_points)
+	w->hi++;
+
+w->num_edges = 0;
+if (w->hi - w->lo <= limit)  /* few enough to draw them all */
+	return w;
+
+i = w->lo;
+while (TRUE)
+	{
+	/* rounding can very occasionally split a column in two */
+	if (w->num_edges >= w->edges_size)
+		{
+		w->edges_size += limit / 4 + 1;
+		w->edges = (gint *) g_realloc(w->edges, w->edges_size * sizeof(gint));
+		}
+	w->edges[w->num_edges++] = i;
+	if (i >= w->hi)
+		break;
+
+	/* the points in this pixel column are [i, end).  columns line up with the axis whatever the span */
+	col = (gint) floorf((GTK_GRAPH_TRACE_X(t, i) - axis_min) * scale);
+	end = gtk_graph_trace_lower_bound(t, i, w->hi, axis_min + (col + 1) / scale);
+	i = (end > i) ? end : i + 1;
+	}
+return w;
+}
+
+/**
+ * gtk_graph_trace_decimate:
+ * @graph:  the #GtkGraph containing @trace, with its axes already scaled
+ * @trace: 	the trace to decimate
+ *
+ * Picks the points of @trace that are worth drawing at the current x axis
+ * limits and fills in @trace->decimated with their indices (counted from
+ * @trace->first_point like everything else, so they can be passed straight to
+ * GTK_GRAPH_TRACE_X() and GTK_GRAPH_TRACE_Y()).  The visible window
+ * is found by binary search (plus one point either side so lines run off the
+ * edges) and every pixel column keeps its first, minimum, maximum and last
+ * point (M4), so spikes survive however far the graph is zoomed out and at most
+ * four points per column are drawn.  Column edges are found by binary search
+ * too, once per redraw for all the traces that share the same x data, and the
+ * min/max come from the trace's range function if it has one, so with a
+ * summary the work done is per column rather than per point.  The result
+ * is kept until the data or the x axis changes.
+ */
+void gtk_graph_trace_decimate(GtkGraph *graph, GtkGraphTrace *t)
+{
+gtk_graph_trace_decimate_span(graph, t, graph->independant->axis_min, graph->independant->axis_max);
+}
+
+/**
+ * gtk_graph_trace_decimate_span:
+ * @graph:  the #GtkGraph containing @trace, with its axes already scaled
+ * @trace: 	the trace to decimate
+ * @span_min: @span_max:	the part of the x axis wanted
+ *
+ * As gtk_graph_trace_decimate() but only for the points between @span_min
+ * and @span_max, for renderers that only need to draw a strip of the graph.
+ */
+void gtk_graph_trace_decimate_span(GtkGraph *graph, GtkGraphTrace *t, gfloat span_min, gfloat span_max)
+{
+gfloat scale = graph->independant->scale_factor;
+gint width = (gint) ceilf((span_max - span_min) * scale) + 1;  /* pixel columns in the span */
+gint limit, i, c, end, count, first, min, max;
+GtkGraphXWindow *w;
+
+if (t->decimation_valid && t->decimated_axis_min == span_min && t->decimated_axis_max == span_max && t->decimated_scale == scale)
+	return;
+
+if (width < 1)
+	width = 1;
+limit = 4 * (width + 2);  /* every visible column plus the one point either side */
+w = gtk_graph_trace_x_window(graph, t, span_min, span_max, limit);
+count = w->hi - w->lo;
+
+if (t->decimated_size < MIN(count, limit))
+	{
+	t->decimated_size = MIN(count, limit);
+	t->decimated = (gint *) g_realloc(t->decimated, t->decimated_size * sizeof(gint));
+	}
+
+t->num_decimated = 0;
+if (w->num_edges == 0)  /* few enough to draw them all */
+	{
+	for (i = w->lo ; i < w->hi ; i++)
+		t->decimated[t->num_decimated++] = i;
+	}
+else
+	{
+	for (c = 0 ; c + 1 < w->num_edges ; c++)
+		{
+		i = w->edges[c];
+		end = w->edges[c + 1];
+
+		if (t->range_func != NULL)
+			t->range_func(t->range_data, i, end, &min, &max);
+		else
+			{
+			gint k;
+			min = max = i;
+			for (k = i + 1 ; k < end ; k++)
+				{
+				if (GTK_GRAPH_TRACE_Y(t, k) < GTK_GRAPH_TRACE_Y(t, min))
+					min = k;
+				if (GTK_GRAPH_TRACE_Y(t, k) > GTK_GRAPH_TRACE_Y(t, max))
+					max = k;
+				}
+			}
+
+		if (t->num_decimated + 4 > t->decimated_size)
+			{
+			t->decimated_size += limit;
+			t->decimated = (gint *) g_realloc(t->decimated, t->decimated_size * sizeof(gint));
+			}
+
+		/* first, min and max in the order they happened, then last */
+		first = i;
+		i = end;
+		t->decimated[t->num_decimated++] = first;
+		if (MIN(min, max) != first)
+			t->decimated[t->num_decimated++] = MIN(min, max);
+		if (MAX(min, max) != MIN(min, max) && MAX(min, max) != i - 1)
+			t->decimated[t->num_decimated++] = MAX(min, max);
+		if (i - 1 != first)
+			t->decimated[t->num_decimated++] = i - 1;
+		}
+	}
+
+t->decimation_valid = TRUE;
+t->decimated_axis_min = span_min;
+t->decimated_axis_max = span_max;
+t->decimated_scale = scale;
 }
 
 void gtk_graph_trace_format_marker(GtkGraph *graph, gint trace_id, GtkGraphMarkerType type, gint marker_size, GdkColor *fg, GdkColor *bg, gboolean is_filled)
 {
-GtkGraphTrace *t = graph->traces;;
+GtkGraphTrace *t;
 GtkWidget *w = GTK_WIDGET(graph);
 GtkGraphTraceFormat *current;
 
@@ -186,10 +425,9 @@ gint i, size = marker_size * 2 + 1;
 g_return_if_fail (graph != NULL);
 g_return_if_fail (GTK_IS_GRAPH (graph));
 g_return_if_fail (graph->traces != NULL);
-g_return_if_fail (trace_id < graph->num_traces);
+g_return_if_fail (trace_id >= 0 && trace_id < graph->num_traces);
 
-for (i = 0 ; i < trace_id ; i++) /* Find the required trace */
-	t = t->next;
+t = graph->traces[trace_id];
 
 current = t->format;
 current->marker_type = type;
@@ -372,6 +610,7 @@ for (i = 0 ; i <=1  ; i++)
 	   }
     }
 gdk_gc_set_clip_mask(current->marker_gc, current->mask);
+gtk_graph_queue_redraw(graph, GTK_GRAPH_DIRTY_TRACES | GTK_GRAPH_DIRTY_FORMAT);
 }
 
 /*! \fn gtk_graph_trace_format_line
@@ -380,18 +619,19 @@ gdk_gc_set_clip_mask(current->marker_gc, current->mask);
 void gtk_graph_trace_format_line(GtkGraph *graph, gint trace_id, GtkGraphLineType type, gint width, GdkColor *line_color, gboolean visible )
 {
 GtkGraphTrace *t;
-gint i;
 gint8 dash_list[4];
 g_return_if_fail (graph != NULL);
 g_return_if_fail (GTK_IS_GRAPH (graph));
 g_return_if_fail (graph->traces != NULL);
-g_return_if_fail (trace_id < graph->num_traces);
+g_return_if_fail (trace_id >= 0 && trace_id < graph->num_traces);
 
-t = graph->traces;
-for (i = 0 ; i < trace_id ; i++)
-	t = t->next;
+t = graph->traces[trace_id];
 
 t->format->line_visible = visible;
+t->format->line_type = type;
+t->format->line_color = *line_color;
+t->format->line_width = width;
+t->format->num_dashes = 0;
 
 gdk_gc_set_foreground(t->format->line_gc, line_color);
 gdk_gc_set_background(t->format->line_gc, &WHITE);
@@ -410,6 +650,7 @@ switch (type)
 		dash_list[0] = 6;
 		dash_list[1] = 6;
 		gdk_gc_set_dashes(t->format->line_gc, 0, dash_list, 2);
+		t->format->num_dashes = 2;
 		t->format->line_visible = TRUE;
 		break;
 	case DASH_DOT:
@@ -419,6 +660,7 @@ switch (type)
 		dash_list[2] = 1;
 		dash_list[3] = 2;
 		gdk_gc_set_dashes(t->format->line_gc, 0, dash_list, 4);
+		t->format->num_dashes = 4;
 		t->format->line_visible = TRUE;
 		break;
 	case DOTTED:
@@ -426,6 +668,7 @@ switch (type)
 		dash_list[0] = 2;
 		dash_list[1] = 3;
 		gdk_gc_set_dashes(t->format->line_gc, 0, dash_list, 2);
+		t->format->num_dashes = 2;
 		t->format->line_visible = TRUE;
 		break;
 	case LONG_DASH:
@@ -433,25 +676,25 @@ switch (type)
 		dash_list[0] = 10;
 		dash_list[1] = 6;
 		gdk_gc_set_dashes(t->format->line_gc, 0, dash_list, 2);
+		t->format->num_dashes = 2;
 		t->format->line_visible = TRUE;
 		break;
 	}
-
+memcpy(t->format->dash_list, dash_list, sizeof(dash_list));
+gtk_graph_queue_redraw(graph, GTK_GRAPH_DIRTY_TRACES | GTK_GRAPH_DIRTY_FORMAT);
 }
 void gtk_graph_trace_format_title(GtkGraph *graph, gint trace_id, gchar *legend_text)
 {
 GtkGraphTrace *t;
-int i;
 g_return_if_fail (graph != NULL);
 g_return_if_fail (GTK_IS_GRAPH (graph));
 g_return_if_fail (graph->traces != NULL);
-g_return_if_fail (trace_id < graph->num_traces);
+g_return_if_fail (trace_id >= 0 && trace_id < graph->num_traces);
 
-t = graph->traces;
-for (i = 0 ; i < trace_id ; i++)
-	t = t->next;
+t = graph->traces[trace_id];
 
 if (t->format->legend_text != NULL)
 	g_free (t->format->legend_text);
 t->format->legend_text = g_strdup(legend_text);
+gtk_graph_queue_redraw(graph, GTK_GRAPH_DIRTY_TRACES | GTK_GRAPH_DIRTY_TITLES);
 }
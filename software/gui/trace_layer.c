@@ -0,0 +1,218 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include "gtkgraph.h"
+#include "gtkgraph_internal.h"
+
+/* The cairo renderer.  XY traces without markers are drawn anti-aliased onto
+ * graph->layer, an ARGB image the size of the plotting area that is clear
+ * wherever there isn't a trace, and the layer is painted over the axes.  While
+ * the x axis just slides along (auto panning) with the same scale and y axis
+ * the layer is scrolled left by the number of pixels the axis moved and only
+ * the strip on the right, from the oldest point not yet drawn onwards, is
+ * cleared and drawn again.  Anything else redraws the whole layer. */
+
+/* Declaration of all local functions */
+
+static gboolean gtk_graph_trace_layer_check(GtkGraph *graph);
+static void gtk_graph_trace_layer_scroll(GtkGraph *graph, gint shift);
+static void gtk_graph_trace_layer_draw(GtkGraph *graph, gint from);
+static gboolean gtk_graph_trace_layer_drawn(GtkGraph *graph, GtkGraphTrace *t);
+
+/* scale factors come out of (max - min) / ticks so panning wobbles them in the last few bits */
+#define SAME_SCALE(a, b) (fabsf((a) - (b)) <= 1e-4 * fabsf(b))
+
+/* Externally referenceable functions */
+
+/**
+ * gtk_graph_trace_layer_plot:
+ * @graph:  the #GtkGraph, bound and with its axes scaled
+ *
+ * Brings the trace layer up to date, as cheaply as it can, and paints it
+ * onto the graph's pixmap.
+ */
+void gtk_graph_trace_layer_plot(GtkGraph *graph)
+{
+gfloat scale = graph->independant->scale_factor;
+gfloat from = G_MAXFLOAT;
+gint shift, start, width;
+GtkGraphTrace *t;
+gint n;
+cairo_t *cr;
+
+if (user_width <= 0 || user_height <= 0)
+	return;
+
+graph->window.x_chunks = NULL;	/* the x window is only good for one pass */
+
+if (!gtk_graph_trace_layer_check(graph))
+	{
+	graph->layer_x_min = graph->independant->axis_min;
+	gtk_graph_trace_layer_draw(graph, 0);
+	}
+else
+	{
+	width = cairo_image_surface_get_width(graph->layer);
+	shift = (gint) rint((graph->independant->axis_min - graph->layer_x_min) * scale);
+
+	/* the oldest point that isn't on the layer yet, lines start from the one before it */
+	for (n = 0 ; n < graph->num_traces ; n++)
+		{
+		t = graph->traces[n];
+		if (!gtk_graph_trace_layer_drawn(graph, t) || t->layer_end == t->first_point + t->num_points)
+			continue;
+		start = MAX(t->layer_end - 1, t->first_point);
+		from = MIN(from, GTK_GRAPH_TRACE_X(t, start));
+		}
+
+	if (shift > 0)
+		{
+		gtk_graph_trace_layer_scroll(graph, shift);
+		graph->layer_x_min += shift / scale;
+		}
+
+	if (shift > 0 || from != G_MAXFLOAT)
+		{
+		start = width - shift;
+		if (from != G_MAXFLOAT)
+			start = MIN(start, (gint) floorf((from - graph->layer_x_min) * scale));
+		start -= 2;  /* room for anti-aliasing and joins either side of the seam */
+		gtk_graph_trace_layer_draw(graph, MAX(start, 0));
+		}
+	}
+
+cr = gdk_cairo_create(buffer);
+cairo_set_source_surface(cr, graph->layer, user_origin_x, user_origin_y);
+cairo_paint(cr);
+cairo_destroy(cr);
+}
+
+void gtk_graph_trace_layer_free(GtkGraph *graph)
+{
+if (graph->layer != NULL)
+	cairo_surface_destroy(graph->layer);
+graph->layer = NULL;
+}
+
+/* Can the layer be scrolled rather than drawn from scratch?  Makes a new one if
+ * the size has changed */
+static gboolean gtk_graph_trace_layer_check(GtkGraph *graph)
+{
+GtkGraphTrace *t;
+gint n;
+gboolean ok = TRUE;
+
+if (graph->layer == NULL || cairo_image_surface_get_width(graph->layer) != user_width || cairo_image_surface_get_height(graph->layer) != user_height)
+	{
+	gtk_graph_trace_layer_free(graph);
+	graph->layer = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, user_width, user_height);
+	ok = FALSE;
+	}
+
+if (graph->dirty & GTK_GRAPH_DIRTY_FORMAT)
+	ok = FALSE;
+if (!SAME_SCALE(graph->layer_x_scale, graph->independant->scale_factor) || !SAME_SCALE(graph->layer_y_scale, graph->dependant->scale_factor))
+	ok = FALSE;
+if (graph->layer_y_min != graph->dependant->axis_min || graph->layer_y_max != graph->dependant->axis_max)
+	ok = FALSE;
+if (graph->independant->axis_min < graph->layer_x_min || (graph->independant->axis_min - graph->layer_x_min) * graph->independant->scale_factor >= user_width)
+	ok = FALSE;
+
+/* data that went backwards (or away) can't be patched up */
+for (n = 0 ; ok && n < graph->num_traces ; n++)
+	{
+	t = graph->traces[n];
+	if (t->first_point + t->num_points < t->layer_end || (t->layer_end > 0 && !gtk_graph_trace_layer_drawn(graph, t)))
+		ok = FALSE;
+	}
+
+graph->layer_x_scale = graph->independant->scale_factor;
+graph->layer_y_scale = graph->dependant->scale_factor;
+graph->layer_y_min = graph->dependant->axis_min;
+graph->layer_y_max = graph->dependant->axis_max;
+return ok;
+}
+
+/* Move everything on the layer shift pixels left, leaving the right hand strip clear */
+static void gtk_graph_trace_layer_scroll(GtkGraph *graph, gint shift)
+{
+guchar *data;
+gint stride, width, height, row;
+
+cairo_surface_flush(graph->layer);
+data = cairo_image_surface_get_data(graph->layer);
+stride = cairo_image_surface_get_stride(graph->layer);
+width = cairo_image_surface_get_width(graph->layer);
+height = cairo_image_surface_get_height(graph->layer);
+
+for (row = 0 ; row < height ; row++)
+	{
+	memmove(data + row * stride, data + row * stride + shift * 4, (width - shift) * 4);
+	memset(data + row * stride + (width - shift) * 4, 0, shift * 4);
+	}
+cairo_surface_mark_dirty(graph->layer);
+}
+
+/* Clear the layer from column from to the right hand edge and draw every trace
+ * there again.  Only the points in that strip are decimated and drawn */
+static void gtk_graph_trace_layer_draw(GtkGraph *graph, gint from)
+{
+gfloat scale = graph->independant->scale_factor;
+gfloat y_scale = graph->dependant->scale_factor;
+gfloat y_max = graph->dependant->axis_max;
+gfloat span_min = graph->layer_x_min + from / scale;
+gdouble dashes[4];
+GtkGraphTrace *t;
+gint n, i, j, k;
+cairo_t *cr;
+
+cr = cairo_create(graph->layer);
+cairo_rectangle(cr, from, 0, user_width - from, user_height);
+cairo_clip(cr);
+cairo_set_operator(cr, CAIRO_OPERATOR_CLEAR);
+cairo_paint(cr);
+cairo_set_operator(cr, CAIRO_OPERATOR_OVER);
+cairo_set_line_join(cr, CAIRO_LINE_JOIN_ROUND);
+
+for (n = 0 ; n < graph->num_traces ; n++)
+	{
+	t = graph->traces[n];
+	if (!gtk_graph_trace_layer_drawn(graph, t))
+		{
+		t->layer_end = 0;
+		continue;
+		}
+	t->layer_end = t->first_point + t->num_points;
+	if (!t->format->line_visible)
+		continue;
+
+	gtk_graph_trace_decimate_span(graph, t, span_min, graph->independant->axis_max);
+	if (t->num_decimated < 2)
+		continue;
+
+	cairo_set_source_rgb(cr, t->format->line_color.red / 65535.0, t->format->line_color.green / 65535.0, t->format->line_color.blue / 65535.0);
+	cairo_set_line_width(cr, MAX(t->format->line_width, 1));
+	for (k = 0 ; k < t->format->num_dashes ; k++)
+		dashes[k] = t->format->dash_list[k];
+	cairo_set_dash(cr, dashes, t->format->num_dashes, 0);
+
+	for (i = 0 ; i < t->num_decimated ; i++)
+		{
+		j = t->decimated[i];
+		if (i == 0)
+			cairo_move_to(cr, (GTK_GRAPH_TRACE_X(t, j) - graph->layer_x_min) * scale, (y_max - GTK_GRAPH_TRACE_Y(t, j)) * y_scale);
+		else
+			cairo_line_to(cr, (GTK_GRAPH_TRACE_X(t, j) - graph->layer_x_min) * scale, (y_max - GTK_GRAPH_TRACE_Y(t, j)) * y_scale);
+		}
+	cairo_stroke(cr);
+	}
+
+cairo_destroy(cr);
+}
+
+/* Is this trace one the layer looks after?  Markers are still drawn with GDK */
+static gboolean gtk_graph_trace_layer_drawn(GtkGraph *graph, GtkGraphTrace *t)
+{
+return t->x_chunks != NULL && t->y_chunks != NULL && t->num_points > 0 && t->format->marker_type == GTK_GRAPH_MARKER_NONE;
+}
@@ -0,0 +1,80 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include <gtk/gtk.h>
+
+#include "gtkgraph.h"
+
+// cost of updating one trace or annotation of a graph as the graph gets more
+// of them.  the ids are looked up in arrays so it should be flat, where
+// walking a list to the id made it grow with the count.  needs a display like
+// the graph does, nothing is shown and no redraw runs.  on an x86-64 Xeon at
+// -O2 an update costs 13-18 ns from 1 to 4096 traces or annotations, against
+// 16 ns at 1, 85 ns at 64 and 15 us at 4096 traces (6 us at 4096
+// annotations) with the lists
+
+#define BENCH_UPDATES 1000000  // updates timed at each size
+#define BENCH_MAX_TRACES 4096
+#define BENCH_POINTS 1024
+
+static double benchNow (void);
+static double benchGraph (int traceCount, int annotations);
+
+static gfloat xData[BENCH_POINTS];
+static gfloat yData[BENCH_POINTS];
+static gfloat* xChunks[1] = {xData};
+static gfloat* yChunks[1] = {yData};
+
+int main (int argc, char *argv[]) {
+	int traceCount;
+
+	gtk_init(&argc, &argv);
+
+	printf ("%8s %16s %16s\n", "traces", "ns per trace", "ns per annotation");
+	for (traceCount = 1; traceCount <= BENCH_MAX_TRACES; traceCount *= 4)
+		printf ("%8d %16.1f %16.1f\n", traceCount, benchGraph(traceCount, 0), benchGraph(traceCount, 1));
+	return 0;
+}
+
+// ns per update of the last id (the furthest down a list) and a random one,
+// alternately, on a graph with traceCount traces or annotations
+static double benchGraph (int traceCount, int annotations) {
+	GtkWidget* window = gtk_window_new(GTK_WINDOW_TOPLEVEL);
+	GtkGraph* graph = (GtkGraph*) gtk_graph_new(XY);
+	int i, id = 0;
+	double start, elapsed;
+
+	gtk_container_add(GTK_CONTAINER(window), GTK_WIDGET(graph));
+	gtk_widget_realize(GTK_WIDGET(graph));
+	for (i=0; i<traceCount; i++) {
+		if (annotations)
+			gtk_graph_annotation_new(graph);
+		else
+			gtk_graph_trace_new(graph);
+	}
+	// an unrealized graph makes nothing and every update would return straight away
+	if ((annotations ? graph->num_annotations : graph->num_traces) != traceCount) {
+		fprintf (stderr, "only made %d of %d\n", annotations ? graph->num_annotations : graph->num_traces, traceCount);
+		exit (1);
+	}
+	srand(traceCount);
+
+	start = benchNow();
+	for (i=0; i<BENCH_UPDATES; i++) {
+		id = (i & 1) ? rand() % traceCount : traceCount - 1;
+		if (annotations)
+			gtk_graph_annotation_set_data(graph, id, HORIZONTAL, i, NULL);
+		else
+			gtk_graph_trace_set_chunked_data(graph, id, xChunks, yChunks, 10, 0, BENCH_POINTS, 0, 1, -1, 1);
+	}
+	elapsed = benchNow() - start;
+
+	gtk_widget_destroy(window);
+	return elapsed * 1e9 / BENCH_UPDATES;
+}
+
+static double benchNow (void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec*1e-9;
+}
@@ -0,0 +1,121 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+
+#include "uart.h"
+#include "serialIngest.h"
+#include "telemetryBus.h"
+#include "packets.h"
+
+// owns the serial port and publishes every frame that comes in on the
+// telemetry bus (telemetryBus.h), so record, graph and anything else can all
+// follow the same flight at once with "bus" in place of the port
+
+#define INGEST_QUEUE_LENGTH 4096  // frames between the serial thread and the bus
+#define DRAIN_BATCH 256
+#define IDLE_US 1000              // how long to sleep when there's nothing waiting
+#define LINK_REPORT_SECONDS 5
+
+void terminate(int sig);
+
+volatile sig_atomic_t running = 1;
+
+int main (int argc, char *argv[]) {
+	static struct telemetrySample samples[DRAIN_BATCH];
+	struct serialIngest ingest;
+	struct telemetryBus bus;
+	struct linkMonitorStats stats;
+	serialIngestLink link = SERIAL_INGEST_RAW;
+	packetType packet = PACKET_FCU;
+	uint64_t published = 0;
+	uint32_t overruns = 0, n;
+	double nextReport = 0;
+	int uartfd, i;
+
+	if (argc < 2) {
+		printf ("Usage: ingestd <serial port device (ex /dev/ttyUSB0)> [imu | fcu | coded | mux [channel=Hz ...]]\n"
+			"what the other end sends, fcu frames if not given.  then ex: record bus flight.log, graph bus\n");
+		exit(-1);
+	}
+
+	if (argc > 2 && strcmp(argv[2], "imu") == 0)
+		packet = PACKET_IMU;
+	else if (argc > 2 && strcmp(argv[2], "coded") == 0)
+		link = SERIAL_INGEST_CODED;
+	else if (argc > 2 && strcmp(argv[2], "mux") == 0) {
+		link = SERIAL_INGEST_MUX;
+		packet = PACKET_TELEMETRY;
+	} else if (argc > 2 && strcmp(argv[2], "fcu") != 0) {
+		printf ("Expected imu, fcu, coded or mux, not %s\n", argv[2]);
+		exit(-1);
+	}
+
+	uartfd = initUART(argv[1]);
+	if (telemetryBusCreate (&bus, TELEMETRY_BUS_NAME, packet, packetLength(packet), TELEMETRY_BUS_SLOTS))
+		exit(-1);
+
+	if (serialIngestStart (&ingest, uartfd, packetLength(packet), FRAME_DECODER_CHECK_PARITY, link, INGEST_QUEUE_LENGTH)) {
+		telemetryBusDestroy (&bus);
+		exit(-1);
+	}
+
+	// channel=Hz asks the FCU for that channel at that rate from now on
+	for (i=3; link == SERIAL_INGEST_MUX && i<argc; i++) {
+		char command[64];
+		char* rate = strchr(argv[i], '=');
+		if (rate == NULL || rate == argv[i]) {
+			printf ("Expected channel=Hz, not %s\n", argv[i]);
+			continue;
+		}
+		snprintf (command, sizeof(command), "rate_%.*s %s", (int)(rate - argv[i]), argv[i], rate + 1);
+		serialIngestSend (&ingest, command);
+	}
+
+	printf ("publishing %s from %s on %s\n", packetTypeName(packet), argv[1], TELEMETRY_BUS_NAME);
+	fflush(stdout);
+
+	//Set up termination signal routine (when user hits Ctrl-c or SIGINT/SIGTERM is sent to this process)
+	signal(SIGINT, terminate);
+	signal(SIGTERM, terminate);
+
+	while (running) {
+		n = serialIngestDrain (&ingest, samples, DRAIN_BATCH);
+		if (n > 0) {
+			telemetryBusPublish (&bus, samples, n);
+			serialIngestLinkStats (&ingest, &stats);
+			telemetryBusPublishLink (&bus, &stats);
+			published += n;
+		}
+
+		if (ingest.queue.overruns != overruns) {
+			overruns = ingest.queue.overruns;
+			fprintf(stderr, "ingestd: fell behind the serial thread, %u frames dropped\n", overruns);
+		}
+		if (serialIngestNow() >= nextReport) {
+			serialIngestLinkStats (&ingest, &stats);
+			printf ("%llu frames published, link: %llu lost, %llu strays, jitter %.1f ms, latency %.1f ms\n",
+				(unsigned long long) published, (unsigned long long) stats.lost, (unsigned long long) stats.strays,
+				stats.jitter*1e3, stats.latency*1e3);
+			fflush(stdout);
+			nextReport = serialIngestNow() + LINK_REPORT_SECONDS;
+		}
+
+		if (n < DRAIN_BATCH)
+			usleep(IDLE_US);
+	}
+
+	serialIngestStop (&ingest);
+	serialIngestLinkStats (&ingest, &stats);
+	telemetryBusPublishLink (&bus, &stats);
+	telemetryBusDestroy (&bus);
+	printf ("%llu frames published\n", (unsigned long long) published);
+	linkMonitorPrint (&stats, stdout);
+	return 0;
+}
+
+//Callback for ctrl-c signal (SIGINT) and SIGTERM, main() tidies up
+void terminate(int sig) {
+	running = 0;
+}
@@ -10,84 +10,185 @@
 #include <string.h>
 #include <time.h>
 #include <inttypes.h>
+#include <stddef.h>
+#include <signal.h>
 
 #include "uart.h"
-
-#define RX_BUFFER_LENGTH 10000
-
-struct imu_rx_pkt_t
-{
-    volatile uint8_t start;
-    volatile uint8_t parity;
-    volatile int16_t roll;
-    volatile int16_t pitch_tmp;
-    volatile int16_t pitch;
-    volatile int16_t yaw;
-    volatile int16_t yaw_tmp;
-    volatile int16_t z_accel;
-    volatile int16_t x_accel;
-    volatile int16_t y_accel;
-};
+#include "frameDecoder.h"
+#include "flightLog.h"
+#include "packets.h"
+#include "telemetryBus.h"
 
 void terminate(int sig);
+void recordPacket (const uint8_t* frame, uint16_t length, void* userData);
+void logPacket (const uint8_t* frame, uint16_t length, void* userData);
+int recordBus (const char* path, int csv);
+
+#define BUS_BATCH 256
 
 float graphTime = 0;
 int uartfd; 
 FILE * file;
+struct frameDecoder decoder;
+struct flightLogWriter flightLog;
+double rxTime;
+volatile sig_atomic_t running = 1;
 
 int main (int argc, char *argv[]) {
 	
+	const char* extension;
+	int csv;
+
 	if (argc != 3) {
-		printf ("Usage: graph <serial port device (ex /dev/ttyUSB0)> <csv filename>\n");
+		printf ("Usage: record <serial port device (ex /dev/ttyUSB0) or bus, to share ingestd's> <filename, .csv for text otherwise a binary flight log>\n");
 		exit(-1);
 	} 
 
-	uartfd = initUART(argv[1]);
-	file = fopen(argv[2], "w");
-		
-	fprintf (file, "roll, ");
-	fprintf (file, "pitch, ");
-	fprintf (file, "yaw, ");
-	fprintf (file, "x accel, ");
-	fprintf (file, "y accel, ");
-	fprintf (file, "z accel\n");
-	
-	//Set up termination signal routine (when user hits Ctrl-c or SIGINT is sent to this process)
+	extension = strrchr(argv[2], '.');
+	csv = (extension != NULL && strcmp(extension, ".csv") == 0);
+
+	//Set up termination signal routine (when user hits Ctrl-c or SIGINT/SIGTERM is sent to this process)
 	signal(SIGINT, terminate);
+	signal(SIGTERM, terminate);
+
+	if (strcmp(argv[1], "bus") == 0)
+		return recordBus(argv[2], csv);
+
+	uartfd = initUART(argv[1]);
+
+	if (csv) {
+		file = fopen(argv[2], "w");
+		if (file == NULL) {
+			perror("fopen");
+			exit(-1);
+		}
+		frameDecoderInit (&decoder, IMU_PACKET_LENGTH, FRAME_DECODER_CHECK_PARITY, recordPacket, NULL);
+
+		fprintf (file, "roll, ");
+		fprintf (file, "pitch, ");
+		fprintf (file, "yaw, ");
+		fprintf (file, "x accel, ");
+		fprintf (file, "y accel, ");
+		fprintf (file, "z accel\n");
+	} else {
+		// every field of the packet goes into the log's header, so replay can find them by name
+		const struct flightLogField* fields;
+		int fieldCount;
+
+		fields = packetFields(PACKET_IMU, &fieldCount);
+		if (flightLogCreate(&flightLog, argv[2], packetTypeName(PACKET_IMU), IMU_PACKET_LENGTH, fields, fieldCount))
+			exit(-1);
+		frameDecoderInit (&decoder, IMU_PACKET_LENGTH, FRAME_DECODER_CHECK_PARITY, logPacket, NULL);
+	}
 		
-	unsigned char rxBuffer[RX_BUFFER_LENGTH];
-	int counter = 0;
-	while (1) {
-	
-		int bytesRead = read (uartfd, rxBuffer, RX_BUFFER_LENGTH-1);
-		int i;
-		for (i=0; i<bytesRead; i++) {
-			if (rxBuffer[i] == 0xAA) {
-				int j=0;
-				while (i<bytesRead) { // if 0xAA was found at index in rxBuffer other than 0, shift everything over so that 0xAA is at 0
-					rxBuffer[j] = rxBuffer[i];
-					j++;
-					i++;
-				}
-				while (j<18) {
-					int dataBytesRead = read (uartfd, rxBuffer+j, RX_BUFFER_LENGTH-j-1);
-					j += dataBytesRead;
-					usleep(100);
-				}
-				fprintf (file, "%d, ", ((struct imu_rx_pkt_t*)rxBuffer)->roll);
-				fprintf (file, "%d, ", ((struct imu_rx_pkt_t*)rxBuffer)->pitch);
-				fprintf (file, "%d, ", ((struct imu_rx_pkt_t*)rxBuffer)->yaw);
-				fprintf (file, "%d, ", ((struct imu_rx_pkt_t*)rxBuffer)->x_accel);
-				fprintf (file, "%d, ", ((struct imu_rx_pkt_t*)rxBuffer)->y_accel);
-				fprintf (file, "%d\n", ((struct imu_rx_pkt_t*)rxBuffer)->z_accel);
+	while (running) {
+		int frames;
+
+		// every frame that comes out of this read gets the same receive time
+		rxTime = flightLogNow();
+		frames = frameDecoderRead (&decoder, uartfd);
+		if (frames < 0) {
+			perror("read");
+			break;
+		}
+		if (frames == 0) {
+			if (!csv && flightLogIdle(&flightLog, rxTime))
+				break;
+			usleep(1000); // nothing waiting - don't spin on the non-blocking fd
+		}
+	}
+
+	// the log is closed here rather than in the signal handler so the index gets written safely
+	if (csv)
+		fclose(file);
+	else
+		flightLogClose(&flightLog);
+	printf ("%u frames recorded, %u corrupt, %u bytes dropped\n", decoder.stats.framesDecoded, decoder.stats.framesCorrupt, decoder.stats.bytesDropped);
+	return 0;
+}
+
+void recordPacket (const uint8_t* frame, uint16_t length, void* userData) {
+	fprintf (file, "%d, %d, %d, %d, %d, %d\n", IMU_PACKET_GET(frame, roll), IMU_PACKET_GET(frame, pitch), IMU_PACKET_GET(frame, yaw),
+		IMU_PACKET_GET(frame, x_accel), IMU_PACKET_GET(frame, y_accel), IMU_PACKET_GET(frame, z_accel));
+}
+
+void logPacket (const uint8_t* frame, uint16_t length, void* userData) {
+	if (flightLogAppend(&flightLog, rxTime, frame))
+		running = 0;
+}
+
+// follows ingestd's bus instead of opening the port, whatever it publishes
+// goes in the log.  the frames come with ingestd's receive times
+int recordBus (const char* path, int csv) {
+	static struct telemetrySample samples[BUS_BATCH];
+	struct telemetryBusReader bus;
+	const struct flightLogField* fields;
+	packetType packet;
+	uint64_t recorded = 0;
+	uint32_t overruns = 0, n, i;
+	int fieldCount;
+
+	if (telemetryBusAttach(&bus, TELEMETRY_BUS_NAME))
+		return -1;
+	packet = bus.header->packet;
+
+	if (csv) {
+		if (packet != PACKET_IMU) {
+			printf ("the bus carries %s, only IMU frames go in a .csv\n", packetTypeName(packet));
+			telemetryBusDetach(&bus);
+			return -1;
+		}
+		file = fopen(path, "w");
+		if (file == NULL) {
+			perror("fopen");
+			telemetryBusDetach(&bus);
+			return -1;
+		}
+		fprintf (file, "roll, pitch, yaw, x accel, y accel, z accel\n");
+	} else {
+		fields = packetFields(packet, &fieldCount);
+		if (flightLogCreate(&flightLog, path, packetTypeName(packet), packetLength(packet), fields, fieldCount)) {
+			telemetryBusDetach(&bus);
+			return -1;
+		}
+	}
+
+	while (running) {
+		n = telemetryBusRead(&bus, samples, BUS_BATCH);
+		for (i=0; i<n; i++) {
+			rxTime = samples[i].rxTime;
+			if (csv)
+				recordPacket(samples[i].frame, samples[i].length, NULL);
+			else
+				logPacket(samples[i].frame, samples[i].length, NULL);
+		}
+		recorded += n;
+
+		if (bus.overruns != overruns) {
+			overruns = bus.overruns;
+			fprintf(stderr, "record: fell behind the bus, %llu frames lost\n", (unsigned long long) bus.lost);
+		}
+		if (n == 0) {
+			if (!telemetryBusAlive(&bus)) {
+				printf ("ingestd stopped\n");
 				break;
 			}
+			if (!csv && flightLogIdle(&flightLog, flightLogNow()))
+				break;
+			usleep(1000);
 		}
 	}
+
+	if (csv)
+		fclose(file);
+	else
+		flightLogClose(&flightLog);
+	printf ("%llu frames recorded, %llu lost off the bus\n", (unsigned long long) recorded, (unsigned long long) bus.lost);
+	telemetryBusDetach(&bus);
+	return 0;
 }
 
-//Callback for ctrl-c signal (SIGINT)
+//Callback for ctrl-c signal (SIGINT) and SIGTERM, main() tidies up
 void terminate(int sig) {
-	fclose(file);
-	exit(0);
+	running = 0;
 }
@@ -0,0 +1,354 @@
+#define _GNU_SOURCE // accept4
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "telemetryBus.h"
+#include "relay.h"
+#include "flightLog.h"
+
+// serves what's on the telemetry bus to any number of clients over TCP
+// (relay.h has the protocol).  one thread, everything non-blocking under
+// epoll: each client's samples queue in its own buffer and go when its socket
+// will take them, a client whose buffer is full has samples dropped and is
+// told, so one on a bad wifi link never holds up the bus or anyone else.
+
+#define RELAY_MAX_CLIENTS 64
+#define RELAY_CLIENT_BUFFER (256*1024)   // bytes queued for a client before its samples are dropped
+#define RELAY_BATCH_MS 10                // how often the bus is read and what's new goes out
+#define RELAY_READ_BATCH 1024
+
+struct relayPeer {
+	int fd;
+	uint64_t mask;
+	uint16_t decimation;       // 0 until it subscribes
+	uint32_t skip;             // samples until the next one it gets
+	uint32_t dropped;          // since its last RELAY_SAMPLES
+	uint64_t droppedTotal;
+	int writing;               // EPOLLOUT is on, its socket was full
+	uint32_t inLength;
+	uint8_t in[RELAY_HEADER_LENGTH + RELAY_SUBSCRIBE_LENGTH];
+	uint32_t outStart, outEnd;
+	uint8_t* out;
+};
+
+static int relayListen (int port);
+static void relayAccept (int listenfd);
+static void relayReceive (struct relayPeer* peer);
+static void relaySend (struct relayPeer* peer);
+static void relayQueue (struct relayPeer* peer, const struct telemetrySample* samples, uint32_t n);
+static int relayAppend (struct relayPeer* peer, const uint8_t* data, uint32_t length);
+static void relayDrop (struct relayPeer* peer);
+
+void terminate(int sig);
+
+volatile sig_atomic_t running = 1;
+struct telemetryBusReader bus;
+const struct flightLogField* fields;
+int fieldCount;
+int epollfd;
+struct relayPeer peers[RELAY_MAX_CLIENTS];
+
+int main (int argc, char *argv[]) {
+	static struct telemetrySample samples[RELAY_READ_BATCH];
+	struct epoll_event events[RELAY_MAX_CLIENTS + 1], event;
+	int port = RELAY_DEFAULT_PORT, listenfd, ready, i, p;
+	uint32_t n;
+
+	if (argc > 2 || (argc == 2 && atoi(argv[1]) <= 0)) {
+		printf ("Usage: relayd [port, %d if not given]\n"
+			"serves what ingestd is publishing.  then ex: graph relay groundstation:%d\n", RELAY_DEFAULT_PORT, RELAY_DEFAULT_PORT);
+		exit(-1);
+	}
+	if (argc == 2)
+		port = atoi(argv[1]);
+
+	if (telemetryBusAttach (&bus, TELEMETRY_BUS_NAME))
+		exit(-1);
+	fields = packetFields(bus.header->packet, &fieldCount);
+
+	listenfd = relayListen(port);
+	if (listenfd < 0)
+		exit(-1);
+	epollfd = epoll_create1(0);
+	if (epollfd < 0) {
+		perror("\n***** RELAY ERROR: epoll_create1 failed\n\n");
+		exit(-1);
+	}
+	event.events = EPOLLIN;
+	event.data.ptr = NULL; // the listening socket, clients are their relayPeer
+	epoll_ctl(epollfd, EPOLL_CTL_ADD, listenfd, &event);
+	for (p=0; p<RELAY_MAX_CLIENTS; p++)
+		peers[p].fd = -1;
+
+	printf ("relaying %s on port %d\n", packetTypeName(bus.header->packet), port);
+	fflush(stdout);
+
+	//Set up termination signal routine (when user hits Ctrl-c or SIGINT/SIGTERM is sent to this process)
+	signal(SIGINT, terminate);
+	signal(SIGTERM, terminate);
+	signal(SIGPIPE, SIG_IGN); // a client gone mid write is an EPIPE, not the end of us
+
+	while (running) {
+		ready = epoll_wait(epollfd, events, RELAY_MAX_CLIENTS + 1, RELAY_BATCH_MS);
+		if (ready < 0 && errno != EINTR) {
+			perror("\n***** RELAY ERROR: epoll_wait failed\n\n");
+			break;
+		}
+		for (i=0; i<ready; i++) {
+			struct relayPeer* peer = events[i].data.ptr;
+			if (peer == NULL) {
+				relayAccept(listenfd);
+				continue;
+			}
+			if (peer->fd < 0)
+				continue; // dropped earlier in this batch
+			if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+				relayDrop(peer);
+				continue;
+			}
+			if (events[i].events & EPOLLIN)
+				relayReceive(peer);
+			if (peer->fd >= 0 && (events[i].events & EPOLLOUT))
+				relaySend(peer);
+		}
+
+		// everything new on the bus, one message per client per batch
+		while ((n = telemetryBusRead(&bus, samples, RELAY_READ_BATCH)) > 0) {
+			for (p=0; p<RELAY_MAX_CLIENTS; p++)
+				if (peers[p].fd >= 0 && peers[p].decimation > 0)
+					relayQueue(&peers[p], samples, n);
+			if (n < RELAY_READ_BATCH)
+				break;
+		}
+		for (p=0; p<RELAY_MAX_CLIENTS; p++)
+			if (peers[p].fd >= 0 && !peers[p].writing && peers[p].outEnd > peers[p].outStart)
+				relaySend(&peers[p]);
+
+		if (!telemetryBusAlive(&bus)) {
+			printf ("ingestd stopped\n");
+			break;
+		}
+	}
+
+	for (p=0; p<RELAY_MAX_CLIENTS; p++)
+		if (peers[p].fd >= 0)
+			relayDrop(&peers[p]);
+	close(listenfd);
+	close(epollfd);
+	if (bus.lost > 0)
+		printf ("fell behind the bus, %llu frames lost\n", (unsigned long long) bus.lost);
+	telemetryBusDetach(&bus);
+	return 0;
+}
+
+static int relayListen (int port) {
+	struct sockaddr_in address;
+	int fd, one = 1;
+
+	fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+	if (fd < 0) {
+		perror("\n***** RELAY ERROR: socket failed\n\n");
+		return -1;
+	}
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_ANY);
+	address.sin_port = htons(port);
+	if (bind(fd, (struct sockaddr*) &address, sizeof(address)) || listen(fd, 16)) {
+		perror("\n***** RELAY ERROR: bind/listen failed\n\n");
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+// everyone waiting to connect, each gets a hello straight away
+static void relayAccept (int listenfd) {
+	uint8_t hello[RELAY_HEADER_LENGTH + RELAY_HELLO_LENGTH] = {RELAY_HELLO, 0, RELAY_HELLO_LENGTH, 0};
+	uint32_t magic = RELAY_MAGIC;
+	uint16_t version = RELAY_VERSION, frameLength = bus.header->frameLength;
+	struct epoll_event event;
+	int fd, p, one = 1;
+
+	memcpy(hello + 4, &magic, 4);
+	memcpy(hello + 8, &version, 2);
+	hello[10] = bus.header->packet;
+	hello[11] = fieldCount;
+	memcpy(hello + 12, &frameLength, 2);
+	strncpy((char*) hello + 14, packetTypeName(bus.header->packet), RELAY_NAME_LENGTH);
+
+	while ((fd = accept4(listenfd, NULL, NULL, SOCK_NONBLOCK)) >= 0) {
+		for (p=0; p<RELAY_MAX_CLIENTS && peers[p].fd >= 0; p++)
+			;
+		if (p == RELAY_MAX_CLIENTS) {
+			fprintf(stderr, "relayd: %d clients already, turning one away\n", RELAY_MAX_CLIENTS);
+			close(fd);
+			continue;
+		}
+		memset(&peers[p], 0, sizeof(struct relayPeer));
+		peers[p].out = malloc(RELAY_CLIENT_BUFFER);
+		if (peers[p].out == NULL) {
+			perror("\n***** RELAY ERROR: malloc failed\n\n");
+			close(fd);
+			continue;
+		}
+		peers[p].fd = fd;
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+		event.events = EPOLLIN;
+		event.data.ptr = &peers[p];
+		epoll_ctl(epollfd, EPOLL_CTL_ADD, fd, &event);
+		relayAppend(&peers[p], hello, sizeof(hello));
+		relaySend(&peers[p]);
+		printf ("client %d connected\n", p);
+		fflush(stdout);
+	}
+}
+
+// subscriptions are all a client ever sends
+static void relayReceive (struct relayPeer* peer) {
+	uint64_t mask;
+	ssize_t got;
+
+	for (;;) {
+		got = read(peer->fd, peer->in + peer->inLength, sizeof(peer->in) - peer->inLength);
+		if (got == 0 || (got < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+			relayDrop(peer);
+			return;
+		}
+		if (got < 0)
+			return;
+		peer->inLength += got;
+		if (peer->inLength < sizeof(peer->in))
+			continue;
+
+		if (peer->in[0] != RELAY_SUBSCRIBE || peer->in[2] != RELAY_SUBSCRIBE_LENGTH || peer->in[3] != 0) {
+			fprintf(stderr, "relayd: client %d isn't speaking the protocol, dropping it\n", (int)(peer - peers));
+			relayDrop(peer);
+			return;
+		}
+		memcpy(&mask, peer->in + 4, 8);
+		memcpy(&peer->decimation, peer->in + 12, 2);
+		if (fieldCount < RELAY_MAX_FIELDS)
+			mask &= ((uint64_t) 1 << fieldCount) - 1;
+		peer->mask = mask;
+		peer->skip = 0;
+		peer->inLength = 0;
+	}
+}
+
+// as much of its buffer as its socket will take.  the rest waits for EPOLLOUT
+static void relaySend (struct relayPeer* peer) {
+	struct epoll_event event;
+	ssize_t sent;
+	int writing;
+
+	while (peer->outEnd > peer->outStart) {
+		sent = send(peer->fd, peer->out + peer->outStart, peer->outEnd - peer->outStart, MSG_NOSIGNAL);
+		if (sent < 0) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				break;
+			if (errno == EINTR)
+				continue;
+			relayDrop(peer);
+			return;
+		}
+		peer->outStart += sent;
+	}
+	if (peer->outStart == peer->outEnd)
+		peer->outStart = peer->outEnd = 0;
+
+	writing = (peer->outEnd > peer->outStart);
+	if (writing != peer->writing) {
+		event.events = EPOLLIN | (writing ? EPOLLOUT : 0);
+		event.data.ptr = peer;
+		epoll_ctl(epollfd, EPOLL_CTL_MOD, peer->fd, &event);
+		peer->writing = writing;
+	}
+}
+
+// the samples this client wants out of a batch, in messages of up to
+// RELAY_MAX_BATCH.  a message that won't fit in its buffer is dropped whole
+static void relayQueue (struct relayPeer* peer, const struct telemetrySample* samples, uint32_t n) {
+	static uint8_t message[RELAY_MAX_MESSAGE];
+	uint32_t i, length = 0;
+	uint16_t count = 0, payload;
+	int f;
+
+	for (i=0; i<=n; i++) {
+		if (count > 0 && (i == n || count == RELAY_MAX_BATCH)) {
+			payload = length - RELAY_HEADER_LENGTH;
+			message[0] = RELAY_SAMPLES;
+			message[1] = 0;
+			memcpy(message + 2, &payload, 2);
+			memcpy(message + 4, &peer->mask, 8);
+			memcpy(message + 12, &peer->dropped, 4);
+			memcpy(message + 16, &count, 2);
+			if (relayAppend(peer, message, length) == 0)
+				peer->dropped = 0;
+			else {
+				peer->dropped += count;
+				peer->droppedTotal += count;
+			}
+			count = 0;
+		}
+		if (i == n)
+			break;
+
+		if (peer->skip > 0) {
+			peer->skip--;
+			continue;
+		}
+		peer->skip = peer->decimation - 1;
+
+		if (count == 0)
+			length = RELAY_HEADER_LENGTH + RELAY_SAMPLES_LENGTH;
+		memcpy(message + length, &samples[i].sampleTime, 8);
+		length += 8;
+		for (f=0; f<fieldCount && f<RELAY_MAX_FIELDS; f++) {
+			if (peer->mask & ((uint64_t) 1 << f)) {
+				memcpy(message + length, samples[i].frame + fields[f].offset, 2);
+				length += 2;
+			}
+		}
+		count++;
+	}
+}
+
+// 0 if it fit
+static int relayAppend (struct relayPeer* peer, const uint8_t* data, uint32_t length) {
+	if (peer->outEnd + length > RELAY_CLIENT_BUFFER && peer->outStart > 0) {
+		memmove(peer->out, peer->out + peer->outStart, peer->outEnd - peer->outStart);
+		peer->outEnd -= peer->outStart;
+		peer->outStart = 0;
+	}
+	if (peer->outEnd + length > RELAY_CLIENT_BUFFER)
+		return -1;
+	memcpy(peer->out + peer->outEnd, data, length);
+	peer->outEnd += length;
+	return 0;
+}
+
+static void relayDrop (struct relayPeer* peer) {
+	printf ("client %d gone, %llu samples dropped while it couldn't keep up\n", (int)(peer - peers), (unsigned long long) peer->droppedTotal);
+	fflush(stdout);
+	epoll_ctl(epollfd, EPOLL_CTL_DEL, peer->fd, NULL);
+	close(peer->fd);
+	free(peer->out);
+	peer->fd = -1;
+}
+
+//Callback for ctrl-c signal (SIGINT) and SIGTERM, main() tidies up
+void terminate(int sig) {
+	running = 0;
+}
@@ -0,0 +1,115 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "relay.h"
+#include "flightLog.h"
+
+// a relay client that counts rather than plots: what it asked for, what came
+// and what the relay had to drop.  run a few at once to load a relay, or with
+// -p to see the values
+
+#define TAP_BATCH 1024
+#define TAP_IDLE_US 1000
+#define TAP_REPORT_SECONDS 1
+
+void terminate(int sig);
+static double tapNow (void);
+
+volatile sig_atomic_t running = 1;
+
+int main (int argc, char *argv[]) {
+	static struct telemetrySample samples[TAP_BATCH];
+	struct relayClient client;
+	uint64_t mask = 0, lastSamples = 0, lastBytes = 0;
+	int decimation = 1, print = 0, option, i, f;
+	double seconds = 0, start, nextReport;
+	const struct flightLogField* fields;
+	int fieldCount;
+	uint32_t n;
+
+	while ((option = getopt(argc, argv, "d:t:p")) != -1) {
+		if (option == 'd')
+			decimation = atoi(optarg);
+		else if (option == 't')
+			seconds = atof(optarg);
+		else if (option == 'p')
+			print = 1;
+		else
+			optind = argc + 1;
+	}
+	if (optind >= argc || decimation <= 0 || decimation > 65535) {
+		printf ("Usage: relaytap [options] <host[:port]> [field or channel ...], every field if none\n"
+			"  -d n          every nth sample (1)\n"
+			"  -t seconds    stop after this long (run until ctrl-c)\n"
+			"  -p            print the samples\n"
+			"ex: relaytap -d 10 localhost gyro attitude\n");
+		exit(-1);
+	}
+
+	if (relayClientConnect(&client, argv[optind]))
+		exit(-1);
+	fields = packetFields(client.packet, &fieldCount);
+	for (i=optind+1; i<argc; i++) {
+		uint64_t field = relayFieldMask(client.packet, argv[i]);
+		if (field == 0)
+			printf ("%s has no field or channel %s\n", packetTypeName(client.packet), argv[i]);
+		mask |= field;
+	}
+	if (optind + 1 == argc)
+		mask = ~(uint64_t) 0;
+	if (relayClientSubscribe(&client, mask, decimation))
+		exit(-1);
+	printf ("%s from %s, %d fields, every %d\n", packetTypeName(client.packet), argv[optind],
+		relayMaskCount(mask & (fieldCount < RELAY_MAX_FIELDS ? ((uint64_t) 1 << fieldCount) - 1 : ~(uint64_t) 0)), decimation);
+
+	//Set up termination signal routine (when user hits Ctrl-c or SIGINT/SIGTERM is sent to this process)
+	signal(SIGINT, terminate);
+	signal(SIGTERM, terminate);
+
+	start = tapNow();
+	nextReport = start + TAP_REPORT_SECONDS;
+	while (running && client.connected && (seconds <= 0 || tapNow() - start < seconds)) {
+		n = relayClientRead(&client, samples, TAP_BATCH);
+		for (i=0; print && i<(int)n; i++) {
+			printf ("%10.3f", samples[i].sampleTime);
+			for (f=0; f<fieldCount && f<RELAY_MAX_FIELDS; f++)
+				if (mask & ((uint64_t) 1 << f))
+					printf (" %6d", packetGetInt16(samples[i].frame + fields[f].offset));
+			printf ("\n");
+		}
+		if (!print && tapNow() >= nextReport) {
+			printf ("%llu samples a second, %llu bytes a second, %llu dropped by the relay\n",
+				(unsigned long long)(client.samples - lastSamples)/TAP_REPORT_SECONDS,
+				(unsigned long long)(client.bytes - lastBytes)/TAP_REPORT_SECONDS, (unsigned long long) client.dropped);
+			fflush(stdout);
+			lastSamples = client.samples;
+			lastBytes = client.bytes;
+			nextReport += TAP_REPORT_SECONDS;
+		}
+		if (n == 0)
+			usleep(TAP_IDLE_US);
+	}
+
+	if (!client.connected)
+		printf ("relay went away\n");
+	printf ("%llu samples in %.1f seconds, %llu bytes, %llu dropped by the relay\n", (unsigned long long) client.samples,
+		tapNow() - start, (unsigned long long) client.bytes, (unsigned long long) client.dropped);
+	relayClientClose(&client);
+	return 0;
+}
+
+static double tapNow (void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec*1e-9;
+}
+
+//Callback for ctrl-c signal (SIGINT) and SIGTERM, main() tidies up
+void terminate(int sig) {
+	running = 0;
+}